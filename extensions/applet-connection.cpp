@@ -4,6 +4,7 @@
 #include <memory>
 
 #include "ext-utils.h"
+#include "ext-protocol.h"
 #include "log.h"
 
 #include "applet-connection.h"
@@ -12,18 +13,48 @@ namespace {
 
 const char *kSeafExtPipeName = "\\\\.\\pipe\\seadrive_ext_pipe_";
 
-struct ThreadData {
+// The commands are triggered by the user clicking the menu, so the queue
+// would only be full when seadrive gui stops responding.
+const size_t kMaxQueuedCommands = 64;
+
+struct ReaderData {
     seafile::AppletConnection *conn;
-    std::string cmd;
+    HANDLE pipe;
+    uint64_t conn_id;
 };
 
-DWORD WINAPI sendDataWrapper (void *vdata)
+bool readFrame(HANDLE pipe, std::string *out, DWORD timeout_msecs)
 {
-    ThreadData *tdata = (ThreadData *)vdata;
-    bool ret = tdata->conn->sendCommandAndWait(tdata->cmd, NULL);
-    delete tdata;
-    ExitThread(ret);
-    return 0;
+    // The timeout is for seadrive gui to prepare the response, so it only
+    // applies to the first read.
+    uint32_t len = 0;
+    if (!seafile::utils::pipeReadNTimeout(pipe, &len, sizeof(len), timeout_msecs)) {
+        return false;
+    }
+
+    // avoid integer overflow
+    if (len == UINT32_MAX) {
+        return false;
+    }
+
+    if (len == 0) {
+        if (out != NULL) {
+            out->clear();
+        }
+        return true;
+    }
+
+    std::unique_ptr<char[]> buf(new char[len + 1]);
+    buf.get()[len] = 0;
+    if (!seafile::utils::pipeReadN(pipe, buf.get(), len)) {
+        return false;
+    }
+
+    if (out != NULL) {
+        out->assign(buf.get(), len);
+    }
+
+    return true;
 }
 
 } // namespace
@@ -33,7 +64,12 @@ namespace seafile {
 AppletConnection::AppletConnection()
     : connected_(false),
       pipe_(INVALID_HANDLE_VALUE),
-      last_conn_failure_(0)
+      last_conn_failure_(0),
+      protocol_version_(1),
+      conn_id_(0),
+      next_request_id_(1),
+      queue_event_(NULL),
+      sender_started_(false)
 {
 }
 
@@ -53,7 +89,7 @@ bool
 AppletConnection::connect ()
 {
     if (pipe_ != INVALID_HANDLE_VALUE) {
-        CloseHandle (pipe_);
+        onPipeError();
     }
 
     pipe_ = CreateFile(
@@ -84,6 +120,44 @@ AppletConnection::connect ()
     }
 
     connected_ = true;
+    conn_id_++;
+    protocol_version_ = 1;
+
+    if (!negotiateVersion()) {
+        last_conn_failure_ = utils::currentMSecsSinceEpoch();
+        return false;
+    }
+    return true;
+}
+
+bool AppletConnection::negotiateVersion()
+{
+    if (!writeRequest(protocol::formatHello(), NULL)) {
+        return false;
+    }
+
+    std::string resp;
+    if (!readResponse(&resp, utils::kPipeWaitTimeMSec)) {
+        return false;
+    }
+
+    protocol_version_ = protocol::parseHelloResponse(resp);
+    if (protocol_version_ < 2) {
+        return true;
+    }
+
+    // From now on the reader thread owns the pipe handle, and closes it when
+    // the connection is broken.
+    ReaderData *data = new ReaderData;
+    data->conn = this;
+    data->pipe = pipe_;
+    data->conn_id = conn_id_;
+    if (!utils::doInThread((LPTHREAD_START_ROUTINE)readResponsesThread, (void *)data)) {
+        delete data;
+        protocol_version_ = 1;
+        onPipeError();
+        return false;
+    }
     return true;
 }
 
@@ -105,105 +179,286 @@ AppletConnection::prepare()
 
 bool AppletConnection::sendCommand(const std::string& cmd)
 {
-    ThreadData *tdata = new ThreadData;
-    tdata->conn = this;
-    tdata->cmd = cmd;
-    utils::doInThread((LPTHREAD_START_ROUTINE)sendDataWrapper, (void *)tdata);
+    utils::MutexLocker lock(&queue_mutex_);
+    if (!sender_started_) {
+        // auto reset event
+        queue_event_ = CreateEvent(NULL, FALSE, FALSE, NULL);
+        if (!queue_event_) {
+            seaf_ext_log("failed to create event: %s", utils::formatErrorMessage().c_str());
+            return false;
+        }
+        if (!utils::doInThread((LPTHREAD_START_ROUTINE)sendQueuedCommandsThread, (void *)this)) {
+            CloseHandle(queue_event_);
+            queue_event_ = NULL;
+            return false;
+        }
+        sender_started_ = true;
+    }
+
+    // e.g. the user clicks "get share link" again before the first one is
+    // sent.
+    for (size_t i = 0; i < queue_.size(); i++) {
+        if (queue_[i] == cmd) {
+            return true;
+        }
+    }
+
+    if (queue_.size() >= kMaxQueuedCommands) {
+        seaf_ext_log("too many commands queued, dropping %s", cmd.c_str());
+        return false;
+    }
+
+    queue_.push_back(cmd);
+    SetEvent(queue_event_);
     return true;
 }
 
-bool AppletConnection::sendCommandAndWait(const std::string& cmd, std::string *resp)
+DWORD WINAPI AppletConnection::sendQueuedCommandsThread(void *vdata)
 {
-    utils::MutexLocker lock(&mutex_);
-    if (!sendWithReconnect(cmd)) {
-        return false;
+    AppletConnection *conn = (AppletConnection *)vdata;
+    conn->sendQueuedCommands();
+    return 0;
+}
+
+void AppletConnection::sendQueuedCommands()
+{
+    while (1) {
+        WaitForSingleObject(queue_event_, INFINITE);
+
+        while (1) {
+            std::string cmd;
+            {
+                utils::MutexLocker lock(&queue_mutex_);
+                if (queue_.empty()) {
+                    break;
+                }
+                // Keep the command in the queue until it's sent, so the same
+                // command queued meanwhile is still coalesced with it.
+                cmd = queue_.front();
+            }
+
+            sendCommandAndWait(cmd, NULL);
+
+            utils::MutexLocker lock(&queue_mutex_);
+            queue_.pop_front();
+        }
     }
+}
 
-    std::string r;
-    if (!readResponse(&r)) {
-        return false;
+bool AppletConnection::sendCommandAndWait(const std::string& cmd,
+                                          std::string *resp,
+                                          DWORD timeout_msecs)
+{
+    PendingRequest req;
+    req.event = NULL;
+    req.id = 0;
+    req.conn_id = 0;
+    req.done = false;
+
+    bool ret = false;
+    bool pipelined = false;
+    {
+        utils::MutexLocker lock(&mutex_);
+        if (sendWithReconnect(cmd, &req)) {
+            if (protocol_version_ >= 2) {
+                pipelined = true;
+            } else {
+                std::string r;
+                ret = readResponse(&r, timeout_msecs);
+                if (ret && resp != NULL) {
+                    *resp = r;
+                }
+            }
+        }
     }
 
-    if (resp != NULL) {
-        *resp = r;
+    // In version 2 other threads can send their requests while we are
+    // waiting for the response.
+    if (pipelined) {
+        ret = waitForResponse(&req, resp, timeout_msecs);
     }
 
-    return true;
+    if (req.event) {
+        CloseHandle(req.event);
+    }
+    return ret;
 }
 
 void AppletConnection::onPipeError()
 {
-    CloseHandle(pipe_);
+    if (protocol_version_ >= 2) {
+        // The reader thread owns the pipe. Cancel its pending read so it
+        // would find out the connection is gone and close the pipe.
+        CancelIoEx(pipe_, NULL);
+    } else {
+        CloseHandle(pipe_);
+    }
     pipe_ = INVALID_HANDLE_VALUE;
     connected_ = false;
 }
 
-bool AppletConnection::writeRequest(const std::string& cmd)
+bool AppletConnection::writeRequest(const std::string& cmd, PendingRequest *req)
 {
-    uint32_t len = cmd.size();
-    if (!utils::pipeWriteN(pipe_, &len, sizeof(len))) {
-        onPipeError();
-        seaf_ext_log("failed to send command: %s", utils::formatErrorMessage().c_str());
-        return false;
+    std::string data;
+    bool pipelined = protocol_version_ >= 2 && req != NULL;
+    if (pipelined) {
+        if (!req->event) {
+            req->event = CreateEvent(NULL, TRUE, FALSE, NULL);
+            if (!req->event) {
+                seaf_ext_log("failed to create event: %s", utils::formatErrorMessage().c_str());
+                return false;
+            }
+        }
+
+        // Register the request before writing it, since the response may
+        // arrive before WriteFile returns.
+        utils::MutexLocker lock(&pending_mutex_);
+        req->id = next_request_id_++;
+        req->conn_id = conn_id_;
+        req->done = false;
+        pending_[req->id] = req;
+        data = protocol::formatTaggedMessage(req->id, cmd);
     }
+    const std::string& body = pipelined ? data : cmd;
 
-    if (!utils::pipeWriteN(pipe_, cmd.c_str(), len)) {
-        onPipeError();
+    uint32_t len = body.size();
+    if (!utils::pipeWriteN(pipe_, &len, sizeof(len))
+        || !utils::pipeWriteN(pipe_, body.c_str(), len)) {
         seaf_ext_log("failed to send command: %s", utils::formatErrorMessage().c_str());
+        if (pipelined) {
+            removePendingRequest(req);
+        }
+        onPipeError();
         return false;
     }
     return true;
 }
 
-bool AppletConnection::readResponse(std::string *out)
+bool AppletConnection::readResponse(std::string *out, DWORD timeout_msecs)
 {
-    uint32_t len = 0;
-    if (!utils::pipeReadN(pipe_, &len, sizeof(len))) {
+    if (!readFrame(pipe_, out, timeout_msecs)) {
         onPipeError();
         return false;
     }
+    return true;
+}
 
-    // avoid integer overflow
-    if (len == UINT32_MAX) {
+bool AppletConnection::waitForResponse(PendingRequest *req,
+                                       std::string *resp,
+                                       DWORD timeout_msecs)
+{
+    DWORD result = WaitForSingleObject(req->event, timeout_msecs);
+
+    // After this the reader thread won't touch the request any more.
+    removePendingRequest(req);
+
+    if (!req->done) {
+        if (result == WAIT_TIMEOUT) {
+            seaf_ext_log("timeout when waiting for the response of request %u",
+                         (unsigned)req->id);
+        }
         return false;
     }
 
-    if (len == 0) {
-        return true;
+    if (resp != NULL) {
+        *resp = req->resp;
     }
+    return true;
+}
 
-    std::unique_ptr<char[]> buf(new char[len + 1]);
-    buf.get()[len] = 0;
-    if (!utils::pipeReadN(pipe_, buf.get(), len)) {
-        onPipeError();
-        return false;
+void AppletConnection::removePendingRequest(PendingRequest *req)
+{
+    utils::MutexLocker lock(&pending_mutex_);
+    std::map<uint32_t, PendingRequest *>::iterator it = pending_.find(req->id);
+    if (it != pending_.end() && it->second == req) {
+        pending_.erase(it);
     }
+}
 
-    if (out != NULL) {
-        *out = buf.get();
+DWORD WINAPI AppletConnection::readResponsesThread(void *vdata)
+{
+    ReaderData *data = (ReaderData *)vdata;
+    data->conn->readResponses(data->pipe, data->conn_id);
+    delete data;
+    return 0;
+}
+
+void AppletConnection::readResponses(HANDLE pipe, uint64_t conn_id)
+{
+    while (1) {
+        {
+            utils::MutexLocker lock(&mutex_);
+            if (!connected_ || conn_id_ != conn_id) {
+                break;
+            }
+        }
+
+        std::string frame;
+        if (!readFrame(pipe, &frame, INFINITE)) {
+            utils::MutexLocker lock(&mutex_);
+            if (connected_ && conn_id_ == conn_id) {
+                seaf_ext_log("connection to seadrive gui is broken");
+                onPipeError();
+            }
+            break;
+        }
+
+        uint32_t id;
+        std::string body;
+        if (!protocol::parseTaggedMessage(frame, &id, &body)) {
+            seaf_ext_log("got a response without request id");
+            continue;
+        }
+
+        utils::MutexLocker lock(&pending_mutex_);
+        std::map<uint32_t, PendingRequest *>::iterator it = pending_.find(id);
+        if (it == pending_.end()) {
+            // The request has timed out.
+            continue;
+        }
+        PendingRequest *req = it->second;
+        req->resp.swap(body);
+        req->done = true;
+        pending_.erase(it);
+        SetEvent(req->event);
     }
 
-    return true;
+    CloseHandle(pipe);
+    failPendingRequests(conn_id);
+}
+
+void AppletConnection::failPendingRequests(uint64_t conn_id)
+{
+    utils::MutexLocker lock(&pending_mutex_);
+    std::map<uint32_t, PendingRequest *>::iterator it = pending_.begin();
+    while (it != pending_.end()) {
+        if (it->second->conn_id == conn_id) {
+            SetEvent(it->second->event);
+            pending_.erase(it++);
+        } else {
+            ++it;
+        }
+    }
 }
 
-bool AppletConnection::sendWithReconnect(const std::string& cmd)
+bool AppletConnection::sendWithReconnect(const std::string& cmd, PendingRequest *req)
 {
     uint64_t now = utils::currentMSecsSinceEpoch();
     if (!connected_ && now - last_conn_failure_ < 2000) {
         return false;
     }
     if (!connected_) {
-        if (connect() && writeRequest(cmd)) {
+        if (connect() && writeRequest(cmd, req)) {
             return true;
         }
     } else {
-        if (writeRequest(cmd)) {
+        if (writeRequest(cmd, req)) {
             return true;
         } else if (!connected_ && connect()) {
             // Retry one more time when connection is broken. This normally
             // happens when seafile client was restarted.
             seaf_ext_log ("reconnected to seafile cient");
-            if (writeRequest(cmd)) {
+            if (writeRequest(cmd, req)) {
                 return true;
             }
         }
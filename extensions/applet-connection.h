@@ -1,6 +1,9 @@
 #ifndef SEAFILE_EXTENSION_APPLET_CONNECTION_H
 #define SEAFILE_EXTENSION_APPLET_CONNECTION_H
 
+#include <atomic>
+#include <deque>
+#include <map>
 #include <string>
 #include "ext-utils.h"
 
@@ -11,6 +14,11 @@ namespace seafile {
  * execute an `AppletCommand`.
  *
  * It connects to seafile appelt through a named pipe.
+ *
+ * When seadrive gui supports version 2 of the extension protocol, requests
+ * from different threads are written to the pipe without waiting for the
+ * previous responses, and a reader thread hands each response to the thread
+ * waiting for it. Otherwise requests are sent one at a time.
  */
 class AppletConnection {
 public:
@@ -20,27 +28,58 @@ public:
     bool connect();
 
     /**
-     * Send the command in a separate thread, returns immediately
+     * Queue the command to be sent by the sender thread, returns immediately.
+     * A command that is the same as one still in the queue is dropped.
      */
     bool sendCommand(const std::string& data);
 
     /**
      * Send the command and blocking wait for response.
      */
-    bool sendCommandAndWait(const std::string& data, std::string *resp);
+    bool sendCommandAndWait(const std::string& data,
+                            std::string *resp,
+                            DWORD timeout_msecs = utils::kPipeWaitTimeMSec);
+
+    /**
+     * The protocol version negotiated on the current connection, 1 if not
+     * connected yet.
+     */
+    int protocolVersion() const { return protocol_version_; }
 
 private:
+    /**
+     * A request that is waiting for its response in version 2.
+     */
+    struct PendingRequest {
+        HANDLE event;
+        uint32_t id;
+        uint64_t conn_id;
+        bool done;
+        std::string resp;
+    };
+
     AppletConnection();
-    bool readResponse(std::string *out);
-    bool writeRequest(const std::string& cmd);
+    bool readResponse(std::string *out, DWORD timeout_msecs);
+    bool writeRequest(const std::string& cmd, PendingRequest *req);
     void onPipeError();
+    bool negotiateVersion();
 
     /**
      * When sending request to seafile client, we would retry one
      * more time if we're sure the connection to seafile client is broken.
      * This normally happens when seafile client was restarted.
      */
-    bool sendWithReconnect(const std::string& cmd);
+    bool sendWithReconnect(const std::string& cmd, PendingRequest *req);
+
+    bool waitForResponse(PendingRequest *req, std::string *resp, DWORD timeout_msecs);
+    void removePendingRequest(PendingRequest *req);
+
+    static DWORD WINAPI sendQueuedCommandsThread(void *data);
+    void sendQueuedCommands();
+
+    static DWORD WINAPI readResponsesThread(void *data);
+    void readResponses(HANDLE pipe, uint64_t conn_id);
+    void failPendingRequests(uint64_t conn_id);
 
     static AppletConnection *singleton_;
 
@@ -49,11 +88,33 @@ private:
 
     uint64_t last_conn_failure_;
 
+    // Version of the protocol used on the current connection. Read by the
+    // overlay handlers without locking.
+    std::atomic<int> protocol_version_;
+
+    // Increased for each new connection, so the reader thread of a broken
+    // connection would not touch the requests of the new one.
+    uint64_t conn_id_;
+
+    uint32_t next_request_id_;
+    std::map<uint32_t, PendingRequest *> pending_;
+
     /**
-     * We have only one connection for each explorer process, so when sending
-     * a command to seafile client we need to ensure exclusive access.
+     * We have only one connection for each explorer process, so when writing
+     * a command to seafile client we need to ensure exclusive access. In
+     * version 1 it's also held until the response is read.
      */
     utils::Mutex mutex_;
+
+    // Protects `pending_`. Never acquire `mutex_` while holding it.
+    utils::Mutex pending_mutex_;
+
+    // Commands queued by sendCommand(), sent one by one by a single
+    // long-lived sender thread.
+    std::deque<std::string> queue_;
+    utils::Mutex queue_mutex_;
+    HANDLE queue_event_;
+    bool sender_started_;
 };
 
 } // namespace seafile
@@ -1,5 +1,8 @@
 #include "ext-common.h"
 
+#include <stdlib.h>
+#include <sstream>
+
 #include "log.h"
 #include "applet-connection.h"
 #include "ext-utils.h"
@@ -59,14 +62,22 @@ std::string GetInternalLinkCommand::serialize()
     return path_;
 }
 
-ListReposCommand::ListReposCommand()
-    : AppletCommand<RepoInfoList>("list-repos")
+ListReposCommand::ListReposCommand(uint64_t known_version)
+    : AppletCommand<RepoInfoList>("list-repos"),
+      known_version_(known_version),
+      version_(0),
+      not_modified_(false)
 {
 }
 
 std::string ListReposCommand::serialize()
 {
-    return "";
+    if (known_version_ == 0) {
+        return "";
+    }
+    std::stringstream ss;
+    ss << known_version_;
+    return ss.str();
 }
 
 bool ListReposCommand::parseResponse(const std::string& raw_resp,
@@ -74,12 +85,21 @@ bool ListReposCommand::parseResponse(const std::string& raw_resp,
 {
     // seaf_ext_log ("ListReposCommand: raw_resp is %s\n", raw_resp.c_str());
 
+    if (raw_resp == "not-modified") {
+        not_modified_ = true;
+        return true;
+    }
+
     std::vector<std::string> lines = utils::split(raw_resp, '\n');
     if (lines.empty()) {
         return true;
     }
     for (size_t i = 0; i < lines.size(); i++) {
         std::string line = lines[i];
+        if (line.compare(0, 8, "version\t") == 0) {
+            version_ = strtoull(line.c_str() + 8, NULL, 10);
+            continue;
+        }
         std::string repo_dir = utils::normalizedPath(line);
         // seaf_ext_log ("repo dir: %s\n", repo_dir.c_str());
         infos->push_back(RepoInfo(repo_dir));
@@ -105,33 +125,50 @@ bool GetStatusCommand::parseResponse(const std::string& raw_resp,
 {
     // seaf_ext_log ("raw_resp is %s\n", raw_resp.c_str());
 
-    if (raw_resp == "syncing") {
-        *status = Syncing;
-    } else if (raw_resp == "error") {
-        *status = Error;
-    } else if (raw_resp == "synced") {
-        *status = Synced;
-    } else if (raw_resp == "partial_synced") {
-        *status = PartialSynced;
-    } else if (raw_resp == "cloud") {
-        *status = Cloud;
-    } else if (raw_resp == "readonly") {
-        *status = ReadOnly;
-    } else if (raw_resp == "locked") {
-        *status = LockedByOthers;
-    } else if (raw_resp == "locked_by_me") {
-        *status = LockedByMe;
-    } else {
-        *status = None;
-
-        // seaf_ext_log ("[GetStatusCommand] status for %s is %s, raw_resp is %s\n",
-        //               path_.c_str(),
-        //               seafile::toString(*status).c_str(), raw_resp.c_str());
-    }
-
+    *status = protocol::parseFileStatus(raw_resp);
     return true;
 }
 
+GetDirStatusCommand::GetDirStatusCommand(const std::string& dir)
+    : AppletCommand<protocol::DirStatusList>("get-dir-status"),
+    dir_(dir)
+{
+}
+
+std::string GetDirStatusCommand::serialize()
+{
+    return dir_;
+}
+
+bool GetDirStatusCommand::parseResponse(const std::string& raw_resp,
+                                        protocol::DirStatusList *entries)
+{
+    // Old versions of seadrive gui send an empty response for unknown
+    // commands, which fails to parse.
+    return protocol::parseDirStatus(raw_resp, entries);
+}
+
+DWORD GetDirStatusCommand::responseTimeoutMSecs()
+{
+    // Large folders take a while to be handled by seadrive gui, but it's
+    // still much faster than querying the files one by one. The explorer
+    // thread is blocked meanwhile, so don't wait too long: a folder that
+    // times out is not asked for again for a while.
+    return 3 * 1000;
+}
+
+PrefetchLinksCommand::PrefetchLinksCommand(const std::string& path, bool is_dir)
+    : AppletCommand<void>("prefetch-links"),
+    path_(path),
+    is_dir_(is_dir)
+{
+}
+
+std::string PrefetchLinksCommand::serialize()
+{
+    return is_dir_ ? path_ + "\tdir" : path_;
+}
+
 LockFileCommand::LockFileCommand(const std::string& path)
     : AppletCommand<void>("lock-file"),
     path_(path)
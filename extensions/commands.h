@@ -5,44 +5,14 @@
 #include <vector>
 
 #include "applet-connection.h"
+#include "ext-protocol.h"
+#include "repo-index.h"
+#include "status.h"
 
 namespace seafile {
 
 static std::string mount_point; // The mount_point of seadrive disk, deafult to "S:".
 
-enum Status {
-    None = 0,
-    Syncing,
-    Error,
-    Synced,
-    PartialSynced,
-    Cloud,
-    ReadOnly,
-    LockedByOthers,
-    LockedByMe,
-    N_Status,
-};
-
-class RepoInfo
-{
-public:
-    std::string topdir;
-
-    bool support_file_lock;
-    bool support_private_share;
-
-    RepoInfo() {}
-
-    RepoInfo(const std::string topdir)
-        : topdir(topdir)
-    {
-    }
-
-};
-
-std::string toString(Status st);
-
-typedef std::vector<RepoInfo> RepoInfoList;
 typedef std::vector<std::string> RepoDirs;
 
 /**
@@ -77,7 +47,8 @@ public:
     bool sendAndWait(T *resp)
     {
         std::string raw_resp;
-        if (!AppletConnection::instance()->sendCommandAndWait(formatRequest(), &raw_resp)) {
+        if (!AppletConnection::instance()->sendCommandAndWait(
+                formatRequest(), &raw_resp, responseTimeoutMSecs())) {
             return false;
         }
 
@@ -100,6 +71,14 @@ protected:
         return true;
     }
 
+    /**
+     * How long to wait for seadrive gui to handle this command.
+     */
+    virtual DWORD responseTimeoutMSecs()
+    {
+        return utils::kPipeWaitTimeMSec;
+    }
+
 private:
     std::string name_;
 };
@@ -128,14 +107,27 @@ private:
 };
 
 
+/**
+ * When `known_version` is not 0, seadrive gui only answers "not-modified" if
+ * its repo list has the same version.
+ */
 class ListReposCommand : public AppletCommand<RepoInfoList> {
 public:
-    ListReposCommand();
+    ListReposCommand(uint64_t known_version = 0);
+
+    // The version of the returned list, 0 if seadrive gui doesn't support it.
+    uint64_t version() const { return version_; }
+    bool notModified() const { return not_modified_; }
 
 protected:
     std::string serialize();
 
     bool parseResponse(const std::string& raw_resp, RepoInfoList *infos);
+
+private:
+    uint64_t known_version_;
+    uint64_t version_;
+    bool not_modified_;
 };
 
 class GetStatusCommand : public AppletCommand<Status> {
@@ -151,6 +143,43 @@ private:
     std::string path_;
 };
 
+/**
+ * Get the status of all the files in a folder with a single request, instead
+ * of one request per file.
+ */
+class GetDirStatusCommand : public AppletCommand<protocol::DirStatusList> {
+public:
+    GetDirStatusCommand(const std::string& dir);
+
+protected:
+    std::string serialize();
+
+    bool parseResponse(const std::string& raw_resp,
+                       protocol::DirStatusList *entries);
+
+    DWORD responseTimeoutMSecs();
+
+private:
+    std::string dir_;
+};
+
+/**
+ * Sent when the context menu of an item is opened, so seadrive gui can get
+ * the links of the item before the share actions of the menu are clicked.
+ * Old versions of seadrive gui ignore it.
+ */
+class PrefetchLinksCommand : public AppletCommand<void> {
+public:
+    PrefetchLinksCommand(const std::string& path, bool is_dir);
+
+protected:
+    std::string serialize();
+
+private:
+    std::string path_;
+    bool is_dir_;
+};
+
 class LockFileCommand : public AppletCommand<void> {
 public:
     LockFileCommand(const std::string& path);
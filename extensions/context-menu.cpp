@@ -3,6 +3,7 @@
 #include "shell-ext.h"
 #include "log.h"
 #include "commands.h"
+#include "status-subscriber.h"
 #include "i18n.h"
 
 #define SEAFILE_TR(x) seafile::getString((x)).c_str()
@@ -215,9 +216,11 @@ STDMETHODIMP ShellExt::InvokeCommand_Wrap(LPCMINVOKECOMMANDINFO info)
     } else if (op == LockFile) {
         seafile::LockFileCommand cmd(path_);
         cmd.send();
+        seafile::StatusSubscriber::instance()->invalidate(path_);
     } else if (op == UnlockFile) {
         seafile::UnlockFileCommand cmd(path_);
         cmd.send();
+        seafile::StatusSubscriber::instance()->invalidate(path_);
     } else if (op == ShareToUser) {
         seafile::PrivateShareCommand cmd(path_, false);
         cmd.send();
@@ -346,6 +349,8 @@ void ShellExt::buildSubMenu(const seafile::RepoInfo& repo,
 
     std::unique_ptr<wchar_t[]> path_w(utils::utf8ToWString(path_));
     bool is_dir = GetFileAttributesW(path_w.get()) & FILE_ATTRIBUTE_DIRECTORY;
+    seafile::PrefetchLinksCommand(path_, is_dir).send();
+
     if (repo.support_private_share && is_dir) {
         insertSubMenuItem(SEAFILE_TR("share to a user"), ShareToUser);
         insertSubMenuItem(SEAFILE_TR("share to a group"), ShareToGroup);
@@ -0,0 +1,126 @@
+#include <stdlib.h>
+#include <sstream>
+
+#include "ext-protocol.h"
+
+namespace {
+
+const char *kDirStatusOK = "ok";
+
+} // namespace
+
+namespace seafile {
+namespace protocol {
+
+std::string formatHello()
+{
+    std::stringstream ss;
+    ss << kHelloCommand << '\t' << kProtocolVersion;
+    return ss.str();
+}
+
+int parseHelloResponse(const std::string& raw)
+{
+    int version = atoi(raw.c_str());
+    if (version < 1) {
+        return 1;
+    }
+    return version < kProtocolVersion ? version : kProtocolVersion;
+}
+
+std::string formatTaggedMessage(uint32_t id, const std::string& body)
+{
+    std::stringstream ss;
+    ss << id << '\t' << body;
+    return ss.str();
+}
+
+bool parseTaggedMessage(const std::string& raw, uint32_t *id, std::string *body)
+{
+    size_t pos = raw.find('\t');
+    if (pos == 0 || pos == std::string::npos) {
+        return false;
+    }
+
+    uint64_t v = 0;
+    for (size_t i = 0; i < pos; i++) {
+        char c = raw[i];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        v = v * 10 + (c - '0');
+        // Not an id we sent.
+        if (v > UINT32_MAX) {
+            return false;
+        }
+    }
+
+    *id = (uint32_t)v;
+    body->assign(raw, pos + 1, std::string::npos);
+    return true;
+}
+
+Status parseFileStatus(const std::string& raw)
+{
+    if (raw == "syncing") {
+        return Syncing;
+    } else if (raw == "error") {
+        return Error;
+    } else if (raw == "synced") {
+        return Synced;
+    } else if (raw == "partial_synced") {
+        return PartialSynced;
+    } else if (raw == "cloud") {
+        return Cloud;
+    } else if (raw == "readonly") {
+        return ReadOnly;
+    } else if (raw == "locked") {
+        return LockedByOthers;
+    } else if (raw == "locked_by_me") {
+        return LockedByMe;
+    }
+    return None;
+}
+
+bool parseDirStatus(const std::string& raw, DirStatusList *entries)
+{
+    size_t start = 0;
+    bool header_seen = false;
+    while (start < raw.size()) {
+        size_t end = raw.find('\n', start);
+        if (end == std::string::npos) {
+            end = raw.size();
+        }
+        std::string line = raw.substr(start, end - start);
+        start = end + 1;
+
+        if (!header_seen) {
+            if (line != kDirStatusOK) {
+                return false;
+            }
+            header_seen = true;
+            continue;
+        }
+
+        size_t tab1 = line.find('\t');
+        if (tab1 == std::string::npos || tab1 == 0) {
+            continue;
+        }
+        size_t tab2 = line.find('\t', tab1 + 1);
+        if (tab2 == std::string::npos) {
+            tab2 = line.size();
+        }
+        std::string rest = tab2 < line.size() ? line.substr(tab2 + 1) : std::string();
+
+        DirEntryStatus entry;
+        entry.name = line.substr(0, tab1);
+        entry.status = parseFileStatus(line.substr(tab1 + 1, tab2 - tab1 - 1));
+        entry.cached = rest.substr(0, rest.find('\t')) == "cached";
+        entries->push_back(entry);
+    }
+
+    return header_seen;
+}
+
+} // namespace protocol
+} // namespace seafile
@@ -0,0 +1,73 @@
+#ifndef SEAFILE_EXTENSION_EXT_PROTOCOL_H
+#define SEAFILE_EXTENSION_EXT_PROTOCOL_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "status.h"
+
+// Framing and parsing of the messages exchanged with seadrive gui. This file
+// must not depend on windows headers.
+
+namespace seafile {
+namespace protocol {
+
+// Each message is written to the pipe as a 4-byte length in native byte
+// order, followed by the utf8 encoded body. A request body is the command name
+// and its arguments separated by tabs.
+//
+// In version 1 of the protocol, a connection carries one request at a time,
+// and the response is the next message from seadrive gui.
+//
+// In version 2, each message body is prefixed with a request id and a tab,
+// so many requests can be in flight on one connection, and the responses may
+// come back in any order. A connection starts in version 1, and switches to
+// version 2 after the client sends "hello\t2" and seadrive gui answers "2".
+// Old versions of seadrive gui answer an empty string to unknown commands, so
+// the client would stay with version 1.
+
+const char *const kHelloCommand = "hello";
+const int kProtocolVersion = 2;
+
+// "get-dir-status" came with version 2, so older versions of seadrive gui are
+// never asked for it.
+const int kDirStatusMinVersion = 2;
+
+std::string formatHello();
+int parseHelloResponse(const std::string& raw);
+
+std::string formatTaggedMessage(uint32_t id, const std::string& body);
+bool parseTaggedMessage(const std::string& raw, uint32_t *id, std::string *body);
+
+/**
+ * Parse the response of "get-file-status".
+ */
+Status parseFileStatus(const std::string& raw);
+
+struct DirEntryStatus {
+    std::string name;
+    Status status;
+    bool cached;
+};
+
+typedef std::vector<DirEntryStatus> DirStatusList;
+
+/**
+ * Parse the response of "get-dir-status", which is like:
+ *
+ *     ok
+ *     <name>\t<file status>\t<cached|uncached>
+ *     ...
+ *
+ * Only the entries that have data in the cache are listed. An entry without
+ * the cached field is taken as uncached, and fields added after it by later
+ * versions are ignored. Returns false if the response doesn't start with "ok", e.g. when seadrive
+ * gui fails to resolve the folder or doesn't support the command at all.
+ */
+bool parseDirStatus(const std::string& raw, DirStatusList *entries);
+
+} // namespace protocol
+} // namespace seafile
+
+#endif // SEAFILE_EXTENSION_EXT_PROTOCOL_H
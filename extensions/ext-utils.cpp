@@ -17,8 +17,6 @@
 
 namespace {
 
-const int kPipeWaitTimeMSec = 1000;
-
 class OverLappedWrapper
 {
 public:
@@ -148,10 +146,10 @@ std::string getHomeDir()
 }
 
 bool
-doPipeWait (HANDLE pipe, OVERLAPPED *ol, DWORD len)
+doPipeWait (HANDLE pipe, OVERLAPPED *ol, DWORD len, DWORD timeout_msecs)
 {
     DWORD bytes_rw, result;
-    result = WaitForSingleObject (ol->hEvent, kPipeWaitTimeMSec);
+    result = WaitForSingleObject (ol->hEvent, timeout_msecs);
     if (result == WAIT_OBJECT_0) {
         if (!GetOverlappedResult(pipe, ol, &bytes_rw, false)
             || bytes_rw != len) {
@@ -194,6 +192,15 @@ bool
 pipeReadN (HANDLE pipe,
            void *buf,
            uint32_t len)
+{
+    return pipeReadNTimeout(pipe, buf, len, kPipeWaitTimeMSec);
+}
+
+bool
+pipeReadNTimeout (HANDLE pipe,
+                  void *buf,
+                  uint32_t len,
+                  DWORD timeout_msecs)
 {
     OverLappedWrapper ol;
     bool ret= ReadFile(
@@ -207,7 +214,7 @@ pipeReadN (HANDLE pipe,
         return false;
     }
 
-    if (!doPipeWait (pipe, ol.get(), (DWORD)len)) {
+    if (!doPipeWait (pipe, ol.get(), (DWORD)len, timeout_msecs)) {
         return false;
     }
 
@@ -231,7 +238,7 @@ pipeWriteN(HANDLE pipe,
         return false;
     }
 
-    if (!doPipeWait(pipe, ol.get(), (DWORD)len))
+    if (!doPipeWait(pipe, ol.get(), (DWORD)len, kPipeWaitTimeMSec))
         return false;
 
     return true;
@@ -30,6 +30,11 @@ private:
     Mutex *mu_;
 };
 
+/**
+ * How long to wait for seadrive gui when reading from or writing to the pipe.
+ */
+const DWORD kPipeWaitTimeMSec = 1000;
+
 std::string getHomeDir();
 
 /**
@@ -41,6 +46,15 @@ bool pipeReadN (HANDLE hPipe,
                 void *buf,
                 uint32_t len);
 
+/**
+ * Like pipeReadN, but wait for at most `timeout_msecs` milliseconds, which
+ * could be INFINITE.
+ */
+bool pipeReadNTimeout (HANDLE hPipe,
+                       void *buf,
+                       uint32_t len,
+                       DWORD timeout_msecs);
+
 bool pipeWriteN (HANDLE hPipe,
                  const void *buf,
                  uint32_t len);
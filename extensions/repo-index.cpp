@@ -0,0 +1,118 @@
+#include <algorithm>
+
+#include "repo-index.h"
+
+namespace seafile {
+
+RepoIndex::RepoIndex(const RepoInfoList& repos, uint64_t version)
+    : version_(version)
+{
+    entries_.reserve(repos.size());
+    for (size_t i = 0; i < repos.size(); i++) {
+        Entry entry;
+        entry.info = repos[i];
+        entry.parent = -1;
+        entries_.push_back(entry);
+    }
+
+    // Keep the first one of the duplicated folders, like the linear scan did.
+    std::stable_sort(entries_.begin(), entries_.end(), entryLess);
+    size_t n = 0;
+    for (size_t i = 0; i < entries_.size(); i++) {
+        if (n > 0 && entries_[n - 1].info.topdir == entries_[i].info.topdir) {
+            continue;
+        }
+        entries_[n++] = entries_[i];
+    }
+    entries_.resize(n);
+
+    // The entries containing entry i are all before it, and they are either
+    // entry i-1 or on the parent chain of entry i-1.
+    for (size_t i = 1; i < entries_.size(); i++) {
+        int p = (int)i - 1;
+        while (p >= 0 && !isPrefix(entries_[p].info.topdir, entries_[i].info.topdir)) {
+            p = entries_[p].parent;
+        }
+        entries_[i].parent = p;
+    }
+}
+
+// Compare two paths as if "/" were smaller than any other character.
+int RepoIndex::compare(const char *a, size_t alen, const char *b, size_t blen)
+{
+    size_t n = std::min(alen, blen);
+    for (size_t i = 0; i < n; i++) {
+        unsigned char ca = a[i] == '/' ? 0 : (unsigned char)a[i];
+        unsigned char cb = b[i] == '/' ? 0 : (unsigned char)b[i];
+        if (ca != cb) {
+            return ca < cb ? -1 : 1;
+        }
+    }
+    if (alen == blen) {
+        return 0;
+    }
+    return alen < blen ? -1 : 1;
+}
+
+bool RepoIndex::entryLess(const Entry& a, const Entry& b)
+{
+    return compare(a.info.topdir.data(), a.info.topdir.size(),
+                   b.info.topdir.data(), b.info.topdir.size()) < 0;
+}
+
+bool RepoIndex::isPrefix(const std::string& dir, const std::string& path)
+{
+    if (path.size() < dir.size() || path.compare(0, dir.size(), dir) != 0) {
+        return false;
+    }
+    return path.size() == dir.size() || path[dir.size()] == '/';
+}
+
+int RepoIndex::findEntry(const std::string& path) const
+{
+    // Find the last entry not greater than `path`. Any entry containing
+    // `path` is either this one or on its parent chain.
+    size_t lo = 0, hi = entries_.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const std::string& topdir = entries_[mid].info.topdir;
+        if (compare(topdir.data(), topdir.size(), path.data(), path.size()) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    int i = (int)lo - 1;
+    while (i >= 0 && !isPrefix(entries_[i].info.topdir, path)) {
+        i = entries_[i].parent;
+    }
+    return i;
+}
+
+const RepoInfo *RepoIndex::findOutermost(const std::string& path,
+                                         std::string *path_in_repo) const
+{
+    int i = findEntry(path);
+    if (i < 0) {
+        return NULL;
+    }
+    while (entries_[i].parent >= 0) {
+        i = entries_[i].parent;
+    }
+    if (path_in_repo) {
+        *path_in_repo = path.substr(entries_[i].info.topdir.size());
+    }
+    return &entries_[i].info;
+}
+
+const RepoInfo *RepoIndex::findTopDir(const std::string& path) const
+{
+    int i = findEntry(path);
+    if (i < 0 || entries_[i].info.topdir.size() != path.size()) {
+        return NULL;
+    }
+    return &entries_[i].info;
+}
+
+} // namespace seafile
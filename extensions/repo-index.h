@@ -0,0 +1,81 @@
+#ifndef SEAFILE_EXTENSION_REPO_INDEX_H
+#define SEAFILE_EXTENSION_REPO_INDEX_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace seafile {
+
+class RepoInfo
+{
+public:
+    std::string topdir;
+
+    bool support_file_lock;
+    bool support_private_share;
+
+    RepoInfo() {}
+
+    RepoInfo(const std::string topdir)
+        : topdir(topdir)
+    {
+    }
+
+};
+
+typedef std::vector<RepoInfo> RepoInfoList;
+
+/**
+ * Finds the repo folder that contains a path, without scanning all the repos.
+ *
+ * The folders are sorted in an order where "/" comes before any other
+ * character, so a folder is followed by its descendants. Each folder also
+ * remembers the nearest folder in the list that contains it. A lookup is a
+ * binary search followed by a walk up this chain, which is as long as the
+ * nesting of the folders (sync root -> repo).
+ *
+ * An index is never modified after it's built, so it can be shared by many
+ * threads without locking.
+ */
+class RepoIndex {
+public:
+    RepoIndex(const RepoInfoList& repos, uint64_t version);
+
+    /**
+     * Returns the outermost folder that contains `path`, which must be
+     * normalized. The remaining part of the path, starting with "/" or empty,
+     * is stored in `path_in_repo`. Returns NULL if no folder contains it.
+     */
+    const RepoInfo *findOutermost(const std::string& path,
+                                  std::string *path_in_repo) const;
+
+    /**
+     * Returns the folder which is exactly `path`, or NULL.
+     */
+    const RepoInfo *findTopDir(const std::string& path) const;
+
+    uint64_t version() const { return version_; }
+    size_t size() const { return entries_.size(); }
+
+private:
+    struct Entry {
+        RepoInfo info;
+        // Index of the nearest entry containing this one, or -1
+        int parent;
+    };
+
+    static int compare(const char *a, size_t alen, const char *b, size_t blen);
+    static bool isPrefix(const std::string& dir, const std::string& path);
+    static bool entryLess(const Entry& a, const Entry& b);
+
+    // Index of the innermost entry containing `path`, or -1
+    int findEntry(const std::string& path) const;
+
+    std::vector<Entry> entries_;
+    uint64_t version_;
+};
+
+} // namespace seafile
+
+#endif // SEAFILE_EXTENSION_REPO_INDEX_H
@@ -6,6 +6,7 @@
 #include "ext-utils.h"
 #include "commands.h"
 #include "log.h"
+#include "status-subscriber.h"
 #include "shell-ext.h"
 
 namespace utils = seafile::utils;
@@ -16,8 +17,9 @@ const int kWorktreeCacheExpireMSecs = 3 * 1000;
 
 } // namespace
 
-std::unique_ptr<seafile::RepoInfoList> ShellExt::repos_cache_;
-uint64_t ShellExt::cache_ts_;
+std::shared_ptr<const seafile::RepoIndex> ShellExt::repo_index_;
+std::atomic<uint64_t> ShellExt::cache_ts_(0);
+seafile::utils::Mutex ShellExt::repo_index_mutex_;
 
 // *********************** ShellExt *************************
 ShellExt::ShellExt(seafile::Status status)
@@ -89,110 +91,133 @@ STDMETHODIMP_(ULONG) ShellExt::Release()
     return 0L;
 }
 
-bool ShellExt::getReposList(seafile::RepoInfoList *wts)
+std::shared_ptr<const seafile::RepoIndex> ShellExt::getRepoIndex()
 {
-    seafile::utils::MutexLocker lock(&repos_cache_mutex_);
-
+    std::shared_ptr<const seafile::RepoIndex> index = std::atomic_load(&repo_index_);
     uint64_t now = utils::currentMSecsSinceEpoch();
-    if (repos_cache_ && now < cache_ts_ + kWorktreeCacheExpireMSecs) {
-        *wts = *(repos_cache_.get());
-        // seaf_ext_log("use cached repos list!");
-        return true;
+    if (index && now < cache_ts_ + kWorktreeCacheExpireMSecs) {
+        return index;
     }
 
-    // no cached worktree list, send request to seafile client
-    seafile::ListReposCommand cmd;
+    seafile::utils::MutexLocker lock(&repo_index_mutex_);
+
+    // Another thread may have refreshed it while we were waiting.
+    index = std::atomic_load(&repo_index_);
+    now = utils::currentMSecsSinceEpoch();
+    if (index && now < cache_ts_ + kWorktreeCacheExpireMSecs) {
+        return index;
+    }
+
+    // The cached list has expired. If seadrive gui supports versioned repo
+    // lists, ask it to send the list only when it has changed.
+    seafile::ListReposCommand cmd(index ? index->version() : 0);
     seafile::RepoInfoList repos;
     if (!cmd.sendAndWait(&repos)) {
         // seaf_ext_log("ListReposCommand returned false!");
-        return false;
+        return std::shared_ptr<const seafile::RepoIndex>();
     }
 
+    if (!cmd.notModified() || !index) {
+        index = std::make_shared<const seafile::RepoIndex>(repos, cmd.version());
+        std::atomic_store(&repo_index_, index);
+    }
     cache_ts_ = utils::currentMSecsSinceEpoch();
-    repos_cache_.reset(new seafile::RepoInfoList(repos));
 
-    *wts = repos;
-    return true;
+    return index;
 }
 
 bool ShellExt::pathInRepo(const std::string& path,
                           std::string *path_in_repo,
                           seafile::RepoInfo *repo)
 {
-    seafile::RepoInfoList repos;
-    if (!getReposList(&repos)) {
-        // seaf_ext_log ("getReposList returns false");
+    std::shared_ptr<const seafile::RepoIndex> index = getRepoIndex();
+    if (!index) {
+        // seaf_ext_log ("getRepoIndex returns null");
         return false;
     }
     std::string p = utils::normalizedPath(path);
 
-    for (size_t i = 0; i < repos.size(); i++) {
-        std::string topdir = repos[i].topdir;
-        // seaf_ext_log ("work tree is %s, path is %s\n", topdir.c_str(), p.c_str());
-        if (p.size() >= topdir.size() && p.substr(0, topdir.size()) == topdir) {
-            if (p.size() > topdir.size() && p[topdir.size()] != '/') {
-                continue;
-            }
-            if (path_in_repo) {
-                *path_in_repo = p.substr(topdir.size(), p.size() - topdir.size());
-            }
-            if (repo) {
-                *repo = repos[i];
-            }
-            return true;
-        }
+    // The sync root is in the list too, so this is the path relative to the
+    // sync root when the path is under it.
+    const seafile::RepoInfo *info = index->findOutermost(p, path_in_repo);
+    if (!info) {
+        return false;
     }
-
-    return false;
+    if (repo) {
+        *repo = *info;
+    }
+    return true;
 }
 
 bool ShellExt::isRepoTopDir(const std::string& path)
 {
-    seafile::RepoInfoList repos;
-    if (!getReposList(&repos)) {
+    std::shared_ptr<const seafile::RepoIndex> index = getRepoIndex();
+    if (!index) {
         return false;
     }
 
-    std::string p = utils::normalizedPath(path);
-    for (size_t i = 0; i < repos.size(); i++) {
-        if (p == repos[i].topdir) {
-            return true;
-        }
-    }
-
-    return false;
+    return index->findTopDir(utils::normalizedPath(path)) != NULL;
 }
 
 seafile::RepoInfo ShellExt::getRepoInfoByPath(const std::string& path)
 {
-    seafile::RepoInfoList repos;
-    if (!getReposList(&repos)) {
+    std::shared_ptr<const seafile::RepoIndex> index = getRepoIndex();
+    if (!index) {
         return seafile::RepoInfo();
     }
 
-    std::string p = utils::normalizedPath(path);
-    for (size_t i = 0; i < repos.size(); i++) {
-        if (p == repos[i].topdir) {
-            return repos[i];
-        }
-    }
-
-    return seafile::RepoInfo();
+    const seafile::RepoInfo *info = index->findTopDir(utils::normalizedPath(path));
+    return info ? *info : seafile::RepoInfo();
 }
 
 seafile::Status
 ShellExt::getFileStatus(const std::string& path)
 {
-    // TODO: get the files under the same folder in a single command to reduce overhead
-    seafile::GetStatusCommand cmd(utils::normalizedPath(path));
+    // Explorer asks every overlay handler for the same file, so the status is
+    // cached and shared by all of them.
+    seafile::StatusSubscriber *subscriber = seafile::StatusSubscriber::instance();
     seafile::Status status;
+    uint64_t generation;
+    if (subscriber->getStatus(path, &status, &generation)) {
+        return status;
+    }
+
+    // Explorer would soon ask about the other files in the same folder, so
+    // get the status of its cached files with one request. The folder is
+    // asked for only once in a while: its uncached files are not listed, and
+    // are queried one by one like the files of a folder whose request failed.
+    std::string p = utils::normalizedPath(path);
+    std::string dir = utils::getParentPath(p);
+    int version = seafile::AppletConnection::instance()->protocolVersion();
+    if (version >= seafile::protocol::kDirStatusMinVersion &&
+        !subscriber->isDirStatusFetched(dir)) {
+        subscriber->setDirStatusFetched(dir);
+        if (getDirStatus(dir, generation) &&
+            subscriber->getStatus(p, &status, &generation)) {
+            return status;
+        }
+    }
+
+    seafile::GetStatusCommand cmd(p);
     if (!cmd.sendAndWait(&status)) {
         return seafile::None;
     }
 
+    subscriber->setStatus(path, status, generation);
     return status;
 }
 
+bool ShellExt::getDirStatus(const std::string& dir, uint64_t generation)
+{
+    seafile::GetDirStatusCommand cmd(dir);
+    seafile::protocol::DirStatusList entries;
+    if (!cmd.sendAndWait(&entries)) {
+        return false;
+    }
+    seafile::StatusSubscriber::instance()->setDirStatus(dir, entries, generation);
+    return true;
+}
+
 bool ShellExt::isManagedFile(const std::string& path)
 {
     return pathInRepo(path, nullptr, nullptr);
@@ -1,6 +1,7 @@
 #ifndef SEAFILE_EXT_SHELL_EXT_H
 #define SEAFILE_EXT_SHELL_EXT_H
 
+#include <atomic>
 #include <string>
 #include <memory>
 #include <vector>
@@ -83,7 +84,7 @@ private:
     void insertSubMenuItem(const std::string& text, MenuOp op);
     void tweakMenu(HMENU menu);
 
-    bool getReposList(seafile::RepoInfoList *wts);
+    std::shared_ptr<const seafile::RepoIndex> getRepoIndex();
     bool pathInRepo(const std::string& path, std::string *path_in_repo, seafile::RepoInfo *repo=0);
 
     bool isManagedFile(const std::string& path);
@@ -91,13 +92,17 @@ private:
     bool isRepoTopDir(const std::string& path);
     seafile::RepoInfo getRepoInfoByPath(const std::string& path);
     seafile::Status getFileStatus(const std::string& path);
+    bool getDirStatus(const std::string& dir, uint64_t generation);
 
     /* the file/dir current clicked on */
     std::string path_;
 
-    static std::unique_ptr<seafile::RepoInfoList> repos_cache_;
-    static uint64_t cache_ts_;
-    seafile::utils::Mutex repos_cache_mutex_;
+    // Published with std::atomic_store, so the overlay handlers can read it
+    // without locking.
+    static std::shared_ptr<const seafile::RepoIndex> repo_index_;
+    static std::atomic<uint64_t> cache_ts_;
+    // Only one thread refreshes the repo list at a time.
+    static seafile::utils::Mutex repo_index_mutex_;
 
     /* The main menu */
     HMENU main_menu_;
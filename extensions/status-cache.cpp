@@ -0,0 +1,111 @@
+#include "status-cache.h"
+
+namespace {
+
+const char *kInvalidateAll = "*";
+
+} // namespace
+
+namespace seafile {
+
+StatusCache::StatusCache(uint64_t expire_msecs, size_t max_entries)
+    : expire_msecs_(expire_msecs),
+      max_entries_(max_entries)
+{
+}
+
+std::string StatusCache::normalizeKey(const std::string& path)
+{
+    std::string key = path;
+    for (size_t i = 0; i < key.size(); i++) {
+        if (key[i] == '\\') {
+            key[i] = '/';
+        } else if (key[i] >= 'A' && key[i] <= 'Z') {
+            key[i] = key[i] - 'A' + 'a';
+        }
+    }
+    while (!key.empty() && key[key.size() - 1] == '/') {
+        key.resize(key.size() - 1);
+    }
+    return key;
+}
+
+bool StatusCache::get(const std::string& path, uint64_t now, Status *status) const
+{
+    EntryMap::const_iterator it = entries_.find(normalizeKey(path));
+    if (it == entries_.end()) {
+        return false;
+    }
+    if (now >= it->second.ts + expire_msecs_) {
+        return false;
+    }
+    *status = it->second.status;
+    return true;
+}
+
+void StatusCache::set(const std::string& path, Status status, uint64_t now)
+{
+    if (entries_.size() >= max_entries_) {
+        removeExpired(now);
+        if (entries_.size() >= max_entries_) {
+            entries_.clear();
+        }
+    }
+
+    Entry& entry = entries_[normalizeKey(path)];
+    entry.status = status;
+    entry.ts = now;
+}
+
+void StatusCache::removeExpired(uint64_t now)
+{
+    EntryMap::iterator it = entries_.begin();
+    while (it != entries_.end()) {
+        if (now >= it->second.ts + expire_msecs_) {
+            entries_.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void StatusCache::invalidate(const std::string& path)
+{
+    std::string key = normalizeKey(path);
+    entries_.erase(key);
+
+    // All the descendants of "a/b" are in the range of ["a/b/", "a/b0"),
+    // since '0' is the character right after '/'.
+    EntryMap::iterator begin = entries_.lower_bound(key + "/");
+    EntryMap::iterator end = entries_.lower_bound(key + "0");
+    entries_.erase(begin, end);
+}
+
+void StatusCache::clear()
+{
+    entries_.clear();
+}
+
+void StatusCache::applyChanges(const std::string& changes)
+{
+    size_t start = 0;
+    while (start < changes.size()) {
+        size_t end = changes.find('\n', start);
+        if (end == std::string::npos) {
+            end = changes.size();
+        }
+        std::string line = changes.substr(start, end - start);
+        start = end + 1;
+
+        if (line.empty()) {
+            continue;
+        }
+        if (line == kInvalidateAll) {
+            entries_.clear();
+            return;
+        }
+        invalidate(line);
+    }
+}
+
+} // namespace seafile
@@ -0,0 +1,68 @@
+#ifndef SEAFILE_EXTENSION_STATUS_CACHE_H
+#define SEAFILE_EXTENSION_STATUS_CACHE_H
+
+#include <map>
+#include <string>
+#include <stdint.h>
+
+#include "status.h"
+
+namespace seafile {
+
+/**
+ * Caches the status of files and folders, so the icon overlay handlers (one
+ * for each status) could all be answered by a single query to seadrive gui.
+ *
+ * Entries are keyed by normalized path, and are invalidated by the status
+ * change notifications pushed by seadrive gui. An entry also expires after
+ * `expire_msecs` in case some notification is missed.
+ *
+ * This class is not thread safe, the caller is responsible for locking.
+ */
+class StatusCache {
+public:
+    StatusCache(uint64_t expire_msecs, size_t max_entries);
+
+    bool get(const std::string& path, uint64_t now, Status *status) const;
+    void set(const std::string& path, Status status, uint64_t now);
+
+    /**
+     * Remove the entry of `path` and the entries of all its descendants.
+     */
+    void invalidate(const std::string& path);
+    void clear();
+
+    /**
+     * Apply a status change notification from seadrive gui. Each line of the
+     * notification is a changed path, and a line of "*" means all the entries
+     * should be dropped.
+     */
+    void applyChanges(const std::string& changes);
+
+    void setExpireMSecs(uint64_t expire_msecs) { expire_msecs_ = expire_msecs; }
+
+    size_t size() const { return entries_.size(); }
+
+    /**
+     * Use "/" as separator, remove the trailing slash, and lower the case
+     * since paths are case insensitive on windows.
+     */
+    static std::string normalizeKey(const std::string& path);
+
+private:
+    struct Entry {
+        Status status;
+        uint64_t ts;
+    };
+    typedef std::map<std::string, Entry> EntryMap;
+
+    void removeExpired(uint64_t now);
+
+    EntryMap entries_;
+    uint64_t expire_msecs_;
+    size_t max_entries_;
+};
+
+} // namespace seafile
+
+#endif // SEAFILE_EXTENSION_STATUS_CACHE_H
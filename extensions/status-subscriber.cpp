@@ -0,0 +1,254 @@
+#include "ext-common.h"
+
+#include <memory>
+
+#include "ext-utils.h"
+#include "log.h"
+
+#include "status-subscriber.h"
+
+namespace {
+
+const char *kSeafExtPipeName = "\\\\.\\pipe\\seadrive_ext_pipe_";
+const char *kSubscribeCommand = "subscribe-status-changes";
+
+// Without the subscription we don't know when the status changes, so the
+// cached status is only used for painting the icons of the same folder.
+const uint64_t kUnsubscribedExpireMSecs = 3 * 1000;
+
+// With the subscription the cache is invalidated by the notifications, but
+// the locks made by other users are not notified, so we still need to expire
+// the entries after some time.
+const uint64_t kSubscribedExpireMSecs = 60 * 1000;
+
+const size_t kMaxCachedEntries = 20000;
+
+// A folder whose status has been asked for is not asked for again during
+// this time.
+const uint64_t kFetchedDirExpireMSecs = 30 * 1000;
+const size_t kMaxFetchedDirs = 1000;
+
+const int kResubscribeIntervalMSecs = 2 * 1000;
+
+// Seadrive gui answers the subscription with this message. Old versions that
+// don't know the command answer an empty message, and are not asked again
+// for a while.
+const char *kSubscribedAck = "subscribed";
+const int kUnsupportedResubscribeIntervalMSecs = 5 * 60 * 1000;
+
+// Any notification larger than this must be corrupted.
+const uint32_t kMaxNotificationSize = 16 * 1024 * 1024;
+
+} // namespace
+
+namespace seafile {
+
+StatusSubscriber *StatusSubscriber::singleton_;
+
+StatusSubscriber *StatusSubscriber::instance()
+{
+    if (!singleton_) {
+        static StatusSubscriber v;
+        singleton_ = &v;
+    }
+    return singleton_;
+}
+
+StatusSubscriber::StatusSubscriber()
+    : cache_(kUnsubscribedExpireMSecs, kMaxCachedEntries),
+      generation_(0),
+      started_(false),
+      pipe_(INVALID_HANDLE_VALUE)
+{
+}
+
+bool StatusSubscriber::getStatus(const std::string& path,
+                                 Status *status,
+                                 uint64_t *generation)
+{
+    utils::MutexLocker lock(&mutex_);
+    if (!started_) {
+        startSubscription();
+    }
+    *generation = generation_;
+    return cache_.get(path, utils::currentMSecsSinceEpoch(), status);
+}
+
+void StatusSubscriber::setStatus(const std::string& path,
+                                 Status status,
+                                 uint64_t generation)
+{
+    utils::MutexLocker lock(&mutex_);
+    if (generation != generation_) {
+        return;
+    }
+    cache_.set(path, status, utils::currentMSecsSinceEpoch());
+}
+
+void StatusSubscriber::setDirStatus(const std::string& dir,
+                                    const protocol::DirStatusList& entries,
+                                    uint64_t generation)
+{
+    utils::MutexLocker lock(&mutex_);
+    if (generation != generation_) {
+        return;
+    }
+    uint64_t now = utils::currentMSecsSinceEpoch();
+    for (size_t i = 0; i < entries.size(); i++) {
+        cache_.set(dir + "/" + entries[i].name, entries[i].status, now);
+    }
+}
+
+void StatusSubscriber::invalidate(const std::string& path)
+{
+    utils::MutexLocker lock(&mutex_);
+    generation_++;
+    cache_.invalidate(path);
+}
+
+void StatusSubscriber::setDirStatusFetched(const std::string& dir)
+{
+    utils::MutexLocker lock(&mutex_);
+    if (fetched_dirs_.size() >= kMaxFetchedDirs) {
+        fetched_dirs_.clear();
+    }
+    fetched_dirs_[StatusCache::normalizeKey(dir)] = utils::currentMSecsSinceEpoch();
+}
+
+bool StatusSubscriber::isDirStatusFetched(const std::string& dir)
+{
+    utils::MutexLocker lock(&mutex_);
+    std::map<std::string, uint64_t>::iterator it =
+        fetched_dirs_.find(StatusCache::normalizeKey(dir));
+    if (it == fetched_dirs_.end()) {
+        return false;
+    }
+    if (utils::currentMSecsSinceEpoch() >= it->second + kFetchedDirExpireMSecs) {
+        fetched_dirs_.erase(it);
+        return false;
+    }
+    return true;
+}
+
+void StatusSubscriber::startSubscription()
+{
+    started_ = utils::doInThread(
+        (LPTHREAD_START_ROUTINE)subscriptionThread, (void *)this);
+}
+
+DWORD WINAPI StatusSubscriber::subscriptionThread(void *data)
+{
+    StatusSubscriber *subscriber = (StatusSubscriber *)data;
+    subscriber->runSubscription();
+    return 0;
+}
+
+void StatusSubscriber::runSubscription()
+{
+    while (1) {
+        if (!subscribe()) {
+            Sleep(kResubscribeIntervalMSecs);
+            continue;
+        }
+
+        // Until the gui acknowledges the subscription, the changes are not
+        // notified, so the cache must keep expiring quickly.
+        std::string changes;
+        bool got_reply = readChanges(&changes, utils::kPipeWaitTimeMSec);
+        if (!got_reply || changes != kSubscribedAck) {
+            seaf_ext_log ("status subscription is not acknowledged");
+            CloseHandle(pipe_);
+            pipe_ = INVALID_HANDLE_VALUE;
+            Sleep(got_reply ? kUnsupportedResubscribeIntervalMSecs
+                        : kResubscribeIntervalMSecs);
+            continue;
+        }
+
+        setSubscribed(true);
+
+        while (readChanges(&changes, INFINITE)) {
+            if (changes.empty()) {
+                // keep-alive message
+                continue;
+            }
+            utils::MutexLocker lock(&mutex_);
+            generation_++;
+            cache_.applyChanges(changes);
+        }
+
+        seaf_ext_log ("status subscription is broken: %s",
+                      utils::formatErrorMessage().c_str());
+        setSubscribed(false);
+
+        CloseHandle(pipe_);
+        pipe_ = INVALID_HANDLE_VALUE;
+        Sleep(kResubscribeIntervalMSecs);
+    }
+}
+
+void StatusSubscriber::setSubscribed(bool subscribed)
+{
+    utils::MutexLocker lock(&mutex_);
+    // We may have missed some notifications while not subscribed.
+    generation_++;
+    cache_.clear();
+    cache_.setExpireMSecs(subscribed ? kSubscribedExpireMSecs
+                                     : kUnsubscribedExpireMSecs);
+}
+
+bool StatusSubscriber::subscribe()
+{
+    pipe_ = CreateFile(
+        utils::getLocalPipeName(kSeafExtPipeName).c_str(), // pipe name
+        GENERIC_READ |          // read and write access
+        GENERIC_WRITE,
+        0,                      // no sharing
+        NULL,                   // default security attributes
+        OPEN_EXISTING,          // opens existing pipe
+        FILE_FLAG_OVERLAPPED,   // default attributes
+        NULL);                  // no template file
+
+    if (pipe_ == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    DWORD mode = PIPE_READMODE_MESSAGE;
+    uint32_t len = strlen(kSubscribeCommand);
+    if (!SetNamedPipeHandleState(pipe_, &mode, NULL, NULL) ||
+        !utils::pipeWriteN(pipe_, &len, sizeof(len)) ||
+        !utils::pipeWriteN(pipe_, kSubscribeCommand, len)) {
+        seaf_ext_log ("failed to subscribe status changes: %s",
+                      utils::formatErrorMessage().c_str());
+        CloseHandle(pipe_);
+        pipe_ = INVALID_HANDLE_VALUE;
+        return false;
+    }
+
+    return true;
+}
+
+bool StatusSubscriber::readChanges(std::string *changes, DWORD timeout_msecs)
+{
+    uint32_t len = 0;
+    if (!utils::pipeReadNTimeout(pipe_, &len, sizeof(len), timeout_msecs)) {
+        return false;
+    }
+
+    if (len > kMaxNotificationSize) {
+        return false;
+    }
+
+    changes->clear();
+    if (len == 0) {
+        return true;
+    }
+
+    std::unique_ptr<char[]> buf(new char[len]);
+    if (!utils::pipeReadN(pipe_, buf.get(), len)) {
+        return false;
+    }
+    changes->assign(buf.get(), len);
+    return true;
+}
+
+} // namespace seafile
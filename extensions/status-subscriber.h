@@ -0,0 +1,81 @@
+#ifndef SEAFILE_EXTENSION_STATUS_SUBSCRIBER_H
+#define SEAFILE_EXTENSION_STATUS_SUBSCRIBER_H
+
+#include <map>
+#include <string>
+
+#include "ext-utils.h"
+#include "ext-protocol.h"
+#include "status-cache.h"
+
+namespace seafile {
+
+/**
+ * Holds the file status cache shared by all the icon overlay handlers of this
+ * explorer process, and keeps it fresh by subscribing to the status changes
+ * pushed by seadrive gui.
+ *
+ * The subscription runs on its own pipe connection in a background thread, so
+ * the notifications never interleave with the requests sent through
+ * `AppletConnection`.
+ */
+class StatusSubscriber {
+public:
+    static StatusSubscriber *instance();
+
+    /**
+     * Look up the cached status of `path`. `generation` is set in any case,
+     * and should be passed to `setStatus` after the status is queried.
+     */
+    bool getStatus(const std::string& path, Status *status, uint64_t *generation);
+
+    /**
+     * Cache the status of `path`, unless some change notification has
+     * arrived since `generation`, in which case the status may be stale.
+     */
+    void setStatus(const std::string& path, Status status, uint64_t generation);
+
+    /**
+     * Like `setStatus`, for all the entries of the folder `dir`.
+     */
+    void setDirStatus(const std::string& dir,
+                      const protocol::DirStatusList& entries,
+                      uint64_t generation);
+
+    void invalidate(const std::string& path);
+
+    /**
+     * Remember that the status of the folder `dir` has been asked for, so
+     * its entries that are not in the cache fall back to per-file queries
+     * instead of asking for the whole folder again. That's the case of the
+     * uncached entries, which are not listed, and of all the entries when
+     * the request failed, e.g. it timed out.
+     */
+    void setDirStatusFetched(const std::string& dir);
+    bool isDirStatusFetched(const std::string& dir);
+
+private:
+    StatusSubscriber();
+    void startSubscription();
+    void runSubscription();
+    bool subscribe();
+    bool readChanges(std::string *changes, DWORD timeout_msecs);
+    void setSubscribed(bool subscribed);
+
+    static DWORD WINAPI subscriptionThread(void *data);
+
+    static StatusSubscriber *singleton_;
+
+    StatusCache cache_;
+    // Normalized folder -> when its status is asked for.
+    std::map<std::string, uint64_t> fetched_dirs_;
+    uint64_t generation_;
+    bool started_;
+    HANDLE pipe_;
+
+    utils::Mutex mutex_;
+};
+
+} // namespace seafile
+
+#endif // SEAFILE_EXTENSION_STATUS_SUBSCRIBER_H
@@ -0,0 +1,28 @@
+#ifndef SEAFILE_EXTENSION_STATUS_H
+#define SEAFILE_EXTENSION_STATUS_H
+
+#include <string>
+
+// This header must not depend on windows headers, since it's shared with the
+// platform independent parts of the extension.
+
+namespace seafile {
+
+enum Status {
+    None = 0,
+    Syncing,
+    Error,
+    Synced,
+    PartialSynced,
+    Cloud,
+    ReadOnly,
+    LockedByOthers,
+    LockedByMe,
+    N_Status,
+};
+
+std::string toString(Status st);
+
+} // namespace seafile
+
+#endif // SEAFILE_EXTENSION_STATUS_H
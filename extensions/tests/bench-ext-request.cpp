@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "ext-protocol.h"
+#include "../src/ext-request.h"
+
+// Measures the parsing of the requests in seadrive gui, which is done for
+// every icon overlay query of Explorer.
+
+namespace {
+
+const int kRounds = 2000000;
+
+} // namespace
+
+int main()
+{
+    std::vector<std::string> requests;
+    requests.push_back(seafile::protocol::formatTaggedMessage(
+        1, "get-file-status\tc:/seadrive/my libraries/docs/report 2024.docx"));
+    requests.push_back(seafile::protocol::formatTaggedMessage(
+        2, "is-file-cached\tc:/seadrive/my libraries/photos/img_0001.jpg"));
+    requests.push_back(seafile::protocol::formatTaggedMessage(
+        3, "get-dir-status\tc:/seadrive/my libraries/photos"));
+    requests.push_back(seafile::protocol::formatTaggedMessage(
+        4, "list-repos\t1700000000000"));
+
+    size_t args = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kRounds; i++) {
+        const std::string& raw = requests[i % requests.size()];
+        ExtRequest req;
+        if (parseExtRequest(raw.data(), raw.size(), true, &req)) {
+            args += req.n_args + req.command;
+        }
+    }
+    std::chrono::duration<double, std::nano> d = std::chrono::steady_clock::now() - start;
+
+    printf("parse: %.1f ns per request (%zu)\n", d.count() / kRounds, args);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "repo-index.h"
+
+// Compares the lookups of RepoIndex with the linear scan it replaced, with
+// a sync root and `n_repos` repos in it. Usage: bench-repo-index [n_repos]
+
+using seafile::RepoIndex;
+using seafile::RepoInfo;
+using seafile::RepoInfoList;
+
+namespace {
+
+const int kLookups = 200000;
+
+const RepoInfo *scanOutermost(const RepoInfoList& repos, const std::string& path)
+{
+    for (size_t i = 0; i < repos.size(); i++) {
+        const std::string& dir = repos[i].topdir;
+        if (path.compare(0, dir.size(), dir) == 0 &&
+            (path.size() == dir.size() || path[dir.size()] == '/')) {
+            return &repos[i];
+        }
+    }
+    return NULL;
+}
+
+double nsecsSince(std::chrono::steady_clock::time_point start, int n)
+{
+    std::chrono::duration<double, std::nano> d =
+        std::chrono::steady_clock::now() - start;
+    return d.count() / n;
+}
+
+void bench(const RepoInfoList& repos, const std::vector<std::string>& paths,
+           const char *what)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    RepoIndex index(repos, 1);
+    double build_nsecs = nsecsSince(start, 1);
+
+    size_t found = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kLookups; i++) {
+        std::string path_in_repo;
+        found += index.findOutermost(paths[i % paths.size()], &path_in_repo) != NULL;
+    }
+    double index_nsecs = nsecsSince(start, kLookups);
+
+    // The old code copied the list out of the cache for every lookup. It's
+    // much slower, so it's run fewer times.
+    int scans = kLookups / 100;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < scans; i++) {
+        RepoInfoList copy = repos;
+        found += scanOutermost(copy, paths[i % paths.size()]) != NULL;
+    }
+    double scan_nsecs = nsecsSince(start, scans);
+
+    printf("%-18s index %8.0f ns   scan %10.0f ns   (build %.0f us, %zu found)\n",
+           what, index_nsecs, scan_nsecs, build_nsecs / 1000, found);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int n_repos = argc > 1 ? atoi(argv[1]) : 10000;
+    if (n_repos <= 0) {
+        fprintf(stderr, "usage: %s [n_repos]\n", argv[0]);
+        return 1;
+    }
+
+    RepoInfoList repos;
+    repos.push_back(RepoInfo("c:/seadrive"));
+    for (int i = 0; i < n_repos; i++) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "c:/seadrive/my libraries/repo %d", i);
+        repos.push_back(RepoInfo(buf));
+    }
+
+    std::vector<std::string> inside, outside;
+    srand(1);
+    for (int i = 0; i < 1000; i++) {
+        char buf[128];
+        snprintf(buf, sizeof(buf), "c:/seadrive/my libraries/repo %d/dir/file %d.txt",
+                 rand() % n_repos, i);
+        inside.push_back(buf);
+        // Explorer also asks about every file outside of the drive.
+        snprintf(buf, sizeof(buf), "c:/users/me/documents/file %d.txt", i);
+        outside.push_back(buf);
+    }
+
+    printf("%d repos\n", n_repos);
+    bench(repos, inside, "inside the drive");
+    bench(repos, outside, "outside the drive");
+    return 0;
+}
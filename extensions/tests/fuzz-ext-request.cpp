@@ -0,0 +1,209 @@
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "ext-protocol.h"
+#include "../src/ext-request.h"
+#include "test-utils.h"
+
+// Fuzzes the parser of the requests in seadrive gui (src/ext-request.cpp)
+// with what the extension sends. Built with EXT_LIBFUZZER it's a libFuzzer
+// target, otherwise it runs the seeds and random mutations of them.
+
+namespace {
+
+const char *kCommands[] = {
+    "hello", "subscribe-status-changes", "list-repos", "get-share-link",
+    "get-internal-link", "get-file-status", "get-dir-status", "lock-file",
+    "unlock-file", "private-share-to-group", "private-share-to-user",
+    "show-history", "show-locked-by", "get-upload-link", "download",
+    "is-file-cached", "get-thumbnail-from-server", "prefetch-links",
+};
+
+const int kMutations = 200000;
+
+bool inBuffer(const ExtToken& token, const char *buf, size_t len)
+{
+    return token.data >= buf && token.data + token.len <= buf + len;
+}
+
+bool hasTab(const ExtToken& token)
+{
+    return memchr(token.data, '\t', token.len) != NULL;
+}
+
+bool isKnownCommand(const char *name, size_t len)
+{
+    for (size_t i = 0; i < sizeof(kCommands) / sizeof(kCommands[0]); i++) {
+        if (strlen(kCommands[i]) == len && memcmp(kCommands[i], name, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void checkParse(const char *buf, size_t len, bool tagged)
+{
+    ExtRequest req;
+    if (!parseExtRequest(buf, len, tagged, &req)) {
+        return;
+    }
+
+    TEST_CHECK(req.n_args >= 0 && req.n_args <= kMaxExtRequestArgs);
+    TEST_CHECK(inBuffer(req.id, buf, len));
+    TEST_CHECK(inBuffer(req.name, buf, len));
+    TEST_CHECK(req.name.len > 0);
+    TEST_CHECK(!hasTab(req.id) && !hasTab(req.name));
+    TEST_CHECK_EQ(req.id.len > 0, tagged);
+    TEST_CHECK_EQ(req.command != EXT_CMD_UNKNOWN,
+                  isKnownCommand(req.name.data, req.name.len));
+
+    // The tokens joined by tabs must give back the request.
+    std::string joined;
+    if (tagged) {
+        joined.append(req.id.data, req.id.len);
+        joined += '\t';
+    }
+    joined.append(req.name.data, req.name.len);
+    for (int i = 0; i < req.n_args; i++) {
+        TEST_CHECK(inBuffer(req.args[i], buf, len));
+        TEST_CHECK(!hasTab(req.args[i]));
+        joined += '\t';
+        joined.append(req.args[i].data, req.args[i].len);
+    }
+    TEST_CHECK(joined == std::string(buf, len));
+}
+
+void checkParseId(const char *buf, size_t len)
+{
+    ExtToken id;
+    if (!parseExtRequestId(buf, len, &id)) {
+        return;
+    }
+    TEST_CHECK(id.data == buf && id.len > 0 && id.len < len);
+    TEST_CHECK_EQ(buf[id.len], '\t');
+    for (size_t i = 0; i < id.len; i++) {
+        TEST_CHECK(buf[i] >= '0' && buf[i] <= '9');
+    }
+}
+
+void checkOne(const char *buf, size_t len)
+{
+    checkParse(buf, len, false);
+    checkParse(buf, len, true);
+    checkParseId(buf, len);
+}
+
+std::vector<std::string> seeds()
+{
+    std::vector<std::string> seeds;
+    for (size_t i = 0; i < sizeof(kCommands) / sizeof(kCommands[0]); i++) {
+        std::string body = std::string(kCommands[i]) + "\tc:/seadrive/my libraries/docs/a.txt";
+        seeds.push_back(body);
+        // As the extension sends them in version 2.
+        seeds.push_back(seafile::protocol::formatTaggedMessage(i * 7919, body));
+    }
+    seeds.push_back(seafile::protocol::formatHello());
+    seeds.push_back("get-thumbnail-from-server\tc:/a.png\t128");
+    seeds.push_back("12\tlist-repos\t1700000000000");
+    return seeds;
+}
+
+void mutate(std::string *s)
+{
+    static const char interesting[] = "\t\n0/\\";
+    int n = 1 + rand() % 4;
+    for (int i = 0; i < n; i++) {
+        size_t pos = s->empty() ? 0 : rand() % s->size();
+        switch (rand() % 5) {
+        case 0:
+            if (!s->empty()) {
+                (*s)[pos] = (char)(rand() % 256);
+            }
+            break;
+        case 1:
+            s->insert(pos, 1, interesting[rand() % (sizeof(interesting) - 1)]);
+            break;
+        case 2:
+            if (!s->empty()) {
+                s->erase(pos, 1 + rand() % 8);
+            }
+            break;
+        case 3:
+            s->resize(pos);
+            break;
+        default:
+            s->insert(pos, "\t\t");
+            break;
+        }
+    }
+}
+
+} // namespace
+
+#if defined(EXT_LIBFUZZER)
+
+namespace seafile { namespace test { int failures = 0; } }
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    checkOne((const char *)data, size);
+    if (seafile::test::failures) {
+        abort();
+    }
+    return 0;
+}
+
+#else
+
+namespace {
+
+void testSeeds()
+{
+    std::vector<std::string> all = seeds();
+    for (size_t i = 0; i < all.size(); i++) {
+        checkOne(all[i].data(), all[i].size());
+    }
+
+    // The seeds themselves must be parsed.
+    ExtRequest req;
+    std::string tagged = seafile::protocol::formatTaggedMessage(42, "get-file-status\tc:/a");
+    TEST_CHECK(parseExtRequest(tagged.data(), tagged.size(), true, &req));
+    TEST_CHECK_EQ(req.command, EXT_CMD_GET_FILE_STATUS);
+    TEST_CHECK_EQ(std::string(req.id.data, req.id.len), std::string("42"));
+    TEST_CHECK_EQ(req.n_args, 1);
+
+    // Empty arguments are kept, too many are refused.
+    std::string body = "lock-file\t\t";
+    TEST_CHECK(parseExtRequest(body.data(), body.size(), false, &req));
+    TEST_CHECK_EQ(req.n_args, 2);
+    TEST_CHECK_EQ(req.args[1].len, (size_t)0);
+    body = "download\t1\t2\t3\t4\t5";
+    TEST_CHECK(!parseExtRequest(body.data(), body.size(), false, &req));
+
+    TEST_CHECK(!parseExtRequest("", 0, false, &req));
+    TEST_CHECK(!parseExtRequest("\tlist-repos", 11, false, &req));
+    TEST_CHECK(!parseExtRequest("7", 1, true, &req));
+    TEST_CHECK(!parseExtRequest("7\t", 2, true, &req));
+}
+
+void testMutations()
+{
+    std::vector<std::string> all = seeds();
+    srand(1);
+    for (int i = 0; i < kMutations; i++) {
+        std::string s = all[rand() % all.size()];
+        mutate(&s);
+        // Not null terminated, so reading past the end would be caught by
+        // the sanitizers.
+        std::vector<char> buf(s.begin(), s.end());
+        checkOne(buf.data(), buf.size());
+    }
+}
+
+} // namespace
+
+TEST_DEFINE_MAIN(testSeeds, testMutations)
+
+#endif
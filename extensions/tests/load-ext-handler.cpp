@@ -0,0 +1,334 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ext-protocol.h"
+
+// Load test of the extension request engine of a running seadrive gui. Each
+// client connects to the extension socket like a file manager plugin, and
+// keeps a window of requests in flight about the given paths. The throughput
+// and the latencies are reported per command.
+//
+//   load-ext-handler [-s <socket>] [-c <clients>] [-w <window>] [-t <secs>] <path>...
+//
+// Only the commands that don't change anything or open a window are sent.
+
+using namespace seafile::protocol;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const char *kDefaultSocket = ".seadrive/data/seadrive_ext.sock";
+
+#if defined(MSG_NOSIGNAL)
+const int kSendFlags = MSG_NOSIGNAL;
+#else
+const int kSendFlags = 0;
+#endif
+
+const char *kCommands[] = {
+    "get-file-status",
+    "is-file-cached",
+    "get-dir-status",
+    "list-repos",
+};
+const int kNumCommands = sizeof(kCommands) / sizeof(kCommands[0]);
+
+struct Options {
+    std::string socket_path;
+    int clients;
+    int window;
+    int seconds;
+    std::vector<std::string> paths;
+};
+
+struct CommandStats {
+    std::vector<double> latencies_usecs;
+    uint64_t empty_responses;
+
+    CommandStats() : empty_responses(0) {}
+};
+
+struct ClientStats {
+    CommandStats commands[kNumCommands];
+    bool failed;
+
+    ClientStats() : failed(false) {}
+};
+
+bool readN(int fd, void *buf, size_t len)
+{
+    char *p = (char *)buf;
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool writeN(int fd, const void *buf, size_t len)
+{
+    const char *p = (const char *)buf;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, kSendFlags);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool sendMessage(int fd, const std::string& body)
+{
+    uint32_t len = body.size();
+    return writeN(fd, &len, sizeof(len)) && writeN(fd, body.data(), len);
+}
+
+bool recvMessage(int fd, std::string *body)
+{
+    uint32_t len;
+    if (!readN(fd, &len, sizeof(len))) {
+        return false;
+    }
+    body->resize(len);
+    return len == 0 || readN(fd, &(*body)[0], len);
+}
+
+int connectTo(const std::string& path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "socket path %s is too long\n", path.c_str());
+        return -1;
+    }
+    memcpy(addr.sun_path, path.data(), path.size());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "failed to connect to %s: %s\n", path.c_str(), strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+struct InFlight {
+    int command;
+    Clock::time_point sent;
+};
+
+void runClient(const Options& options, int client, ClientStats *stats)
+{
+    int fd = connectTo(options.socket_path);
+    if (fd < 0) {
+        stats->failed = true;
+        return;
+    }
+
+    std::string resp;
+    if (!sendMessage(fd, formatHello()) || !recvMessage(fd, &resp)) {
+        stats->failed = true;
+        close(fd);
+        return;
+    }
+    bool tagged = parseHelloResponse(resp) >= 2;
+    // Version 1 only has one request in flight.
+    int window = tagged ? options.window : 1;
+
+    std::map<uint32_t, InFlight> in_flight;
+    uint32_t next_id = 0;
+    unsigned int seed = client + 1;
+    Clock::time_point deadline = Clock::now() + std::chrono::seconds(options.seconds);
+
+    while (true) {
+        bool sending = Clock::now() < deadline;
+        while (sending && (int)in_flight.size() < window) {
+            int command = rand_r(&seed) % kNumCommands;
+            std::string body = kCommands[command];
+            if (command != kNumCommands - 1) {
+                body += '\t';
+                body += options.paths[rand_r(&seed) % options.paths.size()];
+            }
+            uint32_t id = next_id++;
+            if (tagged) {
+                body = formatTaggedMessage(id, body);
+            }
+            InFlight req = { command, Clock::now() };
+            in_flight[id] = req;
+            if (!sendMessage(fd, body)) {
+                stats->failed = true;
+                close(fd);
+                return;
+            }
+        }
+        if (in_flight.empty()) {
+            break;
+        }
+
+        if (!recvMessage(fd, &resp)) {
+            stats->failed = true;
+            break;
+        }
+        Clock::time_point now = Clock::now();
+
+        uint32_t id = in_flight.begin()->first;
+        std::string body = resp;
+        if (tagged && !parseTaggedMessage(resp, &id, &body)) {
+            fprintf(stderr, "got a malformed response\n");
+            stats->failed = true;
+            break;
+        }
+        std::map<uint32_t, InFlight>::iterator it = in_flight.find(id);
+        if (it == in_flight.end()) {
+            fprintf(stderr, "got a response to unknown request %u\n", id);
+            stats->failed = true;
+            break;
+        }
+
+        CommandStats& cs = stats->commands[it->second.command];
+        std::chrono::duration<double, std::micro> d = now - it->second.sent;
+        cs.latencies_usecs.push_back(d.count());
+        if (body.empty()) {
+            cs.empty_responses++;
+        }
+        in_flight.erase(it);
+    }
+
+    close(fd);
+}
+
+double percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t i = (size_t)(p * (sorted.size() - 1));
+    return sorted[i];
+}
+
+void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-s <socket>] [-c <clients>] [-w <window>] [-t <secs>] <path>...\n"
+            "\n"
+            "  -s  the extension socket of seadrive gui, ~/%s by default\n"
+            "  -c  concurrent clients, 100 by default\n"
+            "  -w  requests in flight per client, 8 by default\n"
+            "  -t  duration in seconds, 10 by default\n",
+            prog, kDefaultSocket);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    options.clients = 100;
+    options.window = 8;
+    options.seconds = 10;
+    const char *home = getenv("HOME");
+    options.socket_path = std::string(home ? home : ".") + "/" + kDefaultSocket;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:c:w:t:h")) != -1) {
+        switch (opt) {
+        case 's':
+            options.socket_path = optarg;
+            break;
+        case 'c':
+            options.clients = atoi(optarg);
+            break;
+        case 'w':
+            options.window = atoi(optarg);
+            break;
+        case 't':
+            options.seconds = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    for (int i = optind; i < argc; i++) {
+        options.paths.push_back(argv[i]);
+    }
+    if (options.paths.empty() || options.clients <= 0 ||
+        options.window <= 0 || options.seconds <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<ClientStats> stats(options.clients);
+    std::vector<std::thread> threads;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < options.clients; i++) {
+        threads.push_back(std::thread(runClient, std::cref(options), i, &stats[i]));
+    }
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+
+    int failed_clients = 0;
+    uint64_t total = 0;
+    printf("%d clients, %d in flight each, %.1fs\n\n",
+           options.clients, options.window, elapsed.count());
+    printf("%-16s %10s %10s %8s %10s %10s %10s\n",
+           "command", "requests", "req/s", "empty", "p50 us", "p99 us", "max us");
+    for (int c = 0; c < kNumCommands; c++) {
+        std::vector<double> latencies;
+        uint64_t empty = 0;
+        for (size_t i = 0; i < stats.size(); i++) {
+            const CommandStats& cs = stats[i].commands[c];
+            latencies.insert(latencies.end(), cs.latencies_usecs.begin(),
+                             cs.latencies_usecs.end());
+            empty += cs.empty_responses;
+        }
+        std::sort(latencies.begin(), latencies.end());
+        total += latencies.size();
+        printf("%-16s %10zu %10.0f %8llu %10.0f %10.0f %10.0f\n",
+               kCommands[c], latencies.size(), latencies.size() / elapsed.count(),
+               (unsigned long long)empty, percentile(latencies, 0.5),
+               percentile(latencies, 0.99), percentile(latencies, 1));
+    }
+    for (size_t i = 0; i < stats.size(); i++) {
+        failed_clients += stats[i].failed;
+    }
+    printf("\n%llu requests, %.0f req/s", (unsigned long long)total, total / elapsed.count());
+    if (failed_clients > 0) {
+        printf(", %d clients failed", failed_clients);
+    }
+    printf("\n");
+
+    return failed_clients > 0 ? 1 : 0;
+}
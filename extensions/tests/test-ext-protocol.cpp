@@ -0,0 +1,121 @@
+#include <string>
+
+#include "ext-protocol.h"
+#include "test-utils.h"
+
+using namespace seafile;
+using namespace seafile::protocol;
+
+namespace {
+
+void testHello()
+{
+    TEST_CHECK_EQ(formatHello(), std::string("hello\t2"));
+
+    TEST_CHECK_EQ(parseHelloResponse("2"), 2);
+    TEST_CHECK_EQ(parseHelloResponse("1"), 1);
+    // Old versions of seadrive gui answer unknown commands with nothing.
+    TEST_CHECK_EQ(parseHelloResponse(""), 1);
+    TEST_CHECK_EQ(parseHelloResponse("garbage"), 1);
+    TEST_CHECK_EQ(parseHelloResponse("-3"), 1);
+    // A later gui must not switch us to a version we don't speak.
+    TEST_CHECK_EQ(parseHelloResponse("9"), kProtocolVersion);
+}
+
+void testTaggedMessage()
+{
+    uint32_t id = 0;
+    std::string body;
+
+    std::string raw = formatTaggedMessage(17, "get-file-status\tc:/a/b");
+    TEST_CHECK_EQ(raw, std::string("17\tget-file-status\tc:/a/b"));
+    TEST_CHECK(parseTaggedMessage(raw, &id, &body));
+    TEST_CHECK_EQ(id, (uint32_t)17);
+    TEST_CHECK_EQ(body, std::string("get-file-status\tc:/a/b"));
+
+    // Empty responses, and responses with tabs and newlines in them.
+    TEST_CHECK(parseTaggedMessage(formatTaggedMessage(0, ""), &id, &body));
+    TEST_CHECK_EQ(id, (uint32_t)0);
+    TEST_CHECK_EQ(body, std::string(""));
+    TEST_CHECK(parseTaggedMessage(formatTaggedMessage(UINT32_MAX, "ok\na\tsynced"),
+                                  &id, &body));
+    TEST_CHECK_EQ(id, (uint32_t)UINT32_MAX);
+    TEST_CHECK_EQ(body, std::string("ok\na\tsynced"));
+
+    TEST_CHECK(!parseTaggedMessage("", &id, &body));
+    TEST_CHECK(!parseTaggedMessage("17", &id, &body));
+    TEST_CHECK(!parseTaggedMessage("\tsynced", &id, &body));
+    TEST_CHECK(!parseTaggedMessage("1a\tsynced", &id, &body));
+    TEST_CHECK(!parseTaggedMessage("-1\tsynced", &id, &body));
+    // Would wrap around to an id that may be in flight.
+    TEST_CHECK(!parseTaggedMessage("4294967296\tsynced", &id, &body));
+    TEST_CHECK(!parseTaggedMessage("99999999999999999999\tsynced", &id, &body));
+}
+
+void testFileStatus()
+{
+    TEST_CHECK_EQ(parseFileStatus("syncing"), Syncing);
+    TEST_CHECK_EQ(parseFileStatus("error"), Error);
+    TEST_CHECK_EQ(parseFileStatus("synced"), Synced);
+    TEST_CHECK_EQ(parseFileStatus("partial_synced"), PartialSynced);
+    TEST_CHECK_EQ(parseFileStatus("cloud"), Cloud);
+    TEST_CHECK_EQ(parseFileStatus("readonly"), ReadOnly);
+    TEST_CHECK_EQ(parseFileStatus("locked"), LockedByOthers);
+    TEST_CHECK_EQ(parseFileStatus("locked_by_me"), LockedByMe);
+    TEST_CHECK_EQ(parseFileStatus(""), None);
+    TEST_CHECK_EQ(parseFileStatus("none"), None);
+    TEST_CHECK_EQ(parseFileStatus("synced\n"), None);
+}
+
+void testDirStatus()
+{
+    DirStatusList entries;
+    TEST_CHECK(parseDirStatus("ok\na.txt\tlocked\tcached\nb c\tnone\tuncached\n"
+                              "d\tlocked_by_me\tcached",
+                              &entries));
+    TEST_CHECK_EQ(entries.size(), (size_t)3);
+    if (entries.size() == 3) {
+        TEST_CHECK_EQ(entries[0].name, std::string("a.txt"));
+        TEST_CHECK_EQ(entries[0].status, LockedByOthers);
+        TEST_CHECK(entries[0].cached);
+        TEST_CHECK_EQ(entries[1].name, std::string("b c"));
+        TEST_CHECK_EQ(entries[1].status, None);
+        TEST_CHECK(!entries[1].cached);
+        TEST_CHECK_EQ(entries[2].status, LockedByMe);
+        TEST_CHECK(entries[2].cached);
+    }
+
+    // An empty folder.
+    entries.clear();
+    TEST_CHECK(parseDirStatus("ok", &entries));
+    TEST_CHECK(entries.empty());
+
+    // The fields added by later versions are ignored, broken lines skipped,
+    // and entries without the cached field are uncached.
+    entries.clear();
+    TEST_CHECK(parseDirStatus("ok\na\tlocked\tcached\textra\n\tsynced\nnotab\n\nb\tsynced\n",
+                              &entries));
+    TEST_CHECK_EQ(entries.size(), (size_t)2);
+    if (entries.size() == 2) {
+        TEST_CHECK_EQ(entries[0].name, std::string("a"));
+        TEST_CHECK_EQ(entries[0].status, LockedByOthers);
+        TEST_CHECK(entries[0].cached);
+        TEST_CHECK_EQ(entries[1].name, std::string("b"));
+        TEST_CHECK_EQ(entries[1].status, Synced);
+        TEST_CHECK(!entries[1].cached);
+    }
+
+    // Errors, and guis that don't know the command.
+    entries.clear();
+    TEST_CHECK(!parseDirStatus("error", &entries));
+    TEST_CHECK(!parseDirStatus("", &entries));
+    TEST_CHECK(!parseDirStatus("a\tlocked", &entries));
+    TEST_CHECK(entries.empty());
+}
+
+} // namespace
+
+TEST_DEFINE_MAIN(testHello,
+                 testTaggedMessage,
+                 testFileStatus,
+                 testDirStatus)
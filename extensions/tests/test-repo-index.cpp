@@ -0,0 +1,204 @@
+#include <stdlib.h>
+
+#include "repo-index.h"
+#include "test-utils.h"
+
+using seafile::RepoIndex;
+using seafile::RepoInfo;
+using seafile::RepoInfoList;
+
+namespace {
+
+RepoInfo makeRepo(const std::string& topdir, bool support_file_lock = false)
+{
+    RepoInfo repo(topdir);
+    repo.support_file_lock = support_file_lock;
+    repo.support_private_share = false;
+    return repo;
+}
+
+bool isPrefix(const std::string& dir, const std::string& path)
+{
+    return path.compare(0, dir.size(), dir) == 0 &&
+        (path.size() == dir.size() || path[dir.size()] == '/');
+}
+
+// What the linear scan used to return: the first folder of the list that
+// contains the path, where the outer folders are listed first.
+const RepoInfo *scanOutermost(const RepoInfoList& repos, const std::string& path)
+{
+    const RepoInfo *found = NULL;
+    for (size_t i = 0; i < repos.size(); i++) {
+        if (isPrefix(repos[i].topdir, path) &&
+            (!found || repos[i].topdir.size() < found->topdir.size())) {
+            found = &repos[i];
+        }
+    }
+    return found;
+}
+
+void testEmpty()
+{
+    RepoIndex index(RepoInfoList(), 7);
+    TEST_CHECK_EQ(index.size(), (size_t)0);
+    TEST_CHECK_EQ(index.version(), (uint64_t)7);
+    TEST_CHECK(index.findOutermost("c:/seadrive/a", NULL) == NULL);
+    TEST_CHECK(index.findTopDir("c:/seadrive") == NULL);
+}
+
+void testOutermost()
+{
+    RepoInfoList repos;
+    repos.push_back(makeRepo("c:/seadrive/my libraries/docs"));
+    repos.push_back(makeRepo("c:/seadrive"));
+    repos.push_back(makeRepo("c:/seadrive/shared with me/photos"));
+    RepoIndex index(repos, 1);
+
+    std::string path_in_repo;
+    const RepoInfo *info = index.findOutermost(
+        "c:/seadrive/my libraries/docs/a.txt", &path_in_repo);
+    TEST_CHECK(info != NULL && info->topdir == "c:/seadrive");
+    TEST_CHECK_EQ(path_in_repo, std::string("/my libraries/docs/a.txt"));
+
+    info = index.findOutermost("c:/seadrive", &path_in_repo);
+    TEST_CHECK(info != NULL && info->topdir == "c:/seadrive");
+    TEST_CHECK_EQ(path_in_repo, std::string(""));
+
+    // Shares the prefix, but isn't in the folder.
+    TEST_CHECK(index.findOutermost("c:/seadrive2/a", NULL) == NULL);
+    TEST_CHECK(index.findOutermost("c:/seadriv", NULL) == NULL);
+    TEST_CHECK(index.findOutermost("c:/", NULL) == NULL);
+}
+
+// In plain byte order " " and "-" come before "/", which puts "a/b c" and
+// "a/b-c" between "a/b" and "a/b/c". The index must still find "a/b" as the
+// parent of "a/b/c".
+void testSeparatorOrder()
+{
+    RepoInfoList repos;
+    repos.push_back(makeRepo("/r/a/b c"));
+    repos.push_back(makeRepo("/r/a/b-c"));
+    repos.push_back(makeRepo("/r/a/b/c"));
+    repos.push_back(makeRepo("/r/a/b.d"));
+    repos.push_back(makeRepo("/r/a/b"));
+    RepoIndex index(repos, 1);
+
+    std::string path_in_repo;
+    const RepoInfo *info = index.findOutermost("/r/a/b/c/x", &path_in_repo);
+    TEST_CHECK(info != NULL && info->topdir == "/r/a/b");
+    TEST_CHECK_EQ(path_in_repo, std::string("/c/x"));
+
+    info = index.findOutermost("/r/a/b-c/x", &path_in_repo);
+    TEST_CHECK(info != NULL && info->topdir == "/r/a/b-c");
+    info = index.findOutermost("/r/a/b c", &path_in_repo);
+    TEST_CHECK(info != NULL && info->topdir == "/r/a/b c");
+    TEST_CHECK(index.findOutermost("/r/a/b0", NULL) == NULL);
+    TEST_CHECK(index.findOutermost("/r/a", NULL) == NULL);
+
+    TEST_CHECK(index.findTopDir("/r/a/b/c") != NULL);
+    TEST_CHECK(index.findTopDir("/r/a/b.d") != NULL);
+    TEST_CHECK(index.findTopDir("/r/a/b/c/x") == NULL);
+    TEST_CHECK(index.findTopDir("/r/a/b/") == NULL);
+}
+
+// A folder after a sibling's whole subtree must skip it on the parent
+// chain, e.g. "/r/b/z" is right after "/r/b/a/deep" in the order.
+void testParentChain()
+{
+    RepoInfoList repos;
+    repos.push_back(makeRepo("/r"));
+    repos.push_back(makeRepo("/r/b"));
+    repos.push_back(makeRepo("/r/b/a"));
+    repos.push_back(makeRepo("/r/b/a/deep"));
+    repos.push_back(makeRepo("/r/b/z"));
+    repos.push_back(makeRepo("/r/c"));
+    RepoIndex index(repos, 1);
+
+    std::string path_in_repo;
+    const RepoInfo *info = index.findOutermost("/r/b/z/1", &path_in_repo);
+    TEST_CHECK(info != NULL && info->topdir == "/r");
+    TEST_CHECK_EQ(path_in_repo, std::string("/b/z/1"));
+
+    // Between "/r/b/a/deep" and "/r/b/z" in the order, but only in "/r/b".
+    TEST_CHECK(index.findTopDir("/r/b/m") == NULL);
+    info = index.findOutermost("/r/b/m", &path_in_repo);
+    TEST_CHECK(info != NULL && info->topdir == "/r");
+    TEST_CHECK_EQ(path_in_repo, std::string("/b/m"));
+}
+
+void testDuplicates()
+{
+    RepoInfoList repos;
+    repos.push_back(makeRepo("/r/a", true));
+    repos.push_back(makeRepo("/r/b"));
+    repos.push_back(makeRepo("/r/a", false));
+    RepoIndex index(repos, 1);
+
+    TEST_CHECK_EQ(index.size(), (size_t)2);
+    // The first one is kept, like the linear scan did.
+    const RepoInfo *info = index.findTopDir("/r/a");
+    TEST_CHECK(info != NULL && info->support_file_lock);
+}
+
+std::string randomName()
+{
+    // Few letters and the characters around "/", so the names collide.
+    static const char chars[] = "ab -.0";
+    std::string name;
+    int len = 1 + rand() % 3;
+    for (int i = 0; i < len; i++) {
+        name += chars[rand() % (sizeof(chars) - 1)];
+    }
+    return name;
+}
+
+std::string randomPath(int max_depth)
+{
+    std::string path = "/r";
+    int depth = 1 + rand() % max_depth;
+    for (int i = 0; i < depth; i++) {
+        path += "/" + randomName();
+    }
+    return path;
+}
+
+// Compare with the linear scan on random nested folders.
+void testAgainstScan()
+{
+    srand(1);
+    for (int round = 0; round < 20; round++) {
+        RepoInfoList repos;
+        int n = 1 + rand() % 200;
+        for (int i = 0; i < n; i++) {
+            repos.push_back(makeRepo(randomPath(4)));
+        }
+        RepoIndex index(repos, 1);
+
+        for (int i = 0; i < 1000; i++) {
+            std::string path = randomPath(6);
+            const RepoInfo *expected = scanOutermost(repos, path);
+            std::string path_in_repo;
+            const RepoInfo *info = index.findOutermost(path, &path_in_repo);
+            TEST_CHECK_EQ(info == NULL, expected == NULL);
+            if (info && expected) {
+                TEST_CHECK_EQ(info->topdir, expected->topdir);
+                TEST_CHECK_EQ(path_in_repo, path.substr(expected->topdir.size()));
+            }
+
+            bool is_topdir = false;
+            for (size_t j = 0; j < repos.size(); j++) {
+                is_topdir = is_topdir || repos[j].topdir == path;
+            }
+            TEST_CHECK_EQ(index.findTopDir(path) != NULL, is_topdir);
+        }
+    }
+}
+
+} // namespace
+
+TEST_DEFINE_MAIN(testEmpty,
+                 testOutermost,
+                 testSeparatorOrder,
+                 testParentChain,
+                 testDuplicates,
+                 testAgainstScan)
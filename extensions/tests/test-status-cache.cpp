@@ -0,0 +1,125 @@
+#include "status-cache.h"
+#include "test-utils.h"
+
+using seafile::StatusCache;
+using seafile::Status;
+
+namespace {
+
+const uint64_t kExpireMSecs = 1000;
+
+void testNormalizeKey()
+{
+    TEST_CHECK_EQ(StatusCache::normalizeKey("C:\\SeaDrive\\My Libraries\\"),
+                  std::string("c:/seadrive/my libraries"));
+    TEST_CHECK_EQ(StatusCache::normalizeKey("/home/u/SeaDrive//"),
+                  std::string("/home/u/seadrive"));
+    TEST_CHECK_EQ(StatusCache::normalizeKey(""), std::string(""));
+}
+
+void testGetSet()
+{
+    StatusCache cache(kExpireMSecs, 100);
+    Status status;
+    TEST_CHECK(!cache.get("c:/a/b", 0, &status));
+
+    cache.set("C:\\A\\b", seafile::Synced, 0);
+    // All the handlers of one file share the entry, whatever the spelling.
+    TEST_CHECK(cache.get("c:/a/B/", 10, &status));
+    TEST_CHECK_EQ(status, seafile::Synced);
+
+    cache.set("c:/a/b", seafile::Syncing, 20);
+    TEST_CHECK(cache.get("c:/a/b", 30, &status));
+    TEST_CHECK_EQ(status, seafile::Syncing);
+    TEST_CHECK_EQ(cache.size(), (size_t)1);
+}
+
+void testExpire()
+{
+    StatusCache cache(kExpireMSecs, 100);
+    Status status;
+    cache.set("c:/a", seafile::Synced, 100);
+    TEST_CHECK(cache.get("c:/a", 100 + kExpireMSecs - 1, &status));
+    TEST_CHECK(!cache.get("c:/a", 100 + kExpireMSecs, &status));
+
+    cache.setExpireMSecs(10 * kExpireMSecs);
+    TEST_CHECK(cache.get("c:/a", 100 + kExpireMSecs, &status));
+}
+
+void testInvalidateDescendants()
+{
+    StatusCache cache(kExpireMSecs, 100);
+    Status status;
+    cache.set("c:/a/b", seafile::Synced, 0);
+    cache.set("c:/a/b/c", seafile::Synced, 0);
+    cache.set("c:/a/b/c/d", seafile::Synced, 0);
+    // Siblings sharing the prefix, on both sides of "/" in the order.
+    cache.set("c:/a/b.txt", seafile::Synced, 0);
+    cache.set("c:/a/b0", seafile::Synced, 0);
+    cache.set("c:/a/bc", seafile::Synced, 0);
+    cache.set("c:/a", seafile::Synced, 0);
+
+    cache.invalidate("C:\\a\\B\\");
+
+    TEST_CHECK(!cache.get("c:/a/b", 0, &status));
+    TEST_CHECK(!cache.get("c:/a/b/c", 0, &status));
+    TEST_CHECK(!cache.get("c:/a/b/c/d", 0, &status));
+    TEST_CHECK(cache.get("c:/a/b.txt", 0, &status));
+    TEST_CHECK(cache.get("c:/a/b0", 0, &status));
+    TEST_CHECK(cache.get("c:/a/bc", 0, &status));
+    TEST_CHECK(cache.get("c:/a", 0, &status));
+    TEST_CHECK_EQ(cache.size(), (size_t)4);
+}
+
+void testApplyChanges()
+{
+    StatusCache cache(kExpireMSecs, 100);
+    Status status;
+    cache.set("c:/a/x", seafile::Synced, 0);
+    cache.set("c:/a/y", seafile::Synced, 0);
+    cache.set("c:/b", seafile::Synced, 0);
+
+    // Empty lines, e.g. the keep-alive messages, change nothing.
+    cache.applyChanges("");
+    cache.applyChanges("\n\n");
+    TEST_CHECK_EQ(cache.size(), (size_t)3);
+
+    cache.applyChanges("c:/a/x\nc:/b");
+    TEST_CHECK(!cache.get("c:/a/x", 0, &status));
+    TEST_CHECK(cache.get("c:/a/y", 0, &status));
+    TEST_CHECK(!cache.get("c:/b", 0, &status));
+
+    cache.set("c:/b", seafile::Synced, 0);
+    cache.applyChanges("c:/b\n*\nc:/c");
+    TEST_CHECK_EQ(cache.size(), (size_t)0);
+}
+
+void testMaxEntries()
+{
+    StatusCache cache(kExpireMSecs, 3);
+    Status status;
+    cache.set("c:/1", seafile::Synced, 0);
+    cache.set("c:/2", seafile::Synced, 0);
+    cache.set("c:/3", seafile::Synced, 600);
+
+    // The expired entries are dropped first.
+    cache.set("c:/4", seafile::Synced, 1200);
+    TEST_CHECK_EQ(cache.size(), (size_t)2);
+    TEST_CHECK(cache.get("c:/3", 1200, &status));
+    TEST_CHECK(cache.get("c:/4", 1200, &status));
+
+    // Then everything, if none has expired.
+    cache.set("c:/5", seafile::Synced, 1200);
+    cache.set("c:/6", seafile::Synced, 1200);
+    TEST_CHECK_EQ(cache.size(), (size_t)1);
+    TEST_CHECK(cache.get("c:/6", 1200, &status));
+}
+
+} // namespace
+
+TEST_DEFINE_MAIN(testNormalizeKey,
+                 testGetSet,
+                 testExpire,
+                 testInvalidateDescendants,
+                 testApplyChanges,
+                 testMaxEntries)
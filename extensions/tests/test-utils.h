@@ -0,0 +1,44 @@
+#ifndef SEAFILE_EXTENSION_TEST_UTILS_H
+#define SEAFILE_EXTENSION_TEST_UTILS_H
+
+#include <stdio.h>
+
+// The extension core is built without any test framework, so the tests use
+// these checks. A failed check is reported and the test goes on, main()
+// returns the number of failures.
+
+namespace seafile {
+namespace test {
+
+extern int failures;
+
+} // namespace test
+} // namespace seafile
+
+#define TEST_CHECK(cond)                                                \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            fprintf(stderr, "%s:%d: check failed: %s\n",                \
+                    __FILE__, __LINE__, #cond);                         \
+            seafile::test::failures++;                                  \
+        }                                                               \
+    } while (0)
+
+#define TEST_CHECK_EQ(actual, expected)                                 \
+    TEST_CHECK((actual) == (expected))
+
+#define TEST_DEFINE_MAIN(...)                                           \
+    namespace seafile { namespace test { int failures = 0; } }          \
+    int main()                                                          \
+    {                                                                   \
+        void (*tests[])() = { __VA_ARGS__ };                            \
+        for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) { \
+            tests[i]();                                                 \
+        }                                                               \
+        if (seafile::test::failures) {                                  \
+            fprintf(stderr, "%d checks failed\n", seafile::test::failures); \
+        }                                                               \
+        return seafile::test::failures ? 1 : 0;                         \
+    }
+
+#endif // SEAFILE_EXTENSION_TEST_UTILS_H
@@ -1,14 +1,14 @@
-#include <QTimer>
-
 #include "account-info-service.h"
 #include "account-mgr.h"
 #include "api/api-error.h"
 #include "api/requests.h"
 #include "seadrive-gui.h"
+#include "timer-scheduler.h"
 
 namespace
 {
 const int kRefreshInterval = 3 * 60 * 1000; // 3 min
+const int kMaxRefreshInterval = 15 * 60 * 1000; // 15 min
 }
 
 SINGLETON_IMPL(AccountInfoService)
@@ -16,7 +16,8 @@ SINGLETON_IMPL(AccountInfoService)
 AccountInfoService::AccountInfoService(QObject* parent)
     : QObject(parent)
 {
-    refresh_timer_ = new QTimer(this);
+    refresh_timer_ = new ScheduledTimer("account-info", this);
+    refresh_timer_->setMaxInterval(kMaxRefreshInterval);
     connect(refresh_timer_, SIGNAL(timeout()), this, SLOT(refresh()));
 }
 
@@ -8,7 +8,7 @@
 
 #include "utils/singleton.h"
 
-class QTimer;
+class ScheduledTimer;
 
 class FetchAccountInfoRequest;
 class ApiError;
@@ -35,7 +35,7 @@ private:
     Q_DISABLE_COPY(AccountInfoService)
     AccountInfoService(QObject *parent=0);
 
-    QTimer *refresh_timer_;
+    ScheduledTimer *refresh_timer_;
 };
 
 
@@ -16,7 +16,7 @@
 #if defined(_MSC_VER)
 #include "utils/file-utils.h"
 #endif
-#include "shib/shib-login-dialog.h"
+#include "shib/shib-login.h"
 #include "settings-mgr.h"
 #include "account-info-service.h"
 #include "file-provider-mgr.h"
@@ -316,6 +316,12 @@ void AccountManager::loadAccounts()
 
     std::stable_sort(accounts_.begin(), accounts_.end(), compareAccount);
 
+#if defined(Q_OS_LINUX)
+    for (int i = 0; i < accounts_.size(); i++) {
+        accounts_[i].syncRoot = sync_root_;
+    }
+#endif
+
     qWarning("loaded %d accounts", (int)accounts_.size());
 }
 
@@ -325,6 +331,9 @@ void AccountManager::enableAccount(const Account& account) {
 
     {
         QMutexLocker locker(&accounts_mutex_);
+#if defined(Q_OS_LINUX)
+        new_account.syncRoot = sync_root_;
+#endif
         for (int i = 0; i < accounts_.size(); i++) {
             if (accounts_[i] == account) {
                 accounts_.erase(accounts_.begin() + i);
@@ -707,6 +716,10 @@ void AccountManager::clearAccountToken(const Account& account,
     sqlite_query_exec(db, zql);
     sqlite3_free(zql);
 
+    // The account is no longer active, e.g. after a remote wipe, so the
+    // account menu and the caches of its repos and links must be dropped.
+    emit accountMQUpdated();
+
     if (force_relogin) {
         reloginAccount(account);
     }
@@ -844,8 +857,7 @@ void AccountManager::setAccountSyncRoot(Account &account, bool resync)
 void AccountManager::reloginAccount(const Account &account)
 {
     if (account.isShibboleth) {
-        ShibLoginDialog shib_dialog(account.serverUrl, gui->settingsManager()->getComputerName());
-        shib_dialog.exec();
+        shibLogin(account.serverUrl, gui->settingsManager()->getComputerName());
         return;
     }
 
@@ -866,6 +878,17 @@ const QVector<Account> AccountManager::allAccounts() const
     return accounts_;
 }
 
+#if defined(Q_OS_LINUX)
+void AccountManager::setSyncRoot(const QString& sync_root)
+{
+    QMutexLocker locker(&accounts_mutex_);
+    sync_root_ = sync_root;
+    for (int i = 0; i < accounts_.size(); i++) {
+        accounts_[i].syncRoot = sync_root;
+    }
+}
+#endif
+
 const QVector<Account> AccountManager::activeAccounts() const {
     auto accounts = allAccounts();
     QVector<Account> active_accounts;
@@ -83,6 +83,12 @@ public:
     int resyncAccount(const Account& account);
 #endif
 
+#if defined(Q_OS_LINUX)
+    // The daemon mounts the accounts at one mount point on linux, which is
+    // used as the sync root of all the accounts.
+    void setSyncRoot(const QString& sync_root);
+#endif
+
     // Use all valid accounts, or re-login if no valid account.
     void validateAndUseAccounts();
 
@@ -121,7 +127,7 @@ public slots:
 
 signals:
     /**
-     * Account added/removed/switched.
+     * Account added/removed/switched, or its token cleared.
      */
     void accountMQUpdated();
     void accountInfoUpdated(const Account& account);
@@ -159,6 +165,9 @@ private:
     // For read access, one should use the allAccounts() method.
     mutable QMutex accounts_mutex_;
     QVector<Account> accounts_;
+#if defined(Q_OS_LINUX)
+    QString sync_root_;
+#endif
 
 #if defined(_MSC_VER)
     // Store All sync root information
@@ -0,0 +1,304 @@
+#include <QtGlobal>
+
+#if defined(Q_OS_WIN32)
+#include <windows.h>
+#endif
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSettings>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+#include <QNetworkInformation>
+#endif
+
+#include "daemon-mgr.h"
+#include "rpc/rpc-client.h"
+#include "seadrive-gui.h"
+#include "timer-scheduler.h"
+
+#include "bandwidth-scheduler.h"
+
+namespace {
+
+const char *kBandwidthScheduleGroup = "BandwidthSchedule";
+const char *kRules = "rules";
+const char *kCondition = "condition";
+const char *kDays = "days";
+const char *kStartMinute = "startMinute";
+const char *kEndMinute = "endMinute";
+const char *kUploadLimit = "uploadLimit";
+const char *kDownloadLimit = "downloadLimit";
+
+// The base limits are saved while a rule is in effect, so they can be
+// restored if the gui exits before the rule ends.
+const char *kOverrideBaseUpload = "overrideBaseUpload";
+const char *kOverrideBaseDownload = "overrideBaseDownload";
+
+// The time windows are checked every minute. While the gui is idle nothing
+// is transferred, so a rule may start a few minutes late; the first transfer
+// brings the check back to every minute.
+const int kCheckIntervalMSecs = 60 * 1000;
+const int kMaxCheckIntervalMSecs = 5 * 60 * 1000;
+
+bool isNetworkMetered()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    QNetworkInformation *info = QNetworkInformation::instance();
+    return info && info->isMetered();
+#else
+    return false;
+#endif
+}
+
+bool isOnBattery()
+{
+#if defined(Q_OS_WIN32)
+    SYSTEM_POWER_STATUS status;
+    if (!GetSystemPowerStatus(&status)) {
+        return false;
+    }
+    return status.ACLineStatus == 0;
+#elif defined(Q_OS_LINUX)
+    // On battery when there is a battery, and no AC adapter is online.
+    QDir dir("/sys/class/power_supply");
+    bool has_battery = false;
+    for (const QString& name : dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        QFile type_file(dir.filePath(name + "/type"));
+        if (!type_file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        QByteArray type = type_file.readAll().trimmed();
+        if (type == "Battery") {
+            has_battery = true;
+        } else if (type == "Mains") {
+            QFile online_file(dir.filePath(name + "/online"));
+            if (online_file.open(QIODevice::ReadOnly) &&
+                online_file.readAll().trimmed() == "1") {
+                return false;
+            }
+        }
+    }
+    return has_battery;
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+SINGLETON_IMPL(BandwidthScheduler)
+
+BandwidthScheduler::BandwidthScheduler()
+    : base_upload_(0),
+      base_download_(0),
+      active_rule_(-1),
+      applied_upload_(-1),
+      applied_download_(-1)
+{
+    check_timer_ = new ScheduledTimer("bandwidth-scheduler", this);
+    check_timer_->setMaxInterval(kMaxCheckIntervalMSecs);
+    connect(check_timer_, SIGNAL(timeout()), this, SLOT(evaluate()));
+}
+
+void BandwidthScheduler::start()
+{
+    loadRules();
+
+    QSettings settings;
+    settings.beginGroup(kBandwidthScheduleGroup);
+    if (settings.contains(kOverrideBaseUpload)) {
+        // The gui exited while a rule was in effect, so the limits in the
+        // daemon are the ones of the rule.
+        base_upload_ = settings.value(kOverrideBaseUpload).toUInt();
+        base_download_ = settings.value(kOverrideBaseDownload).toUInt();
+        // Saved again below if a rule is still in effect.
+        settings.remove(kOverrideBaseUpload);
+        settings.remove(kOverrideBaseDownload);
+    } else {
+        int value;
+        if (gui->rpcClient()->seafileGetConfigInt("upload_limit", &value) >= 0) {
+            base_upload_ = value >> 10;
+        }
+        if (gui->rpcClient()->seafileGetConfigInt("download_limit", &value) >= 0) {
+            base_download_ = value >> 10;
+        }
+        applied_upload_ = base_upload_;
+        applied_download_ = base_download_;
+    }
+    settings.endGroup();
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    if (QNetworkInformation::loadBackendByFeatures(QNetworkInformation::Feature::Metered)) {
+        connect(QNetworkInformation::instance(), &QNetworkInformation::isMeteredChanged,
+                this, &BandwidthScheduler::evaluate);
+    }
+#endif
+
+    connect(gui->daemonManager(), SIGNAL(daemonRestarted()),
+            this, SLOT(onDaemonRestarted()));
+
+    check_timer_->start(kCheckIntervalMSecs);
+    evaluate();
+}
+
+void BandwidthScheduler::onDaemonRestarted()
+{
+    // The daemon loads the limits from its config, which are always up to
+    // date, but push them again in case it was reset.
+    applied_upload_ = applied_download_ = -1;
+    evaluate();
+}
+
+void BandwidthScheduler::setRules(const QList<BandwidthRule>& rules)
+{
+    rules_ = rules;
+    saveRules();
+    evaluate();
+}
+
+void BandwidthScheduler::setBaseLimits(unsigned int upload, unsigned int download)
+{
+    base_upload_ = upload;
+    base_download_ = download;
+    if (isOverriding()) {
+        saveOverride();
+    } else {
+        // Pushed to the daemon by the settings manager.
+        applied_upload_ = upload;
+        applied_download_ = download;
+    }
+}
+
+bool BandwidthScheduler::ruleMatches(const BandwidthRule& rule,
+                                     bool metered,
+                                     bool on_battery) const
+{
+    if (rule.condition == BandwidthRule::METERED_NETWORK && !metered) {
+        return false;
+    }
+    if (rule.condition == BandwidthRule::ON_BATTERY && !on_battery) {
+        return false;
+    }
+
+    QDateTime now = QDateTime::currentDateTime();
+    int minute = now.time().hour() * 60 + now.time().minute();
+    int day = now.date().dayOfWeek() - 1;
+    if (rule.start_minute == rule.end_minute) {
+        return rule.days == 0 || (rule.days & (1 << day));
+    }
+
+    if (rule.start_minute < rule.end_minute) {
+        if (minute < rule.start_minute || minute >= rule.end_minute) {
+            return false;
+        }
+    } else {
+        // The window crosses midnight. After midnight it belongs to the
+        // day it started on.
+        if (minute < rule.end_minute) {
+            day = (day + 6) % 7;
+        } else if (minute < rule.start_minute) {
+            return false;
+        }
+    }
+    return rule.days == 0 || (rule.days & (1 << day));
+}
+
+void BandwidthScheduler::evaluate()
+{
+    bool metered = isNetworkMetered();
+    bool on_battery = isOnBattery();
+
+    int matched = -1;
+    for (int i = 0; i < rules_.size(); i++) {
+        if (ruleMatches(rules_[i], metered, on_battery)) {
+            matched = i;
+            break;
+        }
+    }
+
+    if (matched != active_rule_) {
+        if (matched >= 0) {
+            qWarning("[bandwidth] rule %d is in effect", matched);
+        } else {
+            qWarning("[bandwidth] no rule is in effect, using the base limits");
+        }
+        active_rule_ = matched;
+        saveOverride();
+    }
+
+    if (matched >= 0) {
+        apply(rules_[matched].upload_limit, rules_[matched].download_limit);
+    } else {
+        apply(base_upload_, base_download_);
+    }
+}
+
+void BandwidthScheduler::apply(unsigned int upload, unsigned int download)
+{
+    if (applied_upload_ != upload) {
+        if (gui->rpcClient()->setUploadRateLimit(upload << 10) >= 0) {
+            applied_upload_ = upload;
+        }
+    }
+    if (applied_download_ != download) {
+        if (gui->rpcClient()->setDownloadRateLimit(download << 10) >= 0) {
+            applied_download_ = download;
+        }
+    }
+}
+
+void BandwidthScheduler::loadRules()
+{
+    QSettings settings;
+    settings.beginGroup(kBandwidthScheduleGroup);
+    rules_.clear();
+    int n = settings.beginReadArray(kRules);
+    for (int i = 0; i < n; i++) {
+        settings.setArrayIndex(i);
+        BandwidthRule rule;
+        rule.condition = static_cast<BandwidthRule::Condition>(
+            settings.value(kCondition, 0).toInt());
+        rule.days = settings.value(kDays, 0).toInt();
+        rule.start_minute = settings.value(kStartMinute, 0).toInt();
+        rule.end_minute = settings.value(kEndMinute, 0).toInt();
+        rule.upload_limit = settings.value(kUploadLimit, 0).toUInt();
+        rule.download_limit = settings.value(kDownloadLimit, 0).toUInt();
+        rules_.append(rule);
+    }
+    settings.endArray();
+    settings.endGroup();
+}
+
+void BandwidthScheduler::saveRules()
+{
+    QSettings settings;
+    settings.beginGroup(kBandwidthScheduleGroup);
+    settings.beginWriteArray(kRules, rules_.size());
+    for (int i = 0; i < rules_.size(); i++) {
+        const BandwidthRule& rule = rules_[i];
+        settings.setArrayIndex(i);
+        settings.setValue(kCondition, (int)rule.condition);
+        settings.setValue(kDays, rule.days);
+        settings.setValue(kStartMinute, rule.start_minute);
+        settings.setValue(kEndMinute, rule.end_minute);
+        settings.setValue(kUploadLimit, rule.upload_limit);
+        settings.setValue(kDownloadLimit, rule.download_limit);
+    }
+    settings.endArray();
+    settings.endGroup();
+}
+
+void BandwidthScheduler::saveOverride()
+{
+    QSettings settings;
+    settings.beginGroup(kBandwidthScheduleGroup);
+    if (isOverriding()) {
+        settings.setValue(kOverrideBaseUpload, base_upload_);
+        settings.setValue(kOverrideBaseDownload, base_download_);
+    } else {
+        settings.remove(kOverrideBaseUpload);
+        settings.remove(kOverrideBaseDownload);
+    }
+    settings.endGroup();
+}
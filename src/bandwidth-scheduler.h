@@ -0,0 +1,105 @@
+#ifndef SEADRIVE_GUI_BANDWIDTH_SCHEDULER_H
+#define SEADRIVE_GUI_BANDWIDTH_SCHEDULER_H
+
+#include <QObject>
+#include <QList>
+
+#include "utils/singleton.h"
+
+class ScheduledTimer;
+
+/**
+ * A rule of the bandwidth schedule. The limits are in KB/s, 0 means no
+ * limit.
+ */
+struct BandwidthRule {
+    enum Condition {
+        ALWAYS = 0,
+        METERED_NETWORK,
+        ON_BATTERY,
+    };
+
+    Condition condition;
+
+    // Days of the week the rule applies on, bit 0 is Monday. 0 means every
+    // day.
+    int days;
+    // The time window in minutes since midnight. The window may cross
+    // midnight, e.g. 22:00 - 06:00. When start == end it lasts all day.
+    int start_minute;
+    int end_minute;
+
+    unsigned int upload_limit;
+    unsigned int download_limit;
+
+    BandwidthRule()
+        : condition(ALWAYS),
+          days(0),
+          start_minute(0),
+          end_minute(0),
+          upload_limit(0),
+          download_limit(0)
+    {
+    }
+};
+
+/**
+ * Sets the rate limits of the daemon according to a schedule of rules,
+ * e.g. throttle the uploads during the business hours, or when the network
+ * is metered or the computer is on battery.
+ *
+ * The first matching rule wins. When no rule matches, the limits set in the
+ * settings dialog (the "base" limits) are used. The limits are only pushed
+ * to the daemon when they change.
+ *
+ * The rules are saved in the settings.
+ */
+class BandwidthScheduler : public QObject {
+    SINGLETON_DEFINE(BandwidthScheduler)
+    Q_OBJECT
+public:
+    BandwidthScheduler();
+
+    void start();
+
+    QList<BandwidthRule> rules() const { return rules_; }
+    void setRules(const QList<BandwidthRule>& rules);
+
+    // True when a rule is in effect instead of the base limits.
+    bool isOverriding() const { return active_rule_ >= 0; }
+
+    unsigned int baseUploadLimit() const { return base_upload_; }
+    unsigned int baseDownloadLimit() const { return base_download_; }
+    void setBaseLimits(unsigned int upload, unsigned int download);
+
+public slots:
+    void evaluate();
+
+private slots:
+    void onDaemonRestarted();
+
+private:
+    Q_DISABLE_COPY(BandwidthScheduler)
+
+    bool ruleMatches(const BandwidthRule& rule, bool metered, bool on_battery) const;
+    void apply(unsigned int upload, unsigned int download);
+
+    void loadRules();
+    void saveRules();
+    void saveOverride();
+
+    QList<BandwidthRule> rules_;
+    ScheduledTimer *check_timer_;
+
+    unsigned int base_upload_;
+    unsigned int base_download_;
+
+    // Index of the rule in effect, -1 when the base limits are used.
+    int active_rule_;
+
+    // The limits last pushed to the daemon, -1 if unknown.
+    qint64 applied_upload_;
+    qint64 applied_download_;
+};
+
+#endif // SEADRIVE_GUI_BANDWIDTH_SCHEDULER_H
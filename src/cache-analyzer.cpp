@@ -0,0 +1,374 @@
+#include <QtGlobal>
+
+#include <algorithm>
+#if !defined(Q_OS_WIN32)
+#include <sys/statvfs.h>
+#endif
+
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSettings>
+#include <QTimer>
+
+#include "account-mgr.h"
+#include "cached-files-index.h"
+#include "daemon-mgr.h"
+#include "prefetch-mgr.h"
+#include "rpc/rpc-client.h"
+#include "seadrive-gui.h"
+#include "settings-mgr.h"
+#include "timer-scheduler.h"
+#include "utils/file-utils.h"
+#include "utils/utils.h"
+#if defined(_MSC_VER) || defined(Q_OS_LINUX)
+#include "ext-handler.h"
+#endif
+
+#include "cache-analyzer.h"
+
+namespace {
+
+const int kFirstScanDelayMSecs = 60 * 1000;
+const int kScanIntervalMSecs = 30 * 60 * 1000;
+// The cache doesn't grow while the gui is idle.
+const int kMaxScanIntervalMSecs = 2 * 60 * 60 * 1000;
+
+// The scan pauses for a moment after each batch of files, so it doesn't
+// compete with the daemon for the disk.
+const int kScanBatchSize = 1000;
+const int kScanPauseMSecs = 20;
+
+// Only the files not accessed for a week and larger than 1MB are considered
+// for eviction.
+const qint64 kColdFileMSecs = 7LL * 24 * 60 * 60 * 1000;
+const qint64 kMinEvictionSize = 1024 * 1024;
+const int kMaxEvictionCandidates = 500;
+
+// Start evicting when the cache uses 90% of its limit, and stop at 80%.
+const double kEvictionHighWatermark = 0.9;
+const double kEvictionLowWatermark = 0.8;
+
+bool largerCandidate(const CacheEvictionCandidate& a, const CacheEvictionCandidate& b)
+{
+    return a.size > b.size;
+}
+
+} // namespace
+
+void CacheUsage::add(qint64 size, qint64 access)
+{
+    bytes += size;
+    files++;
+    last_access = qMax(last_access, access);
+}
+
+void CacheUsage::add(const CacheUsage& other)
+{
+    bytes += other.bytes;
+    files += other.files;
+    last_access = qMax(last_access, other.last_access);
+}
+
+SINGLETON_IMPL(CacheAnalyzer)
+
+CacheAnalyzer::CacheAnalyzer()
+    : thread_(nullptr)
+{
+    scan_timer_ = new ScheduledTimer("cache-analyzer", this);
+    scan_timer_->setMaxInterval(kMaxScanIntervalMSecs);
+    connect(scan_timer_, SIGNAL(timeout()), this, SLOT(scan()));
+}
+
+CacheAnalyzer::~CacheAnalyzer()
+{
+    if (thread_) {
+        thread_->cancel();
+        thread_->wait();
+    }
+}
+
+void CacheAnalyzer::start()
+{
+    QTimer::singleShot(kFirstScanDelayMSecs, this, SLOT(scan()));
+    scan_timer_->start(kScanIntervalMSecs);
+}
+
+bool CacheAnalyzer::isScanning() const
+{
+    return thread_ != nullptr;
+}
+
+// The daemon keeps the cached files in "file-cache/<repo_id>/<path>" under
+// its data dir.
+QString CacheAnalyzer::fileCacheDir() const
+{
+    QDir cache_dir(gui->daemonManager()->currentCacheDir());
+    QString dir = cache_dir.filePath("data/file-cache");
+    if (QFileInfo(dir).isDir()) {
+        return dir;
+    }
+    dir = cache_dir.filePath("file-cache");
+    if (QFileInfo(dir).isDir()) {
+        return dir;
+    }
+    return QString();
+}
+
+void CacheAnalyzer::scan()
+{
+    if (thread_) {
+        return;
+    }
+    QString dir = fileCacheDir();
+    if (dir.isEmpty()) {
+        qDebug("[cache analyzer] no file cache found in %s",
+               toCStr(gui->daemonManager()->currentCacheDir()));
+        return;
+    }
+
+    qint64 eviction_limit = 0;
+    if (gui->settingsManager()->isCacheEvictionEnabled()) {
+        eviction_limit = (qint64)gui->settingsManager()->getCacheSizeLimitGB() << 30;
+    }
+
+    thread_ = new CacheScanThread(dir, PrefetchManager::instance()->pinnedPaths(),
+                                  eviction_limit, this);
+    connect(thread_, SIGNAL(finished()), this, SLOT(onScanFinished()));
+    thread_->start(QThread::LowestPriority);
+}
+
+void CacheAnalyzer::onScanFinished()
+{
+    report_ = thread_->report();
+    thread_->deleteLater();
+    thread_ = nullptr;
+
+    qDebug("[cache analyzer] %lld bytes in %lld files are cached, "
+           "%d files could be evicted",
+           report_->total.bytes, report_->total.files,
+           (int)report_->candidates.size());
+    emit reportUpdated();
+}
+
+
+CacheScanThread::CacheScanThread(const QString& cache_dir,
+                                 const QStringList& pinned_paths,
+                                 qint64 eviction_limit,
+                                 QObject *parent)
+    : QThread(parent),
+      cache_dir_(cache_dir),
+      pinned_paths_(pinned_paths),
+      eviction_limit_(eviction_limit),
+      report_(new CacheReport),
+      canceled_(false)
+{
+}
+
+bool CacheScanThread::isPinned(const QString& repo_id, const QString& path) const
+{
+    QString full_path = repo_id + path;
+    for (const QString& pinned : pinned_paths_) {
+        if (full_path.startsWith(pinned) &&
+            (full_path.size() == pinned.size() ||
+             full_path[pinned.size()] == '/' || pinned.endsWith('/'))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The candidates are kept in a min heap of their sizes, so only the largest
+// ones are kept no matter how many files are in the cache.
+void CacheScanThread::addCandidate(const CacheEvictionCandidate& candidate)
+{
+    QList<CacheEvictionCandidate>& candidates = report_->candidates;
+    if (candidates.size() < kMaxEvictionCandidates) {
+        candidates.append(candidate);
+        std::push_heap(candidates.begin(), candidates.end(), largerCandidate);
+    } else if (candidate.size > candidates.first().size) {
+        std::pop_heap(candidates.begin(), candidates.end(), largerCandidate);
+        candidates.last() = candidate;
+        std::push_heap(candidates.begin(), candidates.end(), largerCandidate);
+    }
+}
+
+void CacheScanThread::run()
+{
+    checkAccessTime();
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QDir root(cache_dir_);
+    QStringList repo_ids = root.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+
+    int n = 0;
+    for (const QString& repo_id : repo_ids) {
+        RepoCacheUsage& repo = report_->repos[repo_id];
+        repo.repo_id = repo_id;
+
+        QString repo_dir = root.filePath(repo_id);
+        QDirIterator it(repo_dir,
+                        QDir::Files | QDir::Hidden | QDir::System,
+                        QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            if (canceled_) {
+                return;
+            }
+            it.next();
+            QFileInfo info = it.fileInfo();
+
+            // "/dir/file" in the library.
+            QString path = info.filePath().mid(repo_dir.size());
+            qint64 size = info.size();
+            qint64 access = qMax(info.lastRead().toMSecsSinceEpoch(),
+                                 info.lastModified().toMSecsSinceEpoch());
+
+            report_->total.add(size, access);
+            repo.usage.add(size, access);
+            int pos = path.indexOf('/', 1);
+            QString folder = pos > 0 ? path.left(pos) : "/";
+            repo.folders[folder].add(size, access);
+
+            if (size >= kMinEvictionSize && now - access >= kColdFileMSecs &&
+                !isPinned(repo_id, path)) {
+                CacheEvictionCandidate candidate;
+                candidate.repo_id = repo_id;
+                candidate.path = path;
+                candidate.size = size;
+                candidate.last_access = access;
+                addCandidate(candidate);
+            }
+
+            if (++n % kScanBatchSize == 0) {
+                msleep(kScanPauseMSecs);
+            }
+        }
+    }
+
+    std::sort(report_->candidates.begin(), report_->candidates.end(), largerCandidate);
+
+    SeafileRpcClient rpc_client;
+    if (rpc_client.tryConnectDaemon(false)) {
+        resolveRepos(&rpc_client);
+        evictColdFiles(&rpc_client);
+    } else {
+        qWarning("[cache analyzer] failed to connect to the daemon");
+    }
+    addAccountUsages();
+    report_->finish_msecs = QDateTime::currentMSecsSinceEpoch();
+}
+
+// Whether the last access times of the cached files can be trusted.
+void CacheScanThread::checkAccessTime()
+{
+#if defined(Q_OS_WIN32)
+    // Windows stops updating them on large volumes by default. The lowest
+    // bit of the value is set when the updates are disabled.
+    QSettings settings("HKEY_LOCAL_MACHINE\\SYSTEM\\CurrentControlSet\\Control\\FileSystem",
+                       QSettings::NativeFormat);
+    uint value = settings.value("NtfsDisableLastAccessUpdate", 0).toUInt();
+    report_->access_time_reliable = (value & 1) == 0;
+#elif defined(ST_NOATIME)
+    struct statvfs st;
+    if (statvfs(toCStr(cache_dir_), &st) == 0) {
+        report_->access_time_reliable = (st.f_flag & ST_NOATIME) == 0;
+    }
+#endif
+}
+
+// Finds the account and the local folder of each library in the cache.
+void CacheScanThread::resolveRepos(SeafileRpcClient *rpc_client)
+{
+    for (RepoCacheUsage& repo : report_->repos) {
+        if (canceled_) {
+            return;
+        }
+        QString repo_uname;
+        json_t *ret_obj = nullptr;
+        if (!rpc_client->getRepoUnameById(repo.repo_id, &repo_uname) ||
+            !rpc_client->getAccountByRepoId(repo.repo_id, &ret_obj)) {
+            continue;
+        }
+        Account account = gui->accountManager()->getAccountFromJson(ret_obj);
+        json_decref(ret_obj);
+        if (account.username.isEmpty()) {
+            continue;
+        }
+
+        QString name = account.accountInfo.name.isEmpty() ?
+            account.username : account.accountInfo.name;
+        repo.account = QString("%1 (%2)").arg(name, account.serverUrl.host());
+        if (!account.syncRoot.isEmpty()) {
+            repo.local_dir = ::pathJoin(account.syncRoot, repo_uname);
+        }
+    }
+}
+
+// Runs in the scan thread with its own rpc client, since removing hundreds
+// of files from the cache takes a while.
+void CacheScanThread::evictColdFiles(SeafileRpcClient *rpc_client)
+{
+    qint64 used = report_->total.bytes;
+    if (eviction_limit_ <= 0 || used < eviction_limit_ * kEvictionHighWatermark ||
+        report_->candidates.isEmpty() || canceled_) {
+        return;
+    }
+    if (!report_->access_time_reliable) {
+        qWarning("[cache analyzer] the access times of the cached files are "
+                 "not updated, not evicting any of them");
+        return;
+    }
+
+    CachedFilesIndex *cached_files = CachedFilesIndex::instance();
+    qint64 target = (qint64)(eviction_limit_ * kEvictionLowWatermark);
+    for (const CacheEvictionCandidate& candidate : report_->candidates) {
+        if (used <= target || canceled_) {
+            break;
+        }
+        if (rpc_client->unCachePath(candidate.repo_id, candidate.path)) {
+            for (const QString& path : cached_files->localPaths(candidate.repo_id,
+                                                                candidate.path)) {
+                cached_files->setCached(path, false);
+            }
+#if defined(_MSC_VER) || defined(Q_OS_LINUX)
+            QString repo_dir = report_->repos.value(candidate.repo_id).local_dir;
+            if (!repo_dir.isEmpty()) {
+                ExtStatusChangeNotifier::instance()->notifyChanged(
+                    ::pathJoin(repo_dir, candidate.path));
+            }
+#endif
+            used -= candidate.size;
+            removeUsage(candidate);
+            report_->evicted_files++;
+            report_->evicted_bytes += candidate.size;
+        }
+    }
+    qWarning("[cache analyzer] removed %lld cold files from the cache, "
+             "%lld bytes are still cached", report_->evicted_files, used);
+}
+
+void CacheScanThread::addAccountUsages()
+{
+    for (const RepoCacheUsage& repo : report_->repos) {
+        if (!repo.account.isEmpty()) {
+            report_->accounts[repo.account].add(repo.usage);
+        }
+    }
+}
+
+void CacheScanThread::removeUsage(const CacheEvictionCandidate& candidate)
+{
+    CacheUsage& total = report_->total;
+    total.bytes -= candidate.size;
+    total.files--;
+
+    RepoCacheUsage& repo = report_->repos[candidate.repo_id];
+    repo.usage.bytes -= candidate.size;
+    repo.usage.files--;
+
+    int pos = candidate.path.indexOf('/', 1);
+    CacheUsage& folder = repo.folders[pos > 0 ? candidate.path.left(pos) : "/"];
+    folder.bytes -= candidate.size;
+    folder.files--;
+}
@@ -0,0 +1,149 @@
+#ifndef SEADRIVE_GUI_CACHE_ANALYZER_H
+#define SEADRIVE_GUI_CACHE_ANALYZER_H
+
+#include <QObject>
+#include <QThread>
+#include <QHash>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+#include "utils/singleton.h"
+
+class CacheScanThread;
+class ScheduledTimer;
+class SeafileRpcClient;
+
+/**
+ * How much of the local cache is used by a set of files.
+ */
+struct CacheUsage {
+    qint64 bytes;
+    qint64 files;
+    // The latest access time of the files, in msecs since epoch.
+    qint64 last_access;
+
+    CacheUsage() : bytes(0), files(0), last_access(0) {}
+    void add(qint64 size, qint64 access);
+    void add(const CacheUsage& other);
+};
+
+// The usage of a library, and of each of its top level folders.
+struct RepoCacheUsage {
+    QString repo_id;
+    // Like "name (server host)", empty if the library isn't found.
+    QString account;
+    // The local folder of the library, empty if it isn't found.
+    QString local_dir;
+    CacheUsage usage;
+    QHash<QString, CacheUsage> folders;
+};
+
+// A cached file that could be removed from the cache first.
+struct CacheEvictionCandidate {
+    QString repo_id;
+    QString path;
+    qint64 size;
+    qint64 last_access;
+};
+
+struct CacheReport {
+    CacheUsage total;
+    // Keyed by the account of RepoCacheUsage.
+    QHash<QString, CacheUsage> accounts;
+    QHash<QString, RepoCacheUsage> repos;
+    // Large files that are not accessed for a while and not in pinned
+    // folders, the best ones first.
+    QList<CacheEvictionCandidate> candidates;
+    // False if the file system doesn't update the access times, e.g. it's
+    // mounted with noatime. The candidates may be in use then.
+    bool access_time_reliable;
+    // Removed from the cache after the scan, not counted in the usages.
+    qint64 evicted_files;
+    qint64 evicted_bytes;
+    qint64 finish_msecs;
+
+    CacheReport()
+        : access_time_reliable(true),
+          evicted_files(0),
+          evicted_bytes(0),
+          finish_msecs(0) {}
+};
+
+/**
+ * Scans the file cache of the daemon in the background, and aggregates its
+ * size per account, library and folder.
+ *
+ * The large files that are not used for a while are reported as candidates
+ * for eviction. If the automatic eviction is enabled in the settings, which
+ * it isn't by default, and the cache is close to its size limit, the scan
+ * thread also removes them from the cache before the daemon's cache cleaner,
+ * which doesn't know about the pinned folders, evicts the files by itself.
+ */
+class CacheAnalyzer : public QObject {
+    SINGLETON_DEFINE(CacheAnalyzer)
+    Q_OBJECT
+public:
+    CacheAnalyzer();
+    ~CacheAnalyzer();
+
+    void start();
+
+    // The result of the last scan, null if no scan has finished yet.
+    QSharedPointer<const CacheReport> report() const { return report_; }
+
+    bool isScanning() const;
+
+    // Where the daemon keeps the cached files, empty if it's not found.
+    QString fileCacheDir() const;
+
+public slots:
+    void scan();
+
+signals:
+    void reportUpdated();
+
+private slots:
+    void onScanFinished();
+
+private:
+    Q_DISABLE_COPY(CacheAnalyzer)
+
+    ScheduledTimer *scan_timer_;
+    CacheScanThread *thread_;
+    QSharedPointer<const CacheReport> report_;
+};
+
+class CacheScanThread : public QThread {
+    Q_OBJECT
+public:
+    // The cold files are evicted when more than 90% of `eviction_limit`
+    // bytes are cached, never if it's 0.
+    CacheScanThread(const QString& cache_dir,
+                    const QStringList& pinned_paths,
+                    qint64 eviction_limit,
+                    QObject *parent = 0);
+
+    void run();
+    void cancel() { canceled_ = true; }
+
+    QSharedPointer<CacheReport> report() const { return report_; }
+
+private:
+    bool isPinned(const QString& repo_id, const QString& path) const;
+    void addCandidate(const CacheEvictionCandidate& candidate);
+    void checkAccessTime();
+    void resolveRepos(SeafileRpcClient *rpc_client);
+    void evictColdFiles(SeafileRpcClient *rpc_client);
+    void removeUsage(const CacheEvictionCandidate& candidate);
+    void addAccountUsages();
+
+    const QString cache_dir_;
+    const QStringList pinned_paths_;
+    const qint64 eviction_limit_;
+    QSharedPointer<CacheReport> report_;
+    volatile bool canceled_;
+};
+
+#endif // SEADRIVE_GUI_CACHE_ANALYZER_H
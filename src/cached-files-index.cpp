@@ -0,0 +1,290 @@
+#include <QDateTime>
+#include <QMutexLocker>
+
+#include "cached-files-index.h"
+
+namespace {
+
+// The daemon may remove files from the cache when cleaning it, which we
+// have no notification for.
+const qint64 kCachedStateExpireMSecs = 5 * 60 * 1000;
+
+// Start over when the index grows too large.
+const int kMaxCachedFilesEntries = 200000;
+
+QString normalizedKey(const QString& path)
+{
+    QString p = path;
+    p.replace('\\', '/');
+    while (p.endsWith("/")) {
+        p.chop(1);
+    }
+    return p;
+}
+
+QString parentKey(const QString& key)
+{
+    int pos = key.lastIndexOf('/');
+    return pos > 0 ? key.left(pos) : QString();
+}
+
+bool isExpired(qint64 ts, qint64 now)
+{
+    return now - ts >= kCachedStateExpireMSecs;
+}
+
+} // namespace
+
+SINGLETON_IMPL(CachedFilesIndex)
+
+CachedFilesIndex::CachedFilesIndex()
+    : size_(0)
+{
+}
+
+CachedFilesIndex::RepoEntries *CachedFilesIndex::findRepo(const QString& path)
+{
+    // Try each parent of the path, from the deepest one.
+    int pos = path.size();
+    while (pos > 0) {
+        auto it = repos_.find(path.left(pos));
+        if (it != repos_.end()) {
+            return &it.value();
+        }
+        pos = path.lastIndexOf('/', pos - 1);
+    }
+    return nullptr;
+}
+
+bool CachedFilesIndex::lookup(const QString& path, bool *cached)
+{
+    QString key = normalizedKey(path);
+
+    QMutexLocker locker(&mutex_);
+    RepoEntries *repo = findRepo(key);
+    if (!repo) {
+        return false;
+    }
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    auto it = repo->entries.find(key);
+    if (it != repo->entries.end()) {
+        if (!isExpired(it->ts, now)) {
+            *cached = it->cached;
+            return true;
+        }
+        repo->entries.erase(it);
+        size_--;
+    }
+
+    // Any child of a filled folder that isn't recorded is not cached.
+    auto dir = repo->filled_dirs.find(parentKey(key));
+    if (dir == repo->filled_dirs.end()) {
+        return false;
+    }
+    if (isExpired(dir.value(), now)) {
+        repo->filled_dirs.erase(dir);
+        return false;
+    }
+    *cached = false;
+    return true;
+}
+
+void CachedFilesIndex::update(const QString& repo_id,
+                              const QString& repo_dir,
+                              const QString& path,
+                              bool cached)
+{
+    QString dir = normalizedKey(repo_dir);
+    QString key = normalizedKey(path);
+
+    QMutexLocker locker(&mutex_);
+    if (size_ >= kMaxCachedFilesEntries) {
+        repos_.clear();
+        size_ = 0;
+    }
+
+    RepoEntries& repo = repos_[dir];
+    if (repo.repo_id != repo_id) {
+        // The folder now belongs to another repo.
+        size_ -= repo.entries.size();
+        repo.entries.clear();
+        repo.filled_dirs.clear();
+        repo.repo_id = repo_id;
+    }
+    setEntry(&repo, key, cached, QDateTime::currentMSecsSinceEpoch());
+}
+
+void CachedFilesIndex::fillDir(const QString& repo_id,
+                               const QString& repo_dir,
+                               const QString& dir,
+                               const QMap<QString, bool>& children)
+{
+    QString rdir = normalizedKey(repo_dir);
+    QString key = normalizedKey(dir);
+
+    QMutexLocker locker(&mutex_);
+    if (size_ + children.size() >= kMaxCachedFilesEntries) {
+        repos_.clear();
+        size_ = 0;
+    }
+
+    RepoEntries& repo = repos_[rdir];
+    if (repo.repo_id != repo_id) {
+        size_ -= repo.entries.size();
+        repo.entries.clear();
+        repo.filled_dirs.clear();
+        repo.repo_id = repo_id;
+    }
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    // The entries of the children that are no longer cached are dropped.
+    auto it = repo.entries.lowerBound(key + "/");
+    auto end = repo.entries.lowerBound(key + "0");
+    while (it != end) {
+        if (it.key().indexOf('/', key.size() + 1) < 0) {
+            it = repo.entries.erase(it);
+            size_--;
+        } else {
+            ++it;
+        }
+    }
+    for (auto c = children.begin(); c != children.end(); ++c) {
+        setEntry(&repo, key + "/" + c.key(), c.value(), now);
+    }
+    repo.filled_dirs.insert(key, now);
+}
+
+bool CachedFilesIndex::lookupDir(const QString& dir, QMap<QString, bool> *children)
+{
+    QString key = normalizedKey(dir);
+
+    QMutexLocker locker(&mutex_);
+    RepoEntries *repo = findRepo(key);
+    if (!repo) {
+        return false;
+    }
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    auto filled = repo->filled_dirs.find(key);
+    if (filled == repo->filled_dirs.end()) {
+        return false;
+    }
+    if (isExpired(filled.value(), now)) {
+        repo->filled_dirs.erase(filled);
+        return false;
+    }
+
+    children->clear();
+    auto it = repo->entries.lowerBound(key + "/");
+    auto end = repo->entries.lowerBound(key + "0");
+    for (; it != end; ++it) {
+        QString name = it.key().mid(key.size() + 1);
+        if (!name.contains('/') && !isExpired(it->ts, now)) {
+            children->insert(name, it->cached);
+        }
+    }
+    return true;
+}
+
+void CachedFilesIndex::setEntry(RepoEntries *repo, const QString& key, bool cached, qint64 now)
+{
+    Entry entry;
+    entry.cached = cached;
+    entry.ts = now;
+    if (!repo->entries.contains(key)) {
+        size_++;
+    }
+    repo->entries.insert(key, entry);
+}
+
+void CachedFilesIndex::setCached(const QString& path, bool cached)
+{
+    QString key = normalizedKey(path);
+
+    QMutexLocker locker(&mutex_);
+    RepoEntries *repo = findRepo(key);
+    if (!repo) {
+        return;
+    }
+    setEntry(repo, key, cached, QDateTime::currentMSecsSinceEpoch());
+}
+
+QStringList CachedFilesIndex::localPaths(const QString& repo_id,
+                                        const QString& path_in_repo)
+{
+    QString path = normalizedKey(path_in_repo);
+    if (!path.isEmpty() && !path.startsWith("/")) {
+        path.prepend("/");
+    }
+
+    QStringList paths;
+    QMutexLocker locker(&mutex_);
+    for (auto it = repos_.begin(); it != repos_.end(); ++it) {
+        if (it->repo_id == repo_id) {
+            paths.append(it.key() + path);
+        }
+    }
+    return paths;
+}
+
+void CachedFilesIndex::invalidate(const QString& path)
+{
+    QString key = normalizedKey(path);
+
+    QMutexLocker locker(&mutex_);
+    RepoEntries *repo = findRepo(key);
+    if (!repo) {
+        // It may be a category folder or a sync root.
+        for (auto it = repos_.begin(); it != repos_.end();) {
+            if (it.key().startsWith(key + "/")) {
+                size_ -= it->entries.size();
+                it = repos_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        return;
+    }
+
+    // The parent folder no longer knows all its cached children.
+    repo->filled_dirs.remove(parentKey(key));
+    for (auto dir = repo->filled_dirs.begin(); dir != repo->filled_dirs.end();) {
+        if (dir.key() == key || dir.key().startsWith(key + "/")) {
+            dir = repo->filled_dirs.erase(dir);
+        } else {
+            ++dir;
+        }
+    }
+
+    // The descendants of "a" are between "a/" and "a0" ('0' follows '/').
+    auto it = repo->entries.find(key);
+    if (it != repo->entries.end()) {
+        it = repo->entries.erase(it);
+        size_--;
+    }
+    it = repo->entries.lowerBound(key + "/");
+    auto end = repo->entries.lowerBound(key + "0");
+    while (it != end) {
+        it = repo->entries.erase(it);
+        size_--;
+    }
+}
+
+void CachedFilesIndex::invalidateRepo(const QString& repo_id)
+{
+    QMutexLocker locker(&mutex_);
+    for (auto it = repos_.begin(); it != repos_.end();) {
+        if (it->repo_id == repo_id) {
+            size_ -= it->entries.size();
+            it = repos_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CachedFilesIndex::clear()
+{
+    QMutexLocker locker(&mutex_);
+    repos_.clear();
+    size_ = 0;
+}
@@ -0,0 +1,84 @@
+#ifndef SEADRIVE_GUI_CACHED_FILES_INDEX_H
+#define SEADRIVE_GUI_CACHED_FILES_INDEX_H
+
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+#include "utils/singleton.h"
+
+/**
+ * Remembers which files are cached by the daemon, so the shell extensions can
+ * be answered without a rpc call for each file.
+ *
+ * The entries are grouped by the local folder of their repo, and keyed by the
+ * local path of the file, e.g. "S:/user/My Libraries/repo/a.txt". They are
+ * filled a folder at a time as the extensions ask about its files, and kept
+ * up to date by the download events, the files cached or evicted by the gui
+ * and the sync notifications from the daemon. Since the daemon doesn't tell
+ * when it cleans the cache, the entries also expire after a while.
+ *
+ * The methods are thread safe.
+ */
+class CachedFilesIndex {
+    SINGLETON_DEFINE(CachedFilesIndex)
+public:
+    CachedFilesIndex();
+
+    bool lookup(const QString& path, bool *cached);
+
+    void update(const QString& repo_id,
+                const QString& repo_dir,
+                const QString& path,
+                bool cached);
+
+    /**
+     * Records all the children of the folder `dir` that have data in the
+     * cache, mapped to whether they are fully cached files. Until the folder
+     * expires, its other children are known to be uncached.
+     */
+    void fillDir(const QString& repo_id,
+                 const QString& repo_dir,
+                 const QString& dir,
+                 const QMap<QString, bool>& children);
+
+    // The children recorded by `fillDir`. Returns false if the folder isn't
+    // filled or has expired.
+    bool lookupDir(const QString& dir, QMap<QString, bool> *children);
+
+    // Only updates the entry when the repo of the path is known.
+    void setCached(const QString& path, bool cached);
+
+    // The local paths of a path in a repo, one for each folder of the repo
+    // known to the index.
+    QStringList localPaths(const QString& repo_id, const QString& path_in_repo);
+
+    // Drop the entries of the path and all its descendants.
+    void invalidate(const QString& path);
+    void invalidateRepo(const QString& repo_id);
+    void clear();
+
+private:
+    struct Entry {
+        bool cached;
+        qint64 ts;
+    };
+
+    struct RepoEntries {
+        QString repo_id;
+        QMap<QString, Entry> entries;
+        // Filled folder -> when it's filled.
+        QHash<QString, qint64> filled_dirs;
+    };
+
+    RepoEntries *findRepo(const QString& path);
+    void setEntry(RepoEntries *repo, const QString& key, bool cached, qint64 now);
+
+    QMutex mutex_;
+    QHash<QString, RepoEntries> repos_;
+    int size_;
+};
+
+#endif // SEADRIVE_GUI_CACHED_FILES_INDEX_H
@@ -0,0 +1,243 @@
+// seadrive-gui-ctl: sends control requests to the running seadrive-gui, see
+// src/rpc/control-protocol.h for the protocol.
+//
+//   seadrive-gui-ctl status
+//   seadrive-gui-ctl prefetch <server> <username> <repo_id> <path>
+//   seadrive-gui-ctl batch < calls.json
+//   seadrive-gui-ctl set-bandwidth-rules < rules.json
+//   seadrive-gui-ctl --socket <path> status
+//
+// The socket is found from the settings of the gui with the same code as the
+// gui, see utils/app-paths.h. -s or --socket gives it explicitly.
+//
+// The response is printed as json. The exit code is 0 when all the calls
+// succeed, 1 when some of them fail and 2 when the gui can't be reached.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <jansson.h>
+#include <searpc-client.h>
+#include <searpc-named-pipe-transport.h>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QStringList>
+
+#include "rpc/control-protocol.h"
+#include "utils/app-paths.h"
+
+namespace {
+
+enum {
+    EXIT_OK = 0,
+    EXIT_CALL_FAILED = 1,
+    EXIT_UNREACHABLE = 2,
+};
+
+void usage()
+{
+    fprintf(stderr,
+            "usage: seadrive-gui-ctl [-s|--socket <socket>] <command> [args]\n"
+            "\n"
+            "  -s, --socket  the applet rpc socket of the gui. By default it's\n"
+            "                found from the settings of the gui, like the gui does.\n"
+            "\n"
+            "commands:\n"
+            "  status\n"
+            "  prefetch <server> <username> <repo_id> <path>\n"
+            "  pin <server> <username> <repo_id> <path>\n"
+            "  unpin <server> <username> <repo_id> <path>\n"
+            "  set-rate-limits <upload KB/s> <download KB/s>\n"
+            "  sync-errors\n"
+            "  encrypted-repos\n"
+            "  rpc-stats\n"
+            "  timer-stats\n"
+            "  bandwidth-rules\n"
+            "  set-bandwidth-rules  read a json array of rules from stdin, see\n"
+            "                       ControlApi::setBandwidthRules\n"
+            "  history [<from msecs> [<to msecs> [<path prefix> [<limit>]]]]\n"
+            "  batch    read a json array of {\"method\", \"params\"} from stdin\n");
+}
+
+json_t *locationParams(const QStringList& args)
+{
+    json_t *params = json_object();
+    json_object_set_new(params, "server", json_string(args[0].toUtf8().constData()));
+    json_object_set_new(params, "username", json_string(args[1].toUtf8().constData()));
+    json_object_set_new(params, "repo_id", json_string(args[2].toUtf8().constData()));
+    json_object_set_new(params, "path", json_string(args[3].toUtf8().constData()));
+    return params;
+}
+
+json_t *newCall(const char *method, json_t *params)
+{
+    json_t *c = json_object();
+    json_object_set_new(c, "method", json_string(method));
+    if (params) {
+        json_object_set_new(c, "params", params);
+    }
+    return c;
+}
+
+// Returns the calls of the command, or null if the arguments are wrong.
+json_t *buildCalls(const QString& command, const QStringList& args)
+{
+    json_t *calls = json_array();
+
+    if (command == "status" && args.isEmpty()) {
+        json_array_append_new(calls, newCall("status", nullptr));
+    } else if (command == "sync-errors" && args.isEmpty()) {
+        json_array_append_new(calls, newCall("list_sync_errors", nullptr));
+    } else if (command == "encrypted-repos" && args.isEmpty()) {
+        json_array_append_new(calls, newCall("list_encrypted_repos", nullptr));
+    } else if (command == "rpc-stats" && args.isEmpty()) {
+        json_array_append_new(calls, newCall("rpc_stats", nullptr));
+    } else if (command == "timer-stats" && args.isEmpty()) {
+        json_array_append_new(calls, newCall("timer_stats", nullptr));
+    } else if (command == "bandwidth-rules" && args.isEmpty()) {
+        json_array_append_new(calls, newCall("get_bandwidth_rules", nullptr));
+    } else if (command == "set-bandwidth-rules" && args.isEmpty()) {
+        json_error_t error;
+        json_t *rules = json_loadf(stdin, 0, &error);
+        if (!json_is_array(rules)) {
+            fprintf(stderr, "the rules must be a json array: %s\n", error.text);
+            json_decref(rules);
+            json_decref(calls);
+            return nullptr;
+        }
+        json_t *params = json_object();
+        json_object_set_new(params, "rules", rules);
+        json_array_append_new(calls, newCall("set_bandwidth_rules", params));
+    } else if ((command == "prefetch" || command == "pin" || command == "unpin") &&
+               args.size() == 4) {
+        json_array_append_new(calls, newCall(command.toUtf8().constData(),
+                                             locationParams(args)));
+    } else if (command == "set-rate-limits" && args.size() == 2) {
+        json_t *params = json_object();
+        json_object_set_new(params, "upload", json_integer(args[0].toLongLong()));
+        json_object_set_new(params, "download", json_integer(args[1].toLongLong()));
+        json_array_append_new(calls, newCall("set_rate_limits", params));
+    } else if (command == "history" && args.size() <= 4) {
+        json_t *params = json_object();
+        if (args.size() > 0) {
+            json_object_set_new(params, "from", json_integer(args[0].toLongLong()));
+        }
+        if (args.size() > 1) {
+            json_object_set_new(params, "to", json_integer(args[1].toLongLong()));
+        }
+        if (args.size() > 2) {
+            json_object_set_new(params, "prefix", json_string(args[2].toUtf8().constData()));
+        }
+        if (args.size() > 3) {
+            json_object_set_new(params, "limit", json_integer(args[3].toInt()));
+        }
+        json_array_append_new(calls, newCall("transfer_history", params));
+    } else if (command == "batch" && args.isEmpty()) {
+        json_decref(calls);
+        json_error_t error;
+        calls = json_loadf(stdin, 0, &error);
+        if (!json_is_array(calls)) {
+            fprintf(stderr, "the batch must be a json array: %s\n", error.text);
+            json_decref(calls);
+            return nullptr;
+        }
+    } else {
+        json_decref(calls);
+        return nullptr;
+    }
+
+    return calls;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    setupSettingDomain();
+
+    QStringList args = app.arguments().mid(1);
+    QString socket_path;
+    if (args.size() >= 2 && (args[0] == "-s" || args[0] == "--socket")) {
+        // Relative to the dir the command is run in, not to the home dir
+        // changed to below.
+        socket_path = QDir::current().absoluteFilePath(args[1]);
+        args = args.mid(2);
+    }
+    if (args.isEmpty()) {
+        usage();
+        return EXIT_CALL_FAILED;
+    }
+
+    // The default socket path is relative to the home dir, which is the
+    // current dir of the gui.
+    QDir::setCurrent(QDir::homePath());
+    if (socket_path.isEmpty()) {
+        socket_path = getAppletRpcSocketPath();
+    }
+
+    json_t *calls = buildCalls(args[0], args.mid(1));
+    if (!calls) {
+        usage();
+        return EXIT_CALL_FAILED;
+    }
+    json_t *request = json_object();
+    json_object_set_new(request, "version", json_integer(SEADRIVE_CONTROL_API_VERSION));
+    json_object_set_new(request, "calls", calls);
+    char *request_str = json_dumps(request, JSON_COMPACT);
+    json_decref(request);
+
+    SearpcNamedPipeClient *pipe_client =
+        searpc_create_named_pipe_client(socket_path.toUtf8().constData());
+    int connected = searpc_named_pipe_client_connect(pipe_client);
+    SearpcClient *client = searpc_client_with_named_pipe_transport(
+        pipe_client, SEADRIVE_CONTROL_RPC_SERVICE);
+    if (connected < 0) {
+        fprintf(stderr, "failed to connect to %s, is seadrive-gui running?\n",
+                socket_path.toUtf8().constData());
+        searpc_free_client_with_pipe_transport(client);
+        free(request_str);
+        return EXIT_UNREACHABLE;
+    }
+
+    GError *error = NULL;
+    char *response_str = searpc_client_call__string(
+        client, SEADRIVE_CONTROL_RPC_FUNCTION, &error, 1, "string", request_str);
+    free(request_str);
+    searpc_free_client_with_pipe_transport(client);
+    if (error) {
+        fprintf(stderr, "control request failed: %s\n",
+                error->message ? error->message : "");
+        g_error_free(error);
+        return EXIT_UNREACHABLE;
+    }
+
+    json_error_t json_error;
+    json_t *response = json_loads(response_str ? response_str : "", 0, &json_error);
+    g_free(response_str);
+    if (!response) {
+        fprintf(stderr, "invalid response: %s\n", json_error.text);
+        return EXIT_UNREACHABLE;
+    }
+
+    int ret = EXIT_OK;
+    json_t *results = json_object_get(response, "results");
+    if (!json_is_array(results)) {
+        ret = EXIT_CALL_FAILED;
+    }
+    for (size_t i = 0; i < json_array_size(results); i++) {
+        if (!json_is_true(json_object_get(json_array_get(results, i), "ok"))) {
+            ret = EXIT_CALL_FAILED;
+        }
+    }
+
+    char *dump = json_dumps(response, JSON_INDENT(2));
+    printf("%s\n", dump);
+    free(dump);
+    json_decref(response);
+
+    return ret;
+}
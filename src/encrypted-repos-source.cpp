@@ -0,0 +1,178 @@
+#include <QTimer>
+
+#include "account-mgr.h"
+#include "daemon-mgr.h"
+#include "seadrive-gui.h"
+#include "timer-scheduler.h"
+#include "rpc/rpc-client.h"
+#include "utils/json-utils.h"
+
+#include "encrypted-repos-source.h"
+
+namespace {
+
+// Invalidations within this delay are fetched once.
+const int kRefreshDelayMSecs = 300;
+
+// Libraries created on the server don't always come with a notification, so
+// a watched list is still fetched once in a while.
+const int kExpireIntervalMSecs = 60 * 1000;
+const int kMaxExpireIntervalMSecs = 5 * 60 * 1000;
+
+} // namespace
+
+
+EncryptedRepoInfo EncryptedRepoInfo::fromJSON(const json_t *root) {
+
+    EncryptedRepoInfo enc_repo_info;
+    Json json(root);
+
+    enc_repo_info.repo_id = json.getString("repo_id");
+    enc_repo_info.repo_name = json.getString("repo_display_name");
+    enc_repo_info.repo_server = json.getString("server");
+    enc_repo_info.repo_username = json.getString("username");
+    enc_repo_info.is_password_set  = json.getBool("is_passwd_set");
+    return enc_repo_info;
+}
+
+QList<EncryptedRepoInfo> EncryptedRepoInfo::listFromJSON(const json_t *json) {
+    QList<EncryptedRepoInfo> enc_repo_infos;
+    for (size_t i = 0; i < json_array_size(json); i++) {
+        EncryptedRepoInfo enc_repo_info = fromJSON(json_array_get(json, i));
+        enc_repo_infos.push_back(enc_repo_info);
+    }
+    return enc_repo_infos;
+}
+
+
+SINGLETON_IMPL(EncryptedReposSource)
+
+EncryptedReposSource::EncryptedReposSource()
+    : version_(0),
+      dirty_(true),
+      watchers_(0)
+{
+    refresh_timer_ = new QTimer(this);
+    refresh_timer_->setSingleShot(true);
+    refresh_timer_->setInterval(kRefreshDelayMSecs);
+    connect(refresh_timer_, SIGNAL(timeout()), this, SLOT(refresh()));
+
+    expire_timer_ = new ScheduledTimer("encrypted-repos", this);
+    expire_timer_->setInterval(kExpireIntervalMSecs);
+    expire_timer_->setMaxInterval(kMaxExpireIntervalMSecs);
+    connect(expire_timer_, SIGNAL(timeout()), this, SLOT(onRefreshTimeout()));
+}
+
+void EncryptedReposSource::start()
+{
+    connect(gui->accountManager(), SIGNAL(accountMQUpdated()),
+            this, SLOT(invalidate()));
+    connect(gui->daemonManager(), SIGNAL(daemonRestarted()),
+            this, SLOT(invalidate()));
+}
+
+void EncryptedReposSource::addWatcher()
+{
+    if (watchers_++ == 0) {
+        expire_timer_->start();
+        refresh();
+    }
+}
+
+void EncryptedReposSource::removeWatcher()
+{
+    if (--watchers_ == 0) {
+        expire_timer_->stop();
+        refresh_timer_->stop();
+    }
+}
+
+void EncryptedReposSource::invalidate()
+{
+    dirty_ = true;
+    if (watchers_ > 0 && !refresh_timer_->isActive()) {
+        refresh_timer_->start();
+    }
+}
+
+void EncryptedReposSource::onRefreshTimeout()
+{
+    dirty_ = true;
+    refresh();
+}
+
+void EncryptedReposSource::refresh()
+{
+    if (!dirty_) {
+        return;
+    }
+
+    SeafileRpcClient *rpc_client = gui->rpcClient();
+    // Stays invalid, so the list is fetched when the daemon is back.
+    if (!rpc_client->isConnected()) {
+        return;
+    }
+    json_t *ret;
+    if (!rpc_client->getEncryptedRepoList(&ret)) {
+        qWarning("failed to get encrypt library list");
+        return;
+    }
+    QList<EncryptedRepoInfo> repos = EncryptedRepoInfo::listFromJSON(ret);
+    json_decref(ret);
+
+    dirty_ = false;
+    applyList(repos);
+}
+
+// Turns repos_ into `repos` step by step, emitting each step.
+void EncryptedReposSource::applyList(const QList<EncryptedRepoInfo>& repos)
+{
+    bool changed = false;
+
+    // Remove the libraries that are gone, from the last one so the rows
+    // before it don't move.
+    for (int i = repos_.size() - 1; i >= 0; i--) {
+        bool found = false;
+        for (const EncryptedRepoInfo& info : repos) {
+            if (info.isSameRepo(repos_[i])) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            repos_.removeAt(i);
+            emit repoRemoved(i);
+            changed = true;
+        }
+    }
+
+    // Now repos_ only has libraries in `repos`, so walk both in the new
+    // order, moving or inserting the rows that are not in place.
+    for (int i = 0; i < repos.size(); i++) {
+        const EncryptedRepoInfo& info = repos[i];
+        if (i < repos_.size() && repos_[i].isSameRepo(info)) {
+            if (!(repos_[i] == info)) {
+                repos_[i] = info;
+                emit repoUpdated(i, info);
+                changed = true;
+            }
+            continue;
+        }
+
+        for (int j = i + 1; j < repos_.size(); j++) {
+            if (repos_[j].isSameRepo(info)) {
+                repos_.removeAt(j);
+                emit repoRemoved(j);
+                break;
+            }
+        }
+        repos_.insert(i, info);
+        emit repoInserted(i, info);
+        changed = true;
+    }
+
+    if (changed) {
+        version_++;
+        emit versionChanged(version_);
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef SEADRIVE_GUI_ENCRYPTED_REPOS_SOURCE_H
+#define SEADRIVE_GUI_ENCRYPTED_REPOS_SOURCE_H
+
+#include <jansson.h>
+
+#include <QObject>
+#include <QList>
+#include <QString>
+
+#include "utils/singleton.h"
+
+class QTimer;
+class ScheduledTimer;
+
+class EncryptedRepoInfo {
+
+public:
+    QString repo_id;
+    QString repo_name;
+    QString repo_server;
+    QString repo_username;
+    bool is_password_set;
+
+    // The same library of the same account.
+    bool isSameRepo(const EncryptedRepoInfo& info) const {
+        return repo_id == info.repo_id && repo_server == info.repo_server &&
+               repo_username == info.repo_username;
+    }
+
+    bool operator==(const EncryptedRepoInfo& info) const {
+        return repo_id == info.repo_id && repo_name == info.repo_name && is_password_set == info.is_password_set;
+    }
+
+    static  EncryptedRepoInfo fromJSON(const json_t *root);
+    static QList<EncryptedRepoInfo> listFromJSON(const json_t *json);
+
+};
+
+/**
+ * Keeps the list of encrypted libraries reported by the daemon.
+ *
+ * The list is only fetched again after something that may change it: a sync
+ * finished, the accounts changed, the daemon restarted or a library password
+ * was set or cleared. Invalidations close to each other are coalesced into
+ * one fetch, and a list that nobody watches isn't fetched at all until a
+ * watcher is added.
+ *
+ * The new list is compared with the old one, and the differences are emitted
+ * as row insertions, removals and updates, in an order that can be applied
+ * one by one to a copy of the old list. Each change increases the version.
+ */
+class EncryptedReposSource : public QObject {
+    SINGLETON_DEFINE(EncryptedReposSource)
+    Q_OBJECT
+public:
+    EncryptedReposSource();
+
+    void start();
+
+    const QList<EncryptedRepoInfo>& repos() const { return repos_; }
+    quint64 version() const { return version_; }
+
+    // The list is kept fresh while there are watchers, e.g. a visible
+    // dialog.
+    void addWatcher();
+    void removeWatcher();
+
+public slots:
+    void invalidate();
+    // Fetches the list now, if it's invalid.
+    void refresh();
+
+signals:
+    void repoInserted(int row, const EncryptedRepoInfo& info);
+    void repoRemoved(int row);
+    void repoUpdated(int row, const EncryptedRepoInfo& info);
+    // Emitted after a batch of changes.
+    void versionChanged(quint64 version);
+
+private slots:
+    void onRefreshTimeout();
+
+private:
+    Q_DISABLE_COPY(EncryptedReposSource)
+
+    void applyList(const QList<EncryptedRepoInfo>& repos);
+
+    QList<EncryptedRepoInfo> repos_;
+    quint64 version_;
+    bool dirty_;
+    int watchers_;
+
+    QTimer *refresh_timer_;
+    ScheduledTimer *expire_timer_;
+};
+
+#endif // SEADRIVE_GUI_ENCRYPTED_REPOS_SOURCE_H
@@ -1,15 +1,23 @@
+#include <QtGlobal>
+
+#if defined(Q_OS_WIN32)
 #include <winsock2.h>
 #include <windows.h>
 #include <io.h>
 #include <shlobj.h>
 #include <shlwapi.h>
+#include <userenv.h>
+#endif
 #include <fcntl.h>
 #include <ctype.h>
-#include <userenv.h>
+#include <limits.h>
+#include <string.h>
 
+#include <memory>
 #include <string>
 #include <QMutexLocker>
 #include <QList>
+#include <QRunnable>
 #include <QDir>
 #include <QDebug>
 
@@ -26,68 +34,50 @@
 #include "account-mgr.h"
 #include "settings-mgr.h"
 #include "utils/utils.h"
-#include "utils/utils-win.h"
 #include "auto-login-service.h"
 #include "ext-handler.h"
+#include "ext-transport.h"
+#include "ext-request.h"
+#include "cached-files-index.h"
+#include "cache-analyzer.h"
+#include "repo-topology.h"
+#include "prefetch-mgr.h"
 #include "thumbnail-service.h"
+#include "link-service.h"
 
 namespace {
 
-const char *kSeafExtPipeName = "\\\\.\\pipe\\seadrive_ext_pipe_";
-const int kPipeBufSize = 1024;
-
 const quint64 kReposInfoCacheMSecs = 2000;
 
-bool
-extPipeReadN (HANDLE pipe, void *buf, size_t len)
-{
-    DWORD bytes_read;
-    bool success = ReadFile(
-        pipe,                  // handle to pipe
-        buf,                   // buffer to receive data
-        (DWORD)len,            // size of buffer
-        &bytes_read,           // number of bytes read
-        NULL);                 // not overlapped I/O
-
-    if (!success || bytes_read != (DWORD)len) {
-        DWORD error = GetLastError();
-        if (error == ERROR_BROKEN_PIPE) {
-            qDebug("[ext] connection closed by extension\n");
-        } else {
-            qWarning("[ext] Failed to read command from extension(), "
-                     "error code %lu\n", error);
-        }
-        return false;
-    }
+// Only the latest changes are kept for the subscribers. A subscriber that
+// falls behind would be told to invalidate everything.
+const int kMaxPendingStatusChanges = 1000;
 
-    return true;
-}
+// Send an empty message to the subscribers when nothing changes for a while,
+// so we can find out the extensions that are gone.
+const unsigned long kStatusKeepAliveMSecs = 60 * 1000;
 
-bool
-extPipeWriteN(HANDLE pipe, void *buf, size_t len)
-{
-    DWORD bytes_written;
-    bool success = WriteFile(
-        pipe,                  // handle to pipe
-        buf,                   // buffer to receive data
-        (DWORD)len,            // size of buffer
-        &bytes_written,        // number of bytes written
-        NULL);                 // not overlapped I/O
+// Tells the extension to invalidate its whole status cache.
+const char *kStatusChangedAll = "*";
 
-    if (!success || bytes_written != (DWORD)len) {
-        DWORD error = GetLastError();
-        if (error == ERROR_BROKEN_PIPE) {
-            qDebug("[ext] connection closed by extension\n");
-        } else {
-            qWarning("[ext] Failed to read command from extension(), "
-                     "error code %lu\n", error);
-        }
-        return false;
-    }
+// The first message of a subscription, so the extension knows the changes
+// will be notified. Old versions answer an empty message instead.
+const char *kStatusSubscribedAck = "subscribed";
 
-    FlushFileBuffers(pipe);
-    return true;
-}
+const char *kReposNotModified = "not-modified";
+
+const char *kDirStatusOK = "ok";
+const char *kDirStatusError = "error";
+
+// The highest version of the extension protocol we support. In version 2
+// each request carries an id, and is handled in a worker thread, so a slow
+// request doesn't block the others on the same connection.
+const int kExtProtocolVersion = 2;
+
+// Most requests end up waiting for the rpc client lock, so a few workers for
+// each connection are enough to keep the slow ones (e.g. fetching thumbnails
+// from the server) from blocking the others.
+const int kMaxConcurrentExtRequests = 4;
 
 /**
  * Replace "\" with "/", and remove the trailing slash
@@ -101,23 +91,6 @@ QString normalizedPath(const QString& path)
     return p;
 }
 
-std::string formatErrorMessage()
-{
-    DWORD error_code = ::GetLastError();
-    if (error_code == 0) {
-        return "no error";
-    }
-    char buf[256] = {0};
-    ::FormatMessage(FORMAT_MESSAGE_FROM_SYSTEM,
-                    NULL,
-                    error_code,
-                    MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-                    buf,
-                    sizeof(buf) - 1,
-                    NULL);
-    return buf;
-}
-
 bool parseFilePath(const QString &path,
                    Account *account,
                    QString *repo,
@@ -130,6 +103,10 @@ bool parseFilePath(const QString &path,
 
     auto accounts = gui->accountManager()->activeAccounts();
     for (auto a : accounts) {
+        // Otherwise it would be "/", which contains every path.
+        if (a.syncRoot.isEmpty()) {
+            continue;
+        }
         auto root = QDir::cleanPath(a.syncRoot) + "/";
         if (path.startsWith(root)) {
             relative_path = path.mid(root.length());
@@ -178,11 +155,98 @@ bool parseFilePath(const QString &path,
     return true;
 }
 
+// The paths are only decoded by the handlers that need them.
+QString pathArg(const ExtToken& token)
+{
+    return normalizedPath(QString::fromUtf8(token.data, (int)token.len));
+}
+
+quint64 tokenToULongLong(const ExtToken& token)
+{
+    quint64 value = 0;
+    for (size_t i = 0; i < token.len; i++) {
+        char c = token.data[i];
+        if (c < '0' || c > '9') {
+            return 0;
+        }
+        value = value * 10 + (c - '0');
+    }
+    return value;
+}
+
+int tokenToInt(const ExtToken& token)
+{
+    return (int)qMin<quint64>(tokenToULongLong(token), INT_MAX);
+}
+
+// Wraps a constant response without copying it.
+QByteArray constResponse(const char *resp)
+{
+    return QByteArray::fromRawData(resp, (int)strlen(resp));
+}
+
 inline QString path_concat(const QString& s1, const QString& s2)
 {
     return QString("%1/%2").arg(s1).arg(s2);
 }
 
+const char *lockStatusToString(int lock_status)
+{
+    switch (lock_status) {
+    case ExtCommandsHandler::NONE:
+        return "none";
+    case ExtCommandsHandler::LOCKED_BY_OTHER:
+        return "locked";
+    case ExtCommandsHandler::LOCKED_BY_OWNER:
+        return "locked_by_me";
+    case ExtCommandsHandler::LOCKED_AUTO:
+        return "locked_auto";
+    default:
+        qWarning() << "unknown locked status";
+    }
+    return "none";
+}
+
+class ExtRequestTask : public QRunnable {
+public:
+    ExtRequestTask(ExtCommandsHandler *handler, const QByteArray& raw_request)
+        : handler_(handler),
+          raw_request_(raw_request)
+    {
+    }
+
+    void run()
+    {
+        handler_->serveTaggedRequest(raw_request_);
+    }
+
+private:
+    ExtCommandsHandler *handler_;
+    QByteArray raw_request_;
+};
+
+// The children of a folder that have data in the daemon's file cache, mapped
+// to whether they are cached files. A folder there only means that some of
+// its files are cached.
+bool listCachedChildren(const QString& repo_id,
+                        const QString& dir_in_repo,
+                        QMap<QString, bool> *children)
+{
+    QString cache_dir = CacheAnalyzer::instance()->fileCacheDir();
+    if (cache_dir.isEmpty()) {
+        return false;
+    }
+
+    children->clear();
+    QDir dir(QDir(cache_dir).filePath(repo_id + dir_in_repo));
+    const QFileInfoList infos = dir.entryInfoList(
+        QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+    for (const QFileInfo& info : infos) {
+        children->insert(info.fileName(), info.isFile());
+    }
+    return true;
+}
+
 } // namespace
 
 
@@ -214,6 +278,9 @@ SeafileExtensionHandler::SeafileExtensionHandler()
     connect(listener_thread_, &ExtConnectionListenerThread::getUploadLink,
             this, &SeafileExtensionHandler::getUploadLink);
 
+    connect(listener_thread_, &ExtConnectionListenerThread::prefetchLinks,
+            this, &SeafileExtensionHandler::prefetchLinks);
+
     rpc_client_ = new SeafileRpcClient();
 }
 
@@ -241,38 +308,36 @@ void SeafileExtensionHandler::stop()
     if (started_) {
         // Before seafile client exits, tell the shell to clean all the file
         // status icons
+#if defined(Q_OS_WIN32)
         SHChangeNotify (SHCNE_ASSOCCHANGED, SHCNF_IDLIST, NULL, NULL);
+#endif
     }
 }
 
 void SeafileExtensionHandler::getUploadLink(const Account& account, const QString& repo_id, const QString& path_in_repo)
 {
-    GetUploadLinkRequest *req = new GetUploadLinkRequest(
-            account, repo_id, "/" + path_in_repo);
-    connect(req, &GetUploadLinkRequest::success,
-            this,&SeafileExtensionHandler::onGetUploadLinkSuccess);
-    connect(req, &GetUploadLinkRequest::failed,
-            this,&SeafileExtensionHandler::onGetUploadLinkFailed);
-    req->send();
+    LinkReply *reply = LinkService::instance()->getLink(
+        account, repo_id, path_in_repo, UPLOAD_LINK);
+    connect(reply, &LinkReply::finished,
+            this, &SeafileExtensionHandler::onGetUploadLinkSuccess);
+    connect(reply, &LinkReply::failed,
+            this, &SeafileExtensionHandler::onGetUploadLinkFailed);
 }
 
 void SeafileExtensionHandler::onGetUploadLinkSuccess(const QString& upload_link)
 {
-    GetUploadLinkRequest *req = qobject_cast<GetUploadLinkRequest *>(sender());
     UploadLinkDialog *dialog = new UploadLinkDialog(upload_link, NULL);
     dialog->setAttribute(Qt::WA_DeleteOnClose);
     dialog->show();
     dialog->raise();
     dialog->activateWindow();
-    req->deleteLater();
 }
 
 void SeafileExtensionHandler::onGetUploadLinkFailed(const ApiError& error)
 {
-    GetUploadLinkRequest *req = qobject_cast<GetUploadLinkRequest *>(sender());
-    const QString file = ::getBaseName(req->path());
+    LinkReply *reply = qobject_cast<LinkReply *>(sender());
+    const QString file = ::getBaseName(reply->path());
     gui->messageBox(tr("Failed to get upload link information for file \"%1\"").arg(file));
-    req->deleteLater();
 }
 
 void SeafileExtensionHandler::generateShareLink(const Account& account,
@@ -282,45 +347,43 @@ void SeafileExtensionHandler::generateShareLink(const Account& account,
                                                 bool internal)
 {
     if (internal) {
-        QString path = path_in_repo;
-        if (!is_file && !path.endsWith("/")) {
-            path += "/";
-        }
-        GetSmartLinkRequest *req = new GetSmartLinkRequest(account, repo_id, path, !is_file);
-        connect(req, SIGNAL(success(const QString&)),
+        LinkReply *reply = LinkService::instance()->getLink(
+            account, repo_id, path_in_repo, INTERNAL_LINK, !is_file);
+        connect(reply, SIGNAL(finished(const QString&)),
                 this, SLOT(onGetSmartLinkSuccess(const QString&)));
-        connect(req, SIGNAL(failed(const ApiError&)),
+        connect(reply, SIGNAL(failed(const ApiError&)),
                 this, SLOT(onGetSmartLinkFailed(const ApiError&)));
-
-        req->send();
     } else {
-        QString encoded_path_in_repo = path_in_repo.toUtf8().toPercentEncoding();
-        GetSharedLinkRequest *req = new GetSharedLinkRequest(
-            account, repo_id, encoded_path_in_repo);
+        LinkReply *reply = LinkService::instance()->getLink(
+            account, repo_id, path_in_repo, SHARE_LINK);
 
-        connect(req, SIGNAL(success(const QString&)),
+        connect(reply, SIGNAL(finished(const QString&)),
                 this, SLOT(onShareLinkGenerated(const QString&)));
 
-        connect(req, SIGNAL(failed(const ApiError&)),
+        connect(reply, SIGNAL(failed(const ApiError&)),
                 this, SLOT(onShareLinkGeneratedFailed(const ApiError&)));
-        req->send();
     }
 }
 
+void SeafileExtensionHandler::prefetchLinks(const Account& account,
+                                            const QString& repo_id,
+                                            const QString& path_in_repo,
+                                            bool is_dir)
+{
+    LinkService::instance()->prefetch(account, repo_id, path_in_repo, is_dir);
+}
+
 void SeafileExtensionHandler::onGetSmartLinkSuccess(const QString& smart_link)
 {
-    GetSmartLinkRequest *req = (GetSmartLinkRequest *)(sender());
     SeafileLinkDialog *dialog = new SeafileLinkDialog(smart_link, NULL);
     dialog->setAttribute(Qt::WA_DeleteOnClose);
     dialog->show();
     dialog->raise();
     dialog->activateWindow();
-    req->deleteLater();
 }
 
 void SeafileExtensionHandler::onGetSmartLinkFailed(const ApiError& error)
 {
-    GetSmartLinkRequest *req = (GetSmartLinkRequest *)(sender());
     qWarning("get smart_link failed %s\n", error.toString().toUtf8().data());
 
     int http_error_code =  error.httpErrorCode();
@@ -329,15 +392,14 @@ void SeafileExtensionHandler::onGetSmartLinkFailed(const ApiError& error)
     } else {
         gui->warningBox(tr("failed get internal link %1").arg(error.toString()));
     }
-    req->deleteLater();
 }
 
 void SeafileExtensionHandler::onShareLinkGenerated(const QString& link)
 {
-    GetSharedLinkRequest *req = qobject_cast<GetSharedLinkRequest *>(sender());
-    const Account account = req->getAccount();
-    const QString repo_id = req->getRepoId();
-    const QString repo_path = req->getRepoPath();
+    LinkReply *reply = qobject_cast<LinkReply *>(sender());
+    const Account account = reply->account();
+    const QString repo_id = reply->repoId();
+    const QString repo_path = reply->path().toUtf8().toPercentEncoding("/");
 
     SharedLinkDialog *dialog = new SharedLinkDialog(link,
                                                     account,
@@ -348,18 +410,15 @@ void SeafileExtensionHandler::onShareLinkGenerated(const QString& link)
     dialog->show();
     dialog->raise();
     dialog->activateWindow();
-    req->deleteLater();
 }
 
 void SeafileExtensionHandler::onShareLinkGeneratedFailed(const ApiError& error) {
-    GetSharedLinkRequest *req = qobject_cast<GetSharedLinkRequest *>(sender());
     int http_error_code = error.httpErrorCode();
     if (http_error_code == 403) {
         gui->warningBox(tr("No permissions to create a shared link"));
     } else {
         gui->messageBox(tr("Failed to get share link %1\n").arg(error.toString()));
     }
-    req->deleteLater();
 }
 
 void SeafileExtensionHandler::lockFile(const Account& account,
@@ -460,51 +519,80 @@ void SeafileExtensionHandler::onGetFileLockInfoFailed(const ApiError& error)
     req->deleteLater();
 }
 
-void ExtConnectionListenerThread::run()
+SINGLETON_IMPL(ExtStatusChangeNotifier)
+
+ExtStatusChangeNotifier::ExtStatusChangeNotifier()
+    : seq_(0)
 {
-    std::string local_pipe_name = utils::win::getLocalPipeName(kSeafExtPipeName);
-    qWarning("[ext listener] listening on %s", local_pipe_name.c_str());
-    while (1) {
-        HANDLE pipe = INVALID_HANDLE_VALUE;
-        bool connected = false;
-
-        pipe = CreateNamedPipe(
-            local_pipe_name.c_str(),  // pipe name
-            PIPE_ACCESS_DUPLEX,       // read/write access
-            PIPE_TYPE_MESSAGE |       // message type pipe
-            PIPE_READMODE_MESSAGE |   // message-read mode
-            PIPE_WAIT,                // blocking mode
-            PIPE_UNLIMITED_INSTANCES, // max. instances
-            kPipeBufSize,             // output buffer size
-            kPipeBufSize,             // input buffer size
-            0,                        // client time-out
-            NULL);                    // default security attribute
-
-        if (pipe == INVALID_HANDLE_VALUE) {
-            qWarning ("Failed to create named pipe, GLE=%lu\n",
-                      GetLastError());
-            return;
-        }
+}
+
+void ExtStatusChangeNotifier::notifyChanged(const QString& path)
+{
+    QMutexLocker locker(&mutex_);
+    changes_.append(qMakePair(++seq_, normalizedPath(path)));
+    while (changes_.size() > kMaxPendingStatusChanges) {
+        changes_.removeFirst();
+    }
+    cond_.wakeAll();
+}
 
-        /* listening on this pipe */
-        connected = ConnectNamedPipe(pipe, NULL) ?
-            true : (GetLastError() == ERROR_PIPE_CONNECTED);
+quint64 ExtStatusChangeNotifier::currentSeq()
+{
+    QMutexLocker locker(&mutex_);
+    return seq_;
+}
 
-        if (!connected) {
-            qWarning ("Failed on ConnectNamedPipe(), GLE=%lu\n",
-                      GetLastError());
-            CloseHandle(pipe);
-            return;
+bool ExtStatusChangeNotifier::waitForChanges(quint64 *seq,
+                                             QStringList *paths,
+                                             unsigned long timeout_msecs)
+{
+    QMutexLocker locker(&mutex_);
+    if (seq_ == *seq && !cond_.wait(&mutex_, timeout_msecs)) {
+        return false;
+    }
+    if (seq_ == *seq) {
+        return false;
+    }
+
+    paths->clear();
+    if (changes_.isEmpty() || changes_.first().first > *seq + 1) {
+        // Some changes have been dropped before the subscriber got them.
+        paths->append(kStatusChangedAll);
+    } else {
+        for (const auto& change : changes_) {
+            if (change.first <= *seq) {
+                continue;
+            }
+            if (change.second.isEmpty()) {
+                paths->clear();
+                paths->append(kStatusChangedAll);
+                break;
+            }
+            paths->append(change.second);
         }
+    }
+    *seq = seq_;
+    return true;
+}
 
-        qDebug ("[ext pipe] Accepted an extension pipe client\n");
-        servePipeInNewThread(pipe);
+void ExtConnectionListenerThread::run()
+{
+    std::unique_ptr<ExtListener> listener(ExtListener::create());
+    if (!listener) {
+        return;
+    }
+    while (1) {
+        ExtConnection *conn = listener->accept();
+        if (!conn) {
+            return;
+        }
+        serveConnectionInNewThread(conn);
     }
 }
 
-void ExtConnectionListenerThread::servePipeInNewThread(HANDLE pipe)
+void ExtConnectionListenerThread::serveConnectionInNewThread(ExtConnection *conn)
 {
-    ExtCommandsHandler *t = new ExtCommandsHandler(pipe);
+    ExtCommandsHandler *t = new ExtCommandsHandler(conn);
 
     connect(t, SIGNAL(generateShareLink(const Account&, const QString&, const QString&, bool, bool)),
             this, SIGNAL(generateShareLink(const Account&, const QString&, const QString&, bool, bool)));
@@ -518,123 +606,229 @@ void ExtConnectionListenerThread::servePipeInNewThread(HANDLE pipe)
             this, SIGNAL(showLockedBy(const Account&, const QString&, const QString&)));
     connect(t, &ExtCommandsHandler::getUploadLink,
             this, &ExtConnectionListenerThread::getUploadLink);
+    connect(t, &ExtCommandsHandler::prefetchLinks,
+            this, &ExtConnectionListenerThread::prefetchLinks);
     t->start();
 }
 
-ExtCommandsHandler::ExtCommandsHandler(HANDLE pipe)
+ExtCommandsHandler::ExtCommandsHandler(ExtConnection *conn)
+    : conn_(conn),
+      protocol_version_(1)
 {
-    pipe_ = pipe;
+    workers_.setMaxThreadCount(kMaxConcurrentExtRequests);
 }
 
 void ExtCommandsHandler::run()
 {
     while (1) {
-        QStringList args;
-        if (!readRequest(&args)) {
+        uint32_t len;
+        if (!readRequest(&len)) {
             qWarning ("failed to read request from shell extension: %s",
-                      formatErrorMessage().c_str());
+                      toCStr(conn_->errorString()));
             break;
         }
 
-        // qWarning() << "get a new command: " << args;
-
-        QString cmd = args.takeAt(0);
-        QString resp;
-        if (cmd == "list-repos") {
-            resp = handleListRepos(args);
-        } else if (cmd == "get-share-link") {
-            handleGenShareLink(args, false);
-        } else if (cmd == "get-internal-link") {
-            handleGenShareLink(args, true);
-        } else if (cmd == "get-file-status") {
-            resp = handleGetFileLockStatus(args);
-        } else if (cmd == "lock-file") {
-            handleLockFile(args, true);
-        } else if (cmd == "unlock-file") {
-            handleLockFile(args, false);
-        } else if (cmd == "private-share-to-group") {
-            handlePrivateShare(args, true);
-        } else if (cmd == "private-share-to-user") {
-            handlePrivateShare(args, false);
-        } else if (cmd == "show-history") {
-            handleShowHistory(args);
-        } else if (cmd == "show-locked-by") {
-            handleShowLockedBy(args);
-        } else if (cmd == "get-upload-link") {
-            handleGetUploadLink(args);
-        } else if (cmd == "download") {
-            handleDownload(args);
-        } else if (cmd == "is-file-cached") {
-            bool is_cached = handleIsFileCached(args);
-            resp = is_cached ? "cached" : "uncached";
-        } else if (cmd == "get-thumbnail-from-server") {
-            resp = handleGetThumbnailFromServer(args);
+        if (protocol_version_ >= 2) {
+            // The buffer is reused for the next request, so the worker needs
+            // its own copy.
+            workers_.start(new ExtRequestTask(
+                this, QByteArray(read_buf_.constData(), len)));
+            continue;
+        }
+
+        ExtRequest req;
+        QByteArray resp;
+        if (!parseExtRequest(read_buf_.constData(), len, false, &req)) {
+            qWarning("[ext] got a malformed request");
+        } else if (req.command == EXT_CMD_SUBSCRIBE_STATUS_CHANGES) {
+            // The connection is dedicated to the notifications from now on.
+            serveStatusSubscription();
+            break;
+        } else if (req.command == EXT_CMD_HELLO) {
+            resp = handleHello(req);
         } else {
-            qWarning ("[ext] unknown request command: %s", cmd.toUtf8().data());
+            resp = handleRequest(req);
         }
 
         if (!sendResponse(resp)) {
             qWarning ("failed to write response to shell extension: %s",
-                      formatErrorMessage().c_str());
+                      toCStr(conn_->errorString()));
             break;
         }
     }
 
-    qDebug ("An extension client is disconnected: GLE=%lu\n",
-            GetLastError());
-    DisconnectNamedPipe(pipe_);
-    CloseHandle(pipe_);
+    // The workers may still be writing their responses.
+    workers_.waitForDone();
+
+    qDebug ("An extension client is disconnected");
+    delete conn_;
+    conn_ = nullptr;
 }
 
-bool ExtCommandsHandler::readRequest(QStringList *args)
+void ExtCommandsHandler::serveTaggedRequest(const QByteArray& raw_request)
 {
-    uint32_t len = 0;
-    if (!extPipeReadN(pipe_, &len, sizeof(len)) || len == 0)
-        return false;
+    ExtRequest req;
+    if (!parseExtRequest(raw_request.constData(), raw_request.size(), true, &req)) {
+        qWarning("[ext] got a malformed request");
+        // The extension would wait for the response until it times out.
+        // Answer with an empty response, like for an unknown command, or
+        // drop the connection if we don't know which request it was.
+        ExtToken id;
+        if (!parseExtRequestId(raw_request.constData(), raw_request.size(), &id)) {
+            conn_->shutdown();
+        } else if (!sendResponse(QByteArray(), &id)) {
+            qWarning ("failed to write response to shell extension: %s",
+                      toCStr(conn_->errorString()));
+        }
+        return;
+    }
 
-    QScopedArrayPointer<char> buf(new char[len + 1]);
-    buf.data()[len] = 0;
-    if (!extPipeReadN(pipe_, buf.data(), len))
-        return false;
+    QByteArray resp = handleRequest(req);
+    if (!sendResponse(resp, &req.id)) {
+        qWarning ("failed to write response to shell extension: %s",
+                  toCStr(conn_->errorString()));
+    }
+}
+
+QByteArray ExtCommandsHandler::handleHello(const ExtRequest& req)
+{
+    int version = 1;
+    if (req.n_args > 0) {
+        version = tokenToInt(req.args[0]);
+    }
+    protocol_version_ = qBound(1, version, kExtProtocolVersion);
+    return QByteArray::number(protocol_version_);
+}
 
-    QStringList list = QString::fromUtf8(buf.data()).split('\t');
-    if (list.empty()) {
-        qWarning("[ext] got an empty request");
+QByteArray ExtCommandsHandler::handleRequest(const ExtRequest& req)
+{
+    // The handlers take the arguments as they are in the request buffer, and
+    // only decode the paths they need.
+    switch (req.command) {
+    case EXT_CMD_LIST_REPOS:
+        return handleListRepos(req);
+    case EXT_CMD_GET_SHARE_LINK:
+        handleGenShareLink(req, false);
+        break;
+    case EXT_CMD_GET_INTERNAL_LINK:
+        handleGenShareLink(req, true);
+        break;
+    case EXT_CMD_GET_FILE_STATUS:
+        return handleGetFileLockStatus(req);
+    case EXT_CMD_GET_DIR_STATUS:
+        return handleGetDirStatus(req);
+    case EXT_CMD_LOCK_FILE:
+        handleLockFile(req, true);
+        break;
+    case EXT_CMD_UNLOCK_FILE:
+        handleLockFile(req, false);
+        break;
+    case EXT_CMD_PRIVATE_SHARE_TO_GROUP:
+        handlePrivateShare(req, true);
+        break;
+    case EXT_CMD_PRIVATE_SHARE_TO_USER:
+        handlePrivateShare(req, false);
+        break;
+    case EXT_CMD_SHOW_HISTORY:
+        handleShowHistory(req);
+        break;
+    case EXT_CMD_SHOW_LOCKED_BY:
+        handleShowLockedBy(req);
+        break;
+    case EXT_CMD_GET_UPLOAD_LINK:
+        handleGetUploadLink(req);
+        break;
+    case EXT_CMD_DOWNLOAD:
+        handleDownload(req);
+        break;
+    case EXT_CMD_IS_FILE_CACHED:
+        return constResponse(handleIsFileCached(req) ? "cached" : "uncached");
+    case EXT_CMD_GET_THUMBNAIL_FROM_SERVER:
+        return handleGetThumbnailFromServer(req);
+    case EXT_CMD_PREFETCH_LINKS:
+        handlePrefetchLinks(req);
+        break;
+    default:
+        qWarning ("[ext] unknown request command: %s",
+                  QByteArray(req.name.data, req.name.len).data());
+    }
+    return QByteArray();
+}
+
+// The request is read into `read_buf_`, which is reused by the following
+// requests of the connection.
+bool ExtCommandsHandler::readRequest(uint32_t *len)
+{
+    if (!conn_->readN(len, sizeof(*len)) || *len == 0)
         return false;
+
+    if ((uint32_t)read_buf_.size() < *len) {
+        read_buf_.resize(*len);
     }
-    *args = list;
+    if (!conn_->readN(read_buf_.data(), *len))
+        return false;
+
     return true;
 }
 
-bool ExtCommandsHandler::sendResponse(const QString& resp)
+bool ExtCommandsHandler::sendResponse(const QByteArray& resp, const ExtToken *id)
 {
-    QByteArray raw_resp = resp.toUtf8();
+    // In version 2 the response is prefixed with the id of the request.
+    QByteArray tagged;
+    if (id) {
+        tagged.reserve(id->len + 1 + resp.size());
+        tagged.append(id->data, id->len);
+        tagged.append('\t');
+        tagged.append(resp);
+    }
+    const QByteArray& raw_resp = id ? tagged : resp;
     uint32_t len = raw_resp.length();
 
-    if (!extPipeWriteN(pipe_, &len, sizeof(len))) {
+    // The length and the body must not be interleaved with other responses.
+    QMutexLocker locker(&write_mutex_);
+
+    if (!conn_->writeN(&len, sizeof(len))) {
         return false;
     }
     if (len > 0) {
-        if (!extPipeWriteN(pipe_, raw_resp.data(), len)) {
+        if (!conn_->writeN(raw_resp.constData(), len)) {
             return false;
         }
     }
     return true;
 }
 
+void ExtCommandsHandler::serveStatusSubscription()
+{
+    ExtStatusChangeNotifier *notifier = ExtStatusChangeNotifier::instance();
+    quint64 seq = notifier->currentSeq();
+    if (!sendResponse(kStatusSubscribedAck)) {
+        return;
+    }
+    while (1) {
+        QStringList paths;
+        // An empty message is sent as keep-alive when nothing has changed.
+        notifier->waitForChanges(&seq, &paths, kStatusKeepAliveMSecs);
+        if (!sendResponse(paths.join("\n").toUtf8())) {
+            qDebug("[ext] status subscriber is gone");
+            break;
+        }
+    }
+}
+
 // QList<LocalRepo> ExtCommandsHandler::listLocalRepos(quint64 ts)
 // {
 //     return ReposInfoCache::instance()->getReposInfo(ts);
 // }
 
-void ExtCommandsHandler::handleGenShareLink(const QStringList& args, bool internal)
+void ExtCommandsHandler::handleGenShareLink(const ExtRequest& req, bool internal)
 {
-    if (args.size() != 1) {
+    if (req.n_args != 1) {
         return;
     }
 
     Account account;
-    QString path = args[0];
+    QString path = pathArg(req.args[0]);
     QString repo_id, path_in_repo;
     if (!parseRepoFileInfo(path, &account, &repo_id, &path_in_repo)) {
         return;
@@ -645,42 +839,44 @@ void ExtCommandsHandler::handleGenShareLink(const QStringList& args, bool intern
     return;
 }
 
-QString ExtCommandsHandler::handleListRepos(const QStringList& args)
+// The response is like:
+//
+//     internal-link-supported
+//     version\t<version of the list>
+//     <sync root>
+//     <repo folder>
+//     ...
+//
+// When the extension passes the version it already has, and the list hasn't
+// changed since then, only "not-modified" is returned.
+QByteArray ExtCommandsHandler::handleListRepos(const ExtRequest& req)
 {
-    if (args.size() != 0) {
-        qWarning("handleListRepos: args is not 0");
-        return "";
+    if (req.n_args > 1) {
+        qWarning("handleListRepos: too many args");
+        return QByteArray();
     }
 
-    QStringList fullpaths;
-    fullpaths << "internal-link-supported";
-
-    auto accounts = gui->accountManager()->activeAccounts();
-    for (auto account : accounts) {
-        fullpaths << account.syncRoot;
-
-        auto subdirs = QDir(account.syncRoot).entryList(
-            QStringList(), QDir::Dirs | QDir::NoDot | QDir::NoDotDot);
-
-        for (auto subdir : subdirs) {
-            auto repos = QDir(pathJoin(account.syncRoot, subdir)).entryList(
-                QStringList(), QDir::Dirs | QDir::NoDot | QDir::NoDotDot);
-
-            for (auto repo : repos) {
-                fullpaths << pathJoin(account.syncRoot, subdir, repo);
-            }
-        }
+    quint64 version;
+    QStringList dirs = RepoTopology::instance()->repoDirs(&version);
+    if (req.n_args == 1 && tokenToULongLong(req.args[0]) == version) {
+        return constResponse(kReposNotModified);
     }
 
-    return fullpaths.join("\n");
+    QByteArray resp("internal-link-supported\nversion\t");
+    resp += QByteArray::number(version);
+    for (const QString& dir : dirs) {
+        resp += '\n';
+        resp += dir.toUtf8();
+    }
+    return resp;
 }
 
-void ExtCommandsHandler::handleGetUploadLink(const QStringList& args)
+void ExtCommandsHandler::handleGetUploadLink(const ExtRequest& req)
 {
-    if (args.size() != 1) {
+    if (req.n_args != 1) {
         return;
     }
-    QString path = normalizedPath(args[0]);
+    QString path = pathArg(req.args[0]);
     Account account;
     QString repo_id, path_in_repo;
 
@@ -691,55 +887,118 @@ void ExtCommandsHandler::handleGetUploadLink(const QStringList& args)
     emit getUploadLink(account, repo_id, path_in_repo);
 }
 
-QString ExtCommandsHandler::handleGetFileLockStatus(const QStringList& args)
+// Sent when the context menu of an item is opened, so the share actions in
+// the menu find the links ready. Args: path, and "dir" for a folder.
+void ExtCommandsHandler::handlePrefetchLinks(const ExtRequest& req)
 {
-    if (args.size() != 1) {
-        return "";
+    if (req.n_args < 1 || req.n_args > 2) {
+        return;
     }
-    QString path = args[0];
+    QString path = pathArg(req.args[0]);
+    bool is_dir = req.n_args == 2 && QByteArray(req.args[1].data, req.args[1].len) == "dir";
 
     Account account;
     QString repo_id, path_in_repo;
     if (!parseRepoFileInfo(path, &account, &repo_id, &path_in_repo)) {
-        return"";
+        return;
+    }
+
+    emit prefetchLinks(account, repo_id, path_in_repo, is_dir);
+}
+
+QByteArray ExtCommandsHandler::handleGetFileLockStatus(const ExtRequest& req)
+{
+    if (req.n_args != 1) {
+        return QByteArray();
     }
+    QString path = pathArg(req.args[0]);
 
+    Account account;
+    QString repo_id, path_in_repo;
+    if (!parseRepoFileInfo(path, &account, &repo_id, &path_in_repo)) {
+        return QByteArray();
+    }
 
+#if defined(Q_OS_WIN32)
     QMutexLocker locker(&rpc_client_mutex_);
     int lock_status;
     if (!rpc_client_->getRepoFileLockStatus(repo_id, path_in_repo, &lock_status)) {
         qWarning() << "failed to file lock status" << path;
-        return"";
+        return QByteArray();
     }
+#else
+    // The daemon only tracks the file locks on windows.
+    int lock_status = NONE;
+#endif
 
-    QString status = "none";
-    switch (lock_status) {
-    case NONE:
-        status = "none";
-        break;
-    case LOCKED_BY_OTHER:
-        status = "locked";
-        break;
-    case LOCKED_BY_OWNER:
-        status = "locked_by_me";
-        break;
-    case LOCKED_AUTO:
-        status = "locked_auto";
-        break;
-    default:
-        qWarning() << "unknown locked status";
+    return constResponse(lockStatusToString(lock_status));
+}
+
+// Returns the status of the entries of a folder that have data in the cache,
+// so the extension doesn't need to send a request for each of them. The
+// response is like:
+//
+//     ok
+//     <name>\t<lock status>\t<cached|uncached>
+//     ...
+//
+// The daemon has no rpc for the status of a whole folder, and listing the
+// folder on the virtual drive may call back into the daemon. So the entries
+// are taken from the file cache on the local disk, once for each folder until
+// it expires in CachedFilesIndex. The entries not listed are not cached.
+QByteArray ExtCommandsHandler::handleGetDirStatus(const ExtRequest& req)
+{
+    if (req.n_args != 1) {
+        return constResponse(kDirStatusError);
+    }
+    QString dir = pathArg(req.args[0]);
+
+    // The folder is resolved only once for all of its entries.
+    Account account;
+    QString repo_id, dir_in_repo;
+    if (!parseRepoFileInfo(dir, &account, &repo_id, &dir_in_repo)) {
+        return constResponse(kDirStatusError);
+    }
+
+    CachedFilesIndex *cached_files = CachedFilesIndex::instance();
+    QMap<QString, bool> children;
+    if (!cached_files->lookupDir(dir, &children)) {
+        if (!listCachedChildren(repo_id, dir_in_repo, &children)) {
+            return constResponse(kDirStatusError);
+        }
+        QString repo_dir = dir.left(dir.size() - dir_in_repo.size());
+        cached_files->fillDir(repo_id, repo_dir, dir, children);
     }
 
-    return status;
+    QByteArray resp(kDirStatusOK);
+    for (auto it = children.begin(); it != children.end(); ++it) {
+        int lock_status = NONE;
+#if defined(Q_OS_WIN32)
+        // The daemon only has a rpc for the lock status of one file. It's
+        // locked for each entry only, so a large folder doesn't hold up the
+        // other requests on the connection.
+        QMutexLocker locker(&rpc_client_mutex_);
+        if (!rpc_client_->getRepoFileLockStatus(repo_id, dir_in_repo + "/" + it.key(),
+                                                &lock_status)) {
+            lock_status = NONE;
+        }
+#endif
+        resp += '\n';
+        resp += it.key().toUtf8();
+        resp += '\t';
+        resp += lockStatusToString(lock_status);
+        resp += it.value() ? "\tcached" : "\tuncached";
+    }
+    return resp;
 }
 
-void ExtCommandsHandler::handleLockFile(const QStringList& args, bool lock)
+void ExtCommandsHandler::handleLockFile(const ExtRequest& req, bool lock)
 {
-    if (args.size() != 1) {
+    if (req.n_args != 1) {
         return;
     }
 
-    QString path = args[0];
+    QString path = pathArg(req.args[0]);
     Account account;
     QString repo_id, path_in_repo;
     if (!parseRepoFileInfo(path, &account, &repo_id, &path_in_repo)) {
@@ -751,6 +1010,7 @@ void ExtCommandsHandler::handleLockFile(const QStringList& args, bool lock)
         qWarning() << "failed to lock file " << path;
         return;
     }
+    ExtStatusChangeNotifier::instance()->notifyChanged(path);
     emit lockFile(account, repo_id, path_in_repo, lock);
 }
 
@@ -781,13 +1041,13 @@ bool ExtCommandsHandler::parseRepoFileInfo(const QString& path,
     return true;
 }
 
-void ExtCommandsHandler::handlePrivateShare(const QStringList& args,
+void ExtCommandsHandler::handlePrivateShare(const ExtRequest& req,
                                             bool to_group)
 {
-    if (args.size() != 1) {
+    if (req.n_args != 1) {
         return;
     }
-    QString path = normalizedPath(args[0]);
+    QString path = pathArg(req.args[0]);
     if (!QFileInfo(path).isDir()) {
         qWarning("attempting to share %s, which is not a folder",
                  path.toUtf8().data());
@@ -802,12 +1062,12 @@ void ExtCommandsHandler::handlePrivateShare(const QStringList& args,
     emit privateShare(account, repo_id, path_in_repo, to_group);
 }
 
-void ExtCommandsHandler::handleShowHistory(const QStringList& args)
+void ExtCommandsHandler::handleShowHistory(const ExtRequest& req)
 {
-    if (args.size() != 1) {
+    if (req.n_args != 1) {
         return;
     }
-    QString path = normalizedPath(args[0]);
+    QString path = pathArg(req.args[0]);
     if (QFileInfo(path).isDir()) {
         qWarning("attempted to view history of %s, which is not a regular file",
                  path.toUtf8().data());
@@ -824,28 +1084,42 @@ void ExtCommandsHandler::handleShowHistory(const QStringList& args)
     emit openUrlWithAutoLogin(account, url);
 }
 
-void ExtCommandsHandler::handleDownload(const QStringList& args)
+void ExtCommandsHandler::handleDownload(const ExtRequest& req)
 {
-    if (args.size() != 1) {
+    if (req.n_args != 1) {
         return;
     }
-    QString path = normalizedPath(args[0]);
+    QString path = pathArg(req.args[0]);
     Account account;
     QString repo_id, path_in_repo;
     if (!parseRepoFileInfo(path, &account, &repo_id, &path_in_repo)) {
         return;
     }
 
+    // The entries would be updated by the download events.
+    CachedFilesIndex::instance()->invalidate(path);
+
+    // A folder may hold thousands of files, they are fetched by the
+    // prefetch manager in batches instead of blocking this connection.
+    if (QFileInfo(path).isDir()) {
+        QMetaObject::invokeMethod(PrefetchManager::instance(), "prefetch",
+                                  Qt::QueuedConnection,
+                                  Q_ARG(Account, account),
+                                  Q_ARG(QString, repo_id),
+                                  Q_ARG(QString, path_in_repo));
+        return;
+    }
+
     QMutexLocker locker(&rpc_client_mutex_);
     rpc_client_->cachePath(repo_id, path_in_repo);
 }
 
-void ExtCommandsHandler::handleShowLockedBy(const QStringList& args)
+void ExtCommandsHandler::handleShowLockedBy(const ExtRequest& req)
 {
-    if (args.size() != 1) {
+    if (req.n_args != 1) {
         return;
     }
-    QString path = normalizedPath(args[0]);
+    QString path = pathArg(req.args[0]);
     if (QFileInfo(path).isDir()) {
         qDebug("attempted to view lock owner of %s, which is not a regular file",
                path.toUtf8().data());
@@ -862,16 +1136,23 @@ void ExtCommandsHandler::handleShowLockedBy(const QStringList& args)
 }
 
 
-bool ExtCommandsHandler::handleIsFileCached(QStringList &args) {
-    if (args.size() != 1) {
+bool ExtCommandsHandler::handleIsFileCached(const ExtRequest& req) {
+    if (req.n_args != 1) {
         return false;
     }
 
-    QString file_path = normalizedPath(args.first());
+    QString file_path = pathArg(req.args[0]);
     return isFileCached(file_path);
 }
 
 bool ExtCommandsHandler::isFileCached(const QString &path) {
+    // Explorer asks about every file it shows, so the answer is served from
+    // memory whenever possible.
+    bool cached;
+    if (CachedFilesIndex::instance()->lookup(path, &cached)) {
+        return cached;
+    }
+
     Account account;
     QString repo_id, path_in_repo;
     if (!parseRepoFileInfo(path, &account, &repo_id, &path_in_repo)) {
@@ -880,19 +1161,24 @@ bool ExtCommandsHandler::isFileCached(const QString &path) {
     }
 
     QMutexLocker lock(&rpc_client_mutex_);
-    return rpc_client_->isFileCached(repo_id, path_in_repo);
+    cached = rpc_client_->isFileCached(repo_id, path_in_repo);
+    lock.unlock();
+
+    QString repo_dir = path.left(path.size() - path_in_repo.size());
+    CachedFilesIndex::instance()->update(repo_id, repo_dir, path, cached);
+    return cached;
 }
 
 // Get thumbanil from server and return the cached thumbnail path
-QString ExtCommandsHandler::handleGetThumbnailFromServer(QStringList& args) {
-    if (args.size() != 2) {
+QByteArray ExtCommandsHandler::handleGetThumbnailFromServer(const ExtRequest& req) {
+    if (req.n_args != 2) {
         qWarning("invalid command args of get thumbnail");
-        return "";
+        return QByteArray();
     }
 
     QString cached_thumbnail_path;
-    QString path = normalizedPath(args[0]);
-    int size = args[1].toInt();
+    QString path = pathArg(req.args[0]);
+    int size = tokenToInt(req.args[1]);
     if (size <= 0) {
         size = 64;
     } else {
@@ -901,9 +1187,9 @@ QString ExtCommandsHandler::handleGetThumbnailFromServer(QStringList& args) {
     bool success = fetchThumbnail(path, size, &cached_thumbnail_path);
     if (!success) {
         qWarning("fetch thumbnail from server failed");
-        return "";
+        return QByteArray();
     }
-    return cached_thumbnail_path;
+    return cached_thumbnail_path.toUtf8();
 }
 
 // Get thumbnail from server
@@ -5,14 +5,19 @@
 #include <QThread>
 #include <QList>
 #include <QHash>
-
-#include <windows.h>
+#include <QMutex>
+#include <QPair>
+#include <QStringList>
+#include <QThreadPool>
+#include <QWaitCondition>
 
 #include "utils/singleton.h"
 #include "account.h"
+#include "ext-request.h"
 
 class SeafileRpcClient;
 class ExtConnectionListenerThread;
+class ExtConnection;
 class ApiError;
 
 /**
@@ -51,6 +56,10 @@ private slots:
     void getUploadLink(const Account& account, const QString& repo, const QString& path_in_repo);
     void onGetUploadLinkSuccess(const QString &upload_link);
     void onGetUploadLinkFailed(const ApiError& error);
+    void prefetchLinks(const Account& account,
+                       const QString& repo_id,
+                       const QString& path_in_repo,
+                       bool is_dir);
 
     void showLockedBy(const Account& account, const QString& repo, const QString& path_in_repo);
     void onGetFileLockInfoSuccess(bool found, const QString &owner);
@@ -63,8 +72,37 @@ private:
 };
 
 /**
- * Creates the named pipe and listen for incoming connections in a separate
- * thread.
+ * Broadcasts file status changes to the shell extensions that subscribed to
+ * them, so they can invalidate their status cache instead of re-querying.
+ *
+ * Each change is recorded with an increasing sequence number. A subscriber
+ * remembers the last sequence number it has seen, and is told to drop its
+ * whole cache when it falls too far behind.
+ */
+class ExtStatusChangeNotifier {
+    SINGLETON_DEFINE(ExtStatusChangeNotifier)
+public:
+    ExtStatusChangeNotifier();
+
+    // An empty path means the status of every file may have changed.
+    void notifyChanged(const QString& path);
+
+    quint64 currentSeq();
+
+    // Wait until there are changes after `seq`, and return the changed
+    // paths. Returns false if no change happened in `timeout_msecs`.
+    bool waitForChanges(quint64 *seq, QStringList *paths, unsigned long timeout_msecs);
+
+private:
+    QMutex mutex_;
+    QWaitCondition cond_;
+    quint64 seq_;
+    QList<QPair<quint64, QString> > changes_;
+};
+
+/**
+ * Listens for incoming connections from the shell extensions in a separate
+ * thread, through a named pipe on windows and a unix domain socket elsewhere.
  *
  * When a connection is accepted, create a new ExtCommandsHandler thread to
  * serve it.
@@ -91,15 +129,21 @@ signals:
     void openUrlWithAutoLogin(const Account& account, const QUrl& url);
     void showLockedBy(const Account& account, const QString& repo, const QString& path_in_repo);
     void getUploadLink(const Account& account, const QString& repo_id, const QString& path_in_repo);
+    void prefetchLinks(const Account& account,
+                       const QString& repo_id,
+                       const QString& path_in_repo,
+                       bool is_dir);
 
 private:
-    void servePipeInNewThread(HANDLE pipe);
+    void serveConnectionInNewThread(ExtConnection *conn);
 };
 
 /**
  * Serves one extension connection.
  *
  * It's an endless loop of "read request" -> "handle request" -> "send response".
+ * Once the extension switches to version 2 of the protocol, the requests are
+ * handled by a pool of workers and the responses are sent as they are ready.
  */
 class ExtCommandsHandler: public QThread {
     Q_OBJECT
@@ -111,9 +155,13 @@ public:
         LOCKED_AUTO,
     };
 
-    ExtCommandsHandler(HANDLE pipe);
+    // Takes the ownership of `conn`.
+    ExtCommandsHandler(ExtConnection *conn);
     void run();
 
+    // Called in the worker threads.
+    void serveTaggedRequest(const QByteArray& raw_request);
+
 signals:
     void generateShareLink(const Account& account,
                            const QString& repo_id,
@@ -131,23 +179,38 @@ signals:
     void openUrlWithAutoLogin(const Account& account, const QUrl& url);
     void showLockedBy(const Account& account, const QString& repo, const QString& path_in_repo);
     void getUploadLink(const Account& account, const QString& repo_id, const QString& path_in_repo);
+    void prefetchLinks(const Account& account,
+                       const QString& repo_id,
+                       const QString& path_in_repo,
+                       bool is_dir);
 
 private:
-    HANDLE pipe_;
+    ExtConnection *conn_;
+
+    int protocol_version_;
+    QThreadPool workers_;
+    QMutex write_mutex_;
+    QByteArray read_buf_;
 
     // QList<QString> listLocalRepos(quint64 ts = 0);
-    bool readRequest(QStringList *args);
-    bool sendResponse(const QString& resp);
-
-    void handleGenShareLink(const QStringList& args, bool internal);
-    QString handleListRepos(const QStringList& args);
-    QString handleGetFileLockStatus(const QStringList& args);
-    void handleLockFile(const QStringList& args, bool lock);
-    void handlePrivateShare(const QStringList& args, bool to_group);
-    void handleShowHistory(const QStringList& args);
-    void handleDownload(const QStringList& args);
-    void handleShowLockedBy(const QStringList& args);
-    void handleGetUploadLink(const QStringList& args);
+    bool readRequest(uint32_t *len);
+    bool sendResponse(const QByteArray& resp, const ExtToken *id = nullptr);
+    void serveStatusSubscription();
+
+    QByteArray handleHello(const ExtRequest& req);
+    QByteArray handleRequest(const ExtRequest& req);
+
+    void handleGenShareLink(const ExtRequest& req, bool internal);
+    QByteArray handleListRepos(const ExtRequest& req);
+    QByteArray handleGetFileLockStatus(const ExtRequest& req);
+    QByteArray handleGetDirStatus(const ExtRequest& req);
+    void handleLockFile(const ExtRequest& req, bool lock);
+    void handlePrivateShare(const ExtRequest& req, bool to_group);
+    void handleShowHistory(const ExtRequest& req);
+    void handleDownload(const ExtRequest& req);
+    void handleShowLockedBy(const ExtRequest& req);
+    void handleGetUploadLink(const ExtRequest& req);
+    void handlePrefetchLinks(const ExtRequest& req);
 
     bool parseRepoFileInfo(const QString& path,
                            Account *account,
@@ -155,9 +218,9 @@ private:
                            QString *path_in_repo);
 
     bool isFileCached(const QString &path);
-    bool handleIsFileCached(QStringList &args);
+    bool handleIsFileCached(const ExtRequest& req);
     QString handleGetMountPoint();
-    QString handleGetThumbnailFromServer(QStringList &args);
+    QByteArray handleGetThumbnailFromServer(const ExtRequest& req);
     bool fetchThumbnail(const QString &path, int size, QString *file);
 };
 
@@ -0,0 +1,143 @@
+#include <string.h>
+
+#include "ext-request.h"
+
+namespace {
+
+// FNV-1a, so the command names can be used as case labels.
+constexpr uint32_t hashName(const char *s, uint32_t h = 2166136261u)
+{
+    return *s ? hashName(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+}
+
+uint32_t hashName(const char *s, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)s[i]) * 16777619u;
+    }
+    return h;
+}
+
+inline ExtCommand match(const char *name, size_t len,
+                        const char *expected, ExtCommand command)
+{
+    if (len == strlen(expected) && memcmp(name, expected, len) == 0) {
+        return command;
+    }
+    return EXT_CMD_UNKNOWN;
+}
+
+// Returns the length of the token starting at `p`.
+inline size_t tokenLength(const char *p, const char *end)
+{
+    const char *tab = (const char *)memchr(p, '\t', end - p);
+    return tab ? tab - p : end - p;
+}
+
+} // namespace
+
+ExtCommand lookupExtCommand(const char *name, size_t len)
+{
+    // The compiler would complain about duplicated case values if two names
+    // had the same hash.
+    switch (hashName(name, len)) {
+    case hashName("hello"):
+        return match(name, len, "hello", EXT_CMD_HELLO);
+    case hashName("subscribe-status-changes"):
+        return match(name, len, "subscribe-status-changes", EXT_CMD_SUBSCRIBE_STATUS_CHANGES);
+    case hashName("list-repos"):
+        return match(name, len, "list-repos", EXT_CMD_LIST_REPOS);
+    case hashName("get-share-link"):
+        return match(name, len, "get-share-link", EXT_CMD_GET_SHARE_LINK);
+    case hashName("get-internal-link"):
+        return match(name, len, "get-internal-link", EXT_CMD_GET_INTERNAL_LINK);
+    case hashName("get-file-status"):
+        return match(name, len, "get-file-status", EXT_CMD_GET_FILE_STATUS);
+    case hashName("get-dir-status"):
+        return match(name, len, "get-dir-status", EXT_CMD_GET_DIR_STATUS);
+    case hashName("lock-file"):
+        return match(name, len, "lock-file", EXT_CMD_LOCK_FILE);
+    case hashName("unlock-file"):
+        return match(name, len, "unlock-file", EXT_CMD_UNLOCK_FILE);
+    case hashName("private-share-to-group"):
+        return match(name, len, "private-share-to-group", EXT_CMD_PRIVATE_SHARE_TO_GROUP);
+    case hashName("private-share-to-user"):
+        return match(name, len, "private-share-to-user", EXT_CMD_PRIVATE_SHARE_TO_USER);
+    case hashName("show-history"):
+        return match(name, len, "show-history", EXT_CMD_SHOW_HISTORY);
+    case hashName("show-locked-by"):
+        return match(name, len, "show-locked-by", EXT_CMD_SHOW_LOCKED_BY);
+    case hashName("get-upload-link"):
+        return match(name, len, "get-upload-link", EXT_CMD_GET_UPLOAD_LINK);
+    case hashName("download"):
+        return match(name, len, "download", EXT_CMD_DOWNLOAD);
+    case hashName("is-file-cached"):
+        return match(name, len, "is-file-cached", EXT_CMD_IS_FILE_CACHED);
+    case hashName("get-thumbnail-from-server"):
+        return match(name, len, "get-thumbnail-from-server", EXT_CMD_GET_THUMBNAIL_FROM_SERVER);
+    case hashName("prefetch-links"):
+        return match(name, len, "prefetch-links", EXT_CMD_PREFETCH_LINKS);
+    default:
+        return EXT_CMD_UNKNOWN;
+    }
+}
+
+bool parseExtRequest(const char *buf, size_t len, bool tagged, ExtRequest *req)
+{
+    const char *p = buf;
+    const char *end = buf + len;
+
+    req->id.data = p;
+    req->id.len = 0;
+    if (tagged) {
+        size_t n = tokenLength(p, end);
+        if (n == 0 || p + n == end) {
+            return false;
+        }
+        req->id.len = n;
+        p += n + 1;
+    }
+
+    size_t n = tokenLength(p, end);
+    if (n == 0) {
+        return false;
+    }
+    req->name.data = p;
+    req->name.len = n;
+    req->command = lookupExtCommand(p, n);
+    p += n;
+
+    req->n_args = 0;
+    while (p < end) {
+        // skip the tab before the argument
+        p++;
+        if (req->n_args == kMaxExtRequestArgs) {
+            return false;
+        }
+        n = tokenLength(p, end);
+        req->args[req->n_args].data = p;
+        req->args[req->n_args].len = n;
+        req->n_args++;
+        p += n;
+    }
+
+    return true;
+}
+
+bool parseExtRequestId(const char *buf, size_t len, ExtToken *id)
+{
+    size_t n = tokenLength(buf, buf + len);
+    // The extension sends the ids as decimal numbers, followed by a tab.
+    if (n == 0 || n == len) {
+        return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (buf[i] < '0' || buf[i] > '9') {
+            return false;
+        }
+    }
+    id->data = buf;
+    id->len = n;
+    return true;
+}
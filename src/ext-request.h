@@ -0,0 +1,67 @@
+#ifndef SEADRIVE_GUI_EXT_REQUEST_H
+#define SEADRIVE_GUI_EXT_REQUEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Parsing of the requests sent by the shell extensions. The request is
+// tokenized in place, i.e. the tokens point into the buffer holding the
+// request, so no memory is allocated. This file doesn't depend on Qt or
+// windows headers.
+
+enum ExtCommand {
+    EXT_CMD_UNKNOWN = 0,
+    EXT_CMD_HELLO,
+    EXT_CMD_SUBSCRIBE_STATUS_CHANGES,
+    EXT_CMD_LIST_REPOS,
+    EXT_CMD_GET_SHARE_LINK,
+    EXT_CMD_GET_INTERNAL_LINK,
+    EXT_CMD_GET_FILE_STATUS,
+    EXT_CMD_GET_DIR_STATUS,
+    EXT_CMD_LOCK_FILE,
+    EXT_CMD_UNLOCK_FILE,
+    EXT_CMD_PRIVATE_SHARE_TO_GROUP,
+    EXT_CMD_PRIVATE_SHARE_TO_USER,
+    EXT_CMD_SHOW_HISTORY,
+    EXT_CMD_SHOW_LOCKED_BY,
+    EXT_CMD_GET_UPLOAD_LINK,
+    EXT_CMD_DOWNLOAD,
+    EXT_CMD_IS_FILE_CACHED,
+    EXT_CMD_GET_THUMBNAIL_FROM_SERVER,
+    EXT_CMD_PREFETCH_LINKS,
+};
+
+struct ExtToken {
+    const char *data;
+    size_t len;
+};
+
+// No command has more arguments than this.
+const int kMaxExtRequestArgs = 4;
+
+struct ExtRequest {
+    // Empty in version 1 of the protocol.
+    ExtToken id;
+    ExtToken name;
+    ExtCommand command;
+    int n_args;
+    ExtToken args[kMaxExtRequestArgs];
+};
+
+/**
+ * Split the request in `buf` by tabs. When `tagged` is true the request
+ * starts with a request id, as in version 2 of the protocol. Returns false
+ * if the request is malformed or has too many arguments.
+ */
+bool parseExtRequest(const char *buf, size_t len, bool tagged, ExtRequest *req);
+
+/**
+ * Find the id of a tagged request that failed to parse, so an error response
+ * can still be sent for it. Returns false if the request doesn't start with
+ * a valid id.
+ */
+bool parseExtRequestId(const char *buf, size_t len, ExtToken *id);
+
+ExtCommand lookupExtCommand(const char *name, size_t len);
+
+#endif // SEADRIVE_GUI_EXT_REQUEST_H
@@ -0,0 +1,195 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <QDir>
+#include <QFile>
+
+#include "utils/utils.h"
+#include "ext-transport.h"
+
+namespace {
+
+const char *kSeafExtSocketName = "seadrive_ext.sock";
+
+#if defined(MSG_NOSIGNAL)
+const int kSendFlags = MSG_NOSIGNAL;
+#else
+const int kSendFlags = 0;
+#endif
+
+// The errno of the last failed read or write of the current thread, 0 if the
+// connection was closed by the extension.
+thread_local int last_error = 0;
+
+class ExtSocketConnection : public ExtConnection {
+public:
+    ExtSocketConnection(int fd) : fd_(fd)
+    {
+#if defined(SO_NOSIGPIPE)
+        int on = 1;
+        setsockopt(fd_, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    }
+
+    ~ExtSocketConnection()
+    {
+        ::close(fd_);
+    }
+
+    bool readN(void *buf, size_t len)
+    {
+        char *p = (char *)buf;
+        while (len > 0) {
+            ssize_t n = ::recv(fd_, p, len, 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                last_error = n < 0 ? errno : 0;
+                return false;
+            }
+            p += n;
+            len -= n;
+        }
+        return true;
+    }
+
+    bool writeN(const void *buf, size_t len)
+    {
+        const char *p = (const char *)buf;
+        while (len > 0) {
+            ssize_t n = ::send(fd_, p, len, kSendFlags);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                last_error = n < 0 ? errno : 0;
+                return false;
+            }
+            p += n;
+            len -= n;
+        }
+        return true;
+    }
+
+    void shutdown()
+    {
+        ::shutdown(fd_, SHUT_RDWR);
+    }
+
+    QString errorString() const
+    {
+        if (last_error == 0) {
+            return "connection closed";
+        }
+        return QString::fromLocal8Bit(strerror(last_error));
+    }
+
+private:
+    int fd_;
+};
+
+class ExtSocketListener : public ExtListener {
+public:
+    ExtSocketListener() : fd_(-1) {}
+
+    ~ExtSocketListener()
+    {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            QFile::remove(path_);
+        }
+    }
+
+    bool listen(const QString& socket_path);
+    ExtConnection *accept();
+
+private:
+    QString path_;
+    int fd_;
+};
+
+bool ExtSocketListener::listen(const QString& socket_path)
+{
+    path_ = socket_path;
+    QByteArray path = QFile::encodeName(path_);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if ((size_t)path.size() >= sizeof(addr.sun_path)) {
+        qWarning("[ext listener] socket path %s is too long", path.constData());
+        return false;
+    }
+    memcpy(addr.sun_path, path.constData(), path.size());
+
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd_ < 0) {
+        qWarning("[ext listener] failed to create socket: %s", strerror(errno));
+        return false;
+    }
+
+    // Remove the socket left by the last run, only one gui instance is
+    // running at a time.
+    ::unlink(path.constData());
+    if (::bind(fd_, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        qWarning("[ext listener] failed to bind %s: %s",
+                 path.constData(), strerror(errno));
+        return false;
+    }
+    // Only the current user may talk to us.
+    ::chmod(path.constData(), S_IRUSR | S_IWUSR);
+
+    if (::listen(fd_, SOMAXCONN) < 0) {
+        qWarning("[ext listener] failed to listen on %s: %s",
+                 path.constData(), strerror(errno));
+        return false;
+    }
+
+    qWarning("[ext listener] listening on %s", path.constData());
+    return true;
+}
+
+ExtConnection *ExtSocketListener::accept()
+{
+    while (1) {
+        int fd = ::accept(fd_, NULL, NULL);
+        if (fd >= 0) {
+            qDebug("[ext socket] Accepted an extension socket client");
+            return new ExtSocketConnection(fd);
+        }
+        if (errno == EINTR || errno == ECONNABORTED) {
+            continue;
+        }
+        qWarning("[ext listener] failed to accept: %s", strerror(errno));
+        return NULL;
+    }
+}
+
+} // namespace
+
+ExtConnection *createExtSocketConnection(int fd)
+{
+    return new ExtSocketConnection(fd);
+}
+
+ExtListener *createExtSocketListener(const QString& path)
+{
+    ExtSocketListener *listener = new ExtSocketListener;
+    if (!listener->listen(path)) {
+        delete listener;
+        return NULL;
+    }
+    return listener;
+}
+
+ExtListener *ExtListener::create()
+{
+    return createExtSocketListener(
+        QDir(seadriveDataDir()).filePath(kSeafExtSocketName));
+}
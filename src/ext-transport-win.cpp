@@ -0,0 +1,206 @@
+#include <windows.h>
+
+#include <string>
+#include <QDebug>
+
+#include "utils/utils-win.h"
+#include "ext-transport.h"
+
+namespace {
+
+const char *kSeafExtPipeName = "\\\\.\\pipe\\seadrive_ext_pipe_";
+const int kPipeBufSize = 1024;
+
+// The pipes are opened for overlapped I/O, so the responses of a connection
+// can be written by the workers while the handler thread is blocked on
+// reading the next request.
+bool
+extPipeDoIO (HANDLE pipe, void *buf, size_t len, bool read, DWORD *bytes)
+{
+    OVERLAPPED ol;
+    memset(&ol, 0, sizeof(ol));
+    ol.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!ol.hEvent) {
+        return false;
+    }
+
+    BOOL success;
+    if (read) {
+        success = ReadFile(pipe, buf, (DWORD)len, NULL, &ol);
+    } else {
+        success = WriteFile(pipe, buf, (DWORD)len, NULL, &ol);
+    }
+    if (success || GetLastError() == ERROR_IO_PENDING) {
+        success = GetOverlappedResult(pipe, &ol, bytes, TRUE);
+    }
+
+    DWORD error = GetLastError();
+    CloseHandle(ol.hEvent);
+    SetLastError(error);
+    return success;
+}
+
+bool
+extPipeReadN (HANDLE pipe, void *buf, size_t len)
+{
+    DWORD bytes_read = 0;
+    bool success = extPipeDoIO(pipe, buf, len, true, &bytes_read);
+
+    if (!success || bytes_read != (DWORD)len) {
+        DWORD error = GetLastError();
+        if (error == ERROR_BROKEN_PIPE) {
+            qDebug("[ext] connection closed by extension\n");
+        } else {
+            qWarning("[ext] Failed to read command from extension(), "
+                     "error code %lu\n", error);
+        }
+        return false;
+    }
+
+    return true;
+}
+
+bool
+extPipeWriteN(HANDLE pipe, const void *buf, size_t len)
+{
+    DWORD bytes_written = 0;
+    bool success = extPipeDoIO(pipe, (void *)buf, len, false, &bytes_written);
+
+    if (!success || bytes_written != (DWORD)len) {
+        DWORD error = GetLastError();
+        if (error == ERROR_BROKEN_PIPE) {
+            qDebug("[ext] connection closed by extension\n");
+        } else {
+            qWarning("[ext] Failed to read command from extension(), "
+                     "error code %lu\n", error);
+        }
+        return false;
+    }
+
+    FlushFileBuffers(pipe);
+    return true;
+}
+
+std::string formatErrorMessage()
+{
+    DWORD error_code = ::GetLastError();
+    if (error_code == 0) {
+        return "no error";
+    }
+    char buf[256] = {0};
+    ::FormatMessage(FORMAT_MESSAGE_FROM_SYSTEM,
+                    NULL,
+                    error_code,
+                    MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+                    buf,
+                    sizeof(buf) - 1,
+                    NULL);
+    return buf;
+}
+
+class ExtPipeConnection : public ExtConnection {
+public:
+    ExtPipeConnection(HANDLE pipe) : pipe_(pipe) {}
+
+    ~ExtPipeConnection()
+    {
+        DisconnectNamedPipe(pipe_);
+        CloseHandle(pipe_);
+    }
+
+    bool readN(void *buf, size_t len)
+    {
+        return extPipeReadN(pipe_, buf, len);
+    }
+
+    bool writeN(const void *buf, size_t len)
+    {
+        return extPipeWriteN(pipe_, buf, len);
+    }
+
+    void shutdown()
+    {
+        // Closes the end of the extension, which fails the pending read.
+        DisconnectNamedPipe(pipe_);
+    }
+
+    QString errorString() const
+    {
+        return QString::fromLocal8Bit(formatErrorMessage().c_str());
+    }
+
+private:
+    HANDLE pipe_;
+};
+
+class ExtPipeListener : public ExtListener {
+public:
+    ExtPipeListener()
+    {
+        local_pipe_name_ = utils::win::getLocalPipeName(kSeafExtPipeName);
+        qWarning("[ext listener] listening on %s", local_pipe_name_.c_str());
+    }
+
+    ExtConnection *accept();
+
+private:
+    std::string local_pipe_name_;
+};
+
+ExtConnection *ExtPipeListener::accept()
+{
+    HANDLE pipe = INVALID_HANDLE_VALUE;
+    bool connected = false;
+
+    pipe = CreateNamedPipe(
+        local_pipe_name_.c_str(), // pipe name
+        PIPE_ACCESS_DUPLEX |      // read/write access
+        FILE_FLAG_OVERLAPPED,     // overlapped I/O
+        PIPE_TYPE_MESSAGE |       // message type pipe
+        PIPE_READMODE_MESSAGE |   // message-read mode
+        PIPE_WAIT,                // blocking mode
+        PIPE_UNLIMITED_INSTANCES, // max. instances
+        kPipeBufSize,             // output buffer size
+        kPipeBufSize,             // input buffer size
+        0,                        // client time-out
+        NULL);                    // default security attribute
+
+    if (pipe == INVALID_HANDLE_VALUE) {
+        qWarning ("Failed to create named pipe, GLE=%lu\n",
+                  GetLastError());
+        return NULL;
+    }
+
+    /* listening on this pipe */
+    OVERLAPPED ol;
+    memset(&ol, 0, sizeof(ol));
+    ol.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (ConnectNamedPipe(pipe, &ol)) {
+        connected = true;
+    } else if (GetLastError() == ERROR_PIPE_CONNECTED) {
+        connected = true;
+    } else if (GetLastError() == ERROR_IO_PENDING) {
+        DWORD bytes;
+        connected = GetOverlappedResult(pipe, &ol, &bytes, TRUE);
+    }
+    if (ol.hEvent) {
+        CloseHandle(ol.hEvent);
+    }
+
+    if (!connected) {
+        qWarning ("Failed on ConnectNamedPipe(), GLE=%lu\n",
+                  GetLastError());
+        CloseHandle(pipe);
+        return NULL;
+    }
+
+    qDebug ("[ext pipe] Accepted an extension pipe client\n");
+    return new ExtPipeConnection(pipe);
+}
+
+} // namespace
+
+ExtListener *ExtListener::create()
+{
+    return new ExtPipeListener;
+}
@@ -0,0 +1,58 @@
+#ifndef SEADRIVE_GUI_EXT_TRANSPORT_H
+#define SEADRIVE_GUI_EXT_TRANSPORT_H
+
+#include <stddef.h>
+#include <QString>
+
+/**
+ * A connection from a shell extension. The request engine in ext-handler
+ * only talks to the extensions through this interface, so it doesn't depend
+ * on how the bytes are transported: a named pipe on windows, and a unix
+ * domain socket on other platforms.
+ *
+ * The framing is the same on all platforms: each message is a uint32 length
+ * in host byte order followed by the body, so the file manager plugins on
+ * linux can use the same protocol as the windows shell extension, including
+ * the batched get-dir-status and the status change subscription.
+ *
+ * One thread may read from a connection while others are writing to it.
+ * The connection is closed when it's deleted.
+ */
+class ExtConnection {
+public:
+    virtual ~ExtConnection() {}
+
+    virtual bool readN(void *buf, size_t len) = 0;
+    virtual bool writeN(const void *buf, size_t len) = 0;
+
+    // Describes the error of the last failed read or write in this thread.
+    virtual QString errorString() const = 0;
+
+    // Drops the connection: the pending and following reads and writes
+    // fail, so the extension sees it closed and reconnects. Can be called
+    // from any thread.
+    virtual void shutdown() = 0;
+};
+
+/**
+ * Accepts the connections from the shell extensions.
+ */
+class ExtListener {
+public:
+    virtual ~ExtListener() {}
+
+    // Blocks until an extension connects. Returns NULL if the listener
+    // can't accept connections any more.
+    virtual ExtConnection *accept() = 0;
+
+    // Creates the listener of the current platform.
+    static ExtListener *create();
+};
+
+#if !defined(Q_OS_WIN32)
+// The unix domain socket transport. Exposed so it can be tested on its own.
+ExtConnection *createExtSocketConnection(int fd);
+ExtListener *createExtSocketListener(const QString& path);
+#endif
+
+#endif // SEADRIVE_GUI_EXT_TRANSPORT_H
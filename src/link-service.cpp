@@ -0,0 +1,310 @@
+#include <QDateTime>
+#include <QSettings>
+#include <QTimer>
+
+#include "account-mgr.h"
+#include "seadrive-gui.h"
+#include "api/requests.h"
+#include "utils/utils.h"
+
+#include "link-service.h"
+
+namespace {
+
+const char *kLinkServiceGroup = "LinkService";
+const char *kPrefetchEnabled = "prefetchEnabled";
+
+// Share links may be deleted on the web, so they are kept for a short time.
+const qint64 kShareLinkTTLMSecs = 10 * 60 * 1000;
+// Internal links only depend on the path.
+const qint64 kInternalLinkTTLMSecs = 60 * 60 * 1000;
+const qint64 kUploadLinkTTLMSecs = 10 * 60 * 1000;
+
+const int kMaxCachedLinks = 500;
+
+// The prefetches over the limit are dropped, so opening the menus of many
+// items in a row doesn't send a request for each of them.
+const int kMaxRunningPrefetches = 2;
+
+const char *kLinkKeyProperty = "link_key";
+
+} // namespace
+
+LinkReply::LinkReply(const Account& account,
+                     const QString& repo_id,
+                     const QString& path,
+                     LinkType type)
+    : account_(account),
+      repo_id_(repo_id),
+      path_(path),
+      type_(type)
+{
+}
+
+void LinkReply::finish(const QString& link)
+{
+    emit finished(link);
+    deleteLater();
+}
+
+void LinkReply::fail(const ApiError& error)
+{
+    emit failed(error);
+    deleteLater();
+}
+
+
+SINGLETON_IMPL(LinkService)
+
+LinkService::LinkService()
+{
+    QSettings settings;
+    settings.beginGroup(kLinkServiceGroup);
+    prefetch_enabled_ = settings.value(kPrefetchEnabled, true).toBool();
+    settings.endGroup();
+
+    // The tokens of the cached links may be gone with the account.
+    connect(gui->accountManager(), SIGNAL(accountMQUpdated()),
+            this, SLOT(onAccountsChanged()));
+}
+
+void LinkService::setPrefetchEnabled(bool enabled)
+{
+    prefetch_enabled_ = enabled;
+
+    QSettings settings;
+    settings.beginGroup(kLinkServiceGroup);
+    settings.setValue(kPrefetchEnabled, enabled);
+    settings.endGroup();
+}
+
+LinkReply *LinkService::getLink(const Account& account,
+                                const QString& repo_id,
+                                const QString& path,
+                                LinkType type,
+                                bool is_dir)
+{
+    QString normalized = normalizedPath(path);
+    QString key = cacheKey(account, repo_id, normalized, type);
+    LinkReply *reply = new LinkReply(account, repo_id, normalized, type);
+
+    QString link;
+    if (lookupCache(key, &link)) {
+        // The caller connects to the reply after we return.
+        QTimer::singleShot(0, reply, [reply, link]() { reply->finish(link); });
+        return reply;
+    }
+
+    if (!pending_.contains(key)) {
+        startRequest(key, account, repo_id, normalized, type, is_dir, false);
+    }
+    PendingRequest& pending = pending_[key];
+    // A prefetch that is waited for is no longer counted as one.
+    pending.is_prefetch = false;
+    pending.replies.append(reply);
+    return reply;
+}
+
+void LinkService::prefetch(const Account& account,
+                           const QString& repo_id,
+                           const QString& path,
+                           bool is_dir)
+{
+    if (!prefetch_enabled_) {
+        return;
+    }
+
+    QString normalized = normalizedPath(path);
+    const LinkType types[] = { SHARE_LINK, INTERNAL_LINK };
+    for (LinkType type : types) {
+        QString key = cacheKey(account, repo_id, normalized, type);
+        QString link;
+        if (pending_.contains(key) || lookupCache(key, &link)) {
+            continue;
+        }
+        if (runningPrefetches() >= kMaxRunningPrefetches) {
+            return;
+        }
+        startRequest(key, account, repo_id, normalized, type, is_dir, true);
+    }
+}
+
+void LinkService::updateLink(const Account& account,
+                             const QString& repo_id,
+                             const QString& path,
+                             LinkType type,
+                             const QString& link)
+{
+    storeCache(cacheKey(account, repo_id, normalizedPath(path), type), type, link);
+}
+
+void LinkService::onAccountsChanged()
+{
+    cache_.clear();
+}
+
+void LinkService::startRequest(const QString& key,
+                               const Account& account,
+                               const QString& repo_id,
+                               const QString& path,
+                               LinkType type,
+                               bool is_dir,
+                               bool is_prefetch)
+{
+    SeafileApiRequest *req;
+    switch (type) {
+    case SHARE_LINK:
+        req = new GetSharedLinkRequest(
+            account, repo_id, "/" + QString::fromUtf8(path.mid(1).toUtf8().toPercentEncoding()));
+        break;
+    case INTERNAL_LINK:
+        req = new GetSmartLinkRequest(
+            account, repo_id, (is_dir && path != "/") ? path + "/" : path, is_dir);
+        break;
+    default:
+        req = new GetUploadLinkRequest(account, repo_id, path);
+        break;
+    }
+    req->setProperty(kLinkKeyProperty, key);
+
+    connect(req, SIGNAL(success(const QString&)),
+            this, SLOT(onRequestSuccess(const QString&)));
+    connect(req, SIGNAL(failed(const ApiError&)),
+            this, SLOT(onRequestFailed(const ApiError&)));
+
+    PendingRequest pending;
+    pending.req = req;
+    pending.is_prefetch = is_prefetch;
+    pending_.insert(key, pending);
+
+    req->send();
+}
+
+void LinkService::onRequestSuccess(const QString& link)
+{
+    SeafileApiRequest *req = qobject_cast<SeafileApiRequest *>(sender());
+    QString key = req->property(kLinkKeyProperty).toString();
+    req->deleteLater();
+
+    PendingRequest pending = pending_.take(key);
+    // The type is the last field of the key.
+    LinkType type = (LinkType)key.section('\t', -1).toInt();
+    // The share link is created later in the dialog, so "no link" isn't
+    // cached.
+    if (!link.isEmpty()) {
+        storeCache(key, type, link);
+    }
+
+    for (const QPointer<LinkReply>& reply : pending.replies) {
+        if (reply) {
+            reply->finish(link);
+        }
+    }
+}
+
+void LinkService::onRequestFailed(const ApiError& error)
+{
+    SeafileApiRequest *req = qobject_cast<SeafileApiRequest *>(sender());
+    QString key = req->property(kLinkKeyProperty).toString();
+    req->deleteLater();
+
+    PendingRequest pending = pending_.take(key);
+    if (pending.is_prefetch) {
+        qDebug("[link service] failed to prefetch link: %s", toCStr(error.toString()));
+    }
+    for (const QPointer<LinkReply>& reply : pending.replies) {
+        if (reply) {
+            reply->fail(error);
+        }
+    }
+}
+
+bool LinkService::lookupCache(const QString& key, QString *link)
+{
+    auto it = cache_.find(key);
+    if (it == cache_.end()) {
+        return false;
+    }
+    if (it->expire_at <= QDateTime::currentMSecsSinceEpoch()) {
+        cache_.erase(it);
+        return false;
+    }
+    *link = it->link;
+    return true;
+}
+
+void LinkService::storeCache(const QString& key, LinkType type, const QString& link)
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    if (cache_.size() >= kMaxCachedLinks && !cache_.contains(key)) {
+        // Drop the expired links, or the one to expire first.
+        for (auto it = cache_.begin(); it != cache_.end();) {
+            if (it->expire_at <= now) {
+                it = cache_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (cache_.size() >= kMaxCachedLinks) {
+            auto oldest = cache_.begin();
+            for (auto it = cache_.begin(); it != cache_.end(); ++it) {
+                if (it->expire_at < oldest->expire_at) {
+                    oldest = it;
+                }
+            }
+            cache_.erase(oldest);
+        }
+    }
+
+    qint64 ttl;
+    switch (type) {
+    case SHARE_LINK:
+        ttl = kShareLinkTTLMSecs;
+        break;
+    case INTERNAL_LINK:
+        ttl = kInternalLinkTTLMSecs;
+        break;
+    default:
+        ttl = kUploadLinkTTLMSecs;
+        break;
+    }
+
+    CachedLink cached;
+    cached.link = link;
+    cached.expire_at = now + ttl;
+    cache_.insert(key, cached);
+}
+
+int LinkService::runningPrefetches() const
+{
+    int n = 0;
+    for (const PendingRequest& pending : pending_) {
+        if (pending.is_prefetch) {
+            n++;
+        }
+    }
+    return n;
+}
+
+QString LinkService::normalizedPath(const QString& path)
+{
+    QString ret = path;
+    while (ret.startsWith("/")) {
+        ret.remove(0, 1);
+    }
+    while (ret.endsWith("/")) {
+        ret.chop(1);
+    }
+    return "/" + ret;
+}
+
+QString LinkService::cacheKey(const Account& account,
+                              const QString& repo_id,
+                              const QString& path,
+                              LinkType type)
+{
+    return QString("%1\t%2\t%3\t%4")
+        .arg(account.getSignature(), repo_id, path)
+        .arg((int)type);
+}
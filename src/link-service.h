@@ -0,0 +1,142 @@
+#ifndef SEADRIVE_GUI_LINK_SERVICE_H
+#define SEADRIVE_GUI_LINK_SERVICE_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QString>
+
+#include "account.h"
+#include "api/api-error.h"
+#include "utils/singleton.h"
+
+class SeafileApiRequest;
+
+enum LinkType {
+    SHARE_LINK = 0,
+    INTERNAL_LINK,
+    UPLOAD_LINK,
+};
+
+/**
+ * The result of one LinkService::getLink() call. Exactly one of the signals
+ * is emitted, after getLink() has returned, and the reply deletes itself
+ * afterwards.
+ */
+class LinkReply : public QObject {
+    Q_OBJECT
+public:
+    const Account& account() const { return account_; }
+    const QString& repoId() const { return repo_id_; }
+    // The path in the repo, always starting with "/".
+    const QString& path() const { return path_; }
+    LinkType type() const { return type_; }
+
+signals:
+    // The link may be empty for SHARE_LINK, when the item isn't shared yet.
+    void finished(const QString& link);
+    void failed(const ApiError& error);
+
+private:
+    friend class LinkService;
+
+    LinkReply(const Account& account,
+              const QString& repo_id,
+              const QString& path,
+              LinkType type);
+
+    void finish(const QString& link);
+    void fail(const ApiError& error);
+
+    const Account account_;
+    const QString repo_id_;
+    const QString path_;
+    const LinkType type_;
+};
+
+/**
+ * Gets the share, internal and upload links of the items in the drive.
+ *
+ * The links are cached by account, repo, path and type for a few minutes, so
+ * repeating a share action on the same item doesn't go to the server again.
+ * The requests of different items run at the same time, and the callers
+ * asking for the same link while it's being fetched share one request.
+ *
+ * The share and internal links of the item whose context menu is opened in
+ * the file manager can be fetched in advance with prefetch(). Upload links are never prefetched,
+ * because getting one creates it on the server.
+ */
+class LinkService : public QObject {
+    SINGLETON_DEFINE(LinkService)
+    Q_OBJECT
+public:
+    LinkService();
+
+    // `path` is the path in the repo, with or without the leading "/".
+    // `is_dir` is only used for internal links.
+    LinkReply *getLink(const Account& account,
+                       const QString& repo_id,
+                       const QString& path,
+                       LinkType type,
+                       bool is_dir = false);
+
+    void prefetch(const Account& account,
+                  const QString& repo_id,
+                  const QString& path,
+                  bool is_dir);
+
+    // Called when the link is known from elsewhere, e.g. a share link was
+    // just created.
+    void updateLink(const Account& account,
+                    const QString& repo_id,
+                    const QString& path,
+                    LinkType type,
+                    const QString& link);
+
+    bool prefetchEnabled() const { return prefetch_enabled_; }
+    void setPrefetchEnabled(bool enabled);
+
+private slots:
+    void onAccountsChanged();
+    void onRequestSuccess(const QString& link);
+    void onRequestFailed(const ApiError& error);
+
+private:
+    Q_DISABLE_COPY(LinkService)
+
+    struct CachedLink {
+        QString link;
+        qint64 expire_at;
+    };
+
+    struct PendingRequest {
+        SeafileApiRequest *req;
+        bool is_prefetch;
+        QList<QPointer<LinkReply> > replies;
+    };
+
+    static QString normalizedPath(const QString& path);
+    static QString cacheKey(const Account& account,
+                            const QString& repo_id,
+                            const QString& path,
+                            LinkType type);
+
+    bool lookupCache(const QString& key, QString *link);
+    void storeCache(const QString& key, LinkType type, const QString& link);
+    void startRequest(const QString& key,
+                      const Account& account,
+                      const QString& repo_id,
+                      const QString& path,
+                      LinkType type,
+                      bool is_dir,
+                      bool is_prefetch);
+    int runningPrefetches() const;
+
+    QHash<QString, CachedLink> cache_;
+    QHash<QString, PendingRequest> pending_;
+
+    bool prefetch_enabled_;
+};
+
+#endif // SEADRIVE_GUI_LINK_SERVICE_H
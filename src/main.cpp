@@ -79,21 +79,6 @@ void setupHDPIFix()
   #endif
 }
 
-void setupSettingDomain()
-{
-    // see QSettings documentation
-    QCoreApplication::setOrganizationName(getBrand());
-    QCoreApplication::setOrganizationDomain("seafile.com");
-    QString appName = getBrand();
-
-    // Special treatment to keep consistent with old versions. Otherwise the
-    // existing settings would be lost.
-    if (appName == "SeaDrive") {
-        appName = "Seafile Drive";
-    }
-    QCoreApplication::setApplicationName(QString("%1 Client").arg(appName));
-}
-
 void handleCommandLineOption(int argc, char *argv[])
 {
     int c;
@@ -172,6 +157,13 @@ int main(int argc, char *argv[])
     // location.
     QDir::setCurrent(QDir::homePath());
 
+#if defined(SEADRIVE_SHIB_PLUGIN)
+    // The web engine of the shibboleth login plugin is only loaded later, and
+    // it can't share the opengl contexts unless this is set before the
+    // application is created.
+    QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+#endif
+
 #if defined(Q_OS_MAC)
     Application app(argc, argv);
 #else
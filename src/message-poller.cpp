@@ -1,5 +1,5 @@
-#include <QTimer>
 #include <QDateTime>
+#include <QDir>
 #include <QRegularExpression>
 
 #include "utils/utils.h"
@@ -16,13 +16,22 @@
 #include "account-mgr.h"
 
 #include "message-poller.h"
+#include "cached-files-index.h"
+#include "repo-topology.h"
+#include "encrypted-repos-source.h"
+#include "timer-scheduler.h"
+#include "transfer-history.h"
 #if defined(Q_OS_MAC)
 #include "sync-command.h"
 #endif
+#if defined(_MSC_VER) || defined(Q_OS_LINUX)
+#include "ext-handler.h"
+#endif
 
 namespace {
 
 const int kCheckNotificationIntervalMSecs = 1000;
+const int kMaxCheckNotificationIntervalMSecs = 4000;
 
 struct GlobalSyncStatus {
     bool is_syncing;
@@ -72,7 +81,8 @@ public:
 
 MessagePoller::MessagePoller(QObject *parent): QObject(parent)
 {
-    check_notification_timer_ = new QTimer(this);
+    check_notification_timer_ = new ScheduledTimer("message-poller", this);
+    check_notification_timer_->setMaxInterval(kMaxCheckNotificationIntervalMSecs);
 #if defined(Q_OS_MAC)
     sync_command_ = new SyncCommand();
 #endif
@@ -125,6 +135,7 @@ void MessagePoller::checkSeaDriveEvents()
     }
     SeaDriveEvent event = SeaDriveEvent::fromJson(ret);
     json_decref(ret);
+    TimerScheduler::instance()->notifyActivity();
 
     processSeaDriveEvent(event);
 }
@@ -140,6 +151,7 @@ void MessagePoller::checkNotification()
     }
     SyncNotification notification = SyncNotification::fromJson(ret);
     json_decref(ret);
+    TimerScheduler::instance()->notifyActivity();
 
     processNotification(notification);
 }
@@ -157,6 +169,8 @@ void MessagePoller::checkSyncStatus()
     json_decref(ret);
 
     if (sync_status.is_syncing) {
+        TimerScheduler::instance()->notifyActivity();
+        TransferHistory::instance()->notifyTransfers();
         gui->trayIcon()->rotate(true);
         gui->trayIcon()->setTransferRate(sync_status.sent_bytes, sync_status.recv_bytes);
     } else {
@@ -182,9 +196,43 @@ void MessagePoller::checkSyncErrors()
     gui->trayIcon()->setSyncErrors(errors);
 }
 
+QString MessagePoller::repoDir(const QString& repo_id)
+{
+    QString repo_uname;
+    if (repo_id.isEmpty() || !rpc_client_->getRepoUnameById(repo_id, &repo_uname)) {
+        return QString();
+    }
+
+    json_t *ret_obj = nullptr;
+    if (!rpc_client_->getAccountByRepoId(repo_id, &ret_obj)) {
+        return QString();
+    }
+    Account account = gui->accountManager()->getAccountFromJson(ret_obj);
+    json_decref(ret_obj);
+    if (account.syncRoot.isEmpty()) {
+        return QString();
+    }
+
+    return ::pathJoin(account.syncRoot, repo_uname);
+}
+
 void MessagePoller::processNotification(const SyncNotification& notification)
 {
     if (notification.type == "sync.done") {
+        // Libraries may have been added or removed by the sync, and the
+        // files updated by it are no longer cached.
+        RepoTopology::instance()->invalidate();
+        EncryptedReposSource::instance()->invalidate();
+        CachedFilesIndex::instance()->invalidateRepo(notification.repo_id);
+        // The files uploaded by the sync are in the finished list now.
+        TransferHistory::instance()->notifyTransfers();
+#if defined(_MSC_VER) || defined(Q_OS_LINUX)
+        // We don't know which files are changed by the sync, so let the
+        // shell extensions refresh the status of all files of the library,
+        // or of all files if its folder isn't found.
+        ExtStatusChangeNotifier::instance()->notifyChanged(
+            repoDir(notification.repo_id));
+#endif
         if (!gui->settingsManager()->notify()) {
             return;
         }
@@ -233,6 +281,7 @@ void MessagePoller::processNotification(const SyncNotification& notification)
             notification.commit_id,
             notification.parent_commit_id);
     } else if (notification.type == "fs-loaded") {
+        EncryptedReposSource::instance()->invalidate();
         QString title = tr("Libraries are ready");
         QString msg = tr("All libraries are loaded and ready to use.");
         gui->trayIcon()->showMessage(
@@ -336,6 +385,9 @@ void MessagePoller::processNotification(const SyncNotification& notification)
 void MessagePoller::processSeaDriveEvent(const SeaDriveEvent &event)
 {
     last_event_path_ = event.path;
+    if (event.type == "file-download.start" || event.type == "file-download.done") {
+        TransferHistory::instance()->notifyTransfers();
+    }
     if(event.type == "file-download.start") {
         QString title = tr("Download file");
         QString msg = tr("Start to download file \"%1\" ").arg(::getBaseName(event.path));
@@ -343,6 +395,13 @@ void MessagePoller::processSeaDriveEvent(const SeaDriveEvent &event)
         last_event_type_ = event.type;
         return;
     } else if (event.type == "file-download.done") {
+        if (QDir::isAbsolutePath(event.path)) {
+            CachedFilesIndex::instance()->setCached(event.path, true);
+        }
+#if defined(_MSC_VER) || defined(Q_OS_LINUX)
+        ExtStatusChangeNotifier::instance()->notifyChanged(
+            QDir::isAbsolutePath(event.path) ? event.path : QString());
+#endif
         QString title = tr("Download file");
         QString msg = tr("file \"%1\" has been downloaded ").arg(::getBaseName(event.path));
         gui->trayIcon()->showMessage(title, msg);
@@ -4,7 +4,7 @@
 #include <QObject>
 #include <jansson.h>
 
-class QTimer;
+class ScheduledTimer;
 
 class SeafileRpcClient;
 class SeaDriveEvent;
@@ -71,11 +71,13 @@ private:
 
     void processSeaDriveEvent(const SeaDriveEvent& event);
     void processNotification(const SyncNotification& notification);
+    // The local folder of a repo, empty if it can't be found.
+    QString repoDir(const QString& repo_id);
 
     SeafileRpcClient *rpc_client_;
     SyncCommand *sync_command_;
 
-    QTimer *check_notification_timer_;
+    ScheduledTimer *check_notification_timer_;
     QString last_event_type_;
     QString last_event_path_;
 };
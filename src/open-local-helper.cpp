@@ -2,7 +2,10 @@
 #include <shellapi.h>
 #endif
 
+#include <QDateTime>
 #include <QDesktopServices>
+#include <QFileInfo>
+#include <QTimer>
 #include <QUrl>
 #include <QUrlQuery>
 #include <QVariant>
@@ -17,53 +20,37 @@
 #include "seadrive-gui.h"
 #include "rpc/rpc-client.h"
 #include "account-mgr.h"
+#include "daemon-mgr.h"
 
 namespace {
 
 const char *kSeafileProtocolScheme = "seafile";
 const char *kSeafileProtocolHostOpenFile = "openfile";
 
+// The repos may not be known by the daemon right after it's connected, so
+// the pending urls are retried for a while.
+const int kPendingRetryIntervalMSecs = 1000;
+const int kMaxPendingRetries = 30;
 
-} // namespace
-
-
-void openLocalFile(QString& repo_id, QString& path_in_repo)
-{
-#if defined(Q_OS_WIN32)
-    QString repo_name;
-    if (!gui->rpcClient()->getRepoUnameById(repo_id, &repo_name)) {
-        qWarning("failed to get repo uname by %s", toCStr(repo_id));
-        return;
-    }
+// Libraries may be renamed, so the cached folders expire.
+const qint64 kRepoDirExpireMSecs = 10 * 60 * 1000;
 
-    json_t *ret_obj = nullptr;
-    if (!gui->rpcClient()->getAccountByRepoId(repo_id, &ret_obj)) {
-        qWarning("failed to get account by repo id %s", toCStr(repo_id));
-        return;
-    }
 
-    Account account = gui->accountManager()->getAccountFromJson(ret_obj);
-    if (account.syncRoot.isEmpty()) {
-        qWarning("failed to get account from json");
-        return;
-    }
+} // namespace
 
-    QString path_to_open = ::pathJoin(account.syncRoot, repo_name, path_in_repo);
-    QFileInfo fi(path_to_open);
-    if (!fi.exists()) {
-        qWarning("the file or directory %s not exists ", toCStr(path_to_open));
-        return;
-    }
-    QDesktopServices::openUrl(QUrl::fromLocalFile(path_to_open));
-#endif
-}
 
 OpenLocalHelper* OpenLocalHelper::singleton_ = NULL;
 
 OpenLocalHelper::OpenLocalHelper()
+    : pending_retries_(0),
+      daemon_connected_(false)
 {
     url_ = NULL;
 
+    pending_timer_ = new QTimer(this);
+    pending_timer_->setInterval(kPendingRetryIntervalMSecs);
+    connect(pending_timer_, SIGNAL(timeout()), this, SLOT(openPendingUrls()));
+
     QDesktopServices::setUrlHandler(kSeafileProtocolScheme, this, SLOT(openLocalFile(const QUrl&)));
 }
 
@@ -104,11 +91,90 @@ bool OpenLocalHelper::openLocalFile(const QUrl &url)
            repo_id.toUtf8().data(), path.toUtf8().data());
 
     qWarning("get file repo id is %s, eamil is %s, path is %s\n", toCStr(repo_id), toCStr(email), toCStr(path));
-    ::openLocalFile(repo_id, path);
+
+    // Received from another instance while this one is starting.
+    if (!daemon_connected_) {
+        pending_urls_.append(url);
+        return true;
+    }
+
+    if (!openFileInRepo(repo_id, path)) {
+        pending_urls_.append(url);
+        pending_retries_ = 0;
+        pending_timer_->start();
+    }
 
     return true;
 }
 
+bool OpenLocalHelper::lookupRepoDir(const QString& repo_id, QString *repo_dir)
+{
+#if defined(Q_OS_WIN32)
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    auto it = repo_dirs_.find(repo_id);
+    if (it != repo_dirs_.end() && now - it->ts < kRepoDirExpireMSecs) {
+        *repo_dir = it->path;
+        return true;
+    }
+
+    QString repo_name;
+    if (!gui->rpcClient()->getRepoUnameById(repo_id, &repo_name)) {
+        qWarning("failed to get repo uname by %s", toCStr(repo_id));
+        return false;
+    }
+
+    json_t *ret_obj = nullptr;
+    if (!gui->rpcClient()->getAccountByRepoId(repo_id, &ret_obj)) {
+        qWarning("failed to get account by repo id %s", toCStr(repo_id));
+        return false;
+    }
+
+    Account account = gui->accountManager()->getAccountFromJson(ret_obj);
+    json_decref(ret_obj);
+    if (account.syncRoot.isEmpty()) {
+        qWarning("failed to get account from json");
+        return false;
+    }
+
+    RepoDir dir;
+    dir.path = ::pathJoin(account.syncRoot, repo_name);
+    dir.ts = now;
+    repo_dirs_.insert(repo_id, dir);
+    *repo_dir = dir.path;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool OpenLocalHelper::openFileInRepo(const QString& repo_id, const QString& path_in_repo)
+{
+#if defined(Q_OS_WIN32)
+    QString repo_dir;
+    if (!lookupRepoDir(repo_id, &repo_dir)) {
+        return false;
+    }
+
+    QString path_to_open = ::pathJoin(repo_dir, path_in_repo);
+    if (!QFileInfo(path_to_open).exists()) {
+        // The library may have been renamed since its folder was cached, so
+        // look it up again once.
+        repo_dirs_.remove(repo_id);
+        if (!lookupRepoDir(repo_id, &repo_dir)) {
+            return false;
+        }
+        path_to_open = ::pathJoin(repo_dir, path_in_repo);
+    }
+    if (!QFileInfo(path_to_open).exists()) {
+        // It may not be in the drive yet, try again later.
+        qWarning("the file or directory %s not exists ", toCStr(path_to_open));
+        return false;
+    }
+    QDesktopServices::openUrl(QUrl::fromLocalFile(path_to_open));
+#endif
+    return true;
+}
+
 void OpenLocalHelper::messageBox(const QString& msg)
 {
     gui->messageBox(msg);
@@ -131,8 +197,47 @@ void OpenLocalHelper::handleOpenLocalFromCommandLine(const char *url)
 
 void OpenLocalHelper::checkPendingOpenLocalRequest()
 {
+    if (!daemon_connected_) {
+        daemon_connected_ = true;
+        connect(gui->accountManager(), SIGNAL(accountMQUpdated()),
+                this, SLOT(clearRepoDirCache()));
+        connect(gui->daemonManager(), SIGNAL(daemonRestarted()),
+                this, SLOT(clearRepoDirCache()));
+    }
+
     if (!url_.isEmpty()) {
-        openLocalFile(QUrl::fromEncoded(url_));
+        pending_urls_.prepend(QUrl::fromEncoded(url_));
         setUrl(NULL);
     }
+    pending_retries_ = 0;
+    openPendingUrls();
+}
+
+void OpenLocalHelper::openPendingUrls()
+{
+    QList<QUrl> urls;
+    urls.swap(pending_urls_);
+    for (const QUrl& url : urls) {
+        QUrlQuery url_query = QUrlQuery(url.query());
+        QString repo_id = url_query.queryItemValue("repo_id", QUrl::FullyDecoded);
+        QString path = url_query.queryItemValue("path", QUrl::FullyDecoded);
+        if (!openFileInRepo(repo_id, path)) {
+            pending_urls_.append(url);
+        }
+    }
+
+    if (pending_urls_.isEmpty()) {
+        pending_timer_->stop();
+    } else if (++pending_retries_ > kMaxPendingRetries) {
+        qWarning("[OpenLocalHelper] giving up opening %d urls", pending_urls_.size());
+        pending_urls_.clear();
+        pending_timer_->stop();
+    } else if (!pending_timer_->isActive()) {
+        pending_timer_->start();
+    }
+}
+
+void OpenLocalHelper::clearRepoDirCache()
+{
+    repo_dirs_.clear();
 }
@@ -4,6 +4,10 @@
 #include <QObject>
 #include <QUrl>
 #include <QString>
+#include <QHash>
+#include <QList>
+
+class QTimer;
 class Account;
 
 /**
@@ -21,8 +25,14 @@ public:
 
     void handleOpenLocalFromCommandLine(const char *url);
 
+    // Called as soon as the daemon is connected. Opens the urls received
+    // during the startup.
     void checkPendingOpenLocalRequest();
 
+private slots:
+    void openPendingUrls();
+    void clearRepoDirCache();
+
 private:
     static OpenLocalHelper* singleton_;
 
@@ -30,7 +40,27 @@ private:
 
     void messageBox(const QString& msg);
 
+    // Returns false if the repo can't be resolved yet, or the file is not
+    // in the drive yet.
+    bool openFileInRepo(const QString& repo_id, const QString& path_in_repo);
+    bool lookupRepoDir(const QString& repo_id, QString *repo_dir);
+
     QByteArray url_;
+
+    // The urls received before the daemon is connected, or whose repos or
+    // files were not known by the daemon yet.
+    QList<QUrl> pending_urls_;
+    QTimer *pending_timer_;
+    int pending_retries_;
+    bool daemon_connected_;
+
+    // repo_id -> the folder of the repo in the drive, so opening the files
+    // of a repo again doesn't need any rpc.
+    struct RepoDir {
+        QString path;
+        qint64 ts;
+    };
+    QHash<QString, RepoDir> repo_dirs_;
 };
 
 
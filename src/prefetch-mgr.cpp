@@ -0,0 +1,435 @@
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QSettings>
+
+#include "account-mgr.h"
+#include "api/api-error.h"
+#include "api/requests.h"
+#include "api/seaf-dirent.h"
+#include "cached-files-index.h"
+#include "daemon-mgr.h"
+#include "rpc/rpc-client.h"
+#include "seadrive-gui.h"
+#include "timer-scheduler.h"
+#include "utils/file-utils.h"
+#include "utils/utils.h"
+
+#include "prefetch-mgr.h"
+
+namespace {
+
+const char *kPinnedFoldersGroup = "PinnedFolders";
+const char *kPinnedFolders = "folders";
+
+// Walk the pinned folders again every 30 minutes, to fetch the files that
+// were removed from the cache in between.
+const int kRewarmIntervalMSecs = 30 * 60 * 1000;
+// Few files are removed from the cache while the gui is idle.
+const int kMaxRewarmIntervalMSecs = 2 * 60 * 60 * 1000;
+
+// Folders listed from the server at the same time.
+const int kMaxConcurrentListings = 2;
+
+// Files taken from the queue by the worker at a time.
+const int kCacheBatchSize = 100;
+
+// Upper limit of the cache requests sent to the daemon, so a large folder
+// doesn't flood its download queue.
+const int kMaxCacheRequestsPerSec = 50;
+
+QString folderKey(const QString& repo_id, const QString& path)
+{
+    return repo_id + path;
+}
+
+QString pinKey(const Account& account, const QString& repo_id, const QString& path)
+{
+    return QString("%1\t%2\t%3").arg(account.getSignature(), repo_id, path);
+}
+
+// Paths are kept like "/dir/file", as used by the daemon rpcs. The root of
+// the library is "/".
+QString normalizedPathInRepo(const QString& path)
+{
+    QString p = path;
+    while (p.endsWith("/")) {
+        p.chop(1);
+    }
+    if (!p.startsWith("/")) {
+        p.prepend("/");
+    }
+    return p;
+}
+
+} // namespace
+
+SINGLETON_IMPL(PrefetchManager)
+
+PrefetchManager::PrefetchManager()
+    : done_(0),
+      total_(0)
+{
+    rewarm_timer_ = new ScheduledTimer("prefetch-rewarm", this);
+    rewarm_timer_->setMaxInterval(kMaxRewarmIntervalMSecs);
+    connect(rewarm_timer_, SIGNAL(timeout()), this, SLOT(rewarm()));
+
+    worker_ = new PrefetchWorker(this);
+    connect(worker_, SIGNAL(filesCached(int)), this, SLOT(onFilesCached(int)));
+}
+
+PrefetchManager::~PrefetchManager()
+{
+    worker_->stop();
+    worker_->wait();
+}
+
+void PrefetchManager::start()
+{
+    loadPins();
+
+    worker_->connectDaemon();
+    worker_->start();
+
+    connect(gui->daemonManager(), SIGNAL(daemonRestarted()),
+            this, SLOT(onDaemonRestarted()));
+
+    rewarm_timer_->start(kRewarmIntervalMSecs);
+    rewarm();
+}
+
+void PrefetchManager::onDaemonRestarted()
+{
+    worker_->connectDaemon();
+    // The cache may have been cleaned while the daemon was down.
+    rewarm();
+}
+
+void PrefetchManager::prefetch(const Account& account,
+                               const QString& repo_id,
+                               const QString& path)
+{
+    enqueueFolder(account, repo_id, normalizedPathInRepo(path));
+}
+
+void PrefetchManager::pin(const Account& account,
+                          const QString& repo_id,
+                          const QString& path)
+{
+    QString p = normalizedPathInRepo(path);
+    QString key = pinKey(account, repo_id, p);
+    if (!pins_.contains(key)) {
+        pins_.append(key);
+        savePins();
+    }
+    enqueueFolder(account, repo_id, p);
+}
+
+void PrefetchManager::unpin(const Account& account,
+                            const QString& repo_id,
+                            const QString& path)
+{
+    if (pins_.removeAll(pinKey(account, repo_id, normalizedPathInRepo(path))) > 0) {
+        savePins();
+    }
+}
+
+bool PrefetchManager::isPinned(const Account& account,
+                               const QString& repo_id,
+                               const QString& path) const
+{
+    return pins_.contains(pinKey(account, repo_id, normalizedPathInRepo(path)));
+}
+
+QStringList PrefetchManager::pinnedPaths() const
+{
+    QStringList paths;
+    for (const QString& pin : pins_) {
+        QStringList parts = pin.split("\t");
+        if (parts.size() == 3) {
+            paths.append(folderKey(parts[1], parts[2]));
+        }
+    }
+    return paths;
+}
+
+void PrefetchManager::rewarm()
+{
+    for (const QString& pin : pins_) {
+        QStringList parts = pin.split("\t");
+        if (parts.size() != 3) {
+            continue;
+        }
+        Account account = gui->accountManager()->getAccountBySignature(parts[0]);
+        if (!account.isValid()) {
+            // The account is logged out, keep the pin for when it's back.
+            continue;
+        }
+        enqueueFolder(account, parts[1], parts[2]);
+    }
+}
+
+void PrefetchManager::cancel()
+{
+    folders_.clear();
+    pending_folders_.clear();
+    worker_->clear();
+    // The listings in flight would find their folders are no longer pending
+    // and drop the results.
+    done_ = total_ = 0;
+    emit progressChanged(done_, total_);
+    if (listings_.isEmpty()) {
+        emit finished();
+    }
+}
+
+bool PrefetchManager::isRunning() const
+{
+    return !pending_folders_.isEmpty() || done_ < total_;
+}
+
+void PrefetchManager::enqueueFolder(const Account& account,
+                                    const QString& repo_id,
+                                    const QString& path)
+{
+    QString key = folderKey(repo_id, path);
+    if (pending_folders_.contains(key)) {
+        return;
+    }
+    pending_folders_.insert(key);
+
+    Folder folder;
+    folder.account = account;
+    folder.repo_id = repo_id;
+    folder.path = path;
+    folders_.enqueue(folder);
+
+    scheduleListings();
+}
+
+void PrefetchManager::scheduleListings()
+{
+    while (listings_.size() < kMaxConcurrentListings && !folders_.isEmpty()) {
+        Folder folder = folders_.dequeue();
+        GetDirentsRequest *req = new GetDirentsRequest(
+            folder.account, folder.repo_id, folder.path);
+        connect(req, SIGNAL(success(bool, const QList<SeafDirent>&)),
+                this, SLOT(onGetDirentsSuccess(bool, const QList<SeafDirent>&)));
+        connect(req, SIGNAL(failed(const ApiError&)),
+                this, SLOT(onGetDirentsFailed(const ApiError&)));
+        listings_.insert(req, folder);
+        req->send();
+    }
+}
+
+void PrefetchManager::onGetDirentsSuccess(bool current_readonly,
+                                          const QList<SeafDirent>& dirents)
+{
+    Q_UNUSED(current_readonly);
+    GetDirentsRequest *req = qobject_cast<GetDirentsRequest *>(sender());
+    const Folder folder = listings_.value(req);
+    const QString& repo_id = folder.repo_id;
+    const QString& path = folder.path;
+
+    // Dropped by cancel() while being listed.
+    if (pending_folders_.contains(folderKey(repo_id, path))) {
+        QStringList files;
+        for (const SeafDirent& dirent : dirents) {
+            QString child = path == "/" ? path + dirent.name : path + "/" + dirent.name;
+            if (dirent.isDir()) {
+                enqueueFolder(folder.account, repo_id, child);
+            } else {
+                files.append(child);
+            }
+        }
+        if (!files.isEmpty()) {
+            total_ += files.size();
+            worker_->addFiles(repo_id, files);
+            emit progressChanged(done_, total_);
+        }
+    }
+
+    onListingDone(req);
+}
+
+void PrefetchManager::onGetDirentsFailed(const ApiError& error)
+{
+    GetDirentsRequest *req = qobject_cast<GetDirentsRequest *>(sender());
+    qWarning("[prefetch] failed to list %s/%s: %s",
+             toCStr(req->repoId()), toCStr(req->path()),
+             toCStr(error.toString()));
+    onListingDone(req);
+}
+
+void PrefetchManager::onListingDone(GetDirentsRequest *req)
+{
+    Folder folder = listings_.take(req);
+    req->deleteLater();
+
+    pending_folders_.remove(folderKey(folder.repo_id, folder.path));
+    scheduleListings();
+    checkFinished();
+}
+
+void PrefetchManager::onFilesCached(int count)
+{
+    done_ = qMin(done_ + count, total_);
+    emit progressChanged(done_, total_);
+    checkFinished();
+}
+
+void PrefetchManager::checkFinished()
+{
+    if (isRunning() || !listings_.isEmpty()) {
+        return;
+    }
+    if (total_ > 0) {
+        qWarning("[prefetch] %lld files are fetched", total_);
+    }
+    done_ = total_ = 0;
+    emit finished();
+}
+
+void PrefetchManager::loadPins()
+{
+    QSettings settings;
+    settings.beginGroup(kPinnedFoldersGroup);
+    pins_ = settings.value(kPinnedFolders).toStringList();
+    settings.endGroup();
+}
+
+void PrefetchManager::savePins()
+{
+    QSettings settings;
+    settings.beginGroup(kPinnedFoldersGroup);
+    settings.setValue(kPinnedFolders, pins_);
+    settings.endGroup();
+}
+
+
+PrefetchWorker::PrefetchWorker(QObject *parent)
+    : QThread(parent),
+      stopped_(false),
+      rpc_client_(nullptr),
+      window_start_msecs_(0),
+      calls_in_window_(0)
+{
+}
+
+PrefetchWorker::~PrefetchWorker()
+{
+    delete rpc_client_;
+}
+
+void PrefetchWorker::connectDaemon()
+{
+    SeafileRpcClient *rpc_client = new SeafileRpcClient();
+    rpc_client->connectDaemon();
+
+    QMutexLocker locker(&rpc_mutex_);
+    delete rpc_client_;
+    rpc_client_ = rpc_client;
+}
+
+void PrefetchWorker::addFiles(const QString& repo_id, const QStringList& paths)
+{
+    QMutexLocker locker(&mutex_);
+    for (const QString& path : paths) {
+        CacheItem item;
+        item.repo_id = repo_id;
+        item.path = path;
+        items_.enqueue(item);
+    }
+    cond_.wakeAll();
+}
+
+void PrefetchWorker::clear()
+{
+    QMutexLocker locker(&mutex_);
+    items_.clear();
+}
+
+void PrefetchWorker::stop()
+{
+    QMutexLocker locker(&mutex_);
+    stopped_ = true;
+    items_.clear();
+    cond_.wakeAll();
+}
+
+void PrefetchWorker::run()
+{
+    while (1) {
+        QList<CacheItem> batch;
+        {
+            QMutexLocker locker(&mutex_);
+            while (items_.isEmpty() && !stopped_) {
+                cond_.wait(&mutex_);
+            }
+            if (stopped_) {
+                return;
+            }
+            while (!items_.isEmpty() && batch.size() < kCacheBatchSize) {
+                batch.append(items_.dequeue());
+            }
+        }
+
+        for (const CacheItem& item : batch) {
+            cacheFile(item);
+        }
+        emit filesCached(batch.size());
+    }
+}
+
+void PrefetchWorker::cacheFile(const CacheItem& item)
+{
+    // The daemon has no batch call, so skip the files the index already
+    // knows to be cached before asking it.
+    CachedFilesIndex *cached_files = CachedFilesIndex::instance();
+    const QStringList local_paths = cached_files->localPaths(item.repo_id, item.path);
+    for (const QString& path : local_paths) {
+        bool cached = false;
+        if (cached_files->lookup(path, &cached) && cached) {
+            return;
+        }
+    }
+
+    QMutexLocker locker(&rpc_mutex_);
+    if (!rpc_client_) {
+        return;
+    }
+    // Most of the files of a pinned folder are still cached when it's
+    // walked again, checking that is much cheaper than a download request.
+    if (rpc_client_->isFileCached(item.repo_id, item.path)) {
+        return;
+    }
+    locker.unlock();
+
+    throttle();
+
+    locker.relock();
+    if (!rpc_client_ || !rpc_client_->cachePath(item.repo_id, item.path)) {
+        return;
+    }
+    locker.unlock();
+
+    // It's marked as cached by the download event once the daemon has
+    // fetched it.
+    for (const QString& path : local_paths) {
+        cached_files->invalidate(path);
+    }
+}
+
+void PrefetchWorker::throttle()
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (now - window_start_msecs_ >= 1000) {
+        window_start_msecs_ = now;
+        calls_in_window_ = 0;
+    }
+    if (calls_in_window_ >= kMaxCacheRequestsPerSec) {
+        msleep(window_start_msecs_ + 1000 - now);
+        window_start_msecs_ = QDateTime::currentMSecsSinceEpoch();
+        calls_in_window_ = 0;
+    }
+    calls_in_window_++;
+}
@@ -0,0 +1,154 @@
+#ifndef SEADRIVE_GUI_PREFETCH_MGR_H
+#define SEADRIVE_GUI_PREFETCH_MGR_H
+
+#include <QObject>
+#include <QThread>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QQueue>
+#include <QSet>
+#include <QString>
+#include <QWaitCondition>
+
+#include "utils/singleton.h"
+#include "account.h"
+
+class ScheduledTimer;
+class ApiError;
+class GetDirentsRequest;
+class SeafDirent;
+class SeafileRpcClient;
+class PrefetchWorker;
+
+/**
+ * Fetches whole folders into the local cache, so they can be used offline.
+ *
+ * A folder is walked through the server api, and the files in it are handed
+ * to a worker thread, which asks the daemon to cache the ones that are not
+ * cached yet, in batches and at a limited rate.
+ *
+ * Pinned folders are remembered in the settings, and are walked again from
+ * time to time and after the daemon restarts, so the files removed from the
+ * cache (by the cache cleaner or by the user) are fetched again.
+ */
+class PrefetchManager : public QObject {
+    SINGLETON_DEFINE(PrefetchManager)
+    Q_OBJECT
+public:
+    PrefetchManager();
+    ~PrefetchManager();
+
+    void start();
+
+    // Fetches all the files under `path` once. Other threads (e.g. the
+    // extension handlers) should call it through a queued connection.
+    Q_INVOKABLE void prefetch(const Account& account,
+                              const QString& repo_id,
+                              const QString& path);
+
+    void pin(const Account& account, const QString& repo_id, const QString& path);
+    void unpin(const Account& account, const QString& repo_id, const QString& path);
+    bool isPinned(const Account& account, const QString& repo_id, const QString& path) const;
+
+    // Returns "<repo_id><path>" of all the pinned folders.
+    QStringList pinnedPaths() const;
+
+    // Drops all the folders and files that are not fetched yet.
+    void cancel();
+
+    bool isRunning() const;
+    qint64 doneCount() const { return done_; }
+    qint64 totalCount() const { return total_; }
+
+public slots:
+    // Walks all the pinned folders again.
+    void rewarm();
+
+signals:
+    void progressChanged(qint64 done, qint64 total);
+    void finished();
+
+private slots:
+    void onDaemonRestarted();
+    void onGetDirentsSuccess(bool current_readonly, const QList<SeafDirent>& dirents);
+    void onGetDirentsFailed(const ApiError& error);
+    void onFilesCached(int count);
+
+private:
+    Q_DISABLE_COPY(PrefetchManager)
+
+    struct Folder {
+        Account account;
+        QString repo_id;
+        QString path;
+    };
+
+    void enqueueFolder(const Account& account, const QString& repo_id, const QString& path);
+    void scheduleListings();
+    void onListingDone(GetDirentsRequest *req);
+    void checkFinished();
+
+    void loadPins();
+    void savePins();
+
+    QQueue<Folder> folders_;
+    // "<repo_id><path>" of the folders being queued or listed, so a folder
+    // is not walked twice at the same time.
+    QSet<QString> pending_folders_;
+    QHash<GetDirentsRequest *, Folder> listings_;
+
+    qint64 done_;
+    qint64 total_;
+
+    // "<account signature>\t<repo_id>\t<path>"
+    QStringList pins_;
+
+    ScheduledTimer *rewarm_timer_;
+    PrefetchWorker *worker_;
+};
+
+/**
+ * Asks the daemon to cache the files handed over by the PrefetchManager.
+ */
+class PrefetchWorker : public QThread {
+    Q_OBJECT
+public:
+    PrefetchWorker(QObject *parent = 0);
+    ~PrefetchWorker();
+
+    // Called in the main thread.
+    void connectDaemon();
+
+    void addFiles(const QString& repo_id, const QStringList& paths);
+    void clear();
+    void stop();
+
+    void run();
+
+signals:
+    void filesCached(int count);
+
+private:
+    struct CacheItem {
+        QString repo_id;
+        QString path;
+    };
+
+    void cacheFile(const CacheItem& item);
+    void throttle();
+
+    QMutex mutex_;
+    QWaitCondition cond_;
+    QQueue<CacheItem> items_;
+    bool stopped_;
+
+    QMutex rpc_mutex_;
+    SeafileRpcClient *rpc_client_;
+
+    // For limiting the rate of cache requests.
+    qint64 window_start_msecs_;
+    int calls_in_window_;
+};
+
+#endif // SEADRIVE_GUI_PREFETCH_MGR_H
@@ -0,0 +1,301 @@
+#include <string.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+
+#if defined(Q_OS_WIN32)
+#include <QDirIterator>
+#else
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "utils/utils.h"
+
+#include "purge-engine.h"
+
+namespace {
+
+// Removing is bound by the disk, more threads only add contention.
+const int kMaxWorkers = 4;
+
+const int kProgressIntervalMSecs = 300;
+
+// A purge of a broken tree may fail on every entry.
+const int kMaxLoggedFailures = 20;
+
+} // namespace
+
+struct PurgeEngine::DirNode {
+    DirNode(const QString& path, DirNode *parent)
+        : path(path),
+#if !defined(Q_OS_WIN32)
+          fd(-1),
+#endif
+          parent(parent),
+          depth(parent ? parent->depth + 1 : 0),
+          pending(1) {}
+
+    QString path;
+#if !defined(Q_OS_WIN32)
+    // The name in the parent dir. A sub dir is opened and removed relative
+    // to its parent, which stays open until all its sub dirs are removed.
+    QByteArray name;
+    int fd;
+#endif
+    DirNode *parent;
+    int depth;
+    // One for the listing of the dir, and one for each sub dir that is not
+    // removed yet.
+    QAtomicInt pending;
+};
+
+class PurgeEngine::PurgeDirTask : public QRunnable {
+public:
+    PurgeDirTask(PurgeEngine *engine, DirNode *node)
+        : engine_(engine), node_(node) {}
+
+    void run() {
+        engine_->purgeDir(node_);
+    }
+
+private:
+    PurgeEngine *engine_;
+    DirNode *node_;
+};
+
+
+PurgeEngine::PurgeEngine(QObject *parent)
+    : QObject(parent),
+      running_(false)
+{
+    pool_ = new QThreadPool(this);
+    pool_->setMaxThreadCount(qBound(1, QThread::idealThreadCount(), kMaxWorkers));
+
+    progress_timer_ = new QTimer(this);
+    progress_timer_->setInterval(kProgressIntervalMSecs);
+    connect(progress_timer_, SIGNAL(timeout()), this, SLOT(onProgressTimeout()));
+}
+
+PurgeEngine::~PurgeEngine()
+{
+    // The workers use the counters.
+    cancel();
+    pool_->waitForDone();
+}
+
+bool PurgeEngine::start(const QString& path)
+{
+    if (running_) {
+        return false;
+    }
+
+    QString abs_path = QDir::cleanPath(QFileInfo(path).absoluteFilePath());
+    // Avoid removing drives like C:/ or the whole home dir by mistake.
+    if (abs_path.length() <= 3 || QDir(abs_path) == QDir::home() ||
+        QDir(abs_path).isRoot()) {
+        qWarning("[purge] refusing to remove %s", toCStr(abs_path));
+        return false;
+    }
+
+    qWarning("[purge] removing %s", toCStr(abs_path));
+    path_ = abs_path;
+    running_ = true;
+    cancelled_.storeRelease(0);
+    files_removed_.storeRelease(0);
+    dirs_removed_.storeRelease(0);
+    failures_.storeRelease(0);
+
+    submit(new DirNode(abs_path, nullptr));
+
+    progress_timer_->start();
+    return true;
+}
+
+void PurgeEngine::cancel()
+{
+    cancelled_.storeRelease(1);
+}
+
+void PurgeEngine::submit(DirNode *node)
+{
+    // The deeper dirs first, so the tree is removed depth first and only a
+    // few dirs are kept open at a time.
+    pool_->start(new PurgeDirTask(this, node), node->depth);
+}
+
+// Runs in the workers. Removes the files of the dir and queues its sub dirs.
+void PurgeEngine::purgeDir(DirNode *node)
+{
+#if defined(Q_OS_WIN32)
+    QDirIterator iterator(node->path,
+                          QDir::AllEntries | QDir::NoDotAndDotDot |
+                          QDir::Hidden | QDir::System);
+    while (!cancelled_.loadAcquire() && iterator.hasNext()) {
+        iterator.next();
+        QFileInfo info = iterator.fileInfo();
+        if (info.isDir() && !info.isSymLink()) {
+            node->pending.ref();
+            submit(new DirNode(iterator.filePath(), node));
+            continue;
+        }
+
+        QFile file(iterator.filePath());
+        if (!file.remove()) {
+            // Read-only files can't be removed on windows.
+            file.setPermissions(QFile::ReadOwner | QFile::WriteOwner);
+            if (!file.remove()) {
+                fail(iterator.filePath(), "remove", 0);
+                continue;
+            }
+        }
+        files_removed_.ref();
+    }
+#else
+    if (!cancelled_.loadAcquire()) {
+        // Never follow a link to a dir outside of the tree. The sub dirs are
+        // opened relative to the open parent, so a dir above them replaced
+        // by a link during the purge isn't followed either.
+        const int flags = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+        if (node->parent) {
+            node->fd = openat(node->parent->fd, node->name.constData(), flags);
+        } else {
+            node->fd = open(QFile::encodeName(node->path).constData(), flags);
+        }
+        // The listing closes its fd, node->fd is kept for the sub dirs.
+        int list_fd = node->fd < 0 ? -1 : fcntl(node->fd, F_DUPFD_CLOEXEC, 0);
+        DIR *dir = list_fd < 0 ? nullptr : fdopendir(list_fd);
+        if (!dir) {
+            int error = errno;
+            if (error != ENOENT) {
+                fail(node->path, "open", error);
+            }
+            if (list_fd >= 0) {
+                close(list_fd);
+            }
+        } else {
+            int fd = node->fd;
+            // The entries are removed while the dir is listed, which readdir
+            // allows.
+            struct dirent *entry;
+            while (!cancelled_.loadAcquire() && (entry = readdir(dir)) != nullptr) {
+                const char *name = entry->d_name;
+                if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+                    continue;
+                }
+
+                bool is_dir = entry->d_type == DT_DIR;
+                if (entry->d_type == DT_UNKNOWN) {
+                    struct stat st;
+                    if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
+                        int error = errno;
+                        if (error != ENOENT) {
+                            fail(node->path + "/" + QFile::decodeName(name), "stat", error);
+                        }
+                        continue;
+                    }
+                    is_dir = S_ISDIR(st.st_mode);
+                }
+
+                if (is_dir) {
+                    DirNode *child = new DirNode(
+                        node->path + "/" + QFile::decodeName(name), node);
+                    child->name = name;
+                    node->pending.ref();
+                    submit(child);
+                } else if (unlinkat(fd, name, 0) == 0) {
+                    files_removed_.ref();
+                } else {
+                    int error = errno;
+                    if (error != ENOENT) {
+                        fail(node->path + "/" + QFile::decodeName(name), "remove", error);
+                    }
+                }
+            }
+            // Also closes list_fd.
+            closedir(dir);
+        }
+    }
+#endif
+
+    release(node);
+}
+
+// Runs in the workers. The last one to release a dir removes it, then
+// releases its parent.
+void PurgeEngine::release(DirNode *node)
+{
+    while (node && !node->pending.deref()) {
+        DirNode *parent = node->parent;
+#if !defined(Q_OS_WIN32)
+        if (node->fd >= 0) {
+            close(node->fd);
+        }
+#endif
+
+        if (!cancelled_.loadAcquire()) {
+#if defined(Q_OS_WIN32)
+            if (QDir().rmdir(node->path)) {
+                dirs_removed_.ref();
+            } else if (QFileInfo(node->path).exists()) {
+                fail(node->path, "remove dir", 0);
+            }
+#else
+            // The parent is still open, as this dir holds a reference to it.
+            int ret = parent
+                ? unlinkat(parent->fd, node->name.constData(), AT_REMOVEDIR)
+                : rmdir(QFile::encodeName(node->path).constData());
+            if (ret == 0) {
+                dirs_removed_.ref();
+            } else {
+                int error = errno;
+                if (error != ENOENT) {
+                    fail(node->path, "remove dir", error);
+                }
+            }
+#endif
+        }
+
+        if (!parent) {
+            QMetaObject::invokeMethod(this, "onRootDone", Qt::QueuedConnection);
+        }
+        delete node;
+        node = parent;
+    }
+}
+
+// `error` is the errno, or 0 if unknown.
+void PurgeEngine::fail(const QString& path, const char *what, int error)
+{
+    if (failures_.fetchAndAddRelaxed(1) < kMaxLoggedFailures) {
+        qWarning("[purge] failed to %s %s: %s", what, toCStr(path),
+                 error ? strerror(error) : "unknown error");
+    }
+}
+
+void PurgeEngine::onProgressTimeout()
+{
+    emit progress(filesRemoved(), dirsRemoved());
+}
+
+void PurgeEngine::onRootDone()
+{
+    running_ = false;
+    progress_timer_->stop();
+
+    bool completed = !cancelled_.loadAcquire() && failures() == 0;
+    qWarning("[purge] %s %s, %lld files and %lld dirs removed, %lld failures",
+             completed ? "removed" : "stopped removing", toCStr(path_),
+             filesRemoved(), dirsRemoved(), failures());
+
+    emit progress(filesRemoved(), dirsRemoved());
+    emit finished(completed);
+}
@@ -0,0 +1,80 @@
+#ifndef SEADRIVE_GUI_PURGE_ENGINE_H
+#define SEADRIVE_GUI_PURGE_ENGINE_H
+
+#include <QObject>
+#include <QAtomicInteger>
+#include <QString>
+
+class QThreadPool;
+class QTimer;
+
+/**
+ * Removes a directory tree, e.g. the cache dir of the daemon, which may
+ * hold millions of blocks.
+ *
+ * The work is done by a few worker threads, never in the calling thread:
+ * each directory is listed by one worker, its files are removed right away
+ * and its sub directories are handed to the other workers. A directory is
+ * removed by whichever worker finishes its last child. On unix a directory
+ * is kept open until then, and its sub directories are opened and removed
+ * relative to it, never by their full paths.
+ *
+ * A running purge can be cancelled. What has been removed is gone, and
+ * starting again on the same path resumes with what is left.
+ *
+ * The counters are read from the workers every few hundred milliseconds and
+ * reported by progress().
+ */
+class PurgeEngine : public QObject {
+    Q_OBJECT
+public:
+    explicit PurgeEngine(QObject *parent = nullptr);
+    ~PurgeEngine();
+
+    // Returns false if a purge is running, or `path` looks like a drive or
+    // the home dir.
+    bool start(const QString& path);
+    void cancel();
+
+    bool isRunning() const { return running_; }
+    const QString& path() const { return path_; }
+
+    qint64 filesRemoved() const { return files_removed_.loadAcquire(); }
+    qint64 dirsRemoved() const { return dirs_removed_.loadAcquire(); }
+    qint64 failures() const { return failures_.loadAcquire(); }
+
+signals:
+    void progress(qint64 files_removed, qint64 dirs_removed);
+    // `completed` is false when cancelled, or if some entries could not be
+    // removed.
+    void finished(bool completed);
+
+private slots:
+    void onProgressTimeout();
+    void onRootDone();
+
+private:
+    Q_DISABLE_COPY(PurgeEngine)
+
+    struct DirNode;
+    class PurgeDirTask;
+    friend class PurgeDirTask;
+
+    void purgeDir(DirNode *node);
+    void release(DirNode *node);
+    void submit(DirNode *node);
+    void fail(const QString& path, const char *what, int error);
+
+    QString path_;
+    bool running_;
+
+    QThreadPool *pool_;
+    QTimer *progress_timer_;
+
+    QAtomicInt cancelled_;
+    QAtomicInteger<qint64> files_removed_;
+    QAtomicInteger<qint64> dirs_removed_;
+    QAtomicInteger<qint64> failures_;
+};
+
+#endif // SEADRIVE_GUI_PURGE_ENGINE_H
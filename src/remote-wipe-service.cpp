@@ -1,11 +1,10 @@
-#include <QTimer>
-
 #include "account-mgr.h"
 #include "seadrive-gui.h"
 #include "api/requests.h"
 #include "api/api-error.h"
 #include "api/api-error.h"
 #include "rpc/rpc-client.h"
+#include "timer-scheduler.h"
 
 #include "remote-wipe-service.h"
 
@@ -23,7 +22,8 @@ RemoteWipeService::RemoteWipeService(QObject *parent)
     : QObject(parent),
       active_request_count_(0)
 {
-    refresh_timer_ = new QTimer(this);
+    // Not stretched when idle, a wiped account must be logged out soon.
+    refresh_timer_ = new ScheduledTimer("auth-ping", this);
     connect(refresh_timer_, SIGNAL(timeout()), this, SLOT(sendAuthPing()));
 }
 
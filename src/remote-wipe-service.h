@@ -6,7 +6,7 @@
 #include "utils/singleton.h"
 #include "api/requests.h"
 
-class QTimer;
+class ScheduledTimer;
 
 class ApiError;
 class AuthPingRequest;
@@ -34,7 +34,7 @@ private:
     void wipeLocalFiles(const Account& account);
     void askDaemonDeleteAccount(const Account& account);
 
-    QTimer *refresh_timer_;
+    ScheduledTimer *refresh_timer_;
 
     int active_request_count_;
 };
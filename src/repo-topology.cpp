@@ -0,0 +1,100 @@
+#include <QDateTime>
+#include <QDir>
+#include <QMutexLocker>
+
+#include "account-mgr.h"
+#include "daemon-mgr.h"
+#include "seadrive-gui.h"
+#include "utils/file-utils.h"
+
+#include "repo-topology.h"
+
+namespace {
+
+// Libraries created on the server don't always come with a notification, so
+// the list is still rebuilt once in a while.
+const qint64 kRepoTopologyExpireMSecs = 60 * 1000;
+
+} // namespace
+
+SINGLETON_IMPL(RepoTopology)
+
+// The version starts from the current time, so a version seen by the
+// extensions before seadrive gui restarted would not be mistaken as current.
+RepoTopology::RepoTopology()
+    : version_(QDateTime::currentMSecsSinceEpoch()),
+      dirty_(true),
+      last_build_msecs_(0)
+{
+}
+
+void RepoTopology::start()
+{
+    // invalidate() only touches the state under the lock, so it can be
+    // called directly in whatever thread the signal is emitted.
+    connect(gui->accountManager(), SIGNAL(accountMQUpdated()),
+            this, SLOT(invalidate()), Qt::DirectConnection);
+    connect(gui->daemonManager(), SIGNAL(daemonRestarted()),
+            this, SLOT(invalidate()), Qt::DirectConnection);
+}
+
+void RepoTopology::invalidate()
+{
+    QMutexLocker locker(&mutex_);
+    dirty_ = true;
+}
+
+QStringList RepoTopology::repoDirs(quint64 *version)
+{
+    QMutexLocker locker(&mutex_);
+    rebuildIfNeeded();
+    if (version) {
+        *version = version_;
+    }
+    return dirs_;
+}
+
+quint64 RepoTopology::version()
+{
+    QMutexLocker locker(&mutex_);
+    rebuildIfNeeded();
+    return version_;
+}
+
+void RepoTopology::rebuildIfNeeded()
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (!dirty_ && now - last_build_msecs_ < kRepoTopologyExpireMSecs) {
+        return;
+    }
+
+    QStringList dirs;
+    auto accounts = gui->accountManager()->activeAccounts();
+    for (auto account : accounts) {
+        // Not known yet, e.g. before the daemon is mounted on linux, or
+        // shared with another account.
+        if (account.syncRoot.isEmpty() || dirs.contains(account.syncRoot)) {
+            continue;
+        }
+        dirs << account.syncRoot;
+
+        auto subdirs = QDir(account.syncRoot).entryList(
+            QStringList(), QDir::Dirs | QDir::NoDot | QDir::NoDotDot);
+
+        for (auto subdir : subdirs) {
+            auto repos = QDir(pathJoin(account.syncRoot, subdir)).entryList(
+                QStringList(), QDir::Dirs | QDir::NoDot | QDir::NoDotDot);
+
+            for (auto repo : repos) {
+                dirs << pathJoin(account.syncRoot, subdir, repo);
+            }
+        }
+    }
+
+    if (dirs != dirs_) {
+        dirs_ = dirs;
+        version_++;
+    }
+    dirty_ = false;
+    last_build_msecs_ = now;
+}
@@ -0,0 +1,52 @@
+#ifndef SEADRIVE_GUI_REPO_TOPOLOGY_H
+#define SEADRIVE_GUI_REPO_TOPOLOGY_H
+
+#include <QObject>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+#include "utils/singleton.h"
+
+/**
+ * Keeps the folders of the libraries of all active accounts in memory, i.e.
+ * "<sync root>/<category>/<repo>", so the shell extensions can look them up
+ * without enumerating the virtual drive, which may trigger callbacks in the
+ * daemon.
+ *
+ * The list is rebuilt lazily after it's invalidated by account changes, sync
+ * notifications or daemon restarts. Each time its content changes its version
+ * is increased, so a client that already has the latest list can skip it.
+ *
+ * The methods are thread safe.
+ */
+class RepoTopology : public QObject {
+    Q_OBJECT
+    SINGLETON_DEFINE(RepoTopology)
+public:
+    RepoTopology();
+
+    void start();
+
+    // Returns the sync root of each active account, followed by the
+    // folders of its libraries.
+    QStringList repoDirs(quint64 *version);
+
+    quint64 version();
+
+public slots:
+    void invalidate();
+
+private:
+    Q_DISABLE_COPY(RepoTopology)
+
+    void rebuildIfNeeded();
+
+    QMutex mutex_;
+    QStringList dirs_;
+    quint64 version_;
+    bool dirty_;
+    qint64 last_build_msecs_;
+};
+
+#endif // SEADRIVE_GUI_REPO_TOPOLOGY_H
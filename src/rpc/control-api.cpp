@@ -0,0 +1,453 @@
+#include <QCoreApplication>
+#include <QDateTime>
+
+#include "account-mgr.h"
+#include "bandwidth-scheduler.h"
+#include "encrypted-repos-source.h"
+#include "prefetch-mgr.h"
+#include "seadrive-gui.h"
+#include "settings-mgr.h"
+#include "timer-scheduler.h"
+#include "transfer-history.h"
+#include "rpc/control-batch.h"
+#include "rpc/control-protocol.h"
+#include "rpc/rpc-dispatcher.h"
+#include "rpc/rpc-client.h"
+#include "rpc/sync-error.h"
+#include "rpc/transfer-progress.h"
+#include "utils/utils.h"
+
+#include "control-api.h"
+
+namespace {
+
+// Keeps a response small enough for the rpc transport.
+const int kMaxHistoryRecords = 10000;
+
+json_t *jsonString(const QString& value)
+{
+    return json_string(value.toUtf8().constData());
+}
+
+QString stringParam(const json_t *params, const char *name)
+{
+    return QString::fromUtf8(json_string_value(json_object_get(params, name)));
+}
+
+// The account is given by its server url and username.
+Account accountParam(const json_t *params, QString *error)
+{
+    QString server = stringParam(params, "server");
+    QString username = stringParam(params, "username");
+    Account account = gui->accountManager()->getAccountByUrlAndUsername(server, username);
+    if (!account.isValid()) {
+        *error = QString("no account %1 on %2").arg(username, server);
+    }
+    return account;
+}
+
+const char *kRuleConditions[] = { "always", "metered", "battery" };
+const int kMinutesPerDay = 24 * 60;
+
+json_t *ruleToJson(const BandwidthRule& rule)
+{
+    json_t *object = json_object();
+    json_object_set_new(object, "condition", json_string(kRuleConditions[rule.condition]));
+    json_object_set_new(object, "days", json_integer(rule.days));
+    json_object_set_new(object, "start_minute", json_integer(rule.start_minute));
+    json_object_set_new(object, "end_minute", json_integer(rule.end_minute));
+    json_object_set_new(object, "upload", json_integer(rule.upload_limit));
+    json_object_set_new(object, "download", json_integer(rule.download_limit));
+    return object;
+}
+
+// The missing fields keep their defaults: always, every day, all day and no
+// limit.
+bool ruleFromJson(const json_t *object, BandwidthRule *rule, QString *error)
+{
+    if (!json_is_object(object)) {
+        *error = "a rule must be an object";
+        return false;
+    }
+
+    const json_t *condition = json_object_get(object, "condition");
+    if (condition) {
+        QString name = QString::fromUtf8(json_string_value(condition));
+        int i = 0;
+        while (i <= BandwidthRule::ON_BATTERY && name != kRuleConditions[i]) {
+            i++;
+        }
+        if (i > BandwidthRule::ON_BATTERY) {
+            *error = QString("unknown condition \"%1\"").arg(name);
+            return false;
+        }
+        rule->condition = (BandwidthRule::Condition)i;
+    }
+
+    const char *fields[] = { "days", "start_minute", "end_minute", "upload", "download" };
+    json_int_t values[5] = { 0, 0, 0, 0, 0 };
+    for (int i = 0; i < 5; i++) {
+        const json_t *value = json_object_get(object, fields[i]);
+        if (value && !json_is_integer(value)) {
+            *error = QString("%1 must be an integer").arg(fields[i]);
+            return false;
+        }
+        values[i] = json_integer_value(value);
+        if (values[i] < 0) {
+            *error = QString("%1 must not be negative").arg(fields[i]);
+            return false;
+        }
+    }
+    if (values[0] > 0x7f) {
+        *error = "days must be a mask of 7 bits";
+        return false;
+    }
+    if (values[1] >= kMinutesPerDay || values[2] >= kMinutesPerDay) {
+        *error = "the minutes must be less than 1440";
+        return false;
+    }
+
+    rule->days = values[0];
+    rule->start_minute = values[1];
+    rule->end_minute = values[2];
+    rule->upload_limit = values[3];
+    rule->download_limit = values[4];
+    return true;
+}
+
+} // namespace
+
+SINGLETON_IMPL(ControlApi)
+
+ControlApi::ControlApi()
+{
+}
+
+QByteArray ControlApi::handleRequest(const QByteArray& request)
+{
+    return runControlBatch(request, [this](const QString& method, const json_t *params,
+                                           QString *error) {
+        return call(method, params, error);
+    });
+}
+
+json_t *ControlApi::call(const QString& method, const json_t *params, QString *error)
+{
+    if (method == "status") {
+        return status(params, error);
+    } else if (method == "prefetch") {
+        return prefetch(params, error);
+    } else if (method == "pin") {
+        return pin(params, true, error);
+    } else if (method == "unpin") {
+        return pin(params, false, error);
+    } else if (method == "set_rate_limits") {
+        return setRateLimits(params, error);
+    } else if (method == "list_sync_errors") {
+        return listSyncErrors(params, error);
+    } else if (method == "transfer_history") {
+        return transferHistory(params, error);
+    } else if (method == "rpc_stats") {
+        return rpcStats(params, error);
+    } else if (method == "list_encrypted_repos") {
+        return listEncryptedRepos(params, error);
+    } else if (method == "timer_stats") {
+        return timerStats(params, error);
+    } else if (method == "get_bandwidth_rules") {
+        return getBandwidthRules(params, error);
+    } else if (method == "set_bandwidth_rules") {
+        return setBandwidthRules(params, error);
+    }
+
+    *error = QString("unknown method \"%1\"").arg(method);
+    return nullptr;
+}
+
+json_t *ControlApi::status(const json_t *params, QString *error)
+{
+    Q_UNUSED(params);
+    Q_UNUSED(error);
+
+    json_t *result = json_object();
+    json_object_set_new(result, "version", jsonString(STRINGIZE(SEADRIVE_GUI_VERSION)));
+    json_object_set_new(result, "daemon_connected",
+                        json_boolean(gui->rpcClient()->isConnected()));
+
+    json_t *accounts = json_array();
+    for (const Account& account : gui->accountManager()->activeAccounts()) {
+        json_t *object = json_object();
+        json_object_set_new(object, "server", jsonString(account.serverUrl.toString()));
+        json_object_set_new(object, "username", jsonString(account.username));
+        json_object_set_new(object, "name", jsonString(account.accountInfo.name));
+        json_array_append_new(accounts, object);
+    }
+    json_object_set_new(result, "accounts", accounts);
+
+    int upload_rate = 0, download_rate = 0;
+    gui->rpcClient()->getUploadRate(&upload_rate);
+    gui->rpcClient()->getDownloadRate(&download_rate);
+    json_object_set_new(result, "upload_rate", json_integer(upload_rate));
+    json_object_set_new(result, "download_rate", json_integer(download_rate));
+    json_object_set_new(result, "upload_limit",
+                        json_integer(gui->settingsManager()->maxUploadRatio()));
+    json_object_set_new(result, "download_limit",
+                        json_integer(gui->settingsManager()->maxDownloadRatio()));
+
+    PrefetchManager *prefetch_mgr = PrefetchManager::instance();
+    json_t *prefetch = json_object();
+    json_object_set_new(prefetch, "running", json_boolean(prefetch_mgr->isRunning()));
+    json_object_set_new(prefetch, "done", json_integer(prefetch_mgr->doneCount()));
+    json_object_set_new(prefetch, "total", json_integer(prefetch_mgr->totalCount()));
+    json_object_set_new(result, "prefetch", prefetch);
+
+    return result;
+}
+
+// params: {"server", "username", "repo_id", "path"}
+json_t *ControlApi::prefetch(const json_t *params, QString *error)
+{
+    Account account = accountParam(params, error);
+    if (!account.isValid()) {
+        return nullptr;
+    }
+    QString repo_id = stringParam(params, "repo_id");
+    if (repo_id.isEmpty()) {
+        *error = "repo_id is required";
+        return nullptr;
+    }
+    PrefetchManager::instance()->prefetch(account, repo_id, stringParam(params, "path"));
+    return json_null();
+}
+
+json_t *ControlApi::pin(const json_t *params, bool pinned, QString *error)
+{
+    Account account = accountParam(params, error);
+    if (!account.isValid()) {
+        return nullptr;
+    }
+    QString repo_id = stringParam(params, "repo_id");
+    if (repo_id.isEmpty()) {
+        *error = "repo_id is required";
+        return nullptr;
+    }
+    QString path = stringParam(params, "path");
+    if (pinned) {
+        PrefetchManager::instance()->pin(account, repo_id, path);
+    } else {
+        PrefetchManager::instance()->unpin(account, repo_id, path);
+    }
+    return json_null();
+}
+
+// params: {"upload", "download"} in KB/s, 0 means no limit. A missing limit
+// is left unchanged.
+json_t *ControlApi::setRateLimits(const json_t *params, QString *error)
+{
+    json_t *upload = json_object_get(params, "upload");
+    json_t *download = json_object_get(params, "download");
+    if ((upload && !json_is_integer(upload)) ||
+        (download && !json_is_integer(download))) {
+        *error = "the limits must be integers";
+        return nullptr;
+    }
+
+    SettingsManager *settings_mgr = gui->settingsManager();
+    if (upload) {
+        settings_mgr->setMaxUploadRatio(qMax<json_int_t>(json_integer_value(upload), 0));
+    }
+    if (download) {
+        settings_mgr->setMaxDownloadRatio(qMax<json_int_t>(json_integer_value(download), 0));
+    }
+    return json_null();
+}
+
+json_t *ControlApi::listSyncErrors(const json_t *params, QString *error)
+{
+    Q_UNUSED(params);
+
+    json_t *result = json_array();
+    if (!gui->rpcClient()->isConnected()) {
+        json_decref(result);
+        *error = "not connected to the daemon";
+        return nullptr;
+    }
+
+    json_t *ret;
+    // Returns false when there is no error too.
+    if (!gui->rpcClient()->getSyncErrors(&ret)) {
+        return result;
+    }
+    for (const SyncError& sync_error : SyncError::listFromJSON(ret)) {
+        json_t *object = json_object();
+        json_object_set_new(object, "repo_id", jsonString(sync_error.repo_id));
+        json_object_set_new(object, "repo_name", jsonString(sync_error.repo_name));
+        json_object_set_new(object, "path", jsonString(sync_error.path));
+        json_object_set_new(object, "timestamp", json_integer(sync_error.timestamp));
+        json_object_set_new(object, "error_id", json_integer(sync_error.error_id));
+        json_object_set_new(object, "error", jsonString(sync_error.error_str));
+        json_array_append_new(result, object);
+    }
+    json_decref(ret);
+    return result;
+}
+
+// params: {"from", "to"} in msecs since epoch, {"prefix", "limit"}
+json_t *ControlApi::transferHistory(const json_t *params, QString *error)
+{
+    Q_UNUSED(error);
+
+    qint64 from = json_integer_value(json_object_get(params, "from"));
+    json_t *to_value = json_object_get(params, "to");
+    qint64 to = to_value ? json_integer_value(to_value)
+                         : QDateTime::currentMSecsSinceEpoch() + 1;
+    int limit = json_integer_value(json_object_get(params, "limit"));
+    if (limit <= 0 || limit > kMaxHistoryRecords) {
+        limit = kMaxHistoryRecords;
+    }
+
+    json_t *result = json_array();
+    QList<TransferRecord> records = TransferHistory::instance()->query(
+        from, to, stringParam(params, "prefix"), limit);
+    for (const TransferRecord& record : records) {
+        json_t *object = json_object();
+        json_object_set_new(object, "ts", json_integer(record.ts));
+        json_object_set_new(object, "direction",
+                            json_string(record.direction == TransferRecord::UPLOAD
+                                        ? "upload" : "download"));
+        json_object_set_new(object, "server", jsonString(record.server));
+        json_object_set_new(object, "username", jsonString(record.username));
+        json_object_set_new(object, "path", jsonString(record.path));
+        json_object_set_new(object, "bytes", json_integer(record.bytes));
+        json_object_set_new(object, "duration", json_integer(record.duration_msecs));
+        json_array_append_new(result, object);
+    }
+    return result;
+}
+
+// The latency of the commands of the applet rpc server, in msecs.
+json_t *ControlApi::rpcStats(const json_t *params, QString *error)
+{
+    Q_UNUSED(params);
+    Q_UNUSED(error);
+
+    json_t *result = json_object();
+    QHash<QString, RpcDispatcher::CommandStats> stats = RpcDispatcher::instance()->stats();
+    for (auto it = stats.constBegin(); it != stats.constEnd(); ++it) {
+        const RpcDispatcher::CommandStats& s = it.value();
+        json_t *object = json_object();
+        json_object_set_new(object, "calls", json_integer(s.calls));
+        json_object_set_new(object, "failures", json_integer(s.failures));
+        json_object_set_new(object, "rejected", json_integer(s.rejected));
+        json_object_set_new(object, "timeouts", json_integer(s.timeouts));
+        json_object_set_new(object, "avg_msecs",
+                            json_integer(s.calls > 0 ? s.total_msecs / s.calls : 0));
+        json_object_set_new(object, "max_msecs", json_integer(s.max_msecs));
+        json_object_set_new(result, it.key().toUtf8().constData(), object);
+    }
+    return result;
+}
+
+json_t *ControlApi::listEncryptedRepos(const json_t *params, QString *error)
+{
+    Q_UNUSED(params);
+    Q_UNUSED(error);
+
+    // Only fetched from the daemon if something has changed since the last
+    // time.
+    EncryptedReposSource *source = EncryptedReposSource::instance();
+    source->refresh();
+
+    json_t *result = json_object();
+    json_object_set_new(result, "version", json_integer(source->version()));
+    json_t *repos = json_array();
+    for (const EncryptedRepoInfo& info : source->repos()) {
+        json_t *object = json_object();
+        json_object_set_new(object, "repo_id", jsonString(info.repo_id));
+        json_object_set_new(object, "repo_name", jsonString(info.repo_name));
+        json_object_set_new(object, "server", jsonString(info.repo_server));
+        json_object_set_new(object, "username", jsonString(info.repo_username));
+        json_object_set_new(object, "password_set", json_boolean(info.is_password_set));
+        json_array_append_new(repos, object);
+    }
+    json_object_set_new(result, "repos", repos);
+    return result;
+}
+
+// The wakeups of the periodic timers of the gui, see TimerScheduler.
+json_t *ControlApi::timerStats(const json_t *params, QString *error)
+{
+    Q_UNUSED(params);
+    Q_UNUSED(error);
+
+    TimerScheduler *scheduler = TimerScheduler::instance();
+    json_t *result = json_object();
+    json_object_set_new(result, "wakeups_per_minute",
+                        json_integer(scheduler->wakeupsPerMinute()));
+    json_object_set_new(result, "idle_secs", json_integer(scheduler->idleMSecs() / 1000));
+    json_object_set_new(result, "stretch", json_integer(scheduler->stretchFactor()));
+
+    json_t *timers = json_array();
+    for (const ScheduledTimer *timer : scheduler->timers()) {
+        json_t *object = json_object();
+        json_object_set_new(object, "name", jsonString(timer->name()));
+        json_object_set_new(object, "active", json_boolean(timer->isActive()));
+        json_object_set_new(object, "interval_msecs", json_integer(timer->interval()));
+        json_object_set_new(object, "current_interval_msecs",
+                            json_integer(scheduler->effectiveInterval(timer)));
+        json_object_set_new(object, "fires", json_integer(timer->fires()));
+        json_array_append_new(timers, object);
+    }
+    json_object_set_new(result, "timers", timers);
+    return result;
+}
+
+// The rules of the bandwidth schedule, and whether one of them is in effect
+// instead of the base limits. See setBandwidthRules for the format.
+json_t *ControlApi::getBandwidthRules(const json_t *params, QString *error)
+{
+    Q_UNUSED(params);
+    Q_UNUSED(error);
+
+    BandwidthScheduler *scheduler = BandwidthScheduler::instance();
+    json_t *rules = json_array();
+    for (const BandwidthRule& rule : scheduler->rules()) {
+        json_array_append_new(rules, ruleToJson(rule));
+    }
+
+    json_t *result = json_object();
+    json_object_set_new(result, "rules", rules);
+    json_object_set_new(result, "overriding", json_boolean(scheduler->isOverriding()));
+    json_object_set_new(result, "base_upload", json_integer(scheduler->baseUploadLimit()));
+    json_object_set_new(result, "base_download",
+                        json_integer(scheduler->baseDownloadLimit()));
+    return result;
+}
+
+// params: {"rules": [rule, ...]}, which replace all the rules. The first
+// matching rule wins. A rule is like
+//
+//   {"condition": "always" | "metered" | "battery",
+//    "days": <mask of the days, bit 0 is monday, 0 means every day>,
+//    "start_minute", "end_minute": <minutes since midnight>,
+//    "upload", "download": <limits in KB/s, 0 means no limit>}
+json_t *ControlApi::setBandwidthRules(const json_t *params, QString *error)
+{
+    const json_t *array = json_object_get(params, "rules");
+    if (!json_is_array(array)) {
+        *error = "\"rules\" must be an array";
+        return nullptr;
+    }
+
+    QList<BandwidthRule> rules;
+    for (size_t i = 0; i < json_array_size(array); i++) {
+        BandwidthRule rule;
+        if (!ruleFromJson(json_array_get(array, i), &rule, error)) {
+            *error = QString("rule %1: %2").arg((int)i).arg(*error);
+            return nullptr;
+        }
+        rules.append(rule);
+    }
+
+    BandwidthScheduler::instance()->setRules(rules);
+    return json_null();
+}
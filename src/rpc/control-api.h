@@ -0,0 +1,49 @@
+#ifndef SEADRIVE_GUI_RPC_CONTROL_API_H
+#define SEADRIVE_GUI_RPC_CONTROL_API_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+
+#include <jansson.h>
+
+#include "utils/singleton.h"
+
+/**
+ * Runs the calls of the local control api, see control-protocol.h for the
+ * format of the requests.
+ *
+ * The calls use the managers of the gui, so the requests are dispatched to
+ * the main thread by the rpc dispatcher. The calls themselves must return
+ * quickly: long operations are only started, and their progress is reported
+ * by "status".
+ */
+class ControlApi : public QObject {
+    SINGLETON_DEFINE(ControlApi)
+    Q_OBJECT
+public:
+    ControlApi();
+
+    // Returns the json response. Must be called in the main thread.
+    QByteArray handleRequest(const QByteArray& request);
+
+private:
+    Q_DISABLE_COPY(ControlApi)
+
+    // Returns a new reference to the result, or null with error set.
+    json_t *call(const QString& method, const json_t *params, QString *error);
+
+    json_t *status(const json_t *params, QString *error);
+    json_t *prefetch(const json_t *params, QString *error);
+    json_t *pin(const json_t *params, bool pinned, QString *error);
+    json_t *setRateLimits(const json_t *params, QString *error);
+    json_t *listSyncErrors(const json_t *params, QString *error);
+    json_t *transferHistory(const json_t *params, QString *error);
+    json_t *rpcStats(const json_t *params, QString *error);
+    json_t *listEncryptedRepos(const json_t *params, QString *error);
+    json_t *timerStats(const json_t *params, QString *error);
+    json_t *getBandwidthRules(const json_t *params, QString *error);
+    json_t *setBandwidthRules(const json_t *params, QString *error);
+};
+
+#endif // SEADRIVE_GUI_RPC_CONTROL_API_H
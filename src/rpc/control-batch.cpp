@@ -0,0 +1,88 @@
+#include <stdlib.h>
+
+#include "rpc/control-protocol.h"
+
+#include "control-batch.h"
+
+namespace {
+
+json_t *jsonString(const QString& value)
+{
+    return json_string(value.toUtf8().constData());
+}
+
+json_t *resultObject(json_t *result, const QString& error)
+{
+    json_t *object = json_object();
+    if (result) {
+        json_object_set_new(object, "ok", json_true());
+        json_object_set_new(object, "result", result);
+    } else {
+        json_object_set_new(object, "ok", json_false());
+        json_object_set_new(object, "error", jsonString(error));
+    }
+    return object;
+}
+
+json_t *newResponse()
+{
+    json_t *response = json_object();
+    json_object_set_new(response, "version", json_integer(SEADRIVE_CONTROL_API_VERSION));
+    return response;
+}
+
+// Takes the reference to `response`.
+QByteArray dumpResponse(json_t *response)
+{
+    char *dump = json_dumps(response, JSON_COMPACT);
+    QByteArray ret(dump);
+    free(dump);
+    json_decref(response);
+    return ret;
+}
+
+QByteArray errorResponse(const QString& error)
+{
+    json_t *response = newResponse();
+    json_object_set_new(response, "error", jsonString(error));
+    return dumpResponse(response);
+}
+
+} // namespace
+
+QByteArray runControlBatch(const QByteArray& request, const ControlCallFunc& call)
+{
+    json_error_t json_error;
+    json_t *root = json_loadb(request.constData(), request.size(), 0, &json_error);
+    if (!root) {
+        return errorResponse(QString("invalid request: %1").arg(json_error.text));
+    }
+
+    int version = json_integer_value(json_object_get(root, "version"));
+    if (version < 1 || version > SEADRIVE_CONTROL_API_VERSION) {
+        json_decref(root);
+        return errorResponse(QString("unsupported version %1").arg(version));
+    }
+
+    json_t *calls = json_object_get(root, "calls");
+    if (!json_is_array(calls)) {
+        json_decref(root);
+        return errorResponse("\"calls\" must be an array");
+    }
+
+    json_t *results = json_array();
+    for (size_t i = 0; i < json_array_size(calls); i++) {
+        const json_t *c = json_array_get(calls, i);
+        QString method = QString::fromUtf8(json_string_value(json_object_get(c, "method")));
+        const json_t *params = json_object_get(c, "params");
+
+        QString error;
+        json_t *result = call(method, params, &error);
+        json_array_append_new(results, resultObject(result, error));
+    }
+    json_decref(root);
+
+    json_t *response = newResponse();
+    json_object_set_new(response, "results", results);
+    return dumpResponse(response);
+}
@@ -0,0 +1,23 @@
+#ifndef SEADRIVE_GUI_RPC_CONTROL_BATCH_H
+#define SEADRIVE_GUI_RPC_CONTROL_BATCH_H
+
+#include <functional>
+
+#include <QByteArray>
+#include <QString>
+
+#include <jansson.h>
+
+// Runs one call of a batch. Returns a new reference to the result, or null
+// with error set.
+typedef std::function<json_t *(const QString& method, const json_t *params,
+                               QString *error)> ControlCallFunc;
+
+/**
+ * Runs the calls of a control request in order with `call`, and returns the
+ * json response, see control-protocol.h. A failed call doesn't stop the
+ * batch, its error is reported in its own result.
+ */
+QByteArray runControlBatch(const QByteArray& request, const ControlCallFunc& call);
+
+#endif // SEADRIVE_GUI_RPC_CONTROL_BATCH_H
@@ -0,0 +1,29 @@
+#ifndef SEADRIVE_GUI_RPC_CONTROL_PROTOCOL_H
+#define SEADRIVE_GUI_RPC_CONTROL_PROTOCOL_H
+
+// The local control api, served by the applet rpc server and used by
+// seadrive-gui-ctl.
+//
+// The "control" function of the "seadrive-client-rpcserver" service takes a
+// json request and returns a json response, both as strings:
+//
+//   {"version": 1, "calls": [{"method": "prefetch", "params": {...}}, ...]}
+//
+//   {"version": 1, "results": [{"ok": true, "result": ...},
+//                              {"ok": false, "error": "..."}, ...]}
+//
+// The calls of a request run in order and each one gets its own result, so
+// a script can send a whole batch in one round trip. Methods that start long
+// operations, like "prefetch", return once the operation is queued; its
+// progress is reported by "status".
+//
+// A new version is only needed when the meaning of an existing method
+// changes. New methods and new fields can be added to the current version,
+// and clients must ignore the fields they don't know.
+
+#define SEADRIVE_CONTROL_API_VERSION 1
+
+#define SEADRIVE_CONTROL_RPC_SERVICE "seadrive-client-rpcserver"
+#define SEADRIVE_CONTROL_RPC_FUNCTION "control"
+
+#endif // SEADRIVE_GUI_RPC_CONTROL_PROTOCOL_H
@@ -19,6 +19,7 @@
 #include "daemon-mgr.h"
 #include "file-provider-mgr.h"
 #include "i18n.h"
+#include "timer-scheduler.h"
 
 namespace {
 
@@ -27,6 +28,7 @@ const char *kSeadriveSockName = "\\\\.\\pipe\\seadrive_";
 #else
 const char *kSeadriveSockName = "seadrive.sock";
 const int kCheckDaemonIntervalMsec = 2000;
+const int kMaxCheckDaemonIntervalMsec = 8000;
 #endif
 
 const char *kSeadriveRpcService = "seadrive-rpcserver";
@@ -38,7 +40,8 @@ SeafileRpcClient::SeafileRpcClient()
       connected_(false)
 {
 #if defined(Q_OS_MAC)
-    check_daemon_timer_ = new QTimer(this);
+    check_daemon_timer_ = new ScheduledTimer("daemon-ping", this);
+    check_daemon_timer_->setMaxInterval(kMaxCheckDaemonIntervalMsec);
     connect(check_daemon_timer_, SIGNAL(timeout()), this, SLOT(checkDaemonAlive()));
 #endif
 }
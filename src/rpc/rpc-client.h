@@ -21,6 +21,7 @@ struct _SearpcClient;
 }
 
 class Account;
+class ScheduledTimer;
 #if defined(_MSC_VER)
 class AccountManager;
 #endif
@@ -151,7 +152,7 @@ private:
 
     bool connected_;
 
-    QTimer *check_daemon_timer_;
+    ScheduledTimer *check_daemon_timer_;
 };
 
 #endif
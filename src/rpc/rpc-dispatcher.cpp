@@ -0,0 +1,229 @@
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+
+#include "utils/utils.h"
+
+#include "rpc-dispatcher.h"
+
+namespace {
+
+// Commands queued or running at the same time.
+const int kMaxPendingCommands = 16;
+// A command waits this long for a free slot before it's rejected.
+const int kQueueTimeoutMSecs = 2000;
+// A caller waits this long for the result of its command.
+const int kResultTimeoutMSecs = 30 * 1000;
+
+const int kMaxWorkerThreads = 4;
+
+const qint64 kSlowCommandMSecs = 1000;
+
+} // namespace
+
+RpcCompletion::RpcCompletion(RpcDispatcher *dispatcher, const QString& command)
+    : dispatcher_(dispatcher),
+      command_(command),
+      done_(false)
+{
+    timer_.start();
+}
+
+RpcCompletion::~RpcCompletion()
+{
+    // No lock is needed, nobody else holds the completion any more.
+    if (!done_) {
+        qWarning("[rpc dispatcher] command %s is dropped without completion",
+                 toCStr(command_));
+        dispatcher_->onCompleted(command_, timer_.elapsed(), true);
+    }
+}
+
+void RpcCompletion::complete(const QByteArray& result)
+{
+    finish(result, QString());
+}
+
+void RpcCompletion::fail(const QString& error)
+{
+    finish(QByteArray(), error.isEmpty() ? QString("failed") : error);
+}
+
+void RpcCompletion::finish(const QByteArray& result, const QString& error)
+{
+    {
+        QMutexLocker locker(&mutex_);
+        if (done_) {
+            qWarning("[rpc dispatcher] command %s is completed twice", toCStr(command_));
+            return;
+        }
+        done_ = true;
+        result_ = result;
+        error_ = error;
+        cond_.wakeAll();
+    }
+    dispatcher_->onCompleted(command_, timer_.elapsed(), !error.isEmpty());
+}
+
+bool RpcCompletion::wait(int timeout_msecs)
+{
+    QMutexLocker locker(&mutex_);
+    while (!done_) {
+        qint64 left = timeout_msecs - timer_.elapsed();
+        if (left <= 0 || !cond_.wait(&mutex_, (unsigned long)left)) {
+            return done_;
+        }
+    }
+    return true;
+}
+
+
+class RpcJobTask : public QRunnable {
+public:
+    RpcJobTask(std::function<void()> run) : run_(run) {}
+
+    void run() {
+        run_();
+    }
+
+private:
+    std::function<void()> run_;
+};
+
+
+SINGLETON_IMPL(RpcDispatcher)
+
+RpcDispatcher::RpcDispatcher()
+    : free_slots_(kMaxPendingCommands)
+{
+    workers_.setMaxThreadCount(kMaxWorkerThreads);
+}
+
+RpcDispatcher::~RpcDispatcher()
+{
+    workers_.waitForDone();
+}
+
+void RpcDispatcher::registerCommand(const QString& name,
+                                    Affinity affinity,
+                                    bool wait_for_result,
+                                    const Handler& handler)
+{
+    Command command;
+    command.affinity = affinity;
+    command.wait_for_result = wait_for_result;
+    command.handler = handler;
+    commands_.insert(name, command);
+}
+
+bool RpcDispatcher::dispatch(const QString& name,
+                             const QByteArray& arg,
+                             QByteArray *result,
+                             QString *error)
+{
+    // Only read after the server is started, so no lock is needed.
+    auto it = commands_.constFind(name);
+    if (it == commands_.constEnd()) {
+        *error = QString("unknown command %1").arg(name);
+        return false;
+    }
+    const Command& command = it.value();
+
+    // The slot is released when the command completes, so a slow command
+    // keeps its slot even after its caller has given up on it.
+    if (!free_slots_.tryAcquire(1, kQueueTimeoutMSecs)) {
+        qWarning("[rpc dispatcher] too many pending commands, rejecting %s",
+                 toCStr(name));
+        recordRejected(name, false);
+        *error = "server busy";
+        return false;
+    }
+
+    Job job;
+    job.handler = command.handler;
+    job.arg = arg;
+    job.completion = RpcCompletionPtr(new RpcCompletion(this, name));
+
+    if (command.affinity == MAIN_THREAD) {
+        QMutexLocker locker(&main_jobs_mutex_);
+        main_jobs_.enqueue(job);
+        // One call runs all the queued jobs, so only post it for the first.
+        if (main_jobs_.size() == 1) {
+            QMetaObject::invokeMethod(this, "runMainThreadJobs", Qt::QueuedConnection);
+        }
+    } else {
+        workers_.start(new RpcJobTask([job]() { runJob(job); }));
+    }
+
+    if (!command.wait_for_result) {
+        return true;
+    }
+
+    RpcCompletionPtr completion = job.completion;
+    if (!completion->wait(kResultTimeoutMSecs)) {
+        qWarning("[rpc dispatcher] command %s timed out", toCStr(name));
+        recordRejected(name, true);
+        *error = "timed out";
+        return false;
+    }
+
+    QMutexLocker locker(&completion->mutex_);
+    if (!completion->error_.isEmpty()) {
+        *error = completion->error_;
+        return false;
+    }
+    *result = completion->result_;
+    return true;
+}
+
+void RpcDispatcher::runMainThreadJobs()
+{
+    QQueue<Job> jobs;
+    {
+        QMutexLocker locker(&main_jobs_mutex_);
+        jobs.swap(main_jobs_);
+    }
+    while (!jobs.isEmpty()) {
+        runJob(jobs.dequeue());
+    }
+}
+
+void RpcDispatcher::runJob(const Job& job)
+{
+    job.handler(job.arg, job.completion);
+}
+
+void RpcDispatcher::onCompleted(const QString& name, qint64 msecs, bool failed)
+{
+    free_slots_.release();
+
+    if (msecs >= kSlowCommandMSecs) {
+        qWarning("[rpc dispatcher] command %s took %lld ms", toCStr(name), msecs);
+    }
+
+    QMutexLocker locker(&stats_mutex_);
+    CommandStats& stats = stats_[name];
+    stats.calls++;
+    if (failed) {
+        stats.failures++;
+    }
+    stats.total_msecs += msecs;
+    stats.max_msecs = qMax(stats.max_msecs, msecs);
+}
+
+void RpcDispatcher::recordRejected(const QString& name, bool timeout)
+{
+    QMutexLocker locker(&stats_mutex_);
+    CommandStats& stats = stats_[name];
+    if (timeout) {
+        stats.timeouts++;
+    } else {
+        stats.rejected++;
+    }
+}
+
+QHash<QString, RpcDispatcher::CommandStats> RpcDispatcher::stats() const
+{
+    QMutexLocker locker(&stats_mutex_);
+    return stats_;
+}
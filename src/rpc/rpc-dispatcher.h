@@ -0,0 +1,149 @@
+#ifndef SEADRIVE_GUI_RPC_DISPATCHER_H
+#define SEADRIVE_GUI_RPC_DISPATCHER_H
+
+#include <functional>
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QQueue>
+#include <QSemaphore>
+#include <QSharedPointer>
+#include <QString>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include "utils/singleton.h"
+
+class RpcDispatcher;
+
+// The result of a command. The handler completes it exactly once, from any
+// thread, possibly after the handler itself has returned. A completion
+// dropped without being completed fails its command, so the slot of the
+// command is still released.
+class RpcCompletion {
+public:
+    ~RpcCompletion();
+
+    void complete(const QByteArray& result = QByteArray());
+    void fail(const QString& error);
+
+private:
+    friend class RpcDispatcher;
+
+    RpcCompletion(RpcDispatcher *dispatcher, const QString& command);
+
+    // Returns false when the command doesn't complete in time.
+    bool wait(int timeout_msecs);
+    void finish(const QByteArray& result, const QString& error);
+
+    RpcDispatcher *dispatcher_;
+    const QString command_;
+    QElapsedTimer timer_;
+
+    QMutex mutex_;
+    QWaitCondition cond_;
+    bool done_;
+    QByteArray result_;
+    QString error_;
+};
+
+typedef QSharedPointer<RpcCompletion> RpcCompletionPtr;
+
+/**
+ * Runs the commands of the applet rpc server.
+ *
+ * The server calls the registered functions in its own threads, and the
+ * dispatcher hands each command to the thread it belongs to: the main
+ * thread for the commands that use the gui, or a pool of workers for the
+ * ones that may block. The commands that don't return anything (e.g. "exit")
+ * are answered as soon as they are queued, the others are waited for, up to
+ * a timeout.
+ *
+ * The number of commands queued or running at the same time is limited, and
+ * the commands over the limit are rejected instead of piling up behind a
+ * slow one. The latency of each command is recorded.
+ */
+class RpcDispatcher : public QObject {
+    SINGLETON_DEFINE(RpcDispatcher)
+    Q_OBJECT
+public:
+    enum Affinity {
+        MAIN_THREAD = 0,
+        WORKER_THREAD,
+    };
+
+    typedef std::function<void(const QByteArray& arg,
+                               const RpcCompletionPtr& completion)> Handler;
+
+    struct CommandStats {
+        qint64 calls;
+        qint64 failures;
+        qint64 rejected;
+        qint64 timeouts;
+        // The time from dispatching to completion.
+        qint64 total_msecs;
+        qint64 max_msecs;
+
+        CommandStats()
+            : calls(0), failures(0), rejected(0), timeouts(0),
+              total_msecs(0), max_msecs(0) {}
+    };
+
+    RpcDispatcher();
+    ~RpcDispatcher();
+
+    // Must be called in the main thread before the server is started.
+    void registerCommand(const QString& name,
+                         Affinity affinity,
+                         bool wait_for_result,
+                         const Handler& handler);
+
+    // Called from the rpc server threads. Returns false with error set when
+    // the command is unknown, rejected, failed or timed out.
+    bool dispatch(const QString& name,
+                  const QByteArray& arg,
+                  QByteArray *result,
+                  QString *error);
+
+    QHash<QString, CommandStats> stats() const;
+
+private slots:
+    void runMainThreadJobs();
+
+private:
+    Q_DISABLE_COPY(RpcDispatcher)
+    friend class RpcCompletion;
+
+    struct Command {
+        Affinity affinity;
+        bool wait_for_result;
+        Handler handler;
+    };
+
+    struct Job {
+        Handler handler;
+        QByteArray arg;
+        RpcCompletionPtr completion;
+    };
+
+    static void runJob(const Job& job);
+
+    void onCompleted(const QString& name, qint64 msecs, bool failed);
+    void recordRejected(const QString& name, bool timeout);
+
+    QHash<QString, Command> commands_;
+
+    QSemaphore free_slots_;
+    QThreadPool workers_;
+
+    QMutex main_jobs_mutex_;
+    QQueue<Job> main_jobs_;
+
+    mutable QMutex stats_mutex_;
+    QHash<QString, CommandStats> stats_;
+};
+
+#endif // SEADRIVE_GUI_RPC_DISPATCHER_H
@@ -13,6 +13,9 @@
 #include "settings-mgr.h"
 #include "utils/file-utils.h"
 #include "rpc-server.h"
+#include "control-api.h"
+#include "control-protocol.h"
+#include "rpc-dispatcher.h"
 #include "open-local-helper.h"
 
 #if defined(Q_OS_WIN32)
@@ -25,44 +28,60 @@ namespace {
 
 #if defined(Q_OS_WIN32)
 const char *kSeaDriveSockName = "\\\\.\\pipe\\seadrive_client_";
-#else
-const char *kSeaDriveSockName = "seadrive_client.sock";
 #endif
-const char *kSeaDriveRpcService = "seadrive-client-rpcserver";
+const char *kSeaDriveRpcService = SEADRIVE_CONTROL_RPC_SERVICE;
 
 QString getAppletRpcPipePath()
 {
 #if defined(Q_OS_WIN32)
     return utils::win::getLocalPipeName(kSeaDriveSockName).c_str();
 #else
-    QString current_cache_dir;
-    if (!gui->settingsManager()->getCacheDir(&current_cache_dir)) {
-        current_cache_dir = seadriveDataDir();
-    }
-    if (QDir::isAbsolutePath(current_cache_dir)) {
-        current_cache_dir = QDir::home().relativeFilePath(current_cache_dir);
-    }
-    QString socket_path = pathJoin(current_cache_dir,kSeaDriveSockName);
-    return socket_path;
+    // Shared with seadrive-gui-ctl.
+    return getAppletRpcSocketPath();
 #endif
 }
 
+const int kRpcErrorCode = 500;
+
+// Hands the command to the dispatcher, which runs it in the right thread.
+bool dispatchCommand(const char *name, const char *arg,
+                     QByteArray *result, GError **error)
+{
+    QString err;
+    if (!RpcDispatcher::instance()->dispatch(name, arg ? arg : "", result, &err)) {
+        g_set_error(error, g_quark_from_static_string(kSeaDriveRpcService),
+                    kRpcErrorCode, "%s", toCStr(err));
+        return false;
+    }
+    return true;
+}
+
 int
 handle_exit_command (GError **error)
 {
     qWarning("[rpc server] Got a quit command. Quit now.");
-    RpcServerProxy::instance()->proxyExitCommand();
-    return 0;
+    QByteArray result;
+    return dispatchCommand("exit", nullptr, &result, error) ? 0 : -1;
 }
 
 int
 handle_open_seafile_url_command (const char *url, GError **error)
 {
     qWarning("[rpc server] opening seafile url %s", url);
-    RpcServerProxy::instance()->proxyOpenSeafileUrlCommand(QUrl::fromEncoded(url));
-    return 0;
+    QByteArray result;
+    return dispatchCommand("open_seafile_url", url, &result, error) ? 0 : -1;
  }
 
+char *
+handle_control_command (const char *request, GError **error)
+{
+    QByteArray response;
+    if (!dispatchCommand(SEADRIVE_CONTROL_RPC_FUNCTION, request, &response, error)) {
+        return nullptr;
+    }
+    return g_strdup(response.constData());
+}
+
  void register_rpc_service ()
 {
     searpc_server_init ((RegisterMarshalFunc)register_marshals);
@@ -75,6 +94,10 @@ handle_open_seafile_url_command (const char *url, GError **error)
                                      (void *)handle_open_seafile_url_command,
                                      "open_seafile_url",
                                      searpc_signature_int__string());
+    searpc_server_register_function (kSeaDriveRpcService,
+                                     (void *)handle_control_command,
+                                     SEADRIVE_CONTROL_RPC_FUNCTION,
+                                     searpc_signature_string__string());
 }
 
  SearpcClient *createSearpcClientWithPipeTransport(const char *rpc_service)
@@ -150,12 +173,26 @@ SeaDriveRpcServer::SeaDriveRpcServer()
 {
     priv_->pipe_server = searpc_create_named_pipe_server(toCStr(getAppletRpcPipePath()));
 
-    RpcServerProxy *proxy = RpcServerProxy::instance();
-    connect(proxy, SIGNAL(exitCommand()), this, SLOT(handleExitCommand()));
-    connect(proxy,
-            SIGNAL(openSeafileUrlCommand(const QUrl &)),
-            this,
-            SLOT(handleOpenSeafileUrlCommand(const QUrl &)));
+    // The commands that use the gui run in the main thread. The callers of
+    // "exit" and "open_seafile_url" don't wait for them to finish.
+    RpcDispatcher *dispatcher = RpcDispatcher::instance();
+    dispatcher->registerCommand(
+        "exit", RpcDispatcher::MAIN_THREAD, false,
+        [this](const QByteArray&, const RpcCompletionPtr& completion) {
+            handleExitCommand();
+            completion->complete();
+        });
+    dispatcher->registerCommand(
+        "open_seafile_url", RpcDispatcher::MAIN_THREAD, false,
+        [this](const QByteArray& url, const RpcCompletionPtr& completion) {
+            handleOpenSeafileUrlCommand(QUrl::fromEncoded(url));
+            completion->complete();
+        });
+    dispatcher->registerCommand(
+        SEADRIVE_CONTROL_RPC_FUNCTION, RpcDispatcher::MAIN_THREAD, true,
+        [](const QByteArray& request, const RpcCompletionPtr& completion) {
+            completion->complete(ControlApi::instance()->handleRequest(request));
+        });
 }
 
 SeaDriveRpcServer::~SeaDriveRpcServer()
@@ -190,19 +227,3 @@ void SeaDriveRpcServer::handleOpenSeafileUrlCommand(const QUrl& url)
     OpenLocalHelper::instance()->openLocalFile(url);
 }
 
-
-SINGLETON_IMPL(RpcServerProxy)
-
-RpcServerProxy::RpcServerProxy()
-{
-}
-
-void RpcServerProxy::proxyExitCommand()
-{
-    emit exitCommand();
-}
-
-void RpcServerProxy::proxyOpenSeafileUrlCommand(const QUrl& url)
-{
-    emit openSeafileUrlCommand(url);
-}
@@ -26,32 +26,12 @@ public:
 
     static Client* getClient();
 
-private slots:
+private:
+    // Run in the main thread by the rpc dispatcher.
     void handleExitCommand();
     void handleOpenSeafileUrlCommand(const QUrl& url);
 
-
-private:
     SeaDriveRpcServerPriv *priv_;
 };
 
-// Helper object to proxy the rpc commands from the rpc server thread
-// to the main thread (using signals/slots). We need this because,
-// e.g. we can't call QCoreApplication::exit() from non-main thread.
-class RpcServerProxy : public QObject {
-    SINGLETON_DEFINE(RpcServerProxy)
-    Q_OBJECT
-
-public:
-    RpcServerProxy();
-
-    void proxyExitCommand();
-    void proxyOpenSeafileUrlCommand(const QUrl&);
-
-
-signals:
-    void exitCommand();
-    void openSeafileUrlCommand(const QUrl&);
-};
-
 #endif
@@ -39,6 +39,20 @@ marshal_string__void (void *func, json_t *param_array, gsize *ret_len)
     return searpc_marshal_set_ret_common (object, ret_len, error);
 }
 
+
+static char *
+marshal_string__string (void *func, json_t *param_array, gsize *ret_len)
+{
+    GError *error = NULL;
+    const char* param1 = json_array_get_string_or_null_element (param_array, 1);
+
+    char* ret = ((char* (*)(const char*, GError **))func) (param1, &error);
+
+    json_t *object = json_object ();
+    searpc_set_string_to_ret_object (object, ret);
+    return searpc_marshal_set_ret_common (object, ret_len, error);
+}
+
 static void register_marshals()
 {
 
@@ -56,4 +70,9 @@ static void register_marshals()
         searpc_server_register_marshal (searpc_signature_string__void(), marshal_string__void);
     }
 
+
+    {
+        searpc_server_register_marshal (searpc_signature_string__string(), marshal_string__string);
+    }
+
 }
@@ -20,3 +20,9 @@ searpc_signature_string__void()
     return searpc_compute_signature ("string", 0);
 }
 
+
+inline static gchar *
+searpc_signature_string__string()
+{
+    return searpc_compute_signature ("string", 1, "string");
+}
@@ -7,4 +7,5 @@ func_table = [
     [ "int", [] ],
     [ "int", ["string"] ],
     [ "string", [] ],
+    [ "string", ["string"] ],
 ]
@@ -5,6 +5,7 @@
 #include <QDesktopServices>
 #include <QFile>
 #include <QTextStream>
+#include <QElapsedTimer>
 #include <QDir>
 #include <QCoreApplication>
 #include <QMessageBox>
@@ -23,6 +24,7 @@
 #include "ui/settings-dialog.h"
 #include "ui/about-dialog.h"
 #include "ui/init-sync-dialog.h"
+#include "ui/dialog-releaser.h"
 #include "daemon-mgr.h"
 #include "rpc/rpc-client.h"
 #include "account-mgr.h"
@@ -30,10 +32,20 @@
 #include "message-poller.h"
 #include "remote-wipe-service.h"
 #include "account-info-service.h"
+#include "repo-topology.h"
+#include "encrypted-repos-source.h"
+#include "prefetch-mgr.h"
+#include "cache-analyzer.h"
+#include "bandwidth-scheduler.h"
+#include "transfer-history.h"
+#include "open-local-helper.h"
 #include "file-provider-mgr.h"
-#if defined(Q_OS_WIN32)
+#if defined(Q_OS_WIN32) || defined(Q_OS_LINUX)
 #include "thumbnail-service.h"
 #endif
+#if defined(Q_OS_LINUX)
+#include "ext-handler.h"
+#endif
 
 #if defined(Q_OS_WIN32)
 #include "utils/registry.h"
@@ -56,6 +68,9 @@ namespace {
 
 const int kConnectDaemonIntervalMsec = 2000;
 
+// The merged stylesheets, only built into the resources by cmake.
+const char *kStyleBundle = ":/style.css";
+
 enum DEBUG_LEVEL {
   DEBUG = 0,
   WARNING
@@ -226,10 +241,8 @@ SeadriveGui::SeadriveGui(bool dev_mode)
     rpc_client_ = new SeafileRpcClient();
     account_mgr_ = new AccountManager();
     settings_mgr_ = new SettingsManager();
-    settings_dlg_ = new SettingsDialog();
-    about_dlg_ = new AboutDialog();
     message_poller_ = new MessagePoller();
-    init_sync_dlg_ = new InitSyncDialog();
+    init_sync_dlg_ = nullptr;
 
 #if defined(Q_OS_MAC)
     file_provider_mgr_ = new FileProviderManager();
@@ -254,6 +267,33 @@ SeadriveGui::~SeadriveGui()
 
 }
 
+SettingsDialog *SeadriveGui::settingsDialog()
+{
+    if (!settings_dlg_) {
+        settings_dlg_ = new SettingsDialog();
+        DialogReleaser::watch(settings_dlg_);
+    }
+    return settings_dlg_;
+}
+
+AboutDialog *SeadriveGui::aboutDialog()
+{
+    if (!about_dlg_) {
+        about_dlg_ = new AboutDialog();
+        DialogReleaser::watch(about_dlg_);
+    }
+    return about_dlg_;
+}
+
+InitSyncDialog *SeadriveGui::initSyncDialog()
+{
+    // Not released, it remembers the new login until the first sync is done.
+    if (!init_sync_dlg_) {
+        init_sync_dlg_ = new InitSyncDialog();
+    }
+    return init_sync_dlg_;
+}
+
 void SeadriveGui::start()
 {
     started_ = true;
@@ -407,6 +447,10 @@ void SeadriveGui::onDaemonStarted()
             this, SLOT(updateAccountToDaemon()));
     updateAccountToDaemon();
 
+    // Open the urls received during the startup before the other services
+    // are started.
+    OpenLocalHelper::instance()->checkPendingOpenLocalRequest();
+
     tray_icon_->start();
     message_poller_->setRpcClient(rpc_client_);
     message_poller_->start();
@@ -422,13 +466,34 @@ void SeadriveGui::onDaemonStarted()
 
     RemoteWipeService::instance()->start();
     AccountInfoService::instance()->start();
+    RepoTopology::instance()->start();
+    EncryptedReposSource::instance()->start();
+    PrefetchManager::instance()->start();
+    CacheAnalyzer::instance()->start();
+    BandwidthScheduler::instance()->start();
+    TransferHistory::instance()->start();
 
 #if defined(_MSC_VER)
     SeafileExtensionHandler::instance()->start();
     RegElement::installCustomUrlHandler();
 #endif
 
-#if defined(Q_OS_WIN32)
+#if defined(Q_OS_LINUX)
+    // The file manager plugins ask about the paths under the mount point, so
+    // it must be known before they are served.
+    QString mount_point;
+    if (getSeadriveMountPoint(&mount_point)) {
+        qWarning("seadrive is mounted at %s", toCStr(mount_point));
+        account_mgr_->setSyncRoot(mount_point);
+        RepoTopology::instance()->invalidate();
+    } else {
+        qWarning("seadrive is not mounted, no path is in a library");
+    }
+    // Serves the file manager plugins through a unix domain socket.
+    SeafileExtensionHandler::instance()->start();
+#endif
+
+#if defined(Q_OS_WIN32) || defined(Q_OS_LINUX)
     ThumbnailService::instance()->start();
 #endif
 }
@@ -447,7 +512,7 @@ void SeadriveGui::updateAccountToDaemon()
             }
 
             // The init sync dlg only launches when there is a new logged in account.
-            if (init_sync_dlg_->hasNewLogin()) {
+            if (init_sync_dlg_ && init_sync_dlg_->hasNewLogin()) {
                 init_sync_dlg_->launch();
             }
 
@@ -461,7 +526,7 @@ void SeadriveGui::updateAccountToDaemon()
 #ifdef Q_OS_WIN32
             rpc_client_->deleteAccount(msg.account, false);
             rpc_client_->addAccount (msg.account);
-            init_sync_dlg_->launch();
+            initSyncDialog()->launch();
             qWarning() << "Resynced account" << msg.account;
 #endif
         }
@@ -630,7 +695,7 @@ bool SeadriveGui::initLog()
     return true;
 }
 
-bool SeadriveGui::loadQss(const QString& path)
+bool SeadriveGui::loadQss(const QString& path, QString *style)
 {
     QFile file(path);
     if (!QFileInfo(file).exists()) {
@@ -641,25 +706,54 @@ bool SeadriveGui::loadQss(const QString& path)
     }
 
     QTextStream input(&file);
-    style_ += "\n";
-    style_ += input.readAll();
-    qApp->setStyleSheet(style_);
+    *style += "\n";
+    *style += input.readAll();
 
     return true;
 }
 
+// The common and platform stylesheets are merged when building with cmake
+// (see seadrive-style.qrc), so they are parsed and applied in one pass.
+// Stylesheets in the current directory take precedence, so a style change
+// can be tried without rebuilding.
 void SeadriveGui::refreshQss()
 {
-    style_.clear();
-    loadQss("qt.css") || loadQss(":/qt.css");
-
+    QStringList names;
+    names << "qt.css";
 #if defined(Q_OS_WIN32)
-    loadQss("qt-win.css") || loadQss(":/qt-win.css");
+    names << "qt-win.css";
 #elif defined(Q_OS_LINUX)
-    loadQss("qt-linux.css") || loadQss(":/qt-linux.css");
+    names << "qt-linux.css";
 #else
-    loadQss("qt-mac.css") || loadQss(":/qt-mac.css");
+    names << "qt-mac.css";
 #endif
+
+    bool local = false;
+    for (const QString& name : names) {
+        if (QFileInfo::exists(name)) {
+            local = true;
+        }
+    }
+
+    QString style;
+    if (local || !loadQss(kStyleBundle, &style)) {
+        for (const QString& name : names) {
+            loadQss(name, &style) || loadQss(":/" + name, &style);
+        }
+    }
+
+    // Setting the stylesheet repolishes every widget, even when it's the
+    // same one.
+    if (style == style_) {
+        return;
+    }
+    style_ = style;
+
+    QElapsedTimer timer;
+    timer.start();
+    qApp->setStyleSheet(style_);
+    qDebug("[style] applied %d bytes of stylesheet in %lld ms",
+           (int)style_.size(), timer.elapsed());
 }
 
 void SeadriveGui::warningBox(const QString& msg, QWidget *parent)
@@ -786,11 +880,12 @@ bool SeadriveGui::deletingConfirmationBox(const QString& text, const QString& in
     } else if (box.clickedButton() == noButton) {
         return false;
     } else if (box.clickedButton() == settingsButton) {
-        settings_dlg_->setCurrentTab(1);
+        SettingsDialog *dialog = settingsDialog();
+        dialog->setCurrentTab(1);
 
-        settings_dlg_->show();
-        settings_dlg_->raise();
-        settings_dlg_->activateWindow();
+        dialog->show();
+        dialog->raise();
+        dialog->activateWindow();
 
         return false;
     }
@@ -2,6 +2,7 @@
 #define SEAFILE_SEADRIVE_GUI_H
 
 #include <QObject>
+#include <QPointer>
 #include <QVariant>
 #include <QMessageBox>
 #include <QProcess>
@@ -74,13 +75,14 @@ public:
 
     SettingsManager *settingsManager() { return settings_mgr_; }
 
-    SettingsDialog *settingsDialog() { return settings_dlg_; }
+    // The dialogs are created on first use.
+    SettingsDialog *settingsDialog();
 
-    AboutDialog *aboutDialog() { return about_dlg_; }
+    AboutDialog *aboutDialog();
 
     MessagePoller * messagePoller() { return message_poller_; }
 
-    InitSyncDialog *initSyncDialog() { return init_sync_dlg_; }
+    InitSyncDialog *initSyncDialog();
 
     FileProviderManager *fileProviderManager() { return file_provider_mgr_; }
 
@@ -109,7 +111,7 @@ private:
 
     bool initLog();
 
-    bool loadQss(const QString& path);
+    bool loadQss(const QString& path, QString *style);
 
     void loginAccounts();
 
@@ -129,9 +131,9 @@ private:
 
     SettingsManager *settings_mgr_;
 
-    SettingsDialog *settings_dlg_;
+    QPointer<SettingsDialog> settings_dlg_;
 
-    AboutDialog *about_dlg_;
+    QPointer<AboutDialog> about_dlg_;
 
     MessagePoller *message_poller_;
 
@@ -1,7 +1,6 @@
 #include <QHostInfo>
 #include <QSettings>
 #include <QThreadPool>
-#include <QTimer>
 
 #include "utils/utils.h"
 #include "utils/utils-mac.h"
@@ -11,6 +10,8 @@
 #include "utils/utils.h"
 #include "network-mgr.h"
 #include "account-mgr.h"
+#include "bandwidth-scheduler.h"
+#include "timer-scheduler.h"
 
 #if defined(Q_OS_WIN32)
 #include "utils/registry.h"
@@ -22,6 +23,7 @@ namespace
 {
 const char *kCheckLatestVersion = "checkLatestVersion";
 const char *kEnableSearch = "enableSearch";
+const char *kEvictColdFiles = "evictColdFiles";
 const char *kBehaviorGroup = "Behavior";
 
 #if defined(_MSC_VER)
@@ -48,6 +50,7 @@ const char * kHideWindowsIncompatiblePathNotification = "hide_windows_incompatib
 #endif
 
 const int kCheckSystemProxyIntervalMSecs = 5 * 1000;
+const int kMaxCheckSystemProxyIntervalMSecs = 60 * 1000;
 
 bool getSystemProxyForUrl(const QUrl &url, QNetworkProxy *proxy)
 {
@@ -106,7 +109,8 @@ SettingsManager::SettingsManager()
       cache_size_limit_gb_(10),
       delete_confirm_threshold_(500)
 {
-    check_system_proxy_timer_ = new QTimer(this);
+    check_system_proxy_timer_ = new ScheduledTimer("system-proxy", this);
+    check_system_proxy_timer_->setMaxInterval(kMaxCheckSystemProxyIntervalMSecs);
     connect(check_system_proxy_timer_, SIGNAL(timeout()), this, SLOT(checkSystemProxy()));
 }
 
@@ -118,11 +122,19 @@ void SettingsManager::loadSettings()
     if (gui->rpcClient()->seafileGetConfig("notify_sync", &str) >= 0)
         bubbleNotifycation_ = (str == "off") ? false : true;
 
-    if (gui->rpcClient()->seafileGetConfigInt("download_limit", &value) >= 0)
-        maxDownloadRatio_ = value >> 10;
+    // While a scheduled limit is in effect, the daemon has the limits of
+    // the schedule rather than the ones set by the user.
+    BandwidthScheduler *scheduler = BandwidthScheduler::instance();
+    if (scheduler->isOverriding()) {
+        maxDownloadRatio_ = scheduler->baseDownloadLimit();
+        maxUploadRatio_ = scheduler->baseUploadLimit();
+    } else {
+        if (gui->rpcClient()->seafileGetConfigInt("download_limit", &value) >= 0)
+            maxDownloadRatio_ = value >> 10;
 
-    if (gui->rpcClient()->seafileGetConfigInt("upload_limit", &value) >= 0)
-        maxUploadRatio_ = value >> 10;
+        if (gui->rpcClient()->seafileGetConfigInt("upload_limit", &value) >= 0)
+            maxUploadRatio_ = value >> 10;
+    }
 
     if (gui->rpcClient()->seafileGetConfig("sync_extra_temp_file",
                                                   &str) >= 0)
@@ -194,20 +206,28 @@ void SettingsManager::setAutoStart(bool autoStart)
 void SettingsManager::setMaxDownloadRatio(unsigned int ratio)
 {
     if (maxDownloadRatio_ != ratio) {
-        if (gui->rpcClient()->setDownloadRateLimit(ratio << 10) < 0) {
+        // The new limit is pushed by the scheduler when the scheduled one
+        // ends.
+        BandwidthScheduler *scheduler = BandwidthScheduler::instance();
+        if (!scheduler->isOverriding() &&
+            gui->rpcClient()->setDownloadRateLimit(ratio << 10) < 0) {
             return;
         }
         maxDownloadRatio_ = ratio;
+        scheduler->setBaseLimits(maxUploadRatio_, maxDownloadRatio_);
     }
 }
 
 void SettingsManager::setMaxUploadRatio(unsigned int ratio)
 {
     if (maxUploadRatio_ != ratio) {
-        if (gui->rpcClient()->setUploadRateLimit(ratio << 10) < 0) {
+        BandwidthScheduler *scheduler = BandwidthScheduler::instance();
+        if (!scheduler->isOverriding() &&
+            gui->rpcClient()->setUploadRateLimit(ratio << 10) < 0) {
             return;
         }
         maxUploadRatio_ = ratio;
+        scheduler->setBaseLimits(maxUploadRatio_, maxDownloadRatio_);
     }
 }
 
@@ -231,6 +251,26 @@ void SettingsManager::setCacheSizeLimitGB(int limit)
     }
 }
 
+void SettingsManager::setCacheEvictionEnabled(bool enabled)
+{
+    QSettings settings;
+    settings.beginGroup(kSettingsGroup);
+    settings.setValue(kEvictColdFiles, enabled);
+    settings.endGroup();
+}
+
+bool SettingsManager::isCacheEvictionEnabled()
+{
+    QSettings settings;
+    bool enabled;
+
+    settings.beginGroup(kSettingsGroup);
+    enabled = settings.value(kEvictColdFiles, false).toBool();
+    settings.endGroup();
+
+    return enabled;
+}
+
 void SettingsManager::removeAllSettings()
 {
     QSettings settings;
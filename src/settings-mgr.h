@@ -9,7 +9,7 @@
 /**
  * Settings Manager handles seafile client user settings & preferences
  */
-class QTimer;
+class ScheduledTimer;
 
 class SettingsManager : public QObject {
     Q_OBJECT
@@ -93,6 +93,11 @@ public:
     int getCacheSizeLimitGB() const { return cache_size_limit_gb_; }
     void setCacheSizeLimitGB(int limit);
 
+    // Whether the cache analyzer removes the cold files from the cache by
+    // itself, off by default.
+    void setCacheEvictionEnabled(bool enabled);
+    bool isCacheEvictionEnabled();
+
     QString getLastShibUrl();
     void setLastShibUrl(const QString& url);
 
@@ -149,7 +154,7 @@ private:
 
     int delete_confirm_threshold_;
 
-    QTimer *check_system_proxy_timer_;
+    ScheduledTimer *check_system_proxy_timer_;
 };
 
 
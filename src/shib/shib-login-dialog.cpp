@@ -15,14 +15,9 @@
 #include <QNetworkReply>
 #include <QNetworkCookie>
 
-#include "seadrive-gui.h"
-#include "utils/utils.h"
-#include "utils/api-utils.h"
-#include "account-mgr.h"
+#if defined(SEAFILE_USE_WEBKIT)
 #include "network-mgr.h"
-#include "ui/init-sync-dialog.h"
-#include "api/api-error.h"
-#include "api/requests.h"
+#endif
 
 #include "shib-login-dialog.h"
 
@@ -33,7 +28,7 @@ const char *kSeahubShibCookieName = "seahub_auth";
 } // namespace
 
 ShibLoginDialog::ShibLoginDialog(const QUrl& url,
-                                 const QString& computer_name,
+                                 const QUrl& login_url,
                                  QWidget *parent)
     : QDialog(parent),
       url_(url),
@@ -77,20 +72,11 @@ ShibLoginDialog::ShibLoginDialog(const QUrl& url,
             this, SLOT(onWebEngineCookieAdded(const QNetworkCookie&)));
 #endif
 
-    QUrl shib_login_url(url_);
-    QString path = shib_login_url.path();
-    if (!path.endsWith("/")) {
-        path += "/";
-    }
-    path += "shib-login";
-    shib_login_url.setPath(path);
-
     connect(webview_, SIGNAL(urlChanged(const QUrl&)),
            this, SLOT(updateAddressBar(const QUrl&)));
 
     vlayout->addWidget(webview_);
-    webview_->load(::includeQueryParams(
-                       shib_login_url, ::getSeafileLoginParams(computer_name, "shib_")));
+    webview_->load(login_url);
 }
 
 ShibLoginDialog::~ShibLoginDialog()
@@ -117,17 +103,12 @@ void ShibLoginDialog::onNewCookieCreated(const QUrl& url, const QNetworkCookie&
     QString name = cookie.name();
     QString value = cookie.value();
     if (url.host() == url_.host() && name == kSeahubShibCookieName) {
-        Account account = parseAccount(value);
-        if (!account.isValid()) {
+        if (!parseCookie(value)) {
             qWarning("wrong account information from server");
             return;
         }
         cookie_seen_ = true;
 
-        gui->accountManager()->enableAccount(account);
-
-        gui->initSyncDialog()->markNewLogin();
-
         accept();
     }
 }
@@ -144,7 +125,7 @@ void ShibLoginDialog::updateAddressBar(const QUrl& url)
  * The cookie value is like seahub_shib="foo@test.com@bd8cc1138", where
  * foo@test.com is username and bd8cc1138 is api token"
  */
-Account ShibLoginDialog::parseAccount(const QString& cookie_value)
+bool ShibLoginDialog::parseCookie(const QString& cookie_value)
 {
     QString txt = cookie_value;
     if (txt.startsWith("\"")) {
@@ -154,9 +135,11 @@ Account ShibLoginDialog::parseAccount(const QString& cookie_value)
     QString email = txt.left(pos);
     QString token = txt.right(txt.length() - pos - 1);
     if (email.isEmpty() or token.isEmpty()) {
-        return Account();
+        return false;
     }
-    return Account(url_, email, token, 0, true);
+    username_ = email;
+    token_ = token;
+    return true;
 }
 
 void ShibLoginDialog::onWebEngineCookieAdded(const QNetworkCookie& cookie)
@@ -10,8 +10,6 @@
 #include <QWebEnginePage>
 #endif
 
-#include "account.h"
-
 template<typename T> class QList;
 
 #if defined(SEAFILE_USE_WEBKIT)
@@ -22,9 +20,6 @@ class QWebEngineView;
 
 class QNetworkReply;
 class QLineEdit;
-class ApiError;
-class FetchAccountInfoRequest;
-class AccountInfo;
 
 /**
  * Login with Shibboleth SSO.
@@ -32,16 +27,20 @@ class AccountInfo;
  * This dialog use a webview to let the user login seahub configured with
  * Shibboleth SSO auth. When the login succeeded, seahub would set the
  * username and api token in the cookie.
+ *
+ * It only depends on Qt, so it can be built into the seadrive-shib plugin,
+ * see shib-login.h.
  */
 class ShibLoginDialog : public QDialog {
     Q_OBJECT
 public:
     ShibLoginDialog(const QUrl& url,
-                    const QString& computer_name,
+                    const QUrl& login_url,
                     QWidget *parent=0);
     ~ShibLoginDialog();
 
-    Account account() const { return account_; }
+    const QString& username() const { return username_; }
+    const QString& token() const { return token_; }
 
 private slots:
     void sslErrorHandler(QNetworkReply* reply, const QList<QSslError> & ssl_errors);
@@ -50,7 +49,7 @@ private slots:
     void updateAddressBar(const QUrl& url);
 
 private:
-    Account parseAccount(const QString& txt);
+    bool parseCookie(const QString& txt);
 
 private:
 #if !defined(SEAFILE_USE_WEBKIT)
@@ -68,7 +67,8 @@ private:
     QLineEdit *address_text_;
     bool cookie_seen_;
 
-    Account account_;
+    QString username_;
+    QString token_;
 };
 
 
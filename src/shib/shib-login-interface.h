@@ -0,0 +1,33 @@
+#ifndef SEAFILE_CLIENT_SHIB_LOGIN_INTERFACE_H
+#define SEAFILE_CLIENT_SHIB_LOGIN_INTERFACE_H
+
+#include <QtPlugin>
+#include <QString>
+#include <QUrl>
+
+class QWidget;
+
+/**
+ * The interface of the plugin that shows the Shibboleth login page in a web
+ * view. The web engine is only linked into the plugin, so it's only loaded
+ * when the user logs in with Shibboleth.
+ */
+class ShibLoginInterface {
+public:
+    virtual ~ShibLoginInterface() {}
+
+    // Shows `login_url` in a modal dialog. Returns true with the username
+    // and api token that seahub of `server_url` set in the cookie, or false
+    // if the user closed the dialog.
+    virtual bool login(const QUrl& server_url,
+                       const QUrl& login_url,
+                       QWidget *parent,
+                       QString *username,
+                       QString *token) = 0;
+};
+
+#define ShibLoginInterface_iid "com.seafile.seadrive-gui.ShibLoginInterface/1.0"
+
+Q_DECLARE_INTERFACE(ShibLoginInterface, ShibLoginInterface_iid)
+
+#endif /* SEAFILE_CLIENT_SHIB_LOGIN_INTERFACE_H */
@@ -0,0 +1,18 @@
+#include "shib-login-dialog.h"
+
+#include "shib-login-plugin.h"
+
+bool ShibLoginPlugin::login(const QUrl& server_url,
+                            const QUrl& login_url,
+                            QWidget *parent,
+                            QString *username,
+                            QString *token)
+{
+    ShibLoginDialog dialog(server_url, login_url, parent);
+    if (dialog.exec() != QDialog::Accepted) {
+        return false;
+    }
+    *username = dialog.username();
+    *token = dialog.token();
+    return true;
+}
@@ -0,0 +1,20 @@
+#ifndef SEAFILE_CLIENT_SHIB_LOGIN_PLUGIN_H
+#define SEAFILE_CLIENT_SHIB_LOGIN_PLUGIN_H
+
+#include <QObject>
+
+#include "shib-login-interface.h"
+
+class ShibLoginPlugin : public QObject, public ShibLoginInterface {
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID "com.seafile.seadrive-gui.ShibLoginInterface/1.0")
+    Q_INTERFACES(ShibLoginInterface)
+public:
+    bool login(const QUrl& server_url,
+               const QUrl& login_url,
+               QWidget *parent,
+               QString *username,
+               QString *token);
+};
+
+#endif /* SEAFILE_CLIENT_SHIB_LOGIN_PLUGIN_H */
@@ -0,0 +1,111 @@
+#include <QCoreApplication>
+#include <QDir>
+#include <QPluginLoader>
+#include <QStringList>
+
+#include "seadrive-gui.h"
+#include "account.h"
+#include "account-mgr.h"
+#include "ui/init-sync-dialog.h"
+#include "utils/utils.h"
+#include "utils/api-utils.h"
+#if defined(SEADRIVE_SHIB_PLUGIN)
+#include "shib/shib-login-interface.h"
+#else
+#include "shib/shib-login-dialog.h"
+#endif
+
+#include "shib-login.h"
+
+namespace {
+
+#if defined(SEADRIVE_SHIB_PLUGIN)
+const char *kShibPluginName = "seadrive-shib";
+
+// The plugin is looked up next to the executable (the build dir, or the mac
+// bundle), then in lib/seadrive-gui of the install prefix. Once loaded it's
+// never unloaded, since the web engine can't be shut down and started again
+// in the same process.
+ShibLoginInterface *loadShibPlugin()
+{
+    static ShibLoginInterface *plugin = nullptr;
+    if (plugin) {
+        return plugin;
+    }
+
+    QDir app_dir(QCoreApplication::applicationDirPath());
+    QStringList dirs;
+    dirs << app_dir.absolutePath()
+         << app_dir.absoluteFilePath("../lib/seadrive-gui");
+
+    for (const QString& dir : dirs) {
+        QPluginLoader *loader = new QPluginLoader(
+            QDir(dir).filePath(kShibPluginName), qApp);
+        QObject *instance = loader->instance();
+        if (!instance) {
+            qDebug("[shib] no plugin in %s: %s", toCStr(dir),
+                   toCStr(loader->errorString()));
+            delete loader;
+            continue;
+        }
+        plugin = qobject_cast<ShibLoginInterface *>(instance);
+        if (!plugin) {
+            qWarning("[shib] %s is not a shibboleth login plugin",
+                     toCStr(loader->fileName()));
+            loader->unload();
+            delete loader;
+            continue;
+        }
+        qDebug("[shib] loaded %s", toCStr(loader->fileName()));
+        return plugin;
+    }
+    return nullptr;
+}
+#endif
+
+QUrl shibLoginUrl(const QUrl& server_url, const QString& computer_name)
+{
+    QUrl url(server_url);
+    QString path = url.path();
+    if (!path.endsWith("/")) {
+        path += "/";
+    }
+    path += "shib-login";
+    url.setPath(path);
+
+    return ::includeQueryParams(
+        url, ::getSeafileLoginParams(computer_name, "shib_"));
+}
+
+} // namespace
+
+bool shibLogin(const QUrl& server_url,
+               const QString& computer_name,
+               QWidget *parent)
+{
+    QUrl login_url = shibLoginUrl(server_url, computer_name);
+    QString username, token;
+
+#if defined(SEADRIVE_SHIB_PLUGIN)
+    ShibLoginInterface *plugin = loadShibPlugin();
+    if (!plugin) {
+        gui->warningBox(QObject::tr("Failed to load the Shibboleth login module"), parent);
+        return false;
+    }
+    if (!plugin->login(server_url, login_url, parent, &username, &token)) {
+        return false;
+    }
+#else
+    ShibLoginDialog dialog(server_url, login_url, parent);
+    if (dialog.exec() != QDialog::Accepted) {
+        return false;
+    }
+    username = dialog.username();
+    token = dialog.token();
+#endif
+
+    Account account(server_url, username, token, 0, true);
+    gui->accountManager()->enableAccount(account);
+    gui->initSyncDialog()->markNewLogin();
+    return true;
+}
@@ -0,0 +1,19 @@
+#ifndef SEAFILE_CLIENT_SHIB_LOGIN_H
+#define SEAFILE_CLIENT_SHIB_LOGIN_H
+
+#include <QString>
+#include <QUrl>
+
+class QWidget;
+
+// Lets the user login the server with Shibboleth SSO, and enables the
+// account when the login succeeded. Returns false if the user cancelled it,
+// or the login page can't be shown.
+//
+// When built with SEADRIVE_SHIB_PLUGIN the web view lives in the
+// seadrive-shib plugin, which is loaded here the first time it's needed.
+bool shibLogin(const QUrl& server_url,
+               const QString& computer_name,
+               QWidget *parent = 0);
+
+#endif /* SEAFILE_CLIENT_SHIB_LOGIN_H */
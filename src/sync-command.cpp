@@ -1,17 +1,13 @@
-#include <vector>
-#include <mutex>
-#include <memory>
-
 #include <QDir>
 #include <QFileInfo>
 
 #include "account.h"
 #include "account-mgr.h"
 #include "auto-login-service.h"
+#include "link-service.h"
 #include "settings-mgr.h"
 #include "seadrive-gui.h"
 #include "rpc/rpc-client.h"
-#include "api/requests.h"
 #include "ui/sharedlink-dialog.h"
 #include "ui/seafilelink-dialog.h"
 #include "ui/uploadlink-dialog.h"
@@ -20,47 +16,27 @@
 
 #include "sync-command.h"
 
-namespace {
-struct QtLaterDeleter {
-public:
-  void operator()(QObject *ptr) {
-    ptr->deleteLater();
-  }
-};
-} // anonymous namespace
-
-static std::unique_ptr<GetSharedLinkRequest, QtLaterDeleter> get_shared_link_req_;
-static std::unique_ptr<GetUploadLinkRequest, QtLaterDeleter> get_upload_link_req_;
-static std::unique_ptr<GetSmartLinkRequest, QtLaterDeleter> get_smart_link_req_;
-
 SyncCommand::SyncCommand() {
 }
 
 SyncCommand::~SyncCommand() {
-    get_shared_link_req_.reset();
-    get_upload_link_req_.reset();
-    get_smart_link_req_.reset();
 }
 
 void SyncCommand::doShareLink(const Account &account, const QString &repo_id, const QString &path) {
-    QString encoded_path = path.toUtf8().toPercentEncoding();
-    get_shared_link_req_.reset(new GetSharedLinkRequest(
-        account, repo_id, QString("/").append(encoded_path)));
+    LinkReply *reply = LinkService::instance()->getLink(account, repo_id, path, SHARE_LINK);
 
-    connect(get_shared_link_req_.get(), SIGNAL(success(const QString &)), this,
+    connect(reply, SIGNAL(finished(const QString &)), this,
             SLOT(onShareLinkGenerated(const QString &)));
-    connect(get_shared_link_req_.get(), SIGNAL(failed(const ApiError &)), this,
+    connect(reply, SIGNAL(failed(const ApiError &)), this,
             SLOT(onShareLinkGeneratedFailed(const ApiError &)));
-
-    get_shared_link_req_->send();
 }
 
 void SyncCommand::onShareLinkGenerated(const QString &link)
 {
-    GetSharedLinkRequest *req = qobject_cast<GetSharedLinkRequest *>(sender());
-    const Account account = req->getAccount();
-    const QString repo_id = req->getRepoId();
-    const QString repo_path = req->getRepoPath();
+    LinkReply *reply = qobject_cast<LinkReply *>(sender());
+    const Account account = reply->account();
+    const QString repo_id = reply->repoId();
+    const QString repo_path = reply->path().toUtf8().toPercentEncoding("/");
 
     SharedLinkDialog *dialog = new SharedLinkDialog(link, account, repo_id, repo_path, NULL);
     dialog->setAttribute(Qt::WA_DeleteOnClose);
@@ -81,14 +57,12 @@ void SyncCommand::onShareLinkGeneratedFailed(const ApiError& error)
 
 void SyncCommand::doInternalLink(const Account &account, const QString &repo_id, const QString &path, bool is_dir)
 {
-    get_smart_link_req_.reset(new GetSmartLinkRequest(
-        account, repo_id, QString("/").append(path), is_dir));
-    connect(get_smart_link_req_.get(), SIGNAL(success(const QString&)),
+    LinkReply *reply = LinkService::instance()->getLink(
+        account, repo_id, path, INTERNAL_LINK, is_dir);
+    connect(reply, SIGNAL(finished(const QString&)),
             this, SLOT(onGetSmartLinkSuccess(const QString&)));
-    connect(get_smart_link_req_.get(), SIGNAL(failed(const ApiError&)),
+    connect(reply, SIGNAL(failed(const ApiError&)),
             this, SLOT(onGetSmartLinkFailed(const ApiError&)));
-
-    get_smart_link_req_->send();
 }
 
 void SyncCommand::onGetSmartLinkSuccess(const QString& smart_link)
@@ -120,15 +94,12 @@ void SyncCommand::doShowFileHistory(const Account &account, const QString &repo_
 
 void SyncCommand::doGetUploadLink(const Account &account, const QString &repo_id, const QString &path)
 {
-    get_upload_link_req_.reset(new GetUploadLinkRequest(
-            account, repo_id, QString("/").append(path)));
+    LinkReply *reply = LinkService::instance()->getLink(account, repo_id, path, UPLOAD_LINK);
 
-    connect(get_upload_link_req_.get(), SIGNAL(success(const QString&)), this,
+    connect(reply, SIGNAL(finished(const QString&)), this,
             SLOT(onGetUploadLinkSuccess(const QString &)));
-    connect(get_upload_link_req_.get(), SIGNAL(failed(const ApiError&)), this,
+    connect(reply, SIGNAL(failed(const ApiError&)), this,
             SLOT(onGetUploadLinkFailed(const ApiError&)));
-
-    get_upload_link_req_->send();
 }
 
 void SyncCommand::onGetUploadLinkSuccess(const QString& upload_link)
@@ -142,6 +113,7 @@ void SyncCommand::onGetUploadLinkSuccess(const QString& upload_link)
 
 void SyncCommand::onGetUploadLinkFailed(const ApiError& error)
 {
-    const QString file = ::getBaseName(get_upload_link_req_->path());
+    LinkReply *reply = qobject_cast<LinkReply *>(sender());
+    const QString file = ::getBaseName(reply->path());
     gui->messageBox(tr("Failed to get upload link for file \"%1\"").arg(file));
 }
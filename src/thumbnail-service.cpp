@@ -3,7 +3,6 @@
 #include <QHash>
 #include <QImage>
 #include <QQueue>
-#include <QTimer>
 #include <QSemaphore>
 #include <QThread>
 #include <QMutexLocker>
@@ -16,6 +15,7 @@
 #include "seadrive-gui.h"
 #include "utils/file-utils.h"
 #include "utils/utils.h"
+#include "timer-scheduler.h"
 
 #include "thumbnail-service.h"
 
@@ -27,9 +27,12 @@ const int kThumbCacheValidSecs = 600;
 // How often do we run the cache cleaner to purge expired thumb
 // caches.
 const int kThumbCacheCleanIntervalSecs = 300;
+const int kMaxThumbCacheCleanIntervalSecs = 1800;
 
 // Internal scheduling time to check if there is queued requests.
 const int kScheduleIntervalSecs = 1;
+// While idle, new requests bring the interval back to 1 second anyway.
+const int kMaxScheduleIntervalSecs = 8;
 
 class FileTimeComparator {
 public:
@@ -56,11 +59,13 @@ SINGLETON_IMPL(ThumbnailService)
 
 ThumbnailService::ThumbnailService()
 {
-    schedule_timer_ = new QTimer(this);
+    schedule_timer_ = new ScheduledTimer("thumbnail-schedule", this);
+    schedule_timer_->setMaxInterval(kMaxScheduleIntervalSecs * 1000);
     connect(schedule_timer_, SIGNAL(timeout()),
             this, SLOT(doSchedule()));
 
-    cache_clean_timer_ = new QTimer(this);
+    cache_clean_timer_ = new ScheduledTimer("thumbnail-cache-clean", this);
+    cache_clean_timer_->setMaxInterval(kMaxThumbCacheCleanIntervalSecs * 1000);
     connect(cache_clean_timer_, SIGNAL(timeout()),
             this, SLOT(doCleanCache()));
 
@@ -141,7 +146,11 @@ bool ThumbnailService::getThumbnailFromCache(const QString &repo_id,
 
 void ThumbnailService::start()
 {
+#if defined(Q_OS_WIN32)
     thumbnails_dir_ = QDir(gui->seadriveRoot()).filePath("thumbs");
+#else
+    thumbnails_dir_ = QDir(seadriveDataDir()).filePath("thumbs");
+#endif
     checkdir_with_mkdir(toCStr(thumbnails_dir_));
     schedule_timer_->start(kScheduleIntervalSecs * 1000);
     cache_clean_timer_->start(kThumbCacheCleanIntervalSecs * 1000);
@@ -169,8 +178,12 @@ bool ThumbnailService::getThumbnail(const Account &account,
 
 bool ThumbnailService::enqueueRequest(const ThumbnailRequest& request)
 {
-    QMutexLocker lock(&queue_mutex_);
-    queue_.enqueue(request);
+    {
+        QMutexLocker lock(&queue_mutex_);
+        queue_.enqueue(request);
+    }
+    // Called in the ext handler threads.
+    TimerScheduler::instance()->notifyActivity();
     return true;
 }
 
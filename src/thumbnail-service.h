@@ -12,7 +12,7 @@
 #include "utils/singleton.h"
 #include "api/requests.h"
 
-class QTimer;
+class ScheduledTimer;
 
 struct ThumbnailRequest;
 class GetThumbnailRequest;
@@ -118,8 +118,8 @@ private:
 
     ThumbnailDownloader *downloader_;
 
-    QTimer *schedule_timer_;
-    QTimer *cache_clean_timer_;
+    ScheduledTimer *schedule_timer_;
+    ScheduledTimer *cache_clean_timer_;
 
     QQueue<ThumbnailRequest> queue_;
     // The requests queue need to be protected by a mutex because new
@@ -0,0 +1,232 @@
+#include <QPointer>
+#include <QThread>
+#include <QTimer>
+
+#include "timer-scheduler.h"
+
+namespace {
+
+// Timers of at least this interval fire on whole seconds.
+const int kAlignMSecs = 1000;
+
+// A timer fires early by up to a tenth of its interval, so it can share the
+// wakeup of another timer.
+const int kSlackDivisor = 10;
+const int kMaxSlackMSecs = 10 * 1000;
+
+// The timers are stretched after this long without activity, and stretched
+// twice as much after each step.
+const qint64 kIdleAfterMSecs = 60 * 1000;
+const qint64 kStretchStepMSecs = 60 * 1000;
+const int kMaxStretch = 16;
+
+const qint64 kWakeupWindowMSecs = 60 * 1000;
+
+} // namespace
+
+ScheduledTimer::ScheduledTimer(const QString& name, QObject *parent)
+    : QObject(parent),
+      name_(name),
+      interval_(0),
+      max_interval_(0),
+      active_(false),
+      due_(0),
+      fires_(0)
+{
+    TimerScheduler::instance()->addTimer(this);
+}
+
+ScheduledTimer::~ScheduledTimer()
+{
+    TimerScheduler::instance()->removeTimer(this);
+}
+
+void ScheduledTimer::setMaxInterval(int msecs)
+{
+    max_interval_ = msecs;
+}
+
+void ScheduledTimer::setInterval(int msecs)
+{
+    interval_ = msecs;
+    if (active_) {
+        start();
+    }
+}
+
+void ScheduledTimer::start(int msecs)
+{
+    interval_ = msecs;
+    start();
+}
+
+void ScheduledTimer::start()
+{
+    active_ = true;
+    TimerScheduler::instance()->scheduleTimer(this);
+}
+
+void ScheduledTimer::stop()
+{
+    if (!active_) {
+        return;
+    }
+    active_ = false;
+    TimerScheduler::instance()->reschedule();
+}
+
+
+SINGLETON_IMPL(TimerScheduler)
+
+TimerScheduler::TimerScheduler()
+    : last_activity_(0),
+      stretch_(1)
+{
+    clock_.start();
+
+    wakeup_timer_ = new QTimer(this);
+    wakeup_timer_->setSingleShot(true);
+    connect(wakeup_timer_, SIGNAL(timeout()), this, SLOT(onWakeup()));
+}
+
+void TimerScheduler::addTimer(ScheduledTimer *timer)
+{
+    timers_.append(timer);
+}
+
+void TimerScheduler::removeTimer(ScheduledTimer *timer)
+{
+    timers_.removeOne(timer);
+    reschedule();
+}
+
+void TimerScheduler::scheduleTimer(ScheduledTimer *timer)
+{
+    timer->due_ = alignedDue(now(), effectiveInterval(timer));
+    reschedule();
+}
+
+int TimerScheduler::effectiveInterval(const ScheduledTimer *timer) const
+{
+    qint64 interval = (qint64)timer->interval_ * stretch_;
+    return (int)qMin(interval, (qint64)timer->maxInterval());
+}
+
+qint64 TimerScheduler::alignedDue(qint64 now, int interval) const
+{
+    qint64 due = now + interval;
+    if (interval < kAlignMSecs) {
+        return due;
+    }
+    // Rounded to the nearest second, so a timer woken up a bit late doesn't
+    // drift.
+    qint64 aligned = (due + kAlignMSecs / 2) / kAlignMSecs * kAlignMSecs;
+    if (aligned <= now) {
+        aligned += kAlignMSecs;
+    }
+    return aligned;
+}
+
+void TimerScheduler::reschedule()
+{
+    qint64 next = -1;
+    for (const ScheduledTimer *timer : timers_) {
+        if (timer->active_ && (next < 0 || timer->due_ < next)) {
+            next = timer->due_;
+        }
+    }
+
+    if (next < 0) {
+        wakeup_timer_->stop();
+        return;
+    }
+    wakeup_timer_->start((int)qMax<qint64>(next - now(), 0));
+}
+
+void TimerScheduler::onWakeup()
+{
+    qint64 now = this->now();
+    wakeups_.enqueue(now);
+    // Also drops the old wakeups.
+    int wakeups = wakeupsPerMinute();
+    updateStretch(now, wakeups);
+
+    QList<QPointer<ScheduledTimer> > fired;
+    for (ScheduledTimer *timer : timers_) {
+        if (!timer->active_) {
+            continue;
+        }
+        int interval = effectiveInterval(timer);
+        int slack = qMin(interval / kSlackDivisor, kMaxSlackMSecs);
+        if (timer->due_ - slack <= now) {
+            timer->due_ = alignedDue(now, interval);
+            fired.append(timer);
+        }
+    }
+
+    // The slots may stop, start or delete any timer.
+    for (const QPointer<ScheduledTimer>& timer : fired) {
+        if (timer && timer->active_) {
+            timer->fires_++;
+            emit timer->timeout();
+        }
+    }
+
+    reschedule();
+}
+
+void TimerScheduler::updateStretch(qint64 now, int wakeups)
+{
+    qint64 idle = now - last_activity_;
+    int stretch = 1;
+    if (idle >= kIdleAfterMSecs) {
+        qint64 steps = 1 + (idle - kIdleAfterMSecs) / kStretchStepMSecs;
+        stretch = steps >= 4 ? kMaxStretch : qMin(1 << (int)steps, kMaxStretch);
+    }
+
+    if (stretch != stretch_) {
+        stretch_ = stretch;
+        qDebug("[timer scheduler] idle for %lld secs, timers stretched x%d, %d wakeups in the last minute",
+               idle / 1000, stretch_, wakeups);
+    }
+}
+
+void TimerScheduler::notifyActivity()
+{
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod(this, "notifyActivity", Qt::QueuedConnection);
+        return;
+    }
+
+    qint64 now = this->now();
+    last_activity_ = now;
+    if (stretch_ == 1) {
+        return;
+    }
+
+    stretch_ = 1;
+    qDebug("[timer scheduler] activity, timers back to normal");
+
+    // Don't wait for the stretched intervals to end.
+    for (ScheduledTimer *timer : timers_) {
+        qint64 due = alignedDue(now, timer->interval_);
+        if (timer->active_ && timer->due_ > due) {
+            timer->due_ = due;
+        }
+    }
+    reschedule();
+}
+
+int TimerScheduler::wakeupsPerMinute()
+{
+    qint64 now = this->now();
+    while (!wakeups_.isEmpty() && wakeups_.head() <= now - kWakeupWindowMSecs) {
+        wakeups_.dequeue();
+    }
+    return wakeups_.size();
+}
+
+qint64 TimerScheduler::idleMSecs() const
+{
+    return now() - last_activity_;
+}
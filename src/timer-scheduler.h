@@ -0,0 +1,117 @@
+#ifndef SEADRIVE_GUI_TIMER_SCHEDULER_H
+#define SEADRIVE_GUI_TIMER_SCHEDULER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QQueue>
+#include <QString>
+
+#include "utils/singleton.h"
+
+class QTimer;
+
+/**
+ * A periodic timer run by the TimerScheduler. It's used like a QTimer, but
+ * it may fire a little early or late so that it shares a wakeup with the
+ * other timers, and its interval may be stretched while the gui is idle.
+ *
+ * Must be used in the main thread.
+ */
+class ScheduledTimer : public QObject {
+    Q_OBJECT
+public:
+    // The name is shown in the stats.
+    explicit ScheduledTimer(const QString& name, QObject *parent = nullptr);
+    ~ScheduledTimer();
+
+    // While the gui is idle the interval is stretched up to `msecs`. By
+    // default the interval is never stretched.
+    void setMaxInterval(int msecs);
+
+    void setInterval(int msecs);
+    int interval() const { return interval_; }
+    int maxInterval() const { return qMax(interval_, max_interval_); }
+    bool isActive() const { return active_; }
+    const QString& name() const { return name_; }
+    quint64 fires() const { return fires_; }
+
+public slots:
+    void start(int msecs);
+    void start();
+    void stop();
+
+signals:
+    void timeout();
+
+private:
+    Q_DISABLE_COPY(ScheduledTimer)
+    friend class TimerScheduler;
+
+    const QString name_;
+    int interval_;
+    int max_interval_;
+    bool active_;
+    // In the clock of the scheduler.
+    qint64 due_;
+    quint64 fires_;
+};
+
+/**
+ * Runs all the ScheduledTimers of the gui from one QTimer.
+ *
+ * The timers are aligned to whole seconds, and a timer that is almost due
+ * fires with the ones that are, so the gui wakes up once for all of them.
+ *
+ * When nothing has happened for a minute, e.g. no notification from the
+ * daemon and no sync running, the intervals of the stretchable timers are
+ * doubled, and doubled again every minute up to their max intervals. The
+ * first activity brings them back to normal at once.
+ */
+class TimerScheduler : public QObject {
+    SINGLETON_DEFINE(TimerScheduler)
+    Q_OBJECT
+public:
+    TimerScheduler();
+
+    // The number of wakeups in the last minute.
+    int wakeupsPerMinute();
+    qint64 idleMSecs() const;
+    int stretchFactor() const { return stretch_; }
+
+    const QList<ScheduledTimer *>& timers() const { return timers_; }
+    int effectiveInterval(const ScheduledTimer *timer) const;
+
+public slots:
+    // Something has changed, e.g. a notification was received. Can be
+    // called from any thread.
+    void notifyActivity();
+
+private slots:
+    void onWakeup();
+
+private:
+    Q_DISABLE_COPY(TimerScheduler)
+    friend class ScheduledTimer;
+
+    void addTimer(ScheduledTimer *timer);
+    void removeTimer(ScheduledTimer *timer);
+    void scheduleTimer(ScheduledTimer *timer);
+    void reschedule();
+    void updateStretch(qint64 now, int wakeups);
+
+    qint64 now() const { return clock_.elapsed(); }
+    qint64 alignedDue(qint64 now, int interval) const;
+
+    QElapsedTimer clock_;
+    QTimer *wakeup_timer_;
+    QList<ScheduledTimer *> timers_;
+
+    qint64 last_activity_;
+    int stretch_;
+
+    // The times of the wakeups in the last minute.
+    QQueue<qint64> wakeups_;
+};
+
+#endif // SEADRIVE_GUI_TIMER_SCHEDULER_H
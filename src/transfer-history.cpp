@@ -0,0 +1,367 @@
+#include <sqlite3.h>
+
+#include <QDateTime>
+#include <QDir>
+#include <QScopedPointer>
+
+#include "rpc/rpc-client.h"
+#include "rpc/transfer-progress.h"
+#include "seadrive-gui.h"
+#include "timer-scheduler.h"
+#include "utils/json-utils.h"
+#include "utils/utils.h"
+
+#include "transfer-history.h"
+
+namespace {
+
+const char *kTransferHistoryDb = "transfer-history.db";
+
+// The finished list of the daemon only keeps the last few files, so it has
+// to be sampled often enough to see each of them. For the same reason the
+// interval is never stretched.
+const int kSampleIntervalMSecs = 2000;
+
+// The sampling stops after this many samples without any transfer.
+const int kMaxIdleSamples = 3;
+
+// Records older than this are removed when the gui starts.
+const qint64 kMaxRecordAgeMSecs = 180LL * 24 * 60 * 60 * 1000;
+
+struct JsonPointerCustomDeleter {
+    static inline void cleanup(json_t *json) {
+        json_decref(json);
+    }
+};
+
+QString transferKey(int direction,
+                    const QString& server,
+                    const QString& username,
+                    const QString& path)
+{
+    return QString("%1\t%2\t%3\t%4").arg(direction).arg(server, username, path);
+}
+
+QString normalizedPath(const QString& path)
+{
+    QString p = path;
+    return p.replace('\\', '/');
+}
+
+// The smallest string greater than all the strings starting with prefix, so
+// the prefix query can be answered by a range scan of the path index.
+QByteArray prefixUpperBound(const QByteArray& prefix)
+{
+    QByteArray upper = prefix;
+    while (!upper.isEmpty() && (unsigned char)upper.at(upper.size() - 1) == 0xff) {
+        upper.chop(1);
+    }
+    if (!upper.isEmpty()) {
+        upper[upper.size() - 1] = upper.at(upper.size() - 1) + 1;
+    }
+    return upper;
+}
+
+} // namespace
+
+SINGLETON_IMPL(TransferHistory)
+
+TransferHistory::TransferHistory()
+    : db_(nullptr),
+      insert_stmt_(nullptr),
+      idle_samples_(0),
+      first_sample_(true)
+{
+    sample_timer_ = new ScheduledTimer("transfer-history", this);
+    connect(sample_timer_, SIGNAL(timeout()), this, SLOT(sample()));
+}
+
+TransferHistory::~TransferHistory()
+{
+    if (insert_stmt_) {
+        sqlite3_finalize(insert_stmt_);
+    }
+    if (db_) {
+        sqlite3_close(db_);
+    }
+}
+
+bool TransferHistory::start()
+{
+    QString db_path = QDir(seadriveDir()).filePath(kTransferHistoryDb);
+    if (sqlite3_open(toCStr(db_path), &db_)) {
+        const char *errmsg = sqlite3_errmsg(db_);
+        qWarning("[transfer history] failed to open %s: %s",
+                 toCStr(db_path), errmsg ? errmsg : "no error given");
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return false;
+    }
+
+    // With WAL the queries don't block the inserts, and a normal sync is
+    // enough since losing the last records on a power failure is fine.
+    sqlite_query_exec(db_, "PRAGMA journal_mode=WAL;");
+    sqlite_query_exec(db_, "PRAGMA synchronous=NORMAL;");
+
+    if (!createTables()) {
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return false;
+    }
+
+    insert_stmt_ = sqlite_query_prepare(
+        db_, "INSERT INTO TransferHistory (ts, direction, server, username, "
+        "path, bytes, duration) VALUES (?, ?, ?, ?, ?, ?, ?)");
+    if (!insert_stmt_) {
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return false;
+    }
+
+    removeExpiredRecords();
+
+    // The first samples find the transfers that are already running.
+    sample_timer_->start(kSampleIntervalMSecs);
+    return true;
+}
+
+void TransferHistory::notifyTransfers()
+{
+    if (!db_) {
+        return;
+    }
+    idle_samples_ = 0;
+    if (!sample_timer_->isActive()) {
+        sample_timer_->start(kSampleIntervalMSecs);
+    }
+}
+
+bool TransferHistory::createTables()
+{
+    const char *sql = "CREATE TABLE IF NOT EXISTS TransferHistory ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "ts INTEGER NOT NULL, direction INTEGER NOT NULL, "
+        "server TEXT, username TEXT, path TEXT NOT NULL, "
+        "bytes INTEGER, duration INTEGER)";
+    if (sqlite_query_exec(db_, sql) < 0) {
+        qWarning("[transfer history] failed to create the history table");
+        return false;
+    }
+
+    sql = "CREATE INDEX IF NOT EXISTS TransferHistoryTsIndex "
+        "ON TransferHistory (ts)";
+    if (sqlite_query_exec(db_, sql) < 0) {
+        return false;
+    }
+
+    sql = "CREATE INDEX IF NOT EXISTS TransferHistoryPathIndex "
+        "ON TransferHistory (path, ts)";
+    if (sqlite_query_exec(db_, sql) < 0) {
+        return false;
+    }
+
+    return true;
+}
+
+void TransferHistory::removeExpiredRecords()
+{
+    qint64 expire = QDateTime::currentMSecsSinceEpoch() - kMaxRecordAgeMSecs;
+    char *sql = sqlite3_mprintf(
+        "DELETE FROM TransferHistory WHERE ts < %lld", expire);
+    sqlite_query_exec(db_, sql);
+    sqlite3_free(sql);
+}
+
+void TransferHistory::sample()
+{
+    json_t *upload_reply, *download_reply;
+
+    if (!gui->rpcClient()->isConnected()) {
+        return;
+    }
+    if (!gui->rpcClient()->getUploadProgress(&upload_reply)) {
+        return;
+    }
+    QScopedPointer<json_t, JsonPointerCustomDeleter> upload(upload_reply);
+    if (!gui->rpcClient()->getDownloadProgress(&download_reply)) {
+        return;
+    }
+    QScopedPointer<json_t, JsonPointerCustomDeleter> download(download_reply);
+
+    TransferProgress progress =
+        TransferProgress::fromJSON(upload.data(), download.data());
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    QSet<QString> in_progress;
+    for (int direction = TransferRecord::UPLOAD;
+         direction <= TransferRecord::DOWNLOAD; direction++) {
+        const QList<TransferringInfo>& files = direction == TransferRecord::UPLOAD
+            ? progress.uploading_files : progress.downloading_files;
+        for (const TransferringInfo& info : files) {
+            QString key = transferKey(direction, info.server, info.username,
+                                      normalizedPath(info.file_path));
+            in_progress.insert(key);
+            auto it = transferring_.find(key);
+            if (it == transferring_.end()) {
+                Transferring transferring;
+                transferring.first_seen_msecs = now;
+                transferring.bytes = info.total_bytes;
+                transferring_.insert(key, transferring);
+            } else {
+                it->bytes = info.total_bytes;
+            }
+        }
+    }
+
+    QList<TransferRecord> records;
+    QSet<QString> finished;
+    for (int direction = TransferRecord::UPLOAD;
+         direction <= TransferRecord::DOWNLOAD; direction++) {
+        const QList<TransferredInfo>& files = direction == TransferRecord::UPLOAD
+            ? progress.uploaded_files : progress.downloaded_files;
+        for (const TransferredInfo& info : files) {
+            QString path = normalizedPath(info.file_path);
+            QString key = transferKey(direction, info.server, info.username, path);
+            finished.insert(key);
+            // The files already finished when the gui started may have been
+            // recorded by the last run.
+            if (first_sample_ || finished_.contains(key)) {
+                continue;
+            }
+
+            TransferRecord record;
+            record.ts = now;
+            record.direction = static_cast<TransferRecord::Direction>(direction);
+            record.server = info.server;
+            record.username = info.username;
+            record.path = path;
+            record.bytes = -1;
+            record.duration_msecs = -1;
+            auto it = transferring_.find(key);
+            if (it != transferring_.end()) {
+                record.bytes = it->bytes;
+                record.duration_msecs = now - it->first_seen_msecs;
+                transferring_.erase(it);
+            }
+            records.append(record);
+        }
+    }
+    finished_ = finished;
+    first_sample_ = false;
+
+    // Forget the files that are neither in progress nor finished, e.g.
+    // canceled ones.
+    for (auto it = transferring_.begin(); it != transferring_.end();) {
+        if (in_progress.contains(it.key())) {
+            ++it;
+        } else {
+            it = transferring_.erase(it);
+        }
+    }
+
+    insertRecords(records);
+
+    if (in_progress.isEmpty() && records.isEmpty()) {
+        // The files finished while the sampling is stopped are still
+        // recorded by the next sample, as long as they are in the list.
+        if (++idle_samples_ >= kMaxIdleSamples) {
+            sample_timer_->stop();
+        }
+    } else {
+        idle_samples_ = 0;
+    }
+}
+
+// All the records of a sample are inserted in one transaction.
+void TransferHistory::insertRecords(const QList<TransferRecord>& records)
+{
+    if (!db_ || records.isEmpty()) {
+        return;
+    }
+
+    sqlite_query_exec(db_, "BEGIN TRANSACTION;");
+    for (const TransferRecord& record : records) {
+        QByteArray server = record.server.toUtf8();
+        QByteArray username = record.username.toUtf8();
+        QByteArray path = record.path.toUtf8();
+
+        sqlite3_reset(insert_stmt_);
+        sqlite3_bind_int64(insert_stmt_, 1, record.ts);
+        sqlite3_bind_int(insert_stmt_, 2, record.direction);
+        sqlite3_bind_text(insert_stmt_, 3, server.constData(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(insert_stmt_, 4, username.constData(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(insert_stmt_, 5, path.constData(), -1, SQLITE_TRANSIENT);
+        if (record.bytes >= 0) {
+            sqlite3_bind_int64(insert_stmt_, 6, record.bytes);
+            sqlite3_bind_int64(insert_stmt_, 7, record.duration_msecs);
+        } else {
+            sqlite3_bind_null(insert_stmt_, 6);
+            sqlite3_bind_null(insert_stmt_, 7);
+        }
+        if (sqlite3_step(insert_stmt_) != SQLITE_DONE) {
+            qWarning("[transfer history] failed to record %s: %s",
+                     toCStr(record.path), sqlite3_errmsg(db_));
+        }
+    }
+    sqlite_query_exec(db_, "COMMIT;");
+}
+
+QList<TransferRecord> TransferHistory::query(qint64 from_msecs,
+                                             qint64 to_msecs,
+                                             const QString& path_prefix,
+                                             int max_count)
+{
+    QList<TransferRecord> records;
+    if (!db_) {
+        return records;
+    }
+
+    QByteArray prefix = normalizedPath(path_prefix).toUtf8();
+    QByteArray upper = prefixUpperBound(prefix);
+
+    QString sql = "SELECT ts, direction, server, username, path, bytes, duration "
+        "FROM TransferHistory WHERE ts >= ? AND ts < ?";
+    if (!prefix.isEmpty()) {
+        sql += " AND path >= ?";
+        if (!upper.isEmpty()) {
+            sql += " AND path < ?";
+        }
+    }
+    sql += " ORDER BY ts DESC LIMIT ?";
+
+    sqlite3_stmt *stmt = sqlite_query_prepare(db_, toCStr(sql));
+    if (!stmt) {
+        return records;
+    }
+
+    int i = 1;
+    sqlite3_bind_int64(stmt, i++, from_msecs);
+    sqlite3_bind_int64(stmt, i++, to_msecs);
+    if (!prefix.isEmpty()) {
+        sqlite3_bind_text(stmt, i++, prefix.constData(), prefix.size(), SQLITE_TRANSIENT);
+        if (!upper.isEmpty()) {
+            sqlite3_bind_text(stmt, i++, upper.constData(), upper.size(), SQLITE_TRANSIENT);
+        }
+    }
+    sqlite3_bind_int(stmt, i++, max_count);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        TransferRecord record;
+        record.ts = sqlite3_column_int64(stmt, 0);
+        record.direction = static_cast<TransferRecord::Direction>(
+            sqlite3_column_int(stmt, 1));
+        record.server = QString::fromUtf8((const char *)sqlite3_column_text(stmt, 2));
+        record.username = QString::fromUtf8((const char *)sqlite3_column_text(stmt, 3));
+        record.path = QString::fromUtf8((const char *)sqlite3_column_text(stmt, 4));
+        if (sqlite3_column_type(stmt, 5) == SQLITE_NULL) {
+            record.bytes = record.duration_msecs = -1;
+        } else {
+            record.bytes = sqlite3_column_int64(stmt, 5);
+            record.duration_msecs = sqlite3_column_int64(stmt, 6);
+        }
+        records.append(record);
+    }
+    sqlite3_finalize(stmt);
+
+    return records;
+}
@@ -0,0 +1,99 @@
+#ifndef SEADRIVE_GUI_TRANSFER_HISTORY_H
+#define SEADRIVE_GUI_TRANSFER_HISTORY_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+#include "utils/singleton.h"
+
+struct sqlite3;
+struct sqlite3_stmt;
+class ScheduledTimer;
+
+struct TransferRecord {
+    enum Direction {
+        UPLOAD = 0,
+        DOWNLOAD,
+    };
+
+    // When the transfer finished, in msecs since epoch.
+    qint64 ts;
+    Direction direction;
+    QString server;
+    QString username;
+    // Path of the file in the drive, e.g. "My Libraries/repo/a.txt".
+    QString path;
+    // -1 when unknown, e.g. the file finished before it was seen in progress.
+    qint64 bytes;
+    qint64 duration_msecs;
+};
+
+/**
+ * Keeps a log of the finished transfers on disk, so we can tell what was
+ * synced when after the daemon has forgotten about it.
+ *
+ * The daemon only reports the files being transferred and a short list of
+ * the last finished ones, so the history samples both lists, and records a
+ * file when it moves to the finished list. The size and duration come from
+ * the samples in which the file was still in progress.
+ *
+ * The lists are only sampled while files are transferred: the sampling is
+ * started by notifyTransfers(), and stops after a few samples in which
+ * nothing was in progress or finished.
+ *
+ * The records are kept in a sqlite database in WAL mode, indexed by time
+ * and path, so the time range and path prefix queries stay fast with
+ * millions of records.
+ */
+class TransferHistory : public QObject {
+    SINGLETON_DEFINE(TransferHistory)
+    Q_OBJECT
+public:
+    TransferHistory();
+    ~TransferHistory();
+
+    bool start();
+
+    // Returns the records finished in [from, to), the latest first. An empty
+    // prefix matches every path. At most max_count records are returned.
+    QList<TransferRecord> query(qint64 from_msecs,
+                                qint64 to_msecs,
+                                const QString& path_prefix = QString(),
+                                int max_count = 1000);
+
+public slots:
+    // Files are being transferred, starts sampling if it's stopped.
+    void notifyTransfers();
+
+private slots:
+    void sample();
+
+private:
+    Q_DISABLE_COPY(TransferHistory)
+
+    struct Transferring {
+        qint64 first_seen_msecs;
+        qint64 bytes;
+    };
+
+    bool createTables();
+    void insertRecords(const QList<TransferRecord>& records);
+    void removeExpiredRecords();
+
+    sqlite3 *db_;
+    sqlite3_stmt *insert_stmt_;
+
+    ScheduledTimer *sample_timer_;
+    // The samples in a row in which nothing was transferred.
+    int idle_samples_;
+    // Keyed by the direction, server, username and path of the file.
+    QHash<QString, Transferring> transferring_;
+    // The finished lists of the last sample.
+    QSet<QString> finished_;
+    bool first_sample_;
+};
+
+#endif // SEADRIVE_GUI_TRANSFER_HISTORY_H
@@ -0,0 +1,67 @@
+#include <QEvent>
+#include <QTimer>
+#include <QWidget>
+
+#include "dialog-releaser.h"
+
+namespace {
+
+const int kReleaseDelayMSecs = 5 * 60 * 1000;
+
+bool hasVisibleWindow(const QWidget *widget)
+{
+    if (widget->isVisible()) {
+        return true;
+    }
+    // e.g. the login dialog opened from the settings dialog.
+    for (const QWidget *child : widget->findChildren<QWidget *>()) {
+        if (child->isWindow() && child->isVisible()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+void DialogReleaser::watch(QWidget *dialog)
+{
+    // Deleted with the dialog.
+    new DialogReleaser(dialog);
+}
+
+DialogReleaser::DialogReleaser(QWidget *dialog)
+    : QObject(dialog),
+      dialog_(dialog)
+{
+    release_timer_ = new QTimer(this);
+    release_timer_->setSingleShot(true);
+    release_timer_->setInterval(kReleaseDelayMSecs);
+    connect(release_timer_, SIGNAL(timeout()), this, SLOT(onTimeout()));
+
+    dialog_->installEventFilter(this);
+    if (!dialog_->isVisible()) {
+        release_timer_->start();
+    }
+}
+
+bool DialogReleaser::eventFilter(QObject *obj, QEvent *event)
+{
+    if (obj == dialog_) {
+        if (event->type() == QEvent::Show) {
+            release_timer_->stop();
+        } else if (event->type() == QEvent::Hide) {
+            release_timer_->start();
+        }
+    }
+    return QObject::eventFilter(obj, event);
+}
+
+void DialogReleaser::onTimeout()
+{
+    if (hasVisibleWindow(dialog_)) {
+        release_timer_->start();
+        return;
+    }
+    dialog_->deleteLater();
+}
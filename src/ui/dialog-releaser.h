@@ -0,0 +1,38 @@
+#ifndef SEADRIVE_GUI_DIALOG_RELEASER_H
+#define SEADRIVE_GUI_DIALOG_RELEASER_H
+
+#include <QObject>
+
+class QTimer;
+class QWidget;
+
+/**
+ * Deletes a dialog that has been hidden for a while.
+ *
+ * The dialogs opened from the tray menu are rarely used, so they are created
+ * when first shown and released once the user is done with them. The owner
+ * keeps the dialog in a QPointer and creates it again the next time.
+ *
+ * The dialog is kept while it, or a window opened on top of it, is visible.
+ */
+class DialogReleaser : public QObject {
+    Q_OBJECT
+public:
+    static void watch(QWidget *dialog);
+
+protected:
+    bool eventFilter(QObject *obj, QEvent *event);
+
+private slots:
+    void onTimeout();
+
+private:
+    Q_DISABLE_COPY(DialogReleaser)
+
+    explicit DialogReleaser(QWidget *dialog);
+
+    QWidget *dialog_;
+    QTimer *release_timer_;
+};
+
+#endif // SEADRIVE_GUI_DIALOG_RELEASER_H
@@ -5,11 +5,9 @@
 #include <QMenu>
 #include <QAction>
 #include <QInputDialog>
-#include <QTimer>
 
 #include "encrypted-repos-dialog.h"
 
-#include "utils/json-utils.h"
 #include "utils/utils.h"
 #include "rpc/rpc-client.h"
 #include "seadrive-gui.h"
@@ -44,34 +42,9 @@ const int kDefaultColumnSum = kRepoNameColumnWidth +
                               kRepoUsernameColumnWidth +
                               kRepoStatus;
 
-const int kUpdateErrorsIntervalMsecs = 3000;
-
 } //namespace
 
 
-EncryptedRepoInfo EncryptedRepoInfo::fromJSON(const json_t *root) {
-
-    EncryptedRepoInfo enc_repo_info;
-    Json json(root);
-
-    enc_repo_info.repo_id = json.getString("repo_id");
-    enc_repo_info.repo_name = json.getString("repo_display_name");
-    enc_repo_info.repo_server = json.getString("server");
-    enc_repo_info.repo_username = json.getString("username");
-    enc_repo_info.is_password_set  = json.getBool("is_passwd_set");
-    return enc_repo_info;
-}
-
-QList<EncryptedRepoInfo> EncryptedRepoInfo::listFromJSON(const json_t *json) {
-    QList<EncryptedRepoInfo> enc_repo_infos;
-    for (size_t i = 0; i < json_array_size(json); i++) {
-        EncryptedRepoInfo enc_repo_info = fromJSON(json_array_get(json, i));
-        enc_repo_infos.push_back(enc_repo_info);
-    }
-    return enc_repo_infos;
-}
-
-
 EncryptedReposDialog::EncryptedReposDialog(QWidget *parent) : QDialog(parent)
 {
 
@@ -94,11 +67,6 @@ EncryptedReposDialog::EncryptedReposDialog(QWidget *parent) : QDialog(parent)
     connect(table_, SIGNAL(sigClearEncEncRepoPassword(const QString&)),
             model_, SLOT(slotClearEncRepoPassword(const QString&)));
 
-    connect(table_, SIGNAL(sigSetEncRepoPassword(const QString&, const QString&)),
-            model_, SLOT(updateEncryptRepoList()));
-    connect(table_, SIGNAL(sigClearEncEncRepoPassword(const QString&)),
-            model_, SLOT(updateEncryptRepoList()));
-
     QWidget *widget =  new QWidget(this);
     widget->setObjectName("encryptRepoWidget");
 
@@ -123,6 +91,10 @@ EncryptedReposDialog::EncryptedReposDialog(QWidget *parent) : QDialog(parent)
 
     onModelReset();
     connect(model_, SIGNAL(modelReset()), this, SLOT(onModelReset()));
+    connect(model_, SIGNAL(rowsInserted(const QModelIndex&, int, int)),
+            this, SLOT(onModelReset()));
+    connect(model_, SIGNAL(rowsRemoved(const QModelIndex&, int, int)),
+            this, SLOT(onModelReset()));
 }
 
 void EncryptedReposDialog::createEmptyView()
@@ -150,13 +122,12 @@ void EncryptedReposDialog::onModelReset()
 
 void EncryptedReposDialog::showEvent(QShowEvent *event)
 {
-    model_->getUpdateTimer()->start();
-    model_->updateEncryptRepoList();
+    EncryptedReposSource::instance()->addWatcher();
 }
 
 void EncryptedReposDialog::hideEvent(QHideEvent *event)
 {
-    model_->getUpdateTimer()->stop();
+    EncryptedReposSource::instance()->removeWatcher();
 }
 
 
@@ -253,44 +224,38 @@ EncryptedReposTableModel::EncryptedReposTableModel(QObject *parent)
           repo_username_column_width_(kRepoUsernameColumnWidth),
           repo_status_column_width_(kRepoStatus)
 {
-    update_timer_ = new QTimer(this);
-    connect(update_timer_, SIGNAL(timeout()), this, SLOT(updateEncryptRepoList()));
-    update_timer_->start(kUpdateErrorsIntervalMsecs);
+    rpc_client_ = gui->rpcClient();
 
-    updateEncryptRepoList();
+    // Starts from the last known list, the changes since then come as row
+    // updates once the dialog is shown.
+    EncryptedReposSource *source = EncryptedReposSource::instance();
+    enc_repo_infos_ = source->repos();
+    connect(source, &EncryptedReposSource::repoInserted,
+            this, &EncryptedReposTableModel::onRepoInserted);
+    connect(source, &EncryptedReposSource::repoRemoved,
+            this, &EncryptedReposTableModel::onRepoRemoved);
+    connect(source, &EncryptedReposSource::repoUpdated,
+            this, &EncryptedReposTableModel::onRepoUpdated);
+}
 
+void EncryptedReposTableModel::onRepoInserted(int row, const EncryptedRepoInfo& info)
+{
+    beginInsertRows(QModelIndex(), row, row);
+    enc_repo_infos_.insert(row, info);
+    endInsertRows();
 }
 
-void EncryptedReposTableModel::updateEncryptRepoList()
+void EncryptedReposTableModel::onRepoRemoved(int row)
 {
-    rpc_client_ = gui->rpcClient();
-    if (!rpc_client_->isConnected()) {
-        return;
-    }
-    json_t *ret;
-    if (!rpc_client_->getEncryptedRepoList(&ret)) {
-       qWarning("failed to get encrypt library list");
-       return;
-     }
-    QList<EncryptedRepoInfo> enc_repo_infos = EncryptedRepoInfo::listFromJSON(ret);
-    json_decref(ret);
-
-    if (enc_repo_infos_.size() != enc_repo_infos.size()) {
-        beginResetModel();
-        enc_repo_infos_ = enc_repo_infos;
-        endResetModel();
-        return;
-    }
+    beginRemoveRows(QModelIndex(), row, row);
+    enc_repo_infos_.removeAt(row);
+    endRemoveRows();
+}
 
-    for (int i = 0, n = enc_repo_infos.size(); i < n; i++) {
-        if (enc_repo_infos_[i] == enc_repo_infos[i]) {
-            continue;
-        }
-        enc_repo_infos_[i] = enc_repo_infos[i];
-        QModelIndex start = index(i, 0);
-        QModelIndex stop = index(i, MAX_COLUMN - 1);
-        emit dataChanged(start, stop);
-    }
+void EncryptedReposTableModel::onRepoUpdated(int row, const EncryptedRepoInfo& info)
+{
+    enc_repo_infos_[row] = info;
+    emit dataChanged(index(row, 0), index(row, MAX_COLUMN - 1));
 }
 
 void EncryptedReposTableModel::slotSetEncRepoPassword(const QString& repo_id, const QString& password)
@@ -303,6 +268,8 @@ void EncryptedReposTableModel::slotSetEncRepoPassword(const QString& repo_id, co
             gui->messageBox(tr("Password error"));
         }
     }
+    EncryptedReposSource::instance()->invalidate();
+    EncryptedReposSource::instance()->refresh();
 }
 
 void EncryptedReposTableModel::slotClearEncRepoPassword(const QString& repo_id)
@@ -310,6 +277,8 @@ void EncryptedReposTableModel::slotClearEncRepoPassword(const QString& repo_id)
     if (!rpc_client_->clearEncryptedRepoPassword(repo_id)) {
         gui->messageBox(tr("Failed to clear encrypted library password"));
     }
+    EncryptedReposSource::instance()->invalidate();
+    EncryptedReposSource::instance()->refresh();
 }
 
 int EncryptedReposTableModel::rowCount(const QModelIndex& parent) const
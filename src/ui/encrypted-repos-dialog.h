@@ -1,31 +1,12 @@
 #ifndef SEAFILE_ENCRYPT_LIBRARY_DIALOG_H
 #define SEAFILE_ENCRYPT_LIBRARY_DIALOG_H
 
-#include <jansson.h>
-
 #include <QDialog>
 #include <QTableView>
 #include <QStackedWidget>
 #include <QHeaderView>
 
-class EncryptedRepoInfo {
-
-public:
-    QString repo_id;
-    QString repo_name;
-    QString repo_server;
-    QString repo_username;
-    bool is_password_set;
-
-    bool operator==(const EncryptedRepoInfo& info) const {
-        return repo_id == info.repo_id && repo_name == info.repo_name && is_password_set == info.is_password_set;
-    }
-
-    static  EncryptedRepoInfo fromJSON(const json_t *root);
-    static QList<EncryptedRepoInfo> listFromJSON(const json_t *json);
-
-};
-
+#include "encrypted-repos-source.h"
 
 class EncryptedReposTableView;
 class EncryptedReposTableModel;
@@ -93,16 +74,18 @@ public:
     EncryptedRepoInfo encRepoInfoAt(int i) const { return  enc_repo_infos_[i]; }
 
     void onResize(const QSize& size);
-    QTimer* getUpdateTimer() { return update_timer_; }
 
 public slots:
-    void updateEncryptRepoList();
     void slotSetEncRepoPassword(const QString& repo_id, const QString& password);
     void slotClearEncRepoPassword(const QString& repo_id);
 
+private slots:
+    void onRepoInserted(int row, const EncryptedRepoInfo& info);
+    void onRepoRemoved(int row);
+    void onRepoUpdated(int row, const EncryptedRepoInfo& info);
+
 private:
 
-    QTimer* update_timer_;
     QList<EncryptedRepoInfo> enc_repo_infos_;
     SeafileRpcClient *rpc_client_;
     int repo_name_column_width_;
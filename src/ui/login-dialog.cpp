@@ -15,7 +15,7 @@
 #include "login-dialog.h"
 #include "init-sync-dialog.h"
 #include "utils/utils.h"
-#include "shib/shib-login-dialog.h"
+#include "shib/shib-login.h"
 
 namespace {
 
@@ -386,8 +386,7 @@ void LoginDialog::loginWithShib()
 
     gui->settingsManager()->setLastShibUrl(server_addr);
 
-    ShibLoginDialog shib_dialog(url, mComputerName->text(), this);
-    if (shib_dialog.exec() == QDialog::Accepted) {
+    if (shibLogin(url, mComputerName->text(), this)) {
         accept();
     }
 }
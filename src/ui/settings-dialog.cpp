@@ -1,5 +1,7 @@
 #include <QtGlobal>
 
+#include <algorithm>
+
 #include <QtWidgets>
 #include <QDebug>
 #include <QSettings>
@@ -13,6 +15,7 @@
 #include "api/requests.h"
 #include "settings-dialog.h"
 #include "rpc/rpc-client.h"
+#include "cache-analyzer.h"
 #if defined(_MSC_VER)
 #include "utils/registry.h"
 #endif
@@ -21,6 +24,9 @@ namespace {
 
 const char *kSettingsGroupForSettingsDialog = "SettingsDialog";
 
+// Libraries listed in the tooltip of the cache usage.
+const int kMaxCacheUsageRepos = 5;
+
 } // namespace
 
 SettingsDialog::SettingsDialog(QWidget *parent) : QDialog(parent),
@@ -74,6 +80,12 @@ SettingsDialog::SettingsDialog(QWidget *parent) : QDialog(parent),
     mUploadSpinBox->setAttribute(Qt::WA_MacShowFocusRect, 0);
 #endif
 
+    // Shown below the cache size limit.
+    mCacheUsageLabel = new QLabel(this);
+    formLayout_3->insertRow(2, tr("Cache usage:"), mCacheUsageLabel);
+    connect(CacheAnalyzer::instance(), SIGNAL(reportUpdated()),
+            this, SLOT(updateCacheUsage()));
+
     connect(mSelectBtn, SIGNAL(clicked()), this, SLOT(selectDirAction()));
     connect(mOkBtn, SIGNAL(clicked()), this, SLOT(onOkBtnClicked()));
     adjustSize();
@@ -226,6 +238,7 @@ void SettingsDialog::showEvent(QShowEvent *event)
         mCacheCleanInterval->setValue(value);
         value = mgr->getCacheSizeLimitGB();
         mCacheSizeLimit->setValue(value);
+        updateCacheUsage();
 
         value = mgr->deleteConfirmThreshold();
         mDeleteConfirmSpinBox->setValue(value);
@@ -262,6 +275,55 @@ void SettingsDialog::showEvent(QShowEvent *event)
     QDialog::showEvent(event);
 }
 
+void SettingsDialog::updateCacheUsage()
+{
+    QSharedPointer<const CacheReport> report = CacheAnalyzer::instance()->report();
+    if (!report) {
+        mCacheUsageLabel->setText(tr("Not calculated yet"));
+        mCacheUsageLabel->setToolTip(QString());
+        return;
+    }
+
+    mCacheUsageLabel->setText(tr("%1 in %2 files")
+                              .arg(readableFileSize(report->total.bytes))
+                              .arg(report->total.files));
+
+    QStringList lines;
+    if (report->accounts.size() > 1) {
+        for (auto it = report->accounts.begin(); it != report->accounts.end(); ++it) {
+            lines << QString("%1: %2").arg(it.key(), readableFileSize(it->bytes));
+        }
+    }
+
+    QList<RepoCacheUsage> repos = report->repos.values();
+    std::sort(repos.begin(), repos.end(),
+              [](const RepoCacheUsage& a, const RepoCacheUsage& b) {
+                  return a.usage.bytes > b.usage.bytes;
+              });
+    for (int i = 0; i < repos.size() && i < kMaxCacheUsageRepos; i++) {
+        QString name;
+        if (!gui->rpcClient()->getRepoUnameById(repos[i].repo_id, &name)) {
+            name = repos[i].repo_id;
+        }
+        lines << QString("%1: %2").arg(name, readableFileSize(repos[i].usage.bytes));
+    }
+
+    if (report->evicted_files > 0) {
+        lines << tr("%1 cold files (%2) were removed from the cache")
+            .arg(report->evicted_files)
+            .arg(readableFileSize(report->evicted_bytes));
+    } else if (!report->candidates.isEmpty()) {
+        qint64 bytes = 0;
+        for (const CacheEvictionCandidate& candidate : report->candidates) {
+            bytes += candidate.size;
+        }
+        lines << tr("%1 large files (%2) were not used for a week")
+            .arg(report->candidates.size())
+            .arg(readableFileSize(bytes));
+    }
+    mCacheUsageLabel->setToolTip(lines.join("\n"));
+}
+
 void SettingsDialog::proxyRequirePasswordChanged(int state)
 {
     if (state == Qt::Checked) {
@@ -23,6 +23,7 @@ private slots:
 
     void proxyRequirePasswordChanged(int state);
     void showHideControlsBasedOnCurrentProxyType(int state);
+    void updateCacheUsage();
 
 private:
     bool updateProxySettings();
@@ -31,5 +32,7 @@ private:
     QString current_seadrive_root_;
     QString current_cache_dir_;
 
+    QLabel *mCacheUsageLabel;
+
     Q_DISABLE_COPY(SettingsDialog);
 };
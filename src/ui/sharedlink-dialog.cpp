@@ -6,6 +6,7 @@
 #include "account-mgr.h"
 #include "seadrive-gui.h"
 #include "api/requests.h"
+#include "link-service.h"
 
 
 SharedLinkDialog::SharedLinkDialog(const QString &link,
@@ -132,6 +133,10 @@ void SharedLinkDialog::slotGetSharedLink(const QString& link)
 {
    text_ = link;
    editor_->setText(text_);
+   LinkService::instance()->updateLink(
+       account_, repo_id_,
+       QString::fromUtf8(QByteArray::fromPercentEncoding(path_in_repo_.toUtf8())),
+       SHARE_LINK, link);
 }
 
 
@@ -1,5 +1,7 @@
 #include "transfer-progress-dialog.h"
 
+#include <algorithm>
+
 #include <QtGlobal>
 #include <QtWidgets>
 #include <QTime>
@@ -24,6 +26,16 @@ enum {
     FILE_MAX_COLUMN,
 };
 
+enum {
+    REPO_COLUMN_LIBRARY = 0,
+    REPO_COLUMN_ACCOUNT,
+    REPO_COLUMN_UPLOAD_RATE,
+    REPO_COLUMN_DOWNLOAD_RATE,
+    REPO_COLUMN_PROGRESS,
+    REPO_COLUMN_ETA,
+    REPO_MAX_COLUMN,
+};
+
 const int kNameColumnWidth = 200;
 const int kDefaultColumnWidth = 100;
 const int kDefaultColumnHeight = 40;
@@ -34,6 +46,12 @@ const int kPadding = 5;
 
 const int kRefreshProgressInterval = 1000;
 
+// Weight of the latest sample in the moving average of the rates.
+const double kRateSmoothingFactor = 0.3;
+// A library without transferring files is removed once its rates drop
+// below this.
+const double kIdleRate = 1.0;
+
 const QColor kSelectedItemBackgroundcColor("#F9E0C7");
 const QColor kItemBackgroundColor("white");
 const QColor kItemBottomBorderColor("#f3f3f3");
@@ -48,6 +66,24 @@ QString normalizedPath(const QString& file_path)
     return normalized_path.replace('\\', '/');
 }
 
+// The daemon reports the files like "<category>/<library>/<path>".
+QString libraryOfPath(const QString& file_path)
+{
+    QStringList parts = normalizedPath(file_path).split('/', Qt::SkipEmptyParts);
+    if (parts.size() >= 3) {
+        return parts[0] + "/" + parts[1];
+    }
+    return parts.isEmpty() ? QString() : parts[0];
+}
+
+QString readableDuration(qint64 secs)
+{
+    return QString("%1:%2:%3")
+        .arg(secs / 3600)
+        .arg((secs / 60) % 60, 2, 10, QChar('0'))
+        .arg(secs % 60, 2, 10, QChar('0'));
+}
+
 // Used with QScopedPointer for json_t
 struct JsonPointerCustomDeleter {
     static inline void cleanup(json_t *json) {
@@ -72,6 +108,7 @@ TransferProgressDialog::TransferProgressDialog(QWidget *parent)
     tab_widget_ = new QTabWidget;
     tab_widget_->addTab(upload_tab, tr("Upload"));
     tab_widget_->addTab(download_tab, tr("Download"));
+    tab_widget_->addTab(new RepoTransferTab, tr("Libraries"));
 
     QVBoxLayout* vlayout = new QVBoxLayout;
     vlayout->setContentsMargins(0, 0, 0, 0);
@@ -458,6 +495,272 @@ void TransferItemsTableModel::setTransferType(TransferType type)
 }
 
 
+RepoTransferTab::RepoTransferTab(QWidget *parent)
+    : QWidget(parent)
+{
+    model_ = new RepoTransferTableModel(this);
+
+    table_ = new QTableView(this);
+    table_->setModel(model_);
+    table_->verticalHeader()->hide();
+    table_->horizontalHeader()->setStretchLastSection(true);
+    table_->horizontalHeader()->setDefaultAlignment(Qt::AlignLeft | Qt::AlignVCenter);
+    table_->setSelectionMode(QAbstractItemView::NoSelection);
+    table_->setShowGrid(false);
+
+    sample_timer_ = new QTimer(this);
+    connect(sample_timer_, SIGNAL(timeout()), model_, SLOT(sample()));
+
+    QVBoxLayout* vlayout = new QVBoxLayout;
+    vlayout->addWidget(table_);
+    setLayout(vlayout);
+}
+
+void RepoTransferTab::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    model_->sample();
+    sample_timer_->start(kRefreshProgressInterval);
+}
+
+void RepoTransferTab::hideEvent(QHideEvent *event)
+{
+    QWidget::hideEvent(event);
+    sample_timer_->stop();
+    model_->resetSamples();
+}
+
+
+RepoTransferTableModel::RepoTransferTableModel(QObject *parent)
+    : QAbstractTableModel(parent),
+      last_sample_msecs_(0)
+{
+}
+
+int RepoTransferTableModel::rowCount(const QModelIndex& parent) const
+{
+    return stats_.size();
+}
+
+int RepoTransferTableModel::columnCount(const QModelIndex& parent) const
+{
+    return REPO_MAX_COLUMN;
+}
+
+void RepoTransferTableModel::resetSamples()
+{
+    last_bytes_.clear();
+    last_sample_msecs_ = 0;
+}
+
+// One call for each direction per sample, the same as the file lists.
+void RepoTransferTableModel::sample()
+{
+    json_t *upload_reply, *download_reply;
+
+    if (!gui->rpcClient()->isConnected()) {
+        return;
+    }
+    if (!gui->rpcClient()->getUploadProgress(&upload_reply)) {
+        return;
+    }
+    QScopedPointer<json_t, JsonPointerCustomDeleter> upload(upload_reply);
+    if (!gui->rpcClient()->getDownloadProgress(&download_reply)) {
+        return;
+    }
+    QScopedPointer<json_t, JsonPointerCustomDeleter> download(download_reply);
+
+    TransferProgress progress =
+        TransferProgress::fromJSON(upload.data(), download.data());
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    double elapsed_secs = last_sample_msecs_ > 0
+        ? (now - last_sample_msecs_) / 1000.0 : 0;
+
+    // The libraries seen in this sample, and the bytes they transferred
+    // since the last one.
+    QHash<QString, RepoTransferStat> current;
+    QHash<QString, quint64> uploaded, downloaded;
+    QHash<QString, FileSample> bytes;
+
+    for (int type = UPLOAD; type <= DOWNLOAD; type++) {
+        const QList<TransferringInfo>& files = type == UPLOAD
+            ? progress.uploading_files : progress.downloading_files;
+        for (const TransferringInfo& info : files) {
+            QString library = libraryOfPath(info.file_path);
+            QString key = QString("%1\t%2\t%3").arg(info.server, info.username, library);
+            RepoTransferStat& stat = current[key];
+            if (stat.library.isEmpty()) {
+                stat.library = library;
+                stat.server = info.server;
+                stat.username = info.username;
+                stat.files = 0;
+                stat.transferred_bytes = stat.total_bytes = 0;
+                stat.upload_rate = stat.download_rate = 0;
+            }
+            stat.files++;
+            stat.transferred_bytes += info.transferred_bytes;
+            stat.total_bytes += info.total_bytes;
+
+            QString file_key = QString::number(type) + "\t" + key + "\t" + info.file_path;
+            quint64 last = last_bytes_.value(file_key, FileSample{0, 0}).transferred_bytes;
+            if (info.transferred_bytes > last) {
+                (type == UPLOAD ? uploaded : downloaded)[key] +=
+                    info.transferred_bytes - last;
+            }
+            bytes.insert(file_key, FileSample{info.transferred_bytes, info.total_bytes});
+        }
+    }
+
+    // The files that completed since the last sample also transferred the
+    // rest of their bytes. The completed list has no sizes, so a file that
+    // started and completed between two samples isn't counted.
+    for (int type = UPLOAD; type <= DOWNLOAD; type++) {
+        const QList<TransferredInfo>& files = type == UPLOAD
+            ? progress.uploaded_files : progress.downloaded_files;
+        for (const TransferredInfo& info : files) {
+            QString key = QString("%1\t%2\t%3").arg(info.server, info.username,
+                                                  libraryOfPath(info.file_path));
+            QString file_key = QString::number(type) + "\t" + key + "\t" + info.file_path;
+            if (bytes.contains(file_key) || !last_bytes_.contains(file_key)) {
+                continue;
+            }
+            FileSample last = last_bytes_.value(file_key);
+            if (last.total_bytes > last.transferred_bytes) {
+                (type == UPLOAD ? uploaded : downloaded)[key] +=
+                    last.total_bytes - last.transferred_bytes;
+            }
+        }
+    }
+
+    QHash<QString, RepoTransferStat> previous;
+    for (const RepoTransferStat& stat : stats_) {
+        previous.insert(QString("%1\t%2\t%3").arg(stat.server, stat.username, stat.library), stat);
+    }
+    for (auto it = previous.constBegin(); it != previous.constEnd(); ++it) {
+        if (!current.contains(it.key())) {
+            RepoTransferStat stat = it.value();
+            stat.files = 0;
+            stat.transferred_bytes = stat.total_bytes = 0;
+            current.insert(it.key(), stat);
+        }
+    }
+
+    QList<RepoTransferStat> stats;
+    for (auto it = current.begin(); it != current.end(); ++it) {
+        RepoTransferStat& stat = it.value();
+        if (elapsed_secs > 0) {
+            double upload_rate = uploaded.value(it.key(), 0) / elapsed_secs;
+            double download_rate = downloaded.value(it.key(), 0) / elapsed_secs;
+            double last_upload = previous.contains(it.key())
+                ? previous[it.key()].upload_rate : upload_rate;
+            double last_download = previous.contains(it.key())
+                ? previous[it.key()].download_rate : download_rate;
+            stat.upload_rate = kRateSmoothingFactor * upload_rate +
+                (1 - kRateSmoothingFactor) * last_upload;
+            stat.download_rate = kRateSmoothingFactor * download_rate +
+                (1 - kRateSmoothingFactor) * last_download;
+        }
+        if (stat.files == 0 && stat.upload_rate < kIdleRate &&
+            stat.download_rate < kIdleRate) {
+            continue;
+        }
+        stats.append(stat);
+    }
+    std::sort(stats.begin(), stats.end(),
+              [](const RepoTransferStat& a, const RepoTransferStat& b) {
+                  return a.upload_rate + a.download_rate >
+                      b.upload_rate + b.download_rate;
+              });
+
+    beginResetModel();
+    stats_ = stats;
+    endResetModel();
+
+    last_bytes_ = bytes;
+    last_sample_msecs_ = now;
+}
+
+QVariant RepoTransferTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= stats_.size()) {
+        return QVariant();
+    }
+    const RepoTransferStat& stat = stats_[index.row()];
+
+    if (role == Qt::ToolTipRole) {
+        if (index.column() == REPO_COLUMN_ACCOUNT) {
+            return stat.server;
+        }
+        if (index.column() == REPO_COLUMN_PROGRESS) {
+            return tr("%1 of %2 in %3 files")
+                .arg(readableFileSize(stat.transferred_bytes))
+                .arg(readableFileSize(stat.total_bytes))
+                .arg(stat.files);
+        }
+        return QVariant();
+    }
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    switch (index.column()) {
+    case REPO_COLUMN_LIBRARY:
+        return stat.library;
+    case REPO_COLUMN_ACCOUNT: {
+        auto account = gui->accountManager()->getAccountByUrlAndUsername(
+            stat.server, stat.username);
+        return account.accountInfo.name.isEmpty() ? stat.username
+                                                  : account.accountInfo.name;
+    }
+    case REPO_COLUMN_UPLOAD_RATE:
+        return readableFileSize(stat.upload_rate) + "/s";
+    case REPO_COLUMN_DOWNLOAD_RATE:
+        return readableFileSize(stat.download_rate) + "/s";
+    case REPO_COLUMN_PROGRESS:
+        if (stat.total_bytes == 0) {
+            return QVariant();
+        }
+        return QString("%1%").arg(stat.transferred_bytes * 100 / stat.total_bytes);
+    case REPO_COLUMN_ETA: {
+        double rate = stat.upload_rate + stat.download_rate;
+        if (stat.total_bytes <= stat.transferred_bytes || rate < kIdleRate) {
+            return QVariant();
+        }
+        return readableDuration((stat.total_bytes - stat.transferred_bytes) / rate);
+    }
+    default:
+        return QVariant();
+    }
+}
+
+QVariant RepoTransferTableModel::headerData(int section,
+                                            Qt::Orientation orientation,
+                                            int role) const
+{
+    if (orientation == Qt::Vertical || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    switch (section) {
+    case REPO_COLUMN_LIBRARY:
+        return tr("Library");
+    case REPO_COLUMN_ACCOUNT:
+        return tr("Account");
+    case REPO_COLUMN_UPLOAD_RATE:
+        return tr("Upload rate");
+    case REPO_COLUMN_DOWNLOAD_RATE:
+        return tr("Download rate");
+    case REPO_COLUMN_PROGRESS:
+        return tr("Progress");
+    case REPO_COLUMN_ETA:
+        return tr("Time left");
+    default:
+        return QVariant();
+    }
+}
+
+
 TransferItemDelegate::TransferItemDelegate(QObject *parent)
    : QStyledItemDelegate(parent)
 {
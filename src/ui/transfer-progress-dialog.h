@@ -6,12 +6,14 @@
 #include <QHeaderView>
 #include <QTimer>
 #include <QTabWidget>
+#include <QHash>
 
 #include "utils/json-utils.h"
 #include "rpc/transfer-progress.h"
 
 class TransferItemsTableView;
 class TransferItemsTableModel;
+class RepoTransferTableModel;
 
 class TransferProgressDialog : public QDialog
 {
@@ -103,6 +105,81 @@ private:
 };
 
 
+/**
+ * Shows the transfer rate, progress and ETA of each library, so we can see
+ * which one is saturating the network.
+ *
+ * The daemon only reports the progress of each file, so the rates are
+ * computed from the bytes transferred between two samples, and smoothed by
+ * a moving average. The progress is only sampled while the tab is visible.
+ */
+class RepoTransferTab : public QWidget
+{
+    Q_OBJECT
+public:
+    RepoTransferTab(QWidget *parent = 0);
+
+protected:
+    void showEvent(QShowEvent *event) Q_DECL_OVERRIDE;
+    void hideEvent(QHideEvent *event) Q_DECL_OVERRIDE;
+
+private:
+    QTableView *table_;
+    RepoTransferTableModel *model_;
+    QTimer *sample_timer_;
+};
+
+
+struct RepoTransferStat {
+    QString library;
+    QString server;
+    QString username;
+
+    int files;
+    quint64 transferred_bytes;
+    quint64 total_bytes;
+
+    // Moving averages of the rates, in bytes per second.
+    double upload_rate;
+    double download_rate;
+};
+
+
+class RepoTransferTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    RepoTransferTableModel(QObject *parent = 0);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const
+        Q_DECL_OVERRIDE;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const
+        Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex& index,
+                  int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+    QVariant headerData(int section,
+                        Qt::Orientation orientation,
+                        int role) const Q_DECL_OVERRIDE;
+
+    // Forgets the last sample, e.g. when the tab is hidden for a while.
+    void resetSamples();
+
+public slots:
+    void sample();
+
+private:
+    struct FileSample {
+        quint64 transferred_bytes;
+        quint64 total_bytes;
+    };
+
+    QList<RepoTransferStat> stats_;
+    // The files being transferred in the last sample.
+    QHash<QString, FileSample> last_bytes_;
+    qint64 last_sample_msecs_;
+};
+
+
 class TransferItemDelegate : public QStyledItemDelegate {
     Q_OBJECT
 public:
@@ -21,12 +21,15 @@
 #include "src/ui/encrypted-repos-dialog.h"
 #include "src/ui/sync-errors-dialog.h"
 #include "src/ui/transfer-progress-dialog.h"
+#include "src/ui/dialog-releaser.h"
 #include "api/api-error.h"
 #include "api/requests.h"
 #include "seadrive-gui.h"
 #include "account-mgr.h"
 #include "rpc/rpc-client.h"
 #include "file-provider-mgr.h"
+#include "prefetch-mgr.h"
+#include "timer-scheduler.h"
 
 #include "tray-icon.h"
 
@@ -49,6 +52,7 @@ extern void qt_mac_set_dock_menu(QMenu *menu);
 namespace {
 
 const int kRefreshInterval = 1000;
+const int kMaxRefreshInterval = 4000;
 const int kRotateTrayIconIntervalMilli = 250;
 const int kMessageDisplayTimeMSecs = 5000;
 #if defined (Q_OS_WIN32)
@@ -72,16 +76,16 @@ SeafileTrayIcon::SeafileTrayIcon(QObject *parent)
       login_dlg_(nullptr),
       up_rate_(0),
       down_rate_(0),
-      sync_errors_dialog_(nullptr),
-      transfer_progress_dialog_(nullptr),
-      enc_repo_dialog_(nullptr),
+      sync_errors_seen_timestamp_(0),
+      account_menu_dirty_(true),
       enable_login_action_(true)
 {
     setState(STATE_DAEMON_DOWN);
     rotate_timer_ = new QTimer(this);
     connect(rotate_timer_, SIGNAL(timeout()), this, SLOT(rotateTrayIcon()));
 
-    refresh_timer_ = new QTimer(this);
+    refresh_timer_ = new ScheduledTimer("tray-refresh", this);
+    refresh_timer_->setMaxInterval(kMaxRefreshInterval);
     connect(refresh_timer_, SIGNAL(timeout()), this, SLOT(refreshTrayIcon()));
     connect(refresh_timer_, SIGNAL(timeout()), this, SLOT(refreshTrayIconToolTip()));
 #if !defined(Q_OS_LINUX)
@@ -114,10 +118,18 @@ void SeafileTrayIcon::start()
     global_sync_error_action_->setEnabled(true);
     show_sync_errors_action_->setEnabled(true);
     show_enc_repos_action_->setEnabled(true);
+    pin_folder_action_->setEnabled(true);
 
     setState(STATE_DAEMON_UP);
 
     refresh_timer_->start(kRefreshInterval);
+
+    // The account menu is only rebuilt after the accounts change.
+    connect(gui->accountManager(), SIGNAL(accountMQUpdated()),
+            this, SLOT(invalidateAccountMenu()));
+    connect(gui->accountManager(), SIGNAL(accountInfoUpdated(const Account&)),
+            this, SLOT(onAccountInfoUpdated(const Account&)));
+    invalidateAccountMenu();
 #if defined(Q_OS_MAC)
     utils::mac::set_darkmode_watcher(&darkmodeWatcher);
 #endif
@@ -134,6 +146,9 @@ void SeafileTrayIcon::createActions()
     show_enc_repos_action_ = new QAction(tr("Show encrypted libraries"), this);
     connect(show_enc_repos_action_, SIGNAL(triggered()), this, SLOT(showEncRepoDialog()));
 
+    pin_folder_action_ = new QAction(tr("Make a folder available offline..."), this);
+    connect(pin_folder_action_, SIGNAL(triggered()), this, SLOT(pinFolder()));
+
     quit_action_ = new QAction(tr("&Quit"), this);
     connect(quit_action_, SIGNAL(triggered()), this, SLOT(quitSeafile()));
 
@@ -158,6 +173,11 @@ void SeafileTrayIcon::createActions()
     open_help_action_ = new QAction(tr("&Online help"), this);
     open_help_action_->setStatusTip(tr("open %1 online help").arg(getBrand()));
     connect(open_help_action_, SIGNAL(triggered()), this, SLOT(openHelp()));
+
+    login_action_ = new QAction(tr("Add an account"), this);
+    login_action_->setIcon(getIcon(":/images/add-account.png"));
+    login_action_->setIconVisibleInMenu(true);
+    connect(login_action_, SIGNAL(triggered()), this, SLOT(showLoginDialog()));
 }
 
 void SeafileTrayIcon::createContextMenu()
@@ -167,6 +187,7 @@ void SeafileTrayIcon::createContextMenu()
     global_sync_error_action_->setEnabled(false);
     show_sync_errors_action_->setEnabled(false);
     show_enc_repos_action_->setEnabled(false);
+    pin_folder_action_->setEnabled(false);
 
     context_menu_ = new QMenu(NULL);
     context_menu_->addAction(transfer_rate_display_action_);
@@ -176,6 +197,7 @@ void SeafileTrayIcon::createContextMenu()
     context_menu_->addSeparator();
 
     context_menu_->addAction(show_enc_repos_action_);
+    context_menu_->addAction(pin_folder_action_);
     context_menu_->addSeparator();
 
     context_menu_->addAction(open_log_directory_action_);
@@ -198,7 +220,7 @@ void SeafileTrayIcon::createContextMenu()
 
 void SeafileTrayIcon::prepareContextMenu()
 {
-    auto accounts = gui->accountManager()->allAccounts();
+    TimerScheduler::instance()->notifyActivity();
 
     if (global_sync_error_.isValid()) {
         global_sync_error_action_->setVisible(true);
@@ -209,52 +231,53 @@ void SeafileTrayIcon::prepareContextMenu()
 
     show_sync_errors_action_->setVisible(true);
 
-    // Remove all menu items and recreate them.
+    if (account_menu_dirty_) {
+        rebuildAccountMenu();
+    }
+}
+
+void SeafileTrayIcon::invalidateAccountMenu()
+{
+    account_menu_dirty_ = true;
+}
+
+void SeafileTrayIcon::rebuildAccountMenu()
+{
+    auto accounts = gui->accountManager()->allAccounts();
+
+    // Remove all menu items and recreate them. clear() doesn't delete the
+    // submenus, and the login action is kept.
+    qDeleteAll(account_submenus_);
+    account_submenus_.clear();
     account_menu_->clear();
 
     if (!accounts.empty()) {
         for (size_t i = 0, n = accounts.size(); i < n; i++) {
             const Account &account = accounts[i];
-            QString text_name = account.accountInfo.name.isEmpty() ?
-                        account.username : account.accountInfo.name;
-            QString text = text_name + " (" + account.serverUrl.host() + ")";
-            if (!account.isValid()) {
-                text += ", " + tr("not logged in");
-            }
-            QMenu *submenu = new QMenu(text, account_menu_);
-            if (account.isValid()) {
-                submenu->setIcon(QIcon(":/images/account-checked.png"));
-            } else {
-                submenu->setIcon(QIcon(":/images/account-else.png"));
-            }
+            QMenu *submenu = new QMenu(account_menu_);
 
-            QAction *delete_account_action = new QAction(tr("Delete"), this);
-            delete_account_action->setIcon(QIcon(":/images/delete-account.png"));
+            QAction *delete_account_action = new QAction(tr("Delete"), submenu);
+            delete_account_action->setIcon(getIcon(":/images/delete-account.png"));
             delete_account_action->setIconVisibleInMenu(true);
-            delete_account_action->setData(QVariant::fromValue(account));
             connect(delete_account_action, SIGNAL(triggered()), this, SLOT(deleteAccount()));
             submenu->addAction(delete_account_action);
 
 #if defined(Q_OS_WIN32)
-            QAction *resync_account_action = new QAction(tr("Resync"), this);
-            resync_account_action->setIcon(QIcon(":/images/resync.png"));
+            QAction *resync_account_action = new QAction(tr("Resync"), submenu);
+            resync_account_action->setIcon(getIcon(":/images/resync.png"));
             resync_account_action->setIconVisibleInMenu(true);
-            resync_account_action->setData(QVariant::fromValue(account));
             connect(resync_account_action, SIGNAL(triggered()), this, SLOT(resyncAccount()));
             submenu->addAction(resync_account_action);
 #endif
 
+            updateAccountSubmenu(submenu, account);
+            account_submenus_.insert(account.getSignature(), submenu);
             account_menu_->addMenu(submenu);
         }
 
         account_menu_->addSeparator();
     }
 
-    login_action_ = new QAction(tr("Add an account"), this);
-    login_action_->setIcon(QIcon(":/images/add-account.png"));
-    login_action_->setIconVisibleInMenu(true);
-    login_action_->setEnabled(enable_login_action_);
-    connect(login_action_, SIGNAL(triggered()), this, SLOT(showLoginDialog()));
     account_menu_->addAction(login_action_);
 #if defined(Q_OS_WIN32)
     QVariant use_kerberos_login = gui->readPreconfigureExpandedString(kPreconfigureUseKerberosLogin, "0");
@@ -263,6 +286,42 @@ void SeafileTrayIcon::prepareContextMenu()
         account_menu_->removeAction(login_action_);
     }
 #endif
+
+    account_menu_dirty_ = false;
+}
+
+void SeafileTrayIcon::updateAccountSubmenu(QMenu *submenu, const Account& account)
+{
+    QString text_name = account.accountInfo.name.isEmpty() ?
+                account.username : account.accountInfo.name;
+    QString text = text_name + " (" + account.serverUrl.host() + ")";
+    if (!account.isValid()) {
+        text += ", " + tr("not logged in");
+    }
+    submenu->setTitle(text);
+    if (account.isValid()) {
+        submenu->setIcon(getIcon(":/images/account-checked.png"));
+    } else {
+        submenu->setIcon(getIcon(":/images/account-else.png"));
+    }
+
+    foreach (QAction *action, submenu->actions()) {
+        action->setData(QVariant::fromValue(account));
+    }
+}
+
+void SeafileTrayIcon::onAccountInfoUpdated(const Account& account)
+{
+    if (account_menu_dirty_) {
+        return;
+    }
+
+    QMenu *submenu = account_submenus_.value(account.getSignature());
+    if (submenu) {
+        updateAccountSubmenu(submenu, account);
+    } else {
+        account_menu_dirty_ = true;
+    }
 }
 
 void SeafileTrayIcon::createGlobalMenuBar()
@@ -342,6 +401,8 @@ void SeafileTrayIcon::showMessage(const QString &title,
     msg.commit_id = commit_id;
     msg.previous_commit_id = previous_commit_id;
     pending_messages_.enqueue(msg);
+    // The queue is checked by the refresh timer.
+    TimerScheduler::instance()->notifyActivity();
 #endif
 }
 
@@ -722,12 +783,7 @@ void SeafileTrayIcon::setSyncErrors(const QList<SyncError> errors)
 
 void SeafileTrayIcon::setStateWithSyncErrors()
 {
-    qint64 timestamp;
-    if(sync_errors_dialog_ != nullptr) {
-        timestamp = sync_errors_dialog_->getLastOpenSyncDialogTimestamp();
-    } else {
-        timestamp = 0;
-    }
+    qint64 timestamp = sync_errors_seen_timestamp_;
     if (global_sync_error_.isValid()) {
         setState(STATE_HAS_SYNC_ERRORS);
     } else if(!sync_errors_.isEmpty()) {
@@ -744,14 +800,18 @@ void SeafileTrayIcon::setStateWithSyncErrors()
 void SeafileTrayIcon::setLoginActionEnabled(bool enabled)
 {
     enable_login_action_ = enabled;
+    login_action_->setEnabled(enabled);
 }
 
 void SeafileTrayIcon::showSyncErrorsDialog()
 {
     gui->refreshQss();
-    if (sync_errors_dialog_ == nullptr) {
+    if (!sync_errors_dialog_) {
         sync_errors_dialog_ = new SyncErrorsDialog;
+        DialogReleaser::watch(sync_errors_dialog_);
     }
+    // Kept here, the dialog may be released after it's closed.
+    sync_errors_seen_timestamp_ = QDateTime::currentMSecsSinceEpoch() / 1000;
 
     sync_errors_dialog_->updateErrors();
     sync_errors_dialog_->show();
@@ -761,13 +821,17 @@ void SeafileTrayIcon::showSyncErrorsDialog()
 
 void SeafileTrayIcon::showTransferProgressDialog()
 {
-    if (transfer_progress_dialog_ == nullptr) {
+    if (!transfer_progress_dialog_) {
         transfer_progress_dialog_ = new TransferProgressDialog();
+        DialogReleaser::watch(transfer_progress_dialog_);
     }
 
     // A bug that changes default button styles is fixed here by
     // delaying the dialog 10ms.
-    QTimer::singleShot(10, this, [&] {
+    QTimer::singleShot(10, this, [this] {
+        if (!transfer_progress_dialog_) {
+            return;
+        }
         transfer_progress_dialog_->show();
         transfer_progress_dialog_->raise();
         transfer_progress_dialog_->activateWindow();
@@ -776,11 +840,68 @@ void SeafileTrayIcon::showTransferProgressDialog()
 
 void SeafileTrayIcon::showEncRepoDialog() {
 
-    if (enc_repo_dialog_ == nullptr) {
+    if (!enc_repo_dialog_) {
         enc_repo_dialog_ = new EncryptedReposDialog();
+        DialogReleaser::watch(enc_repo_dialog_);
     }
 
     enc_repo_dialog_->show();
     enc_repo_dialog_->raise();
     enc_repo_dialog_->activateWindow();
 }
+
+void SeafileTrayIcon::pinFolder()
+{
+    const QVector<Account> accounts = gui->accountManager()->activeAccounts();
+    QString start_dir;
+    for (const Account& account : accounts) {
+        if (!account.syncRoot.isEmpty()) {
+            start_dir = account.syncRoot;
+            break;
+        }
+    }
+    if (start_dir.isEmpty()) {
+        gui->warningBox(tr("No account is logged in"));
+        return;
+    }
+
+    QString dir = QFileDialog::getExistingDirectory(nullptr,
+                                                    tr("Choose a folder to make available offline"),
+                                                    start_dir,
+                                                    QFileDialog::ShowDirsOnly
+                                                    | QFileDialog::DontResolveSymlinks);
+    if (dir.isEmpty()) {
+        return;
+    }
+    dir = QDir::cleanPath(QDir::fromNativeSeparators(dir));
+
+    // The folder is "<sync root>/<category>/<library>[/<path in library>]".
+    for (const Account& account : accounts) {
+        if (account.syncRoot.isEmpty()) {
+            continue;
+        }
+        QString root = QDir::cleanPath(account.syncRoot) + "/";
+        if (!dir.startsWith(root)) {
+            continue;
+        }
+        QStringList parts = dir.mid(root.length()).split('/', Qt::SkipEmptyParts);
+        if (parts.size() < 2) {
+            break;
+        }
+        QString repo_uname = parts.takeFirst();
+        repo_uname += "/" + parts.takeFirst();
+
+        QString repo_id;
+        if (!gui->rpcClient()->getRepoIdByPath(account.serverUrl.url(),
+                                               account.username,
+                                               repo_uname,
+                                               &repo_id)) {
+            qWarning("failed to get the repo id for %s", toCStr(dir));
+            break;
+        }
+        PrefetchManager::instance()->pin(account, repo_id, "/" + parts.join("/"));
+        return;
+    }
+
+    gui->warningBox(tr("Please choose a library or a folder in a library"));
+}
@@ -5,6 +5,7 @@
 #include <QHash>
 #include <QQueue>
 #include <QList>
+#include <QPointer>
 
 #include "rpc/sync-error.h"
 
@@ -16,6 +17,7 @@ class Account;
 class ApiError;
 class LoginDialog;
 class TrayNotificationManager;
+class ScheduledTimer;
 class SyncErrorsDialog;
 class TransferProgressDialog;
 class EncryptedReposDialog;
@@ -93,6 +95,10 @@ private slots:
     void showSyncErrorsDialog();
     void showTransferProgressDialog();
     void showEncRepoDialog();
+    void pinFolder();
+
+    void invalidateAccountMenu();
+    void onAccountInfoUpdated(const Account& account);
 
 private:
     Q_DISABLE_COPY(SeafileTrayIcon)
@@ -101,6 +107,8 @@ private:
     void createContextMenu();
     void createGlobalMenuBar();
     void setStateWithSyncErrors();
+    void rebuildAccountMenu();
+    void updateAccountSubmenu(QMenu *submenu, const Account& account);
 
     QIcon stateToIcon(TrayState state);
     QIcon getIcon(const QString& name);
@@ -108,6 +116,9 @@ private:
     QMenu *context_menu_;
     QMenu *help_menu_;
     QMenu *account_menu_;
+    // Account signature => submenu.
+    QHash<QString, QMenu *> account_submenus_;
+    bool account_menu_dirty_;
 
     QMenu *global_menu_;
     QMenu *dock_menu_;
@@ -126,7 +137,7 @@ private:
 
 
     QTimer *rotate_timer_;
-    QTimer *refresh_timer_;
+    ScheduledTimer *refresh_timer_;
     int nth_trayicon_;
     int rotate_counter_;
     bool auto_sync_;
@@ -161,14 +172,19 @@ private:
     QAction *transfer_rate_display_action_;
     QAction *transfer_progress_action_;
     QAction *show_enc_repos_action_;
+    QAction *pin_folder_action_;
     qint64 up_rate_;
     qint64 down_rate_;
 
     QList<SyncError> sync_errors_;
     SyncError global_sync_error_;
-    SyncErrorsDialog *sync_errors_dialog_;
-    TransferProgressDialog * transfer_progress_dialog_;
-    EncryptedReposDialog *enc_repo_dialog_;
+    // When the errors dialog was last opened, in seconds.
+    qint64 sync_errors_seen_timestamp_;
+
+    // Created on first use, and released some time after being closed.
+    QPointer<SyncErrorsDialog> sync_errors_dialog_;
+    QPointer<TransferProgressDialog> transfer_progress_dialog_;
+    QPointer<EncryptedReposDialog> enc_repo_dialog_;
 
 };
 
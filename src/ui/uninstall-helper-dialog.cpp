@@ -11,6 +11,7 @@
 #include "seadrive-gui.h"
 #include "settings-mgr.h"
 #include "utils/uninstall-helpers.h"
+#include "purge-engine.h"
 #if defined(_MSC_VER)
 #include "utils/registry.h"
 #endif
@@ -19,7 +20,8 @@
 
 
 UninstallHelperDialog::UninstallHelperDialog(QWidget *parent)
-    : QDialog(parent)
+    : QDialog(parent),
+      cancelled_(false)
 {
     setupUi(this);
     setWindowIcon(QIcon(":/images/seafile.png"));
@@ -48,18 +50,90 @@ UninstallHelperDialog::UninstallHelperDialog(QWidget *parent)
             this, SLOT(onYesClicked()));
 
     connect(mNoBtn, SIGNAL(clicked()),
-            this, SLOT(doExit()));
+            this, SLOT(onNoClicked()));
+
+    purge_engine_ = new PurgeEngine(this);
+    connect(purge_engine_, SIGNAL(progress(qint64, qint64)),
+            this, SLOT(onPurgeProgress(qint64, qint64)));
+    connect(purge_engine_, SIGNAL(finished(bool)),
+            this, SLOT(onPurgeFinished(bool)));
 }
 
 void UninstallHelperDialog::onYesClicked()
 {
     mYesBtn->setEnabled(false);
     mNoBtn->setEnabled(false);
+
+    // Resuming a cancelled removal.
+    if (cancelled_) {
+        startPurge();
+        return;
+    }
+
     mText->setText(tr("Removing account information..."));
 
     RemoveSeafileDataThread *thread = new RemoveSeafileDataThread;
+    connect(thread, SIGNAL(finished()), this, SLOT(startPurge()));
+    connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
     thread->start();
-    connect(thread, SIGNAL(finished()), this, SLOT(doExit()));
+}
+
+void UninstallHelperDialog::onNoClicked()
+{
+    if (purge_engine_->isRunning()) {
+        mNoBtn->setEnabled(false);
+        cancelled_ = true;
+        purge_engine_->cancel();
+        return;
+    }
+    doExit();
+}
+
+void UninstallHelperDialog::startPurge()
+{
+    cancelled_ = false;
+    if (!purge_engine_->start(seadriveDataDir())) {
+        finishRemoval();
+        return;
+    }
+
+    mText->setText(tr("Removing cached files..."));
+    mNoBtn->setText(tr("Cancel"));
+    mNoBtn->setEnabled(true);
+}
+
+void UninstallHelperDialog::onPurgeProgress(qint64 files_removed, qint64 dirs_removed)
+{
+    Q_UNUSED(dirs_removed);
+    if (cancelled_) {
+        return;
+    }
+    mText->setText(tr("Removing cached files... %1 files removed").arg(files_removed));
+}
+
+void UninstallHelperDialog::onPurgeFinished(bool completed)
+{
+    // The entries that could not be removed are logged, and left behind as
+    // before.
+    Q_UNUSED(completed);
+
+    if (cancelled_) {
+        mText->setText(tr("Removing cached files is paused, %1 files removed.")
+                       .arg(purge_engine_->filesRemoved()));
+        mYesBtn->setText(tr("Resume"));
+        mYesBtn->setEnabled(true);
+        mNoBtn->setText(tr("Exit"));
+        mNoBtn->setEnabled(true);
+        return;
+    }
+
+    finishRemoval();
+}
+
+void UninstallHelperDialog::finishRemoval()
+{
+    SettingsManager::removeAllSettings();
+    doExit();
 }
 
 void UninstallHelperDialog::doExit()
@@ -86,21 +160,15 @@ bool UninstallHelperDialog::loadQss(const QString& path)
 }
 
 
+// The data dir is removed afterwards by the purge engine.
 void RemoveSeafileDataThread::run()
 {
-    QString seadrive_data_dir = seadriveDataDir();
-    QString seadrive_dir = seadriveDir();
-
 #ifdef Q_OS_WIN32
     do_seadrive_unregister_sync_root();
     RegElement::removeAllSyncRootManagerItem();
     RegElement::removeIconRegItem();
 
-    QDir dir(seadrive_dir);
+    QDir dir(seadriveDir());
     dir.remove("accounts.db");
 #endif
-
-    delete_dir_recursively(seadrive_data_dir);
-    SettingsManager::removeAllSettings();
-    return;
 }
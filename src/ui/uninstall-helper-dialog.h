@@ -6,6 +6,7 @@
 
 #include "ui_uninstall-helper-dialog.h"
 
+class PurgeEngine;
 
 class UninstallHelperDialog : public QDialog,
                               public Ui::UninstallHelperDialog
@@ -16,14 +17,24 @@ public:
 
 private slots:
     void onYesClicked();
+    void onNoClicked();
+    void startPurge();
+    void onPurgeProgress(qint64 files_removed, qint64 dirs_removed);
+    void onPurgeFinished(bool completed);
     void doExit();
 
 private:
     Q_DISABLE_COPY(UninstallHelperDialog)
 
     bool loadQss(const QString& path);
+    void finishRemoval();
 
     QString style_;
+
+    // Removes the data dir in its own threads, which may take long for a
+    // big cache.
+    PurgeEngine *purge_engine_;
+    bool cancelled_;
 };
 
 class RemoveSeafileDataThread : public QThread
@@ -0,0 +1,70 @@
+#include <QCoreApplication>
+#include <QDir>
+#include <QSettings>
+
+#include "utils/app-paths.h"
+
+namespace {
+
+const char *kSeafileClientBrand = "SeaDrive";
+#if defined(Q_OS_MAC)
+const char *kSeadriveConfDir = "Library/Containers/com.seafile.seadrive.fprovider/Data/Documents";
+#elif defined(Q_OS_WIN32)
+const char *kSeadriveConfDir = "seadrive";
+#else
+const char *kSeadriveConfDir = ".seadrive";
+#endif
+
+#if !defined(Q_OS_WIN32)
+const char *kSeaDriveSockName = "seadrive_client.sock";
+
+// The cache dir setting of SettingsManager.
+const char *kSettingsGroup = "Settings";
+const char *kCacheDir = "cacheDir";
+#endif
+
+} // namespace
+
+QString getBrand()
+{
+    return QString::fromUtf8(kSeafileClientBrand);
+}
+
+QString seadriveDir() {
+    return kSeadriveConfDir;
+}
+
+QString seadriveDataDir() {
+    return QDir(seadriveDir()).filePath("data");
+}
+
+void setupSettingDomain()
+{
+    // see QSettings documentation
+    QCoreApplication::setOrganizationName(getBrand());
+    QCoreApplication::setOrganizationDomain("seafile.com");
+    QString appName = getBrand();
+
+    // Special treatment to keep consistent with old versions. Otherwise the
+    // existing settings would be lost.
+    if (appName == "SeaDrive") {
+        appName = "Seafile Drive";
+    }
+    QCoreApplication::setApplicationName(QString("%1 Client").arg(appName));
+}
+
+#if !defined(Q_OS_WIN32)
+QString getAppletRpcSocketPath()
+{
+    QSettings settings;
+    settings.beginGroup(kSettingsGroup);
+    QString current_cache_dir = settings.contains(kCacheDir)
+        ? settings.value(kCacheDir).toString() : seadriveDataDir();
+    settings.endGroup();
+
+    if (QDir::isAbsolutePath(current_cache_dir)) {
+        current_cache_dir = QDir::home().relativeFilePath(current_cache_dir);
+    }
+    return QDir(current_cache_dir).filePath(kSeaDriveSockName);
+}
+#endif
@@ -0,0 +1,24 @@
+#ifndef SEAFILE_CLIENT_APP_PATHS_H_
+#define SEAFILE_CLIENT_APP_PATHS_H_
+
+#include <QString>
+
+// The brand, the config dir and the settings domain of the gui. They are
+// shared with seadrive-gui-ctl, so this file only uses QtCore.
+
+QString getBrand();
+
+QString seadriveDir();
+
+QString seadriveDataDir();
+
+// Sets the organization and application names, which QSettings uses.
+void setupSettingDomain();
+
+#if !defined(Q_OS_WIN32)
+// The applet rpc socket, relative to the home dir which is the current dir
+// of the gui. It's in the cache dir if one is set, otherwise in the data dir.
+QString getAppletRpcSocketPath();
+#endif
+
+#endif // SEAFILE_CLIENT_APP_PATHS_H_
@@ -5,11 +5,6 @@
 #if defined(Q_OS_WIN32)
 #include <windows.h>
 #include <shellapi.h>
-#else
-#include <memory>
-#include <fts.h>
-#include <errno.h>
-#include <unistd.h>
 #endif
 
 #include <glib.h>
@@ -58,87 +53,9 @@ namespace {
 const char *kPreconfigureKeepConfigWhenUninstall = "PreconfigureKeepConfigWhenUninstall";
 #endif
 
-#if !defined(Q_OS_WIN32)
-int posix_rmdir(const QString &root)
-{
-    if (!QFileInfo(root).exists()) {
-        qWarning("dir %s doesn't exists", toCStr(root));
-        return -1;
-    }
-
-    std::unique_ptr<char[]> root_ptr(strdup(toCStr(root)));
-
-    char *paths[] = {root_ptr.get(), NULL};
-
-    // Using `FTS_PHYSICAL` here because we need `FTSENT` for the
-    // symbolic link in the directory and not the target it links to.
-    FTS *tree = fts_open(paths, (FTS_NOCHDIR | FTS_PHYSICAL), NULL);
-    if (tree == NULL) {
-        qWarning("failed to fts_open: %s", strerror(errno));
-        return -1;
-    }
-
-    FTSENT *node;
-    while ((node = fts_read(tree)) != NULL) {
-        // printf ("%s: fts_info = %d\n", node->fts_path, (int)(node->fts_info));
-        switch (node->fts_info) {
-            case FTS_DP:
-                // qWarning("removing directory %s", node->fts_path);
-                if (rmdir(node->fts_path) < 0 && errno != ENOENT) {
-                    qWarning("failed to remove dir %s", node->fts_path);
-                }
-                break;
-            // `FTS_DEFAULT` would include any file type which is not
-            // explicitly described by any of the other `fts_info` values.
-            case FTS_DEFAULT:
-            case FTS_F:
-            case FTS_SL:
-            // `FTS_SLNONE` should never be the case as we don't set
-            // `FTS_COMFOLLOW` or `FTS_LOGICAL`. Adding here for completion.
-            case FTS_SLNONE:
-                // qWarning("removing file %s", node->fts_path);
-                if (unlink(node->fts_path) < 0 && errno != ENOENT) {
-                    qWarning("failed to remove file %s", node->fts_path);
-                }
-                break;
-            default:
-                break;
-        }
-    }
-
-    if (errno != 0) {
-        fts_close(tree);
-        return -1;
-    }
-
-    if (fts_close(tree) < 0) {
-        return -1;
-    }
-    return 0;
-}
-#endif
-
 } // namespace
 
 
-int delete_dir_recursively(const QString& path_in)
-{
-    qWarning ("removing folder %s\n", toCStr(path_in));
-    if (path_in.length() <= 3) {
-        // avoid errornous delete drives like C:/ D:/ E:/
-        return -1;
-    }
-
-    QDir dir (path_in);
-    bool ok = dir.removeRecursively();
-    if (!ok) {
-        qWarning("failed to removeRecursively remove directory %s",toCStr(path_in));
-        return -1 ;
-    }
-    return 0;
-
-}
-
 void do_stop_app()
 {
     SeaDriveRpcServer::Client *client = SeaDriveRpcServer::getClient();
@@ -3,9 +3,6 @@
 
 #include <QString>
 
-
-int delete_dir_recursively(const QString& path_in);
-
 /**
  * stop running seaDrive-gui by rpc
  */
@@ -16,6 +16,7 @@
 #include <QObject>
 #include <QString>
 #include <QSettings>
+#include <QFile>
 #include <QProcess>
 #include <QDesktopServices>
 #include <QHostInfo>
@@ -48,15 +49,6 @@
 
 namespace {
 
-const char *kSeafileClientBrand = "SeaDrive";
-#if defined(Q_OS_MAC)
-const char *kSeadriveConfDir = "Library/Containers/com.seafile.seadrive.fprovider/Data/Documents";
-#elif defined(Q_OS_WIN32)
-const char *kSeadriveConfDir = "seadrive";
-#else
-const char *kSeadriveConfDir = ".seadrive";
-#endif
-
 const char *kSettingsGroup = "Settings";
 
 #if defined(_MSC_VER)
@@ -110,14 +102,6 @@ bool getOpenApplicationFromXdgUtils(const QString &mime, QString *application)
 } // namespace
 
 
-QString seadriveDir() {
-    return kSeadriveConfDir;
-}
-
-QString seadriveDataDir() {
-    return QDir(seadriveDir()).filePath("data");
-}
-
 QString seadriveLogDir() {
     return QDir(seadriveDir()).filePath("logs");
 }
@@ -139,6 +123,45 @@ bool getSeadriveRoot(QString *seadrive_root)
 }
 #endif
 
+#if defined(Q_OS_LINUX)
+bool getSeadriveMountPoint(QString *mount_point)
+{
+    QFile mounts("/proc/self/mounts");
+    if (!mounts.open(QIODevice::ReadOnly)) {
+        qWarning("failed to open /proc/self/mounts");
+        return false;
+    }
+
+    // The lines are like
+    //
+    //     seadrive /home/me/SeaDrive fuse.seadrive rw,nosuid,nodev,user_id=1000,group_id=1000 0 0
+    //
+    // where the spaces in the mount point are escaped as \040.
+    QByteArray user_id = "user_id=" + QByteArray::number(getuid());
+    while (!mounts.atEnd()) {
+        QList<QByteArray> fields = mounts.readLine().split(' ');
+        if (fields.size() < 4 || fields[2] != "fuse.seadrive" ||
+            !fields[3].split(',').contains(user_id)) {
+            continue;
+        }
+
+        QByteArray escaped = fields[1];
+        QByteArray path;
+        for (int i = 0; i < escaped.size(); i++) {
+            if (escaped[i] == '\\' && i + 3 < escaped.size()) {
+                path += (char)escaped.mid(i + 1, 3).toInt(nullptr, 8);
+                i += 3;
+            } else {
+                path += escaped[i];
+            }
+        }
+        *mount_point = QFile::decodeName(path);
+        return true;
+    }
+    return false;
+}
+#endif
+
 QString defaultDownloadDir() {
     static QStringList list = QStandardPaths::standardLocations(QStandardPaths::DownloadLocation);
     if (!list.empty())
@@ -475,11 +498,6 @@ bool parse_key_value_pairs (char *string, KeyValueFunc func, void *data)
     return true;
 }
 
-QString getBrand()
-{
-    return QString::fromUtf8(kSeafileClientBrand);
-}
-
 static
 QList<QVariant> listFromJSON(json_t *array)
 {
@@ -670,21 +688,6 @@ QUrl urlJoin(const QUrl& head, const QString& tail)
     return QUrl(a + b);
 }
 
-void removeDirRecursively(const QString &path)
-{
-    QFileInfo file_info(path);
-    if (file_info.isDir()) {
-        QDir dir(path);
-        QStringList file_list = dir.entryList();
-        for (int i = 0; i < file_list.count(); ++i) {
-            removeDirRecursively(file_list.at(i));
-        }
-        removeDirRecursively(path);
-    } else {
-        QFile::remove(path);
-    }
-}
-
 QString dumpHexPresentation(const QByteArray &bytes)
 {
     if (bytes.size() < 2)
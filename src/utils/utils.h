@@ -11,6 +11,8 @@
 #include <QUrl>
 #include <QSslError>
 
+#include "utils/app-paths.h"
+
 class QSslCipher;
 class QSslCertificate;
 
@@ -47,8 +49,6 @@ typedef bool (*KeyValueFunc) (void *data, const char *key,
 
 bool parse_key_value_pairs (char *string, KeyValueFunc func, void *data);
 
-QString getBrand();
-
 QString translateCommitTime(qint64 timestamp);
 
 QString readableFileSize(qint64 size);
@@ -62,9 +62,10 @@ QString mapToJson(QMap<QString, QVariant> map);
 bool getSeadriveRoot(QString *seadrive_root);
 #endif
 
-QString seadriveDir();
-
-QString seadriveDataDir();
+#if defined(Q_OS_LINUX)
+// Finds where the seadrive daemon of the current user is mounted.
+bool getSeadriveMountPoint(QString *mount_point);
+#endif
 
 QString seadriveLogDir();
 
@@ -80,8 +81,6 @@ QString md5(const QString& s);
 
 QUrl urlJoin(const QUrl& url, const QString& tail);
 
-void removeDirRecursively(const QString &path);
-
 QString dumpHexPresentation(const QByteArray &bytes);
 
 QString dumpSslErrors(const QList<QSslError>&);
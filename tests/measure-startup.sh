@@ -0,0 +1,70 @@
+#!/bin/bash
+#
+# Measures the start time and the idle memory of seadrive-gui on Linux.
+#
+#   measure-startup.sh <seadrive-gui> [<runs>] [<idle secs>]
+#
+# The gui is ready when it answers a control request with the daemon
+# connected, which is polled with seadrive-gui-ctl from the same dir. After
+# <idle secs> its VmRSS is read from /proc, together with whether the web
+# engine is mapped. Run as root to drop the page cache before each run, which
+# makes it a cold start. Any running gui is quit first, so use a test account.
+
+set -e
+
+GUI=$(readlink -f "$1")
+RUNS=${2:-5}
+IDLE_SECS=${3:-30}
+
+if [ ! -x "$GUI" ]; then
+    echo "usage: $0 <seadrive-gui> [<runs>] [<idle secs>]" >&2
+    exit 1
+fi
+
+CTL=$(dirname "$GUI")/seadrive-gui-ctl
+if [ ! -x "$CTL" ]; then
+    CTL=seadrive-gui-ctl
+fi
+
+now_ms() {
+    echo $(( $(date +%s%N) / 1000000 ))
+}
+
+pkill -x seadrive-gui || true
+sleep 2
+
+for run in $(seq "$RUNS"); do
+    cold=warm
+    if [ "$(id -u)" = 0 ]; then
+        sync
+        echo 3 > /proc/sys/vm/drop_caches
+        cold=cold
+    fi
+
+    start=$(now_ms)
+    "$GUI" > /dev/null 2>&1 &
+    pid=$!
+
+    until "$CTL" status 2> /dev/null | grep -q '"daemon_connected": true'; do
+        if ! kill -0 $pid 2> /dev/null; then
+            echo "seadrive-gui exited during the start" >&2
+            exit 1
+        fi
+        sleep 0.05
+    done
+    ready=$(( $(now_ms) - start ))
+
+    sleep "$IDLE_SECS"
+    rss=$(awk '/^VmRSS/ { print $2 }' /proc/$pid/status)
+    webengine=no
+    if grep -q libQt5WebEngineCore /proc/$pid/maps; then
+        webengine=yes
+    fi
+
+    echo "run $run ($cold): ready in ${ready} ms, idle rss ${rss} kB, web engine loaded: $webengine"
+
+    kill $pid
+    wait $pid 2> /dev/null || true
+    pkill -x seadrive || true
+    sleep 2
+done
@@ -0,0 +1,174 @@
+#include <stdlib.h>
+
+#include <QtTest>
+#include <QStringList>
+
+#include "rpc/control-batch.h"
+#include "rpc/control-protocol.h"
+
+namespace {
+
+// Echoes the params of "echo", fails "fail" and counts the calls.
+class FakeCalls {
+public:
+    json_t *call(const QString& method, const json_t *params, QString *error) {
+        methods.append(method);
+        if (method == "echo") {
+            return params ? json_deep_copy(params) : json_null();
+        }
+        *error = QString("%1 failed").arg(method);
+        return nullptr;
+    }
+
+    ControlCallFunc func() {
+        return [this](const QString& method, const json_t *params, QString *error) {
+            return call(method, params, error);
+        };
+    }
+
+    QStringList methods;
+};
+
+json_t *parse(const QByteArray& response)
+{
+    json_t *root = json_loadb(response.constData(), response.size(), 0, NULL);
+    if (root) {
+        // Every response carries the version.
+        if (json_integer_value(json_object_get(root, "version")) !=
+            SEADRIVE_CONTROL_API_VERSION) {
+            json_decref(root);
+            return nullptr;
+        }
+    }
+    return root;
+}
+
+QString errorOf(const QByteArray& response)
+{
+    json_t *root = parse(response);
+    QString error = QString::fromUtf8(json_string_value(json_object_get(root, "error")));
+    json_decref(root);
+    return error;
+}
+
+} // namespace
+
+class ControlBatchTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void runsCallsInOrder();
+    void failedCallDoesNotStopBatch();
+    void emptyBatch();
+    void invalidJson();
+    void unsupportedVersion();
+    void callsNotArray();
+    void callWithoutParams();
+};
+
+void ControlBatchTest::runsCallsInOrder()
+{
+    FakeCalls calls;
+    QByteArray response = runControlBatch(
+        "{\"version\": 1, \"calls\": ["
+        "{\"method\": \"echo\", \"params\": {\"n\": 1}},"
+        "{\"method\": \"echo\", \"params\": {\"n\": 2}},"
+        "{\"method\": \"echo\", \"params\": {\"n\": 3}}]}",
+        calls.func());
+
+    QCOMPARE(calls.methods, QStringList() << "echo" << "echo" << "echo");
+    json_t *root = parse(response);
+    QVERIFY(root != nullptr);
+    json_t *results = json_object_get(root, "results");
+    QCOMPARE(json_array_size(results), (size_t)3);
+    for (size_t i = 0; i < 3; i++) {
+        json_t *r = json_array_get(results, i);
+        QVERIFY(json_is_true(json_object_get(r, "ok")));
+        QCOMPARE(json_integer_value(json_object_get(json_object_get(r, "result"), "n")),
+                 (json_int_t)(i + 1));
+    }
+    json_decref(root);
+}
+
+void ControlBatchTest::failedCallDoesNotStopBatch()
+{
+    FakeCalls calls;
+    QByteArray response = runControlBatch(
+        "{\"version\": 1, \"calls\": ["
+        "{\"method\": \"echo\", \"params\": {}},"
+        "{\"method\": \"prefetch\"},"
+        "{\"method\": \"echo\", \"params\": {}}]}",
+        calls.func());
+
+    QCOMPARE(calls.methods.size(), 3);
+    json_t *root = parse(response);
+    QVERIFY(root != nullptr);
+    json_t *results = json_object_get(root, "results");
+    QCOMPARE(json_array_size(results), (size_t)3);
+    QVERIFY(json_is_true(json_object_get(json_array_get(results, 0), "ok")));
+    json_t *failed = json_array_get(results, 1);
+    QVERIFY(json_is_false(json_object_get(failed, "ok")));
+    QCOMPARE(QString(json_string_value(json_object_get(failed, "error"))),
+             QString("prefetch failed"));
+    QVERIFY(json_object_get(failed, "result") == nullptr);
+    QVERIFY(json_is_true(json_object_get(json_array_get(results, 2), "ok")));
+    json_decref(root);
+}
+
+void ControlBatchTest::emptyBatch()
+{
+    FakeCalls calls;
+    json_t *root = parse(runControlBatch("{\"version\": 1, \"calls\": []}", calls.func()));
+    QVERIFY(root != nullptr);
+    QVERIFY(json_is_array(json_object_get(root, "results")));
+    QCOMPARE(json_array_size(json_object_get(root, "results")), (size_t)0);
+    QVERIFY(calls.methods.isEmpty());
+    json_decref(root);
+}
+
+void ControlBatchTest::invalidJson()
+{
+    FakeCalls calls;
+    QVERIFY(errorOf(runControlBatch("{\"version\": 1, \"calls\": [", calls.func()))
+                .startsWith("invalid request"));
+    QVERIFY(errorOf(runControlBatch("", calls.func())).startsWith("invalid request"));
+    QVERIFY(calls.methods.isEmpty());
+}
+
+void ControlBatchTest::unsupportedVersion()
+{
+    FakeCalls calls;
+    QByteArray newer = QString("{\"version\": %1, \"calls\": []}")
+                           .arg(SEADRIVE_CONTROL_API_VERSION + 1).toUtf8();
+    QVERIFY(errorOf(runControlBatch(newer, calls.func())).startsWith("unsupported version"));
+    QVERIFY(errorOf(runControlBatch("{\"calls\": []}", calls.func()))
+                .startsWith("unsupported version"));
+    QVERIFY(calls.methods.isEmpty());
+}
+
+void ControlBatchTest::callsNotArray()
+{
+    FakeCalls calls;
+    QCOMPARE(errorOf(runControlBatch("{\"version\": 1, \"calls\": {}}", calls.func())),
+             QString("\"calls\" must be an array"));
+    QCOMPARE(errorOf(runControlBatch("{\"version\": 1}", calls.func())),
+             QString("\"calls\" must be an array"));
+    QVERIFY(calls.methods.isEmpty());
+}
+
+void ControlBatchTest::callWithoutParams()
+{
+    FakeCalls calls;
+    json_t *root = parse(runControlBatch(
+        "{\"version\": 1, \"calls\": [{\"method\": \"echo\"}, {}]}", calls.func()));
+    QVERIFY(root != nullptr);
+    // A call without a method is still run, and fails as an unknown method.
+    QCOMPARE(calls.methods, QStringList() << "echo" << "");
+    json_t *results = json_object_get(root, "results");
+    QVERIFY(json_is_null(json_object_get(json_array_get(results, 0), "result")));
+    QVERIFY(json_is_false(json_object_get(json_array_get(results, 1), "ok")));
+    json_decref(root);
+}
+
+QTEST_GUILESS_MAIN(ControlBatchTest)
+#include "test-control-batch.moc"
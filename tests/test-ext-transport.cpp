@@ -0,0 +1,202 @@
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <memory>
+#include <thread>
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "ext-transport.h"
+
+// Only used by ExtListener::create(), which isn't tested here.
+QString seadriveDataDir()
+{
+    return QDir::tempPath();
+}
+
+namespace {
+
+// The framing used by the extensions and ext-handler.
+bool writeMessage(ExtConnection *conn, const QByteArray& body)
+{
+    uint32_t len = body.size();
+    return conn->writeN(&len, sizeof(len)) && conn->writeN(body.constData(), len);
+}
+
+bool readMessage(ExtConnection *conn, QByteArray *body)
+{
+    uint32_t len;
+    if (!conn->readN(&len, sizeof(len))) {
+        return false;
+    }
+    body->resize(len);
+    return conn->readN(body->data(), len);
+}
+
+} // namespace
+
+class ExtTransportTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void readWrite();
+    void largeMessage();
+    void peerClosed();
+    void writeToClosedPeer();
+    void shutdownUnblocksRead();
+    void listener();
+    void listenerPathTooLong();
+
+private:
+    std::unique_ptr<ExtConnection> a_;
+    std::unique_ptr<ExtConnection> b_;
+};
+
+void ExtTransportTest::init()
+{
+    int fds[2];
+    QCOMPARE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    a_.reset(createExtSocketConnection(fds[0]));
+    b_.reset(createExtSocketConnection(fds[1]));
+}
+
+void ExtTransportTest::cleanup()
+{
+    a_.reset();
+    b_.reset();
+}
+
+void ExtTransportTest::readWrite()
+{
+    QByteArray body;
+    QVERIFY(writeMessage(a_.get(), "7\tget-file-status\t/seadrive/a.txt"));
+    QVERIFY(writeMessage(a_.get(), ""));
+    QVERIFY(readMessage(b_.get(), &body));
+    QCOMPARE(body, QByteArray("7\tget-file-status\t/seadrive/a.txt"));
+    QVERIFY(readMessage(b_.get(), &body));
+    QVERIFY(body.isEmpty());
+
+    QVERIFY(writeMessage(b_.get(), "7\tsynced"));
+    QVERIFY(readMessage(a_.get(), &body));
+    QCOMPARE(body, QByteArray("7\tsynced"));
+}
+
+// Much larger than the socket buffer, so it takes many partial writes and
+// reads, like a get-dir-status response of a big folder.
+void ExtTransportTest::largeMessage()
+{
+    QByteArray sent(8 << 20, 'x');
+    for (int i = 0; i < sent.size(); i += 4096) {
+        sent[i] = (char)(i / 4096);
+    }
+
+    bool written = false;
+    std::thread writer([&] { written = writeMessage(a_.get(), sent); });
+    QByteArray received;
+    bool read = readMessage(b_.get(), &received);
+    writer.join();
+
+    QVERIFY(written);
+    QVERIFY(read);
+    QVERIFY(received == sent);
+}
+
+void ExtTransportTest::peerClosed()
+{
+    QVERIFY(writeMessage(b_.get(), "last"));
+    b_.reset();
+
+    // What was written before the close is still delivered.
+    QByteArray body;
+    QVERIFY(readMessage(a_.get(), &body));
+    QCOMPARE(body, QByteArray("last"));
+    QVERIFY(!readMessage(a_.get(), &body));
+    QCOMPARE(a_->errorString(), QString("connection closed"));
+}
+
+// Must fail instead of killing the gui with SIGPIPE.
+void ExtTransportTest::writeToClosedPeer()
+{
+    b_.reset();
+    QByteArray body(64 << 10, 'x');
+    bool ok = true;
+    for (int i = 0; i < 100 && ok; i++) {
+        ok = writeMessage(a_.get(), body);
+    }
+    QVERIFY(!ok);
+    QCOMPARE(a_->errorString(), QString::fromLocal8Bit(strerror(EPIPE)));
+}
+
+void ExtTransportTest::shutdownUnblocksRead()
+{
+    bool read = true;
+    std::thread reader([&] {
+        QByteArray body;
+        read = readMessage(a_.get(), &body);
+    });
+    // Give the reader time to block, the test passes either way.
+    QThread::msleep(50);
+    a_->shutdown();
+    reader.join();
+
+    QVERIFY(!read);
+    QVERIFY(!writeMessage(a_.get(), "after shutdown"));
+    // The extension sees the connection closed.
+    QByteArray body;
+    QVERIFY(!readMessage(b_.get(), &body));
+}
+
+void ExtTransportTest::listener()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString path = QDir(dir.path()).filePath("seadrive_ext.sock");
+    QByteArray native_path = QFile::encodeName(path);
+
+    std::unique_ptr<ExtListener> listener(createExtSocketListener(path));
+    QVERIFY(listener != nullptr);
+
+    // Only accessible by the current user.
+    struct stat st;
+    QCOMPARE(::stat(native_path.constData(), &st), 0);
+    QVERIFY(S_ISSOCK(st.st_mode));
+    QCOMPARE((int)(st.st_mode & 0777), (int)(S_IRUSR | S_IWUSR));
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    QVERIFY(fd >= 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, native_path.constData(), native_path.size());
+    QCOMPARE(::connect(fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    std::unique_ptr<ExtConnection> client(createExtSocketConnection(fd));
+
+    std::unique_ptr<ExtConnection> server(listener->accept());
+    QVERIFY(server != nullptr);
+    QByteArray body;
+    QVERIFY(writeMessage(client.get(), "hello\t2"));
+    QVERIFY(readMessage(server.get(), &body));
+    QCOMPARE(body, QByteArray("hello\t2"));
+
+    listener.reset();
+    QVERIFY(!QFile::exists(path));
+}
+
+void ExtTransportTest::listenerPathTooLong()
+{
+    QString path = QDir::tempPath() + "/" + QString(200, 'x') + "/seadrive_ext.sock";
+    std::unique_ptr<ExtListener> listener(createExtSocketListener(path));
+    QVERIFY(listener == nullptr);
+}
+
+QTEST_GUILESS_MAIN(ExtTransportTest)
+#include "test-ext-transport.moc"
@@ -0,0 +1,132 @@
+#include <glib.h>
+#include <jansson.h>
+#include <searpc.h>
+#include <searpc-client.h>
+#include <searpc-server.h>
+#include <searpc-named-pipe-transport.h>
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "rpc/searpc-signature.h"
+#include "rpc/searpc-marshal.h"
+#include "rpc/control-batch.h"
+#include "rpc/control-protocol.h"
+
+namespace {
+
+// Echoes the params of "echo" and fails the other methods.
+json_t *fakeCall(const QString& method, const json_t *params, QString *error)
+{
+    if (method == "echo") {
+        return params ? json_deep_copy(params) : json_null();
+    }
+    *error = QString("%1 failed").arg(method);
+    return nullptr;
+}
+
+// Registered like the control function of rpc-server.cpp, which hands the
+// request to the control api in the main thread.
+char *handleControl(const char *request, GError **error)
+{
+    QByteArray response = runControlBatch(request, fakeCall);
+    return g_strdup(response.constData());
+}
+
+// Sends the request like seadrive-gui-ctl does.
+json_t *call(SearpcClient *client, const char *request)
+{
+    GError *error = NULL;
+    char *response = searpc_client_call__string(
+        client, SEADRIVE_CONTROL_RPC_FUNCTION, &error, 1, "string", request);
+    if (error) {
+        qWarning("control request failed: %s", error->message);
+        g_error_free(error);
+        return nullptr;
+    }
+    json_t *root = json_loads(response ? response : "", 0, NULL);
+    g_free(response);
+    return root;
+}
+
+} // namespace
+
+class RpcServerTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void batchThroughSocket();
+    void unreachableSocket();
+};
+
+void RpcServerTest::initTestCase()
+{
+    searpc_server_init((RegisterMarshalFunc)register_marshals);
+    searpc_create_service(SEADRIVE_CONTROL_RPC_SERVICE);
+    searpc_server_register_function(SEADRIVE_CONTROL_RPC_SERVICE,
+                                    (void *)handleControl,
+                                    SEADRIVE_CONTROL_RPC_FUNCTION,
+                                    searpc_signature_string__string());
+}
+
+void RpcServerTest::batchThroughSocket()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QByteArray path = QFile::encodeName(QDir(dir.path()).filePath("seadrive_client.sock"));
+
+    SearpcNamedPipeServer *server = searpc_create_named_pipe_server(path.constData());
+    QCOMPARE(searpc_named_pipe_server_start(server), 0);
+
+    SearpcNamedPipeClient *pipe_client = searpc_create_named_pipe_client(path.constData());
+    QCOMPARE(searpc_named_pipe_client_connect(pipe_client), 0);
+    SearpcClient *client = searpc_client_with_named_pipe_transport(
+        pipe_client, SEADRIVE_CONTROL_RPC_SERVICE);
+
+    json_t *root = call(client,
+                        "{\"version\": 1, \"calls\": ["
+                        "{\"method\": \"echo\", \"params\": {\"n\": 1}},"
+                        "{\"method\": \"prefetch\"},"
+                        "{\"method\": \"echo\", \"params\": {\"n\": 3}}]}");
+    QVERIFY(root != nullptr);
+    QCOMPARE(json_integer_value(json_object_get(root, "version")),
+             (json_int_t)SEADRIVE_CONTROL_API_VERSION);
+    json_t *results = json_object_get(root, "results");
+    QCOMPARE(json_array_size(results), (size_t)3);
+    json_t *first = json_array_get(results, 0);
+    QVERIFY(json_is_true(json_object_get(first, "ok")));
+    QCOMPARE(json_integer_value(json_object_get(json_object_get(first, "result"), "n")),
+             (json_int_t)1);
+    json_t *failed = json_array_get(results, 1);
+    QVERIFY(json_is_false(json_object_get(failed, "ok")));
+    QCOMPARE(QString(json_string_value(json_object_get(failed, "error"))),
+             QString("prefetch failed"));
+    QVERIFY(json_is_true(json_object_get(json_array_get(results, 2), "ok")));
+    json_decref(root);
+
+    // The connection serves the following requests too.
+    root = call(client, "{\"version\": 1, \"calls\": []}");
+    QVERIFY(root != nullptr);
+    QCOMPARE(json_array_size(json_object_get(root, "results")), (size_t)0);
+    json_decref(root);
+
+    searpc_free_client_with_pipe_transport(client);
+}
+
+void RpcServerTest::unreachableSocket()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QByteArray path = QFile::encodeName(QDir(dir.path()).filePath("missing.sock"));
+
+    // seadrive-gui-ctl exits with "unreachable" then.
+    SearpcNamedPipeClient *pipe_client = searpc_create_named_pipe_client(path.constData());
+    QVERIFY(searpc_named_pipe_client_connect(pipe_client) < 0);
+    SearpcClient *client = searpc_client_with_named_pipe_transport(
+        pipe_client, SEADRIVE_CONTROL_RPC_SERVICE);
+    searpc_free_client_with_pipe_transport(client);
+}
+
+QTEST_GUILESS_MAIN(RpcServerTest)
+#include "test-rpc-server.moc"
@@ -0,0 +1,116 @@
+#include <QtTest>
+#include <QtWidgets>
+
+#include "ui_settings-dialog.h"
+#include "ui_login-dialog.h"
+#include "ui_about-dialog.h"
+#include "ui_init-sync-dialog.h"
+
+namespace {
+
+// The merged stylesheet that refreshQss() applies, see seadrive-style.qrc.
+QString loadStyle()
+{
+    QFile file(SEADRIVE_STYLE_FILE);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return QString();
+    }
+    return QTextStream(&file).readAll();
+}
+
+template <typename Ui>
+QDialog *createDialog()
+{
+    QDialog *dialog = new QDialog;
+    Ui ui;
+    ui.setupUi(dialog);
+    return dialog;
+}
+
+QDialog *createDialog(const QString& name)
+{
+    if (name == "settings") {
+        return createDialog<Ui::SettingsDialog>();
+    } else if (name == "login") {
+        return createDialog<Ui::LoginDialog>();
+    } else if (name == "about") {
+        return createDialog<Ui::AboutDialog>();
+    }
+    return createDialog<Ui::InitSyncDialog>();
+}
+
+void polish(QWidget *widget)
+{
+    widget->ensurePolished();
+    for (QWidget *child : widget->findChildren<QWidget *>()) {
+        child->ensurePolished();
+    }
+}
+
+} // namespace
+
+// Times applying the stylesheet with the main dialogs open, and polishing
+// each of them, like showing it the first time.
+class StylePolishTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void setStyleSheet();
+    void polishDialog_data();
+    void polishDialog();
+
+private:
+    QString style_;
+    QList<QDialog *> dialogs_;
+};
+
+void StylePolishTest::initTestCase()
+{
+    style_ = loadStyle();
+    QVERIFY(!style_.isEmpty());
+
+    for (const QString& name : { "settings", "login", "about", "init-sync" }) {
+        QDialog *dialog = createDialog(name);
+        polish(dialog);
+        dialogs_.append(dialog);
+    }
+}
+
+void StylePolishTest::cleanupTestCase()
+{
+    qDeleteAll(dialogs_);
+    qApp->setStyleSheet(QString());
+}
+
+void StylePolishTest::setStyleSheet()
+{
+    // Qt repolishes every widget even when the sheet is the same one.
+    QBENCHMARK {
+        qApp->setStyleSheet(style_);
+    }
+}
+
+void StylePolishTest::polishDialog_data()
+{
+    QTest::addColumn<QString>("name");
+    QTest::newRow("settings") << "settings";
+    QTest::newRow("login") << "login";
+    QTest::newRow("about") << "about";
+    QTest::newRow("init-sync") << "init-sync";
+}
+
+void StylePolishTest::polishDialog()
+{
+    QFETCH(QString, name);
+    qApp->setStyleSheet(style_);
+
+    QBENCHMARK {
+        QScopedPointer<QDialog> dialog(createDialog(name));
+        polish(dialog.data());
+    }
+}
+
+QTEST_MAIN(StylePolishTest)
+#include "test-style-polish.moc"